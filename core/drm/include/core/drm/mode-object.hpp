@@ -1,6 +1,10 @@
 #pragma once
 
+#include <span>
+#include <vector>
+
 #include <core/id-allocator.hpp>
+#include <libdrm/drm.h>
 #include <libdrm/drm_fourcc.h>
 
 #include "fwd-decls.hpp"
@@ -224,6 +228,31 @@ private:
 	std::shared_ptr<ConnectorState> _drmState;
 };
 
+/**
+ * Accumulates the damaged regions of a framebuffer until the driver flushes them.
+ * Rectangles are clipped to the framebuffer; overlapping or adjacent rectangles are
+ * merged such that drivers never transfer the same pixels twice.
+ */
+struct Damage {
+	// Beyond this number of rectangles, all damage is collapsed into the bounding box.
+	static constexpr size_t maxRects = 16;
+
+	// Adds clips to the damaged region. An empty span damages the entire framebuffer.
+	void add(std::span<const drm_clip_rect> clips, uint32_t width, uint32_t height);
+
+	bool empty() {
+		return _rects.empty();
+	}
+
+	// Returns the damaged rectangles and resets the damaged region.
+	std::vector<drm_clip_rect> take();
+
+private:
+	void _addRect(drm_clip_rect rect);
+
+	std::vector<drm_clip_rect> _rects;
+};
+
 /**
  * Holds all info relating to a framebuffer, such as size and pixel format.
  */
@@ -240,7 +269,9 @@ public:
 	uint32_t format();
 	void setFormat(uint32_t format);
 
-	virtual void notifyDirty() = 0;
+	// Called on DRM_IOCTL_MODE_DIRTYFB. Clips are in framebuffer coordinates
+	// and are not clipped yet; an empty span means that the entire framebuffer changed.
+	virtual void notifyDirty(std::span<const drm_clip_rect> clips) = 0;
 	virtual uint32_t getWidth() = 0;
 	virtual uint32_t getHeight() = 0;
 };
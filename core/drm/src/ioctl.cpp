@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <libdrm/drm_fourcc.h>
 
 #include <bragi/helpers-std.hpp>
@@ -647,7 +648,17 @@ drm_core::File::ioctl(void *object, uint32_t id, helix_ng::RecvInlineResult msg,
 			} else {
 				auto fb = obj->asFrameBuffer();
 				assert(fb);
-				fb->notifyDirty();
+
+				// drm_clip_rect uses unsigned shorts; clamp the coordinates to that range.
+				auto clamp = [] (int32_t v) -> unsigned short {
+					return std::clamp(v, int32_t{0}, int32_t{0xFFFF});
+				};
+				std::vector<drm_clip_rect> clips;
+				clips.reserve(req->drm_clips().size());
+				for(auto &rect : req->drm_clips())
+					clips.push_back(drm_clip_rect{clamp(rect.x1()), clamp(rect.y1()),
+							clamp(rect.x2()), clamp(rect.y2())});
+				fb->notifyDirty(clips);
 			}
 
 			auto [send_resp] = co_await helix_ng::exchangeMsgs(conversation,
@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <utility>
 #include <sys/epoll.h>
 
 #include <helix/memory.hpp>
@@ -173,6 +175,76 @@ std::weak_ptr<drm_core::Crtc> drm_core::CrtcState::crtc(void) {
 	return _crtc;
 }
 
+// ----------------------------------------------------------------
+// Damage
+// ----------------------------------------------------------------
+
+namespace {
+	// Returns true if the rectangles overlap or touch.
+	bool canMergeRects(const drm_clip_rect &a, const drm_clip_rect &b) {
+		return a.x1 <= b.x2 && b.x1 <= a.x2 && a.y1 <= b.y2 && b.y1 <= a.y2;
+	}
+
+	drm_clip_rect unionRects(const drm_clip_rect &a, const drm_clip_rect &b) {
+		return drm_clip_rect{
+			std::min(a.x1, b.x1), std::min(a.y1, b.y1),
+			std::max(a.x2, b.x2), std::max(a.y2, b.y2)
+		};
+	}
+}
+
+void drm_core::Damage::add(std::span<const drm_clip_rect> clips,
+		uint32_t width, uint32_t height) {
+	auto maxX = static_cast<unsigned short>(std::min(width, uint32_t{0xFFFF}));
+	auto maxY = static_cast<unsigned short>(std::min(height, uint32_t{0xFFFF}));
+	if(!maxX || !maxY)
+		return;
+
+	if(clips.empty()) {
+		_rects.clear();
+		_rects.push_back(drm_clip_rect{0, 0, maxX, maxY});
+		return;
+	}
+
+	for(auto clip : clips) {
+		clip.x2 = std::min(clip.x2, maxX);
+		clip.y2 = std::min(clip.y2, maxY);
+		if(clip.x1 >= clip.x2 || clip.y1 >= clip.y2)
+			continue;
+		_addRect(clip);
+	}
+}
+
+std::vector<drm_clip_rect> drm_core::Damage::take() {
+	return std::exchange(_rects, {});
+}
+
+void drm_core::Damage::_addRect(drm_clip_rect rect) {
+	// Merging can make the rectangle overlap others, hence we repeat until nothing changes.
+	bool merged;
+	do {
+		merged = false;
+		for(auto it = _rects.begin(); it != _rects.end(); ++it) {
+			if(!canMergeRects(*it, rect))
+				continue;
+			rect = unionRects(*it, rect);
+			_rects.erase(it);
+			merged = true;
+			break;
+		}
+	} while(merged);
+
+	if(_rects.size() < maxRects) {
+		_rects.push_back(rect);
+		return;
+	}
+
+	for(auto &other : _rects)
+		rect = unionRects(other, rect);
+	_rects.clear();
+	_rects.push_back(rect);
+}
+
 // ----------------------------------------------------------------
 // FrameBuffer
 // ----------------------------------------------------------------
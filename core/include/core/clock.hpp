@@ -6,9 +6,14 @@
 namespace clk {
 
 helix::BorrowedDescriptor trackerPageMemory();
+// Read-only kernel page that exports the monotone clock (see helGetClockPage()).
+helix::BorrowedDescriptor clockPageMemory();
 
 async::result<void> enumerateTracker();
 
+// Like helGetClock() but avoids the syscall if the kernel exports the clock.
+uint64_t getClockNanos();
+
 int64_t getRealtimeNanos();
 
 struct timespec getRealtime();
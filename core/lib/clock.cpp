@@ -12,6 +12,34 @@ namespace clk {
 
 namespace {
 
+struct ClockPage {
+	ClockPage() {
+		HelHandle handle;
+		HEL_CHECK(helGetClockPage(&handle));
+		memory = helix::UniqueDescriptor{handle};
+		mapping = helix::Mapping{memory, 0, 0x1000, kHelMapProtRead};
+	}
+
+	helix::UniqueDescriptor memory;
+	helix::Mapping mapping;
+};
+
+ClockPage &accessClockPage() {
+	static ClockPage page;
+	return page;
+}
+
+uint64_t readCounter() {
+#if defined(__x86_64__)
+	uint32_t lsw, msw;
+	asm volatile ("lfence; rdtsc" : "=a"(lsw), "=d"(msw));
+	return (static_cast<uint64_t>(msw) << 32) | static_cast<uint64_t>(lsw);
+#else
+	// The kernel does not export the counter on other architectures.
+	__builtin_trap();
+#endif
+}
+
 helix::UniqueLane trackerLane;
 helix::UniqueDescriptor globalTrackerPageMemory;
 helix::Mapping trackerPageMapping;
@@ -48,6 +76,36 @@ helix::BorrowedDescriptor trackerPageMemory() {
 	return globalTrackerPageMemory;
 }
 
+helix::BorrowedDescriptor clockPageMemory() {
+	return accessClockPage().memory;
+}
+
+uint64_t getClockNanos() {
+	auto page = reinterpret_cast<const HelClockPage *>(accessClockPage().mapping.get());
+
+	while(true) {
+		auto seqlock = __atomic_load_n(&page->seqlock, __ATOMIC_ACQUIRE);
+		if(seqlock & 1)
+			continue;
+
+		auto mode = __atomic_load_n(&page->mode, __ATOMIC_RELAXED);
+		auto factor = __atomic_load_n(&page->factor, __ATOMIC_RELAXED);
+		auto shift = __atomic_load_n(&page->shift, __ATOMIC_RELAXED);
+
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		if(__atomic_load_n(&page->seqlock, __ATOMIC_RELAXED) != seqlock)
+			continue;
+
+		if(mode != kHelClockPageCounter)
+			break;
+		return (static_cast<__uint128_t>(factor) * readCounter()) >> shift;
+	}
+
+	uint64_t now;
+	HEL_CHECK(helGetClock(&now));
+	return now;
+}
+
 async::result<void> enumerateTracker() {
 	auto filter = mbus_ng::Conjunction{{
 		mbus_ng::EqualsFilter{"class", "clocktracker"}
@@ -65,23 +123,25 @@ async::result<void> enumerateTracker() {
 int64_t getRealtimeNanos() {
 	auto page = reinterpret_cast<TrackerPage *>(trackerPageMapping.get());
 
-	// Start the seqlock read.
-	auto seqlock = __atomic_load_n(&page->seqlock, __ATOMIC_ACQUIRE);
-	assert(!(seqlock & 1));
+	int64_t ref, base;
+	while(true) {
+		// Start the seqlock read. The clocktracker holds the lock while it updates the page.
+		auto seqlock = __atomic_load_n(&page->seqlock, __ATOMIC_ACQUIRE);
+		if(seqlock & 1)
+			continue;
 
-	// Perform the actual loads.
-	auto ref = __atomic_load_n(&page->refClock, __ATOMIC_RELAXED);
-	auto base = __atomic_load_n(&page->baseRealtime, __ATOMIC_RELAXED);
+		// Perform the actual loads.
+		ref = __atomic_load_n(&page->refClock, __ATOMIC_RELAXED);
+		base = __atomic_load_n(&page->baseRealtime, __ATOMIC_RELAXED);
 
-	// Finish the seqlock read.
-	__atomic_thread_fence(__ATOMIC_ACQUIRE);
-	assert(__atomic_load_n(&page->seqlock, __ATOMIC_RELAXED) == seqlock);
+		// Finish the seqlock read.
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		if(__atomic_load_n(&page->seqlock, __ATOMIC_RELAXED) == seqlock)
+			break;
+	}
 
 	// Calculate the current time.
-	uint64_t now;
-	HEL_CHECK(helGetClock(&now));
-
-	return base + (now - ref);
+	return base + (getClockNanos() - ref);
 }
 
 struct timespec getRealtime() {
@@ -93,8 +153,7 @@ struct timespec getRealtime() {
 }
 
 struct timespec getTimeSinceBoot() {
-	uint64_t now;
-	HEL_CHECK(helGetClock(&now));
+	auto now = getClockNanos();
 
 	struct timespec result;
 	result.tv_sec = now / 1'000'000'000;
@@ -81,7 +81,7 @@ struct LegacyPciTransport : Transport {
 	friend struct LegacyPciQueue;
 
 	LegacyPciTransport(protocols::hw::Device hw_device,
-			arch::io_space legacy_space, helix::UniqueDescriptor irq);
+			uint16_t legacy_port, arch::io_space legacy_space, helix::UniqueDescriptor irq);
 
 	protocols::hw::Device &hwDevice() override {
 		return _hwDevice;
@@ -104,6 +104,7 @@ private:
 	async::detached _processIrqs();
 
 	protocols::hw::Device _hwDevice;
+	uint16_t _legacyPort;
 	arch::io_space _legacySpace;
 	helix::UniqueDescriptor _irq;
 
@@ -123,8 +124,8 @@ private:
 };
 
 LegacyPciTransport::LegacyPciTransport(protocols::hw::Device hw_device,
-		arch::io_space legacy_space, helix::UniqueDescriptor irq)
-: _hwDevice{std::move(hw_device)}, _legacySpace{legacy_space},
+		uint16_t legacy_port, arch::io_space legacy_space, helix::UniqueDescriptor irq)
+: _hwDevice{std::move(hw_device)}, _legacyPort{legacy_port}, _legacySpace{legacy_space},
 		_irq{std::move(irq)} { }
 
 uint8_t LegacyPciTransport::loadConfig8(size_t offset) {
@@ -218,6 +219,73 @@ void LegacyPciTransport::runDevice() {
 }
 
 async::detached LegacyPciTransport::_processIrqs() {
+#ifdef __x86_64__
+	co_await connectKernletCompiler();
+
+	// Legacy devices share their (level-triggered) IRQ line with other devices.
+	// Reading the ISR deasserts the IRQ, hence the kernlet passes the bits on.
+	std::vector<uint8_t> kernlet_program;
+	fnr::emit_to(std::back_inserter(kernlet_program),
+		// Load the ISR status register.
+		fnr::scope_push{} (
+			fnr::intrin{"__pio_read8", 1, 1} (
+				fnr::binding{0} // Legacy PIO offset (bound to slot 0).
+					 + fnr::literal{PCI_L_ISR_STATUS.offset()} // Offset of the ISR status.
+			) & fnr::literal{3} // Progress and configuration change bits.
+		),
+		// Ack the IRQ iff one of the bits was set.
+		fnr::check_if{},
+			fnr::scope_get{0},
+		fnr::then{},
+			// Trigger the bitset event (bound to slot 1).
+			fnr::intrin{"__trigger_bitset", 2, 0} (
+				fnr::binding{1},
+				fnr::scope_get{0}
+			),
+			fnr::scope_push{} ( fnr::literal{1} ),
+		fnr::else_then{},
+			fnr::scope_push{} ( fnr::literal{2} ),
+		fnr::end{}
+	);
+
+	auto kernlet_object = co_await compile(kernlet_program.data(),
+			kernlet_program.size(), {BindType::offset, BindType::bitsetEvent});
+
+	HelHandle event_handle;
+	HEL_CHECK(helCreateBitsetEvent(&event_handle));
+	helix::UniqueDescriptor event{event_handle};
+
+	HelKernletData data[2];
+	data[0].handle = _legacyPort;
+	data[1].handle = event.getHandle();
+	HelHandle bound_handle;
+	HEL_CHECK(helBindKernlet(kernlet_object.getHandle(), data, 2, &bound_handle));
+	HEL_CHECK(helAutomateIrq(_irq.getHandle(), 0, bound_handle));
+
+	co_await _hwDevice.enableBusIrq();
+
+	// Clear the IRQ in case it was pending while we attached the kernlet.
+	HEL_CHECK(helAcknowledgeIrq(_irq.getHandle(), kHelAckKick | kHelAckClear, 0));
+
+	uint64_t sequence = 0;
+	while(true) {
+		auto await = co_await helix_ng::awaitEvent(event, sequence);
+		HEL_CHECK(await.error());
+		sequence = await.sequence();
+
+		assert(!(await.bitset() & ~3U));
+
+		if(await.bitset() & 2) {
+			std::cout << "core-virtio: Configuration change" << std::endl;
+			auto status = _legacySpace.load(PCI_L_DEVICE_STATUS);
+			assert(!(status & DEVICE_NEEDS_RESET));
+		}
+
+		if(await.bitset() & 1)
+			for(auto &queue : _queues)
+				queue->processInterrupt();
+	}
+#else
 	co_await _hwDevice.enableBusIrq();
 
 	// TODO: The kick here should not be required.
@@ -247,6 +315,7 @@ async::detached LegacyPciTransport::_processIrqs() {
 			for(auto &queue : _queues)
 				queue->processInterrupt();
 	}
+#endif
 }
 
 LegacyPciQueue::LegacyPciQueue(LegacyPciTransport *transport,
@@ -706,7 +775,7 @@ discover(protocols::hw::Device hw_device, DiscoverMode mode) {
 
 			std::cout << "virtio: Using legacy PCI transport" << std::endl;
 			co_return std::make_unique<LegacyPciTransport>(std::move(hw_device),
-					legacy_space, std::move(irq));
+					static_cast<uint16_t>(info.barInfo[0].address), legacy_space, std::move(irq));
 		}
 #else
 		throw std::runtime_error("Legacy transports are unsupported on this architecture");
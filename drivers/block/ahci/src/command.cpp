@@ -11,8 +11,8 @@ Command::Command(uint64_t sector, size_t numSectors, size_t numBytes, void *buff
 		CommandType type) : sector_{sector}, numSectors_{numSectors}, numBytes_{numBytes},
 	buffer_{buffer}, type_{type}, event_{} {
 
-	// TODO: Requests larger than 64k need to be split
-	assert(numBytes < 65536);
+	// Larger requests are split by Port::transferSectors().
+	assert(numBytes <= limits::maxCmdBytes);
 
 	if (logCommands) {
 		printf("block/ahci: queueing %zu byte %s to %p at sector %" PRIu64 "\n",
@@ -29,7 +29,7 @@ void Command::notifyCompletion() {
 	event_.raise();
 }
 
-void Command::prepare(commandTable& table, commandHeader& header) {
+void Command::prepare(commandTable& table, commandHeader& header, std::optional<size_t> ncqTag) {
 	auto tablePhys = helix::ptrToPhysical(&table);
 	assert((tablePhys & 0x7F) == 0 && tablePhys < std::numeric_limits<uint32_t>::max());
 	assert(numSectors_ < std::numeric_limits<uint16_t>::max());
@@ -72,6 +72,21 @@ void Command::prepare(commandTable& table, commandHeader& header) {
 			assert(!"unknown command type");
 	}
 
+	if (ncqTag) {
+		assert(type_ != CommandType::identify);
+		assert(*ncqTag < limits::maxCmdSlots);
+
+		// For FPDMA QUEUED commands, the sector count is passed in the features
+		// registers and the count register holds the tag.
+		if (type_ == CommandType::read)
+			table.commandFis.command = 0x60; // READ FPDMA QUEUED
+		else
+			table.commandFis.command = 0x61; // WRITE FPDMA QUEUED
+		table.commandFis.features = numSectors_ & 0xFF;
+		table.commandFis.featuresUpper = (numSectors_ >> 8) & 0xFF;
+		table.commandFis.sectorCount = static_cast<uint16_t>(*ncqTag << 3);
+	}
+
 	if (logCommands) {
 		printf("block/ahci: submitting %zu byte %s to %p at sector %" PRIu64 "\n",
 				numBytes_, cmdTypeToString(type_), buffer_, sector_);
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <optional>
+
 #include <async/oneshot-event.hpp>
 
 #include "spec.hpp"
@@ -22,7 +24,8 @@ public:
 		assert(type == CommandType::identify);
 	}
 
-	void prepare(commandTable& table, commandHeader& header);
+	// If ncqTag is given, the command is issued as a READ/WRITE FPDMA QUEUED.
+	void prepare(commandTable& table, commandHeader& header, std::optional<size_t> ncqTag = std::nullopt);
 	void notifyCompletion(); 
 
 	auto getFuture() {
@@ -12,6 +12,8 @@ namespace regs {
 	constexpr arch::scalar_register<uint32_t> interruptStatus{0x8};
 	constexpr arch::scalar_register<uint32_t> portsImpl{0xC};
 	constexpr arch::scalar_register<uint32_t> version{0x10};
+	constexpr arch::scalar_register<uint32_t> cccControl{0x14};
+	constexpr arch::scalar_register<uint32_t> cccPorts{0x18};
 	constexpr arch::scalar_register<uint32_t> cap2{0x24};
 	constexpr arch::scalar_register<uint32_t> biosHandoff{0x28};
 }
@@ -32,7 +34,13 @@ namespace flags {
 
 	namespace cap {
 		constexpr int supports64Bit   = 1 << 31;
+		constexpr int supportsNcq     = 1 << 30;
 		constexpr int staggeredSpinup = 1 << 27;
+		constexpr int supportsCcc     = 1 << 7;
+	}
+
+	namespace ccc {
+		constexpr int enable = 1;
 	}
 
 	namespace cap2 {
@@ -40,9 +48,18 @@ namespace flags {
 	}
 }
 
+namespace {
+	// Command completion coalescing: raise an interrupt after this many completions
+	// or after the timeout (in ms) expires, whichever comes first.
+	constexpr bool useCoalescing = true;
+	constexpr uint32_t cccCompletions = 8;
+	constexpr uint32_t cccTimeout = 1;
+}
+
 Controller::Controller(int64_t parentId, protocols::hw::Device hwDevice, helix::Mapping hbaRegs, helix::UniqueDescriptor irq, bool useMsis)
 	: hwDevice_{std::move(hwDevice)} ,regsMapping_{std::move(hbaRegs)},
-	regs_{regsMapping_.get()}, irq_{std::move(irq)}, parentId_{parentId}, useMsis_{useMsis}
+	regs_{regsMapping_.get()}, irq_{std::move(irq)}, parentId_{parentId}, cccInterrupts_{0},
+	useMsis_{useMsis}
 {
 }
 
@@ -103,17 +120,37 @@ async::detached Controller::run() {
 	bool revertSingleMessage = regs_.load(regs::ghc) & flags::ghc::revertSingleMessage;
 	bool s64a = cap & flags::cap::supports64Bit;
 	assert(s64a); // TODO: We aren't allowed to read some fields if no 64-bit support
+	bool sncq = cap & flags::cap::supportsNcq;
+	bool cccs = cap & flags::cap::supportsCcc;
 
 	printf("block/ahci: Initialised controller: version %x, %d active ports, "
-			"%d slots, Gen %d, SS %s, 64-bit %s, MSI %s%s\n", version, std::popcount(portsImpl_),
-			numCommandSlots, iss, ss ? "yes" : "no", s64a ? "yes" : "no", useMsis_ ? "yes" : "no",
-			revertSingleMessage ? "/reverted to single" : "");
+			"%d slots, Gen %d, SS %s, 64-bit %s, NCQ %s, CCC %s, MSI %s%s\n", version,
+			std::popcount(portsImpl_), numCommandSlots, iss, ss ? "yes" : "no",
+			s64a ? "yes" : "no", sncq ? "yes" : "no", cccs ? "yes" : "no",
+			useMsis_ ? "yes" : "no", revertSingleMessage ? "/reverted to single" : "");
 
-	if (!(co_await initPorts_(numCommandSlots, ss))) {
+	bool coalesce = useCoalescing && cccs;
+	if (!(co_await initPorts_(numCommandSlots, ss, sncq, coalesce))) {
 		std::cout << "\e[31mblock/ahci: No ports found, exiting\e[39m\n";
 		co_return;
 	}
 
+	if (coalesce) {
+		// Configure CCC for all active ports (AHCI spec 11). CC and TV may only be
+		// changed while CCC is disabled.
+		uint32_t cccPorts = 0;
+		for (auto &port : activePorts_)
+			cccPorts |= 1u << port->getIndex();
+		regs_.store(regs::cccControl, 0);
+		regs_.store(regs::cccPorts, cccPorts);
+		regs_.store(regs::cccControl, (cccTimeout << 16) | (cccCompletions << 8));
+		auto cccControl = regs_.load(regs::cccControl);
+		regs_.store(regs::cccControl, cccControl | flags::ccc::enable);
+
+		// The HBA reports the CCC interrupt in IS at the bit given by CCC_CTL.INT.
+		cccInterrupts_ = 1u << ((cccControl >> 3) & 0x1F);
+	}
+
 	// Enable interrupts
 	co_await hwDevice_.enableBusIrq();
 	ghc = regs_.load(regs::ghc);
@@ -138,6 +175,7 @@ void Controller::dumpState_() {
 	printf("  PI: %#x\n", regs_.load(regs::portsImpl));
 	printf("  VS: %#x\n", regs_.load(regs::version));
 	printf("  BOHC: %#x\n", regs_.load(regs::biosHandoff));
+	printf("  CCC_CTL: %#x\n", regs_.load(regs::cccControl));
 }
 
 async::detached Controller::handleIrqs_() {
@@ -158,10 +196,12 @@ async::detached Controller::handleIrqs_() {
 				irqSequence_, regs_.load(regs::interruptStatus));
 		}
 
-		auto intStatus = regs_.load(regs::interruptStatus) & portsImpl_;
+		auto intStatus = regs_.load(regs::interruptStatus) & (portsImpl_ | cccInterrupts_);
 		if (intStatus) {
+			// On a CCC interrupt, reap completions from all ports.
+			bool coalesced = intStatus & cccInterrupts_;
 			for (auto &port : activePorts_) {
-				if (intStatus & (1 << port->getIndex())) {
+				if (coalesced || (intStatus & (1 << port->getIndex()))) {
 					port->handleIrq();
 				}
 			}
@@ -186,11 +226,13 @@ async::detached Controller::handleIrqs_() {
 	}
 }
 
-async::result<bool> Controller::initPorts_(size_t numCommandSlots, bool ss) {
+async::result<bool> Controller::initPorts_(size_t numCommandSlots, bool ss, bool ncq,
+		bool coalesce) {
 	for (int i = 0; i < maxPorts_; i++) {
 		if (portsImpl_ & (1 << i)) {
 			auto offset = 0x100 + i * 0x80;
-			auto port = std::make_unique<Port>(parentId_, i, numCommandSlots, ss, regs_.subspace(offset));
+			auto port = std::make_unique<Port>(parentId_, i, numCommandSlots, ss, ncq, coalesce,
+					regs_.subspace(offset));
 
 			if (co_await port->init())
 				activePorts_.push_back(std::move(port));
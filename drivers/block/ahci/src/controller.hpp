@@ -15,7 +15,8 @@ public:
 	async::detached run();
 
 private:
-	async::result<bool> initPorts_(size_t numCommandSlots, bool staggeredSpinUp);
+	async::result<bool> initPorts_(size_t numCommandSlots, bool staggeredSpinUp, bool ncq,
+			bool coalesce);
 	async::detached handleIrqs_();
 	void dumpState_();
 
@@ -30,6 +31,8 @@ private:
 	int64_t parentId_;
 	uint32_t portsImpl_;
 	uint64_t irqSequence_;
+	// Bits in IS that correspond to the CCC interrupt (zero if CCC is not used).
+	uint32_t cccInterrupts_;
 	int maxPorts_;
 	bool useMsis_;
 };
@@ -1,3 +1,4 @@
+#include <bit>
 #include <inttypes.h>
 
 #include <helix/memory.hpp>
@@ -36,6 +37,7 @@ namespace flags {
 		constexpr int hostDataError   = 1 << 28;
 		constexpr int ifFatalError    = 1 << 27;
 		constexpr int ifNonFatalError = 1 << 26;
+		constexpr int setDeviceBits   = 1 << 3;
 		constexpr int d2hFis          = 1;
 	}
 
@@ -50,11 +52,14 @@ namespace {
 }
 
 // TODO: We can use a more appropriate block size, but this breaks other parts of the OS.
-Port::Port(int64_t parentId, int portIndex, size_t numCommandSlots, bool staggeredSpinUp, arch::mem_space regs)
-	: BlockDevice{::sectorSize, parentId},  regs_{regs}, deviceSize_{0},
-	numCommandSlots_{numCommandSlots}, commandsInFlight_{0}, portIndex_{portIndex}, 
-	staggeredSpinUp_{staggeredSpinUp}
+Port::Port(int64_t parentId, int portIndex, size_t numCommandSlots, bool staggeredSpinUp,
+		bool hbaSupportsNcq, bool coalesced, arch::mem_space regs)
+	: BlockDevice{::sectorSize, parentId},  regs_{regs}, usedSlots_{0}, deviceSize_{0},
+	numCommandSlots_{numCommandSlots}, maxCommandsInFlight_{numCommandSlots},
+	commandsInFlight_{0}, portIndex_{portIndex}, staggeredSpinUp_{staggeredSpinUp},
+	hbaSupportsNcq_{hbaSupportsNcq}, useNcq_{false}, coalesced_{coalesced}
 {
+	vectoredTransfers = true;
 }
 
 async::result<bool> Port::init() {
@@ -172,7 +177,8 @@ async::result<bool> Port::run() {
 	cas = regs_.load(regs::commandAndStatus);
 	regs_.store(regs::commandAndStatus, cas | flags::cmd::start);
 
-	size_t slot = co_await findFreeSlot_();
+	// No other commands are in flight yet.
+	size_t slot = 0;
 
 	arch::dma_object<identifyDevice> identify{&dmaPool_};
 	Command cmd = Command(identify.data(), CommandType::identify);
@@ -200,17 +206,33 @@ async::result<bool> Port::run() {
 			logicalSize, physicalSize, sectorCount);
 	assert(logicalSize == 512 && "block/ahci: logical sector size > 512 is not supported");
 
+	// Use NCQ if both the HBA and the device support it. NCQ tags are slot numbers,
+	// hence we must not use more slots than the device's queue depth.
+	if (hbaSupportsNcq_ && identify->supportsNcq()) {
+		useNcq_ = true;
+		maxCommandsInFlight_ = std::min(numCommandSlots_, identify->getQueueDepth());
+	}
+	queueDepth = maxCommandsInFlight_;
+
+	printf("block/ahci: Port %d uses %s with %zu slots%s\n", portIndex_,
+			useNcq_ ? "NCQ" : "legacy DMA", maxCommandsInFlight_,
+			coalesced_ ? ", coalesced completions" : "");
+
 	// Clear and enable interrupts on this port
 	auto is = regs_.load(regs::interruptStatus);
 	regs_.store(regs::interruptStatus, is);
-	auto ie = regs_.load(regs::interruptEnable);
-	regs_.store(regs::interruptEnable, ie
-			| flags::is::d2hFis
+	auto ie = regs_.load(regs::interruptEnable)
 			| flags::is::taskFileError
 			| flags::is::hostDataError
 			| flags::is::hostFatalError
 			| flags::is::ifFatalError
-			| flags::is::ifNonFatalError);
+			| flags::is::ifNonFatalError;
+	// With CCC, the HBA raises the coalesced interrupt for completions instead.
+	if (!coalesced_) {
+		// NCQ commands complete with a Set Device Bits FIS, other commands with a D2H FIS.
+		ie |= flags::is::d2hFis | flags::is::setDeviceBits;
+	}
+	regs_.store(regs::interruptEnable, ie);
 
 	submitPendingLoop_();
 
@@ -219,28 +241,6 @@ async::result<bool> Port::run() {
 	co_return true;
 }
 
-async::result<size_t> Port::findFreeSlot_() {
-	while (commandsInFlight_ >= numCommandSlots_) {
-		if (logCommands) {
-			printf("block/ahci: submission queue full, waiting...\n");
-		}
-
-		co_await freeSlotDoorbell_.async_wait();
-	}
-
-	// We can't look at CI here, as the HBA might clear it before we have
-	// a chance to notify completion, so the array slot will still be occupied.
-	// TODO: We could use a bitmask and CLZ for this.
-	for (size_t i = 0; i < numCommandSlots_; i++) {
-		if (!submittedCmds_[i]) {
-			co_return i;
-		}
-	}
-
-	assert(!"commandsInFlight < numCommandSlots, but submission queue was full");
-	co_return 0;
-}
-
 void Port::checkErrors() {
 	auto is = regs_.load(regs::interruptStatus);
 
@@ -271,71 +271,117 @@ void Port::handleIrq() {
 
 	checkErrors();
 
-	std::vector<Command *> completed;
+	// Clear PxIS before looking at the slots: if more commands complete after we read
+	// PxSACT / PxCI, the HBA raises another interrupt.
+	regs_.store(regs::interruptStatus, is);
 
-	// Notify all completed commands
-	auto cmdActiveMask = regs_.load(regs::commandIssue);
-	for (size_t i = 0; i < numCommandSlots_; i++) {
-		if (submittedCmds_[i] && !(cmdActiveMask & (1 << i))) {
-			completed.push_back(std::exchange(submittedCmds_[i], nullptr));
-		}
-	}
+	// Reap all completed commands at once. NCQ commands are outstanding until
+	// their PxSACT bit is cleared (PxCI is cleared as soon as the device accepts them).
+	auto activeMask = regs_.load(regs::commandIssue);
+	if (useNcq_)
+		activeMask |= regs_.load(regs::sataActive);
+	auto completedMask = usedSlots_ & ~activeMask;
+	if (!completedMask)
+		return;
 
+	std::vector<Command *> completed;
+	completed.reserve(std::popcount(completedMask));
+	for (auto mask = completedMask; mask; mask &= mask - 1) {
+		auto slot = std::countr_zero(mask);
+		completed.push_back(std::exchange(submittedCmds_[slot], nullptr));
+	}
+	usedSlots_ &= ~completedMask;
 	commandsInFlight_ -= completed.size();
-	regs_.store(regs::interruptStatus, is);
 
 	for (auto &cmd : completed) {
 		cmd->notifyCompletion();
 	}
 
-	// If the buffer has gone from full to not full, wake the tasks waiting for a free slot.
-	// TODO: If we have a lot of waiters, this will cause many spurious wakeups. Ideally, we only
-	// notify a certain number of tasks, and the rest can stay asleep.
-	if (commandsInFlight_ + completed.size() == numCommandSlots_ && completed.size() > 0) {
-		freeSlotDoorbell_.raise();
-	}
+	freeSlotDoorbell_.raise();
 }
 
 async::detached Port::submitPendingLoop_() {
 	while (true) {
-		auto cmd = co_await pendingCmdQueue_.async_get();
-		assert(cmd);
-		co_await submitCommand_(cmd.value());
-	}
-}
-
-async::result<void> Port::submitCommand_(Command *cmd) {
-	auto slot = co_await findFreeSlot_();
-	assert(!(regs_.load(regs::commandIssue) & (1 << slot)));
-	assert(!submittedCmds_[slot]);
-
-	// Setup command table and FIS
-	cmd->prepare(commandTables_[slot], commandList_->slots[slot]);
+		if (pendingCmds_.empty()) {
+			co_await pendingDoorbell_.async_wait();
+			continue;
+		}
+		if (commandsInFlight_ >= maxCommandsInFlight_) {
+			if (logCommands) {
+				printf("block/ahci: submission queue full, waiting...\n");
+			}
 
-	// Issue command
-	submittedCmds_[slot] = cmd;
-	commandsInFlight_++;
+			co_await freeSlotDoorbell_.async_wait();
+			continue;
+		}
 
-	// Wait until not busy
-	while (regs_.load(regs::tfd) & (flags::tfd::bsy | flags::tfd::drq))
-		;
+		// Fill all free slots, then issue the commands with a single write to PxCI.
+		uint32_t issueMask = 0;
+		while (!pendingCmds_.empty() && commandsInFlight_ < maxCommandsInFlight_) {
+			auto cmd = pendingCmds_.front();
+			pendingCmds_.pop_front();
+
+			// The lowest free slot is always below maxCommandsInFlight_.
+			size_t slot = std::countr_one(usedSlots_);
+			assert(slot < maxCommandsInFlight_);
+			assert(!submittedCmds_[slot]);
+
+			// Setup command table and FIS
+			if (useNcq_)
+				cmd->prepare(commandTables_[slot], commandList_->slots[slot], slot);
+			else
+				cmd->prepare(commandTables_[slot], commandList_->slots[slot]);
+
+			submittedCmds_[slot] = cmd;
+			usedSlots_ |= 1u << slot;
+			commandsInFlight_++;
+			issueMask |= 1u << slot;
+		}
+		assert(!(regs_.load(regs::commandIssue) & issueMask));
+
+		if (useNcq_) {
+			// PxSACT must be set before PxCI (AHCI spec 9.3.1).
+			regs_.store(regs::sataActive, issueMask);
+		} else {
+			// Wait until not busy
+			while (regs_.load(regs::tfd) & (flags::tfd::bsy | flags::tfd::drq))
+				;
+		}
 
-	regs_.store(regs::commandIssue, 1 << slot);
-	co_return;
+		regs_.store(regs::commandIssue, issueMask);
+	}
 }
 
 async::result<void> Port::readSectors(uint64_t sector, void *buffer, size_t numSectors) {
-	Command cmd{sector, numSectors, numSectors * sectorSize,
-			buffer, CommandType::read};
-	pendingCmdQueue_.put(&cmd);
-	co_await cmd.getFuture();
+	blockfs::SectorTransfer transfer{false, sector, buffer, numSectors};
+	co_await transferSectors({&transfer, 1});
 }
 
 async::result<void> Port::writeSectors(uint64_t sector, const void *buffer, size_t numSectors) {
-	Command cmd{sector, numSectors, numSectors * sectorSize,
-			const_cast<void *>(buffer), CommandType::write};
-	pendingCmdQueue_.put(&cmd);
-	co_await cmd.getFuture();
+	blockfs::SectorTransfer transfer{true, sector, const_cast<void *>(buffer), numSectors};
+	co_await transferSectors({&transfer, 1});
+}
+
+async::result<void> Port::transferSectors(std::span<const blockfs::SectorTransfer> transfers) {
+	constexpr size_t maxSectors = limits::maxCmdBytes / sectorSize;
+
+	// Queue all commands before waking up the submission loop such that they are
+	// issued together and the device can reorder them.
+	std::deque<Command> cmds;
+	for (auto &transfer : transfers) {
+		for (size_t progress = 0; progress < transfer.numSectors; progress += maxSectors) {
+			auto numSectors = std::min(transfer.numSectors - progress, maxSectors);
+			auto &cmd = cmds.emplace_back(transfer.sector + progress, numSectors,
+					numSectors * sectorSize,
+					reinterpret_cast<char *>(transfer.buffer) + progress * sectorSize,
+					transfer.write ? CommandType::write : CommandType::read);
+			pendingCmds_.push_back(&cmd);
+		}
+	}
+	pendingDoorbell_.raise();
+
+	for (auto &cmd : cmds)
+		co_await cmd.getFuture();
 }
 
 async::result<size_t> Port::getSize() {
@@ -1,13 +1,12 @@
 #pragma once
 
-#include <queue>
+#include <deque>
 
 #include <arch/mem_space.hpp>
 #include <arch/dma_structs.hpp>
 #include <arch/dma_pool.hpp>
 #include <async/recurring-event.hpp>
 #include <async/result.hpp>
-#include <async/queue.hpp>
 
 #include <blockfs.hpp>
 
@@ -17,7 +16,7 @@
 class Port : public blockfs::BlockDevice {
 public:
 	Port(int64_t parentId, int index, size_t numCommandSlots, bool staggeredSpinUp,
-			arch::mem_space regs);
+			bool hbaSupportsNcq, bool coalesced, arch::mem_space regs);
 
 public:
 	async::result<bool> init();
@@ -28,14 +27,13 @@ public:
 
 	async::result<void> readSectors(uint64_t sector, void *buf, size_t numSectors) override;
 	async::result<void> writeSectors(uint64_t sector, const void *buf, size_t numSectors) override;
+	async::result<void> transferSectors(std::span<const blockfs::SectorTransfer> transfers) override;
 	async::result<size_t> getSize() override;
 
 	int getIndex() const { return portIndex_; }
 
 private:
-	async::result<size_t> findFreeSlot_();
 	async::detached submitPendingLoop_();
-	async::result<void> submitCommand_(Command *cmd);
 	void start_();
 	void stop_();
 
@@ -48,24 +46,23 @@ private:
 	arch::dma_array<commandTable> commandTables_;
 	arch::dma_object<receivedFis> receivedFis_;
 
-	// TODO: Move this to libasync
-	struct stl_allocator {
-		void *allocate(size_t size) {
-			return operator new(size);
-		}
-
-		void deallocate(void *p, size_t) {
-			return operator delete(p);
-		}
-	};
-	async::queue<Command *, stl_allocator> pendingCmdQueue_;
+	std::deque<Command *> pendingCmds_;
+	async::recurring_event pendingDoorbell_;
 
 	std::array<Command *, limits::maxCmdSlots> submittedCmds_{};
+	// Bitmask of slots in submittedCmds_ that are in use.
+	uint32_t usedSlots_;
 	async::recurring_event freeSlotDoorbell_;
 
 	uint64_t deviceSize_;
 	size_t numCommandSlots_;
+	// Number of slots that we use; this is limited by the device's queue depth if NCQ is used.
+	size_t maxCommandsInFlight_;
 	size_t commandsInFlight_;
 	int portIndex_;
 	bool staggeredSpinUp_;
+	bool hbaSupportsNcq_;
+	bool useNcq_;
+	// Completion interrupts are coalesced by the HBA (CCC).
+	bool coalesced_;
 };
@@ -8,6 +8,8 @@
 namespace limits {
 	constexpr size_t maxCmdSlots = 32;
 	constexpr size_t maxPorts    = 32;
+	// Limited by the size of the PRDT in commandTable.
+	constexpr size_t maxCmdBytes = 16 * 4096;
 }
 
 namespace {
@@ -90,15 +92,18 @@ static_assert(alignof(commandTable) >= 128);
 struct identifyDevice {
 	uint16_t _junkA[27];
 	uint16_t model[20];
-	uint16_t _junkB[36];
+	uint16_t _junkB[28];
+	uint16_t queueDepth;
+	uint16_t sataCapabilities;
+	uint16_t _junkC[6];
 	uint16_t capabilities;
-	uint16_t _junkC[16];
+	uint16_t _junkD[16];
 	uint64_t maxLBA48;
-	uint16_t _junkD[2];
+	uint16_t _junkE[2];
 	uint16_t sectorSizeInfo;
-	uint16_t _junkE[9];
+	uint16_t _junkF[9];
 	uint16_t logicalSectorSize;
-	uint16_t _junkF[139];
+	uint16_t _junkG[139];
 
 	std::string getModel() const {
 		char modelNative[41];
@@ -143,5 +148,14 @@ struct identifyDevice {
 	bool supportsLba48() const {
 		return capabilities & (1 << 10);
 	}
+
+	bool supportsNcq() const {
+		return sataCapabilities & (1 << 8);
+	}
+
+	// Maximal number of outstanding NCQ commands.
+	size_t getQueueDepth() const {
+		return (queueDepth & 0x1F) + 1;
+	}
 };
 static_assert(sizeof(identifyDevice) == 512);
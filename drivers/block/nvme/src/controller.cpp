@@ -1,6 +1,8 @@
 #include <arch/bit.hpp>
+#include <fafnir/dsl.hpp>
 #include <format>
 #include <helix/timer.hpp>
+#include <protocols/kernlet/compiler.hpp>
 #include <protocols/mbus/client.hpp>
 
 #include "controller.hpp"
@@ -67,11 +69,11 @@ async::detached PciExpressController::run(mbus_ng::EntityId subsystem) {
 		ns->run();
 }
 
-async::detached PciExpressController::handleIrqs(helix::UniqueDescriptor irq) {
+async::detached PciExpressController::handleIrqs() {
 	irqSequence_ = 0;
 
 	while (true) {
-		auto awaitResult = co_await helix_ng::awaitEvent(irq, irqSequence_);
+		auto awaitResult = co_await helix_ng::awaitEvent(irq_, irqSequence_);
 
 		regs_.store(regs::intms, 1);
 
@@ -86,18 +88,19 @@ async::detached PciExpressController::handleIrqs(helix::UniqueDescriptor irq) {
 		regs_.store(regs::intmc, 1);
 
 		if (found) {
-			HEL_CHECK(helAcknowledgeIrq(irq.getHandle(), kHelAckAcknowledge, irqSequence_));
+			HEL_CHECK(helAcknowledgeIrq(irq_.getHandle(), kHelAckAcknowledge, irqSequence_));
 		} else {
-			HEL_CHECK(helAcknowledgeIrq(irq.getHandle(), kHelAckNack, irqSequence_));
+			HEL_CHECK(helAcknowledgeIrq(irq_.getHandle(), kHelAckNack, irqSequence_));
 		}
 	}
 }
 
 async::detached PciExpressController::handleMsis(helix::UniqueDescriptor irq, size_t queueId, bool isMsiX) {
-	irqSequence_ = 0;
+	// Each MSI has its own sequence numbers.
+	uint64_t sequence = 0;
 
 	while (true) {
-		auto awaitResult = co_await helix_ng::awaitEvent(irq, irqSequence_);
+		auto awaitResult = co_await helix_ng::awaitEvent(irq, sequence);
 
 		auto q = std::ranges::find_if(activeQueues_, [queueId](auto &q) {
 			return q->getQueueId() == queueId;
@@ -112,14 +115,14 @@ async::detached PciExpressController::handleMsis(helix::UniqueDescriptor irq, si
 			regs_.store(regs::intms, 1 << queueId);
 
 		HEL_CHECK(awaitResult.error());
-		irqSequence_ = awaitResult.sequence();
+		sequence = awaitResult.sequence();
 
 		static_cast<PciExpressQueue *>(q->get())->handleIrq();
 
 		if(!isMsiX)
 			regs_.store(regs::intmc, 1 << queueId);
 
-		HEL_CHECK(helAcknowledgeIrq(irq.getHandle(), kHelAckAcknowledge, irqSequence_));
+		HEL_CHECK(helAcknowledgeIrq(irq.getHandle(), kHelAckAcknowledge, sequence));
 	}
 }
 
@@ -146,11 +149,94 @@ async::result<void> PciExpressController::disable() {
 	co_await waitStatus(false);
 }
 
-async::result<void> PciExpressController::setupIOQueueInterrupts(size_t queueId, size_t vector) {
+async::result<void> PciExpressController::setupIOQueueInterrupts(PciExpressQueue *q) {
 	if(irqMode_ == InterruptMode::Msi || irqMode_ == InterruptMode::MsiX) {
-		auto irq = co_await hwDevice_.installMsi(vector);
-		handleMsis(std::move(irq), queueId, irqMode_ == InterruptMode::MsiX);
+		auto irq = co_await hwDevice_.installMsi(q->interruptVector());
+		co_await automateIrq(irq, q);
+		handleMsis(std::move(irq), q->getQueueId(), irqMode_ == InterruptMode::MsiX);
+	}
+}
+
+// Attaches a kernlet that checks the phase bit of the next entry of each CQ.
+// IRQs that do not complete any commands are then handled in the kernel.
+async::result<void> PciExpressController::automateIrq(const helix::UniqueDescriptor &irq,
+		PciExpressQueue *q, PciExpressQueue *other) {
+#ifdef __x86_64__ // TODO: implement kernlet compilation for aarch64
+	co_await connectKernletCompiler();
+
+	// Evaluates to 1 iff the next entry of the CQ is new (see PciExpressQueue::updateKernletState()).
+	auto checkPhase = [] (auto cq, auto state) {
+		return (
+			fnr::intrin{"__mmio_read8", 2, 1} (
+				cq,
+				fnr::intrin{"__mmio_read32", 2, 1} (
+					state,
+					fnr::literal{0} // Offset of the status byte.
+				)
+			) + fnr::intrin{"__mmio_read32", 2, 1} (
+				state,
+				fnr::literal{4} // Inverse of the expected phase.
+			)
+		) & fnr::literal{1};
+	};
+
+	std::vector<uint8_t> kernlet_program;
+	std::vector<BindType> bind_types;
+	if(!other) {
+		// MSIs are not shared; drop MSIs for completions that the driver already handled.
+		fnr::emit_to(std::back_inserter(kernlet_program),
+			fnr::scope_push{} (
+				checkPhase(fnr::binding{0}, fnr::binding{1}) // CQ and state (bound to slots 0 and 1).
+			),
+			// Wake up the driver iff there is a new entry.
+			fnr::check_if{},
+				fnr::scope_get{0},
+			fnr::then{},
+				fnr::scope_push{} ( fnr::literal{0} ),
+			fnr::else_then{},
+				fnr::scope_push{} ( fnr::literal{1} ),
+			fnr::end{}
+		);
+		bind_types = {BindType::memoryView, BindType::memoryView};
+	}else{
+		// Legacy IRQs can be shared; NAK the IRQ if neither CQ has a new entry.
+		fnr::emit_to(std::back_inserter(kernlet_program),
+			fnr::scope_push{} (
+				checkPhase(fnr::binding{0}, fnr::binding{1}) // CQ and state (bound to slots 0 and 1).
+					+ checkPhase(fnr::binding{2}, fnr::binding{3}) // CQ and state (bound to slots 2 and 3).
+			),
+			// Wake up the driver iff there is a new entry.
+			fnr::check_if{},
+				fnr::scope_get{0},
+			fnr::then{},
+				fnr::scope_push{} ( fnr::literal{0} ),
+			fnr::else_then{},
+				fnr::scope_push{} ( fnr::literal{2} ),
+			fnr::end{}
+		);
+		bind_types = {BindType::memoryView, BindType::memoryView,
+				BindType::memoryView, BindType::memoryView};
+	}
+
+	auto kernlet_object = co_await compile(kernlet_program.data(),
+			kernlet_program.size(), bind_types);
+
+	HelKernletData data[4];
+	data[0].handle = q->getCqMemory();
+	data[1].handle = q->getKernletStateMemory();
+	if(other) {
+		data[2].handle = other->getCqMemory();
+		data[3].handle = other->getKernletStateMemory();
 	}
+	HelHandle bound_handle;
+	HEL_CHECK(helBindKernlet(kernlet_object.getHandle(), data, bind_types.size(), &bound_handle));
+	HEL_CHECK(helAutomateIrq(irq.getHandle(), 0, bound_handle));
+#else
+	(void)irq;
+	(void)q;
+	(void)other;
+	co_return;
+#endif
 }
 
 async::result<void> PciExpressController::reset() {
@@ -166,20 +252,21 @@ async::result<void> PciExpressController::reset() {
 
 	auto info = co_await hwDevice_.getPciInfo();
 
+	// The queues need to be allocated before their IRQs are automated.
+	auto adminQ = std::make_unique<PciExpressQueue>(0, 32, regs_.subspace(doorbellsOffset));
+	co_await adminQ->init();
+
 	if(info.numMsis) {
 		irqMode_ = info.msiX ? InterruptMode::MsiX : InterruptMode::Msi;
 		co_await hwDevice_.enableMsi();
-		co_await setupIOQueueInterrupts(0, 0);
+		co_await setupIOQueueInterrupts(adminQ.get());
 	} else {
 		irqMode_ = InterruptMode::LegacyIrq;
-		auto irq = co_await hwDevice_.accessIrq();
+		irq_ = co_await hwDevice_.accessIrq();
 		co_await hwDevice_.enableBusIrq();
-		handleIrqs(std::move(irq));
+		handleIrqs();
 	}
 
-	auto adminQ = std::make_unique<PciExpressQueue>(0, 32, regs_.subspace(doorbellsOffset));
-	co_await adminQ->init();
-
 	uint32_t aqa = (31 << 16) | 31;
 	regs_.store(regs::aqa, aqa);
 	regs_.store(regs::asq, adminQ->getSqPhysAddr());
@@ -192,12 +279,16 @@ async::result<void> PciExpressController::reset() {
 
 	requestIoQueues(1, 1);
 
-	co_await setupIOQueueInterrupts(1, 1);
 	auto ioQ = std::make_unique<PciExpressQueue>(1, queueDepth_, regs_.subspace(doorbellsOffset + 1 * 8 * dbStride_), 1);
 	co_await ioQ->init();
+	co_await setupIOQueueInterrupts(ioQ.get());
 
 	if (co_await setupIoQueue(ioQ.get())) {
 		ioQ->run();
+		// The legacy IRQ is shared by both queues.
+		if(irqMode_ == InterruptMode::LegacyIrq)
+			co_await automateIrq(irq_, static_cast<PciExpressQueue *>(activeQueues_.front().get()),
+					ioQ.get());
 		activeQueues_.push_back(std::move(ioQ));
 	}
 
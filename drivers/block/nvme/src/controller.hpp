@@ -81,7 +81,9 @@ struct PciExpressController final : public Controller {
 	async::result<Command::Result> submitAdminCommand(std::unique_ptr<Command> cmd) override;
 	async::result<Command::Result> submitIoCommand(std::unique_ptr<Command> cmd) override;
 private:
-	async::result<void> setupIOQueueInterrupts(size_t queueId, size_t vector);
+	async::result<void> setupIOQueueInterrupts(PciExpressQueue *q);
+	async::result<void> automateIrq(const helix::UniqueDescriptor &irq,
+			PciExpressQueue *q, PciExpressQueue *other = nullptr);
 
 	static constexpr int IO_QUEUE_DEPTH = 1024;
 
@@ -93,6 +95,7 @@ private:
 	unsigned int queueDepth_;
 	uint32_t dbStride_;
 
+	helix::UniqueDescriptor irq_;
 	uint64_t irqSequence_;
 	InterruptMode irqMode_;
 
@@ -107,6 +110,6 @@ private:
 	async::result<Command::Result> createCQ(PciExpressQueue *q);
 	async::result<Command::Result> createSQ(PciExpressQueue *q);
 
-	async::detached handleIrqs(helix::UniqueDescriptor irq);
+	async::detached handleIrqs();
 	async::detached handleMsis(helix::UniqueDescriptor irq, size_t queueId, bool isMsiX);
 };
@@ -12,6 +12,10 @@ Namespace::Namespace(Controller *controller, unsigned int nsid, int lbaShift, si
 	diskNamePrefix = "nvme";
 	diskNameSuffix = std::format("n{}", nsid);
 	partNameSuffix = std::format("n{}p", nsid);
+
+	// NVMe has per-CPU submission queues; sorting requests does not pay off.
+	ioScheduler = blockfs::IoScheduler::multiQueue;
+	queueDepth = 64;
 }
 
 async::detached Namespace::run() {
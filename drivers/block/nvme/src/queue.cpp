@@ -1,3 +1,5 @@
+#include <stddef.h>
+
 #include <arch/bit.hpp>
 #include <helix/ipc.hpp>
 #include <helix/memory.hpp>
@@ -20,11 +22,19 @@ async::result<void> PciExpressQueue::init() {
 	HEL_CHECK(helAllocateMemory(cqSize, kHelAllocContinuous, nullptr, &memory));
 	HEL_CHECK(helMapMemory(memory, kHelNullHandle, nullptr,
 						   0, cqSize, kHelMapProtRead | kHelMapProtWrite, &window));
-	HEL_CHECK(helCloseDescriptor(kHelThisUniverse, memory));
+	cqMemory_ = helix::UniqueDescriptor{memory};
 
 	cqes_ = reinterpret_cast<spec::CompletionEntry *>(window);
 	memset(cqes_, 0, cqSize);
 
+	HEL_CHECK(helAllocateMemory(align, kHelAllocContinuous, nullptr, &memory));
+	HEL_CHECK(helMapMemory(memory, kHelNullHandle, nullptr,
+						   0, align, kHelMapProtRead | kHelMapProtWrite, &window));
+	kernletStateMemory_ = helix::UniqueDescriptor{memory};
+
+	kernletState_ = reinterpret_cast<uint32_t *>(window);
+	updateKernletState();
+
 	HEL_CHECK(helAllocateMemory(sqSize, kHelAllocContinuous, nullptr, &memory));
 	HEL_CHECK(helMapMemory(memory, kHelNullHandle, nullptr,
 						   0, sqSize, kHelMapProtRead | kHelMapProtWrite, &window));
@@ -75,12 +85,25 @@ int PciExpressQueue::handleIrq() {
 
 	commandsInFlight_ -= found;
 
-	if (found)
+	if (found) {
+		updateKernletState();
 		doorbells_.store(arch::scalar_register<uint32_t>{0x4}, cqHead_);
+	}
 
 	return found;
 }
 
+// The kernlet runs while the IRQ is not in service, i.e., only after the driver
+// acknowledged the IRQ. Hence, it never observes a partially updated state.
+void PciExpressQueue::updateKernletState() {
+	// Offset of the status byte that contains the phase bit of the next entry.
+	__atomic_store_n(&kernletState_[0],
+			cqHead_ * sizeof(spec::CompletionEntry) + offsetof(spec::CompletionEntry, status),
+			__ATOMIC_RELAXED);
+	// The kernlet adds this to the phase bit; bit 0 of the sum is set iff the entry is new.
+	__atomic_store_n(&kernletState_[1], cqPhase_ ^ 1u, __ATOMIC_RELAXED);
+}
+
 async::result<size_t> Queue::findFreeSlot() {
 	if (commandsInFlight_ >= depth_)
 		co_await freeSlotDoorbell_.async_wait();
@@ -6,6 +6,7 @@
 #include <async/recurring-event.hpp>
 #include <async/queue.hpp>
 #include <frg/std_compat.hpp>
+#include <helix/ipc.hpp>
 
 #include "command.hpp"
 #include "spec.hpp"
@@ -58,6 +59,15 @@ struct PciExpressQueue final : Queue {
 		return interruptVector_;
 	}
 
+	// Kernlets bind the CQ and a page that describes the next CQ entry
+	// in order to check the entry's phase bit in the kernel.
+	HelHandle getCqMemory() const {
+		return cqMemory_.getHandle();
+	}
+	HelHandle getKernletStateMemory() const {
+		return kernletStateMemory_.getHandle();
+	}
+
 	int handleIrq();
 
 private:
@@ -71,6 +81,12 @@ private:
 	uint8_t cqPhase_;
 	size_t interruptVector_;
 
+	helix::UniqueDescriptor cqMemory_;
+	helix::UniqueDescriptor kernletStateMemory_;
+	uint32_t *kernletState_;
+
+	void updateKernletState();
+
 	async::detached submitPendingLoop();
 
 	async::result<Command::Result> submitCommand(std::unique_ptr<Command> cmd) override;
@@ -1,5 +1,6 @@
 
 #include <stdlib.h>
+#include <bit>
 #include <iostream>
 
 #include "block.hpp"
@@ -9,6 +10,18 @@ namespace virtio {
 
 static bool logInitiateRetire = false;
 
+namespace {
+
+constexpr size_t pageSize = 0x1000;
+
+// Returns the number of descriptors that scatterGather() uses for a buffer.
+size_t numSegments(const void *buffer, size_t length) {
+	auto address = reinterpret_cast<uintptr_t>(buffer);
+	return ((address + length - 1) / pageSize) - (address / pageSize) + 1;
+}
+
+} // anonymous namespace
+
 // --------------------------------------------------------
 // UserRequest
 // --------------------------------------------------------
@@ -16,101 +29,184 @@ static bool logInitiateRetire = false;
 UserRequest::UserRequest(bool write_, uint64_t sector_, void *buffer_, size_t num_sectors_)
 : write{write_}, sector{sector_}, buffer{buffer_}, numSectors{num_sectors_} { }
 
+// --------------------------------------------------------
+// RequestQueue
+// --------------------------------------------------------
+
+RequestQueue::RequestQueue(virtio_core::Queue *virtq_)
+: virtq{virtq_},
+		virtRequestBuffer{std::make_unique<VirtRequest[]>(virtq_->numDescriptors())},
+		statusBuffer{std::make_unique<uint8_t[]>(virtq_->numDescriptors())},
+		chainBuffer{std::make_unique<ChainRequest[]>(virtq_->numDescriptors())} {
+	// natural alignment makes sure that request headers do not cross page boundaries
+	assert((uintptr_t)virtRequestBuffer.get() % sizeof(VirtRequest) == 0);
+}
+
 // --------------------------------------------------------
 // Device
 // --------------------------------------------------------
 
 Device::Device(std::unique_ptr<virtio_core::Transport> transport, int64_t parent_id)
 : blockfs::BlockDevice{512, parent_id}, _transport{std::move(transport)},
-		_requestQueue{nullptr}, _size{0} { }
+		_maxSegments{0}, _physicalBlockSize{512}, _size{0} {
+	vectoredTransfers = true;
+}
 
 void Device::runDevice() {
+	bool haveSegMax = false;
+	if(_transport->checkDeviceFeature(VIRTIO_BLK_F_SEG_MAX)) {
+		_transport->acknowledgeDriverFeature(VIRTIO_BLK_F_SEG_MAX);
+		haveSegMax = true;
+	}
+	if(_transport->checkDeviceFeature(VIRTIO_BLK_F_BLK_SIZE))
+		_transport->acknowledgeDriverFeature(VIRTIO_BLK_F_BLK_SIZE);
+
+	// Use one virtq per CPU that we can run on (but not more than the device supports).
+	unsigned int numQueues = 1;
+	if(_transport->checkDeviceFeature(VIRTIO_BLK_F_MQ)) {
+		_transport->acknowledgeDriverFeature(VIRTIO_BLK_F_MQ);
+
+		uint8_t mask[128]{};
+		size_t maskSize;
+		HEL_CHECK(helGetAffinity(kHelThisThread, mask, sizeof(mask), &maskSize));
+		unsigned int numCpus = 0;
+		for(size_t i = 0; i < maskSize; i++)
+			numCpus += std::popcount(mask[i]);
+
+		numQueues = std::max(1u, std::min(numCpus,
+				static_cast<unsigned int>(_transport->space().load(spec::regs::numQueues))));
+	}
+
 	_transport->finalizeFeatures();
-	_transport->claimQueues(1);
-	_requestQueue = _transport->setupQueue(0);
+	_transport->claimQueues(numQueues);
+	for(unsigned int i = 0; i < numQueues; i++)
+		_queues.push_back(std::make_unique<RequestQueue>(_transport->setupQueue(i)));
 
 	auto size = static_cast<uint64_t>(_transport->space().load(spec::regs::capacity[0]))
 			| (static_cast<uint64_t>(_transport->space().load(spec::regs::capacity[1])) << 32);
 	std::cout << "virtio: Disk size: " << size << " sectors" << std::endl;
 	_size = size;
 
-	_transport->runDevice();
+	// Limit to ensure that we don't monopolize the device.
+	_maxSegments = _queues.front()->virtq->numDescriptors() / 4;
+	if(haveSegMax) {
+		auto segMax = _transport->space().load(spec::regs::segMax);
+		if(segMax)
+			_maxSegments = std::min(_maxSegments, static_cast<size_t>(segMax));
+	}
+	// We need at least two segments such that every page-sized chunk fits into a chain.
+	assert(_maxSegments >= 2);
+
+	if(_transport->checkDeviceFeature(VIRTIO_BLK_F_BLK_SIZE)) {
+		auto blkSize = _transport->space().load(spec::regs::blkSize);
+		if(blkSize >= 512 && std::has_single_bit(blkSize))
+			_physicalBlockSize = blkSize;
+	}
 
-	// perform device specific setup
-	virtRequestBuffer = new VirtRequest[_requestQueue->numDescriptors()];
-	statusBuffer = new uint8_t[_requestQueue->numDescriptors()];
+	std::cout << "virtio: Using " << numQueues << " request queue(s), "
+			<< _maxSegments << " segments per request, "
+			<< _physicalBlockSize << " byte blocks" << std::endl;
 
-	// natural alignment makes sure that request headers do not cross page boundaries
-	assert((uintptr_t)virtRequestBuffer % sizeof(VirtRequest) == 0);
+	_transport->runDevice();
 
 	// setup an interrupt for the device
-	_processRequests();
+	for(auto &queue : _queues)
+		_processRequests(queue.get());
 
 	blockfs::runDevice(this);
 }
 
 async::result<void> Device::readSectors(uint64_t sector,
 		void *buffer, size_t num_sectors) {
-	// Natural alignment makes sure a sector does not cross a page boundary.
-	assert(!((uintptr_t)buffer % 512));
-//	printf("readSectors(%lu, %lu)\n", sector, num_sectors);
-
-	// Limit to ensure that we don't monopolize the device.
-	auto max_sectors = _requestQueue->numDescriptors() / 4;
-	assert(max_sectors >= 1);
-
-	for(size_t progress = 0; progress < num_sectors; progress += max_sectors) {
-		auto request = new UserRequest(false, sector + progress,
-				(char *)buffer + 512 * progress,
-				std::min(num_sectors - progress, max_sectors));
-		_pendingQueue.push(request);
-		_pendingDoorbell.raise();
-		co_await request->event.wait();
-		delete request;
-	}
+	blockfs::SectorTransfer transfer{false, sector, buffer, num_sectors};
+	co_await transferSectors({&transfer, 1});
 }
 
 async::result<void> Device::writeSectors(uint64_t sector,
 		const void *buffer, size_t num_sectors) {
-	// Natural alignment makes sure a sector does not cross a page boundary.
-	assert(!((uintptr_t)buffer % 512));
-//	printf("writeSectors(%lu, %lu)\n", sector, num_sectors);
+	blockfs::SectorTransfer transfer{true, sector, const_cast<void *>(buffer), num_sectors};
+	co_await transferSectors({&transfer, 1});
+}
 
-	// Limit to ensure that we don't monopolize the device.
-	auto max_sectors = _requestQueue->numDescriptors() / 4;
+async::result<void> Device::transferSectors(std::span<const blockfs::SectorTransfer> transfers) {
+	// A buffer of (_maxSegments - 1) pages spans at most _maxSegments pages.
+	// Round down to whole physical blocks to avoid read-modify-write cycles on the host.
+	auto max_bytes = (_maxSegments - 1) * pageSize;
+	if(max_bytes >= _physicalBlockSize)
+		max_bytes &= ~(_physicalBlockSize - 1);
+	auto max_sectors = max_bytes / 512;
 	assert(max_sectors >= 1);
 
-	for(size_t progress = 0; progress < num_sectors; progress += max_sectors) {
-		auto request = new UserRequest(true, sector + progress,
-				(char *)buffer + 512 * progress,
-				std::min(num_sectors - progress, max_sectors));
-		_pendingQueue.push(request);
-		_pendingDoorbell.raise();
-		co_await request->event.wait();
-		delete request;
+	// Push all chunks before waking up _processRequests() such that
+	// adjacent chunks end up in the same descriptor chain.
+	auto queue = _currentQueue();
+	std::deque<UserRequest> requests;
+	for(auto &transfer : transfers) {
+		// Natural alignment makes sure a sector does not cross a page boundary.
+		assert(!((uintptr_t)transfer.buffer % 512));
+
+		for(size_t progress = 0; progress < transfer.numSectors; progress += max_sectors) {
+			auto &request = requests.emplace_back(transfer.write, transfer.sector + progress,
+					(char *)transfer.buffer + 512 * progress,
+					std::min(transfer.numSectors - progress, max_sectors));
+			queue->pendingQueue.push_back(&request);
+		}
 	}
+	queue->pendingDoorbell.raise();
+
+	for(auto &request : requests)
+		co_await request.event.wait();
 }
 
 async::result<size_t> Device::getSize() {
 	co_return _size * 512;
 }
 
-async::detached Device::_processRequests() {
+RequestQueue *Device::_currentQueue() {
+	if(_queues.size() == 1)
+		return _queues.front().get();
+
+	int cpu;
+	HEL_CHECK(helGetCurrentCpu(&cpu));
+	return _queues[cpu % _queues.size()].get();
+}
+
+async::detached Device::_processRequests(RequestQueue *queue) {
 	while(true) {
-		if(_pendingQueue.empty()) {
-			co_await _pendingDoorbell.async_wait();
+		if(queue->pendingQueue.empty()) {
+			co_await queue->pendingDoorbell.async_wait();
 			continue;
 		}
 
-		auto request = _pendingQueue.front();
-		_pendingQueue.pop();
+		auto request = queue->pendingQueue.front();
+		queue->pendingQueue.pop_front();
 		assert(request->numSectors);
 
+		// Merge requests that continue the current one on disk into the same chain.
+		auto tail = request;
+		auto segments = numSegments(request->buffer, 512 * request->numSectors);
+		while(!queue->pendingQueue.empty()) {
+			auto successor = queue->pendingQueue.front();
+			if(successor->write != request->write
+					|| successor->sector != tail->sector + tail->numSectors)
+				break;
+			auto successorSegments = numSegments(successor->buffer, 512 * successor->numSectors);
+			if(segments + successorSegments > _maxSegments)
+				break;
+			queue->pendingQueue.pop_front();
+
+			tail->next = successor;
+			tail = successor;
+			segments += successorSegments;
+			queue->numMerged++;
+		}
+		queue->numChains++;
+
 		// Setup the descriptor for the request header.
 		virtio_core::Chain chain;
-		chain.append(co_await _requestQueue->obtainDescriptor());
+		chain.append(co_await queue->virtq->obtainDescriptor());
 
-		VirtRequest *header = &virtRequestBuffer[chain.front().tableIndex()];
+		VirtRequest *header = &queue->virtRequestBuffer[chain.front().tableIndex()];
 		if(request->write) {
 			header->type = VIRTIO_BLK_T_OUT;
 		}else{
@@ -123,37 +219,48 @@ async::detached Device::_processRequests() {
 				header, sizeof(VirtRequest)});
 
 		// Setup descriptors for the transfered data.
-		for(size_t i = 0; i < request->numSectors; i++) {
-			chain.append(co_await _requestQueue->obtainDescriptor());
+		for(auto part = request; part; part = part->next) {
+			arch::dma_buffer_view view{nullptr, part->buffer, 512 * part->numSectors};
 			if(request->write) {
-				chain.setupBuffer(virtio_core::hostToDevice, arch::dma_buffer_view{nullptr,
-						(char *)request->buffer + 512 * i, 512});
+				co_await virtio_core::scatterGather(virtio_core::hostToDevice,
+						chain, queue->virtq, view);
 			}else{
-				chain.setupBuffer(virtio_core::deviceToHost, arch::dma_buffer_view{nullptr,
-						(char *)request->buffer + 512 * i, 512});
+				co_await virtio_core::scatterGather(virtio_core::deviceToHost,
+						chain, queue->virtq, view);
 			}
 		}
 
 		if(logInitiateRetire)
-			std::cout << "Submitting " << request->numSectors
+			std::cout << "Submitting " << segments
 					<< " data descriptors" << std::endl;
 
 		// Setup a descriptor for the status byte.
-		chain.append(co_await _requestQueue->obtainDescriptor());
+		chain.append(co_await queue->virtq->obtainDescriptor());
 		chain.setupBuffer(virtio_core::deviceToHost, arch::dma_buffer_view{nullptr,
-				&statusBuffer[chain.front().tableIndex()], 1});
+				&queue->statusBuffer[chain.front().tableIndex()], 1});
 
 		// Submit the request to the device
-		_requestQueue->postDescriptor(chain.front(), request,
+		auto chainRequest = &queue->chainBuffer[chain.front().tableIndex()];
+		assert(!chainRequest->first);
+		chainRequest->first = request;
+		queue->virtq->postDescriptor(chain.front(), chainRequest,
 				[] (virtio_core::Request *base_request) {
-			auto request = static_cast<UserRequest *>(base_request);
-			if(logInitiateRetire)
-				std::cout << "Retiring " << request->numSectors
-						<< " data descriptors" << std::endl;
-			request->event.raise();
+			auto chainRequest = static_cast<ChainRequest *>(base_request);
+			auto part = chainRequest->first;
+			chainRequest->first = nullptr;
+			while(part) {
+				// Raising the event might destroy the request.
+				auto successor = part->next;
+				if(logInitiateRetire)
+					std::cout << "Retiring " << part->numSectors
+							<< " sectors" << std::endl;
+				part->event.raise();
+				part = successor;
+			}
 		});
-		_requestQueue->notify();
+		queue->virtq->notify();
 	}
 }
 
 } } // namespace block::virtio
+
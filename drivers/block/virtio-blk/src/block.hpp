@@ -1,6 +1,7 @@
 
+#include <deque>
 #include <memory>
-#include <queue>
+#include <vector>
 
 #include <blockfs.hpp>
 #include <core/virtio/core.hpp>
@@ -25,10 +26,20 @@ enum {
 	VIRTIO_BLK_T_OUT = 1
 };
 
+// Feature bits.
+enum {
+	VIRTIO_BLK_F_SEG_MAX = 2,
+	VIRTIO_BLK_F_BLK_SIZE = 6,
+	VIRTIO_BLK_F_MQ = 12
+};
+
 namespace spec::regs {
 	inline constexpr arch::scalar_register<uint32_t> capacity[] = {
 			arch::scalar_register<uint32_t>{0},
 			arch::scalar_register<uint32_t>{4}};
+	inline constexpr arch::scalar_register<uint32_t> segMax{12};
+	inline constexpr arch::scalar_register<uint32_t> blkSize{20};
+	inline constexpr arch::scalar_register<uint16_t> numQueues{34};
 }
 
 struct Device;
@@ -37,7 +48,8 @@ struct Device;
 // UserRequest
 // --------------------------------------------------------
 
-struct UserRequest : virtio_core::Request {
+// Lives in the frame of the transferSectors() coroutine.
+struct UserRequest {
 	UserRequest(bool write, uint64_t sector, void *buffer, size_t num_sectors);
 
 	bool write;
@@ -45,9 +57,47 @@ struct UserRequest : virtio_core::Request {
 	void *buffer;
 	size_t numSectors;
 
+	// Links requests that are merged into the same descriptor chain.
+	UserRequest *next = nullptr;
+
 	async::oneshot_event event;
 };
 
+// Represents a single descriptor chain that is submitted to the device.
+// ChainRequests are not allocated dynamically: each queue owns one per descriptor
+// and a chain uses the one that is indexed by its first descriptor.
+struct ChainRequest : virtio_core::Request {
+	UserRequest *first = nullptr;
+};
+
+// --------------------------------------------------------
+// RequestQueue
+// --------------------------------------------------------
+
+struct RequestQueue {
+	RequestQueue(virtio_core::Queue *virtq);
+
+	RequestQueue(const RequestQueue &) = delete;
+
+	RequestQueue &operator= (const RequestQueue &) = delete;
+
+	virtio_core::Queue *virtq;
+
+	// Stores UserRequest objects that have not been submitted yet.
+	std::deque<UserRequest *> pendingQueue;
+	async::recurring_event pendingDoorbell;
+
+	// These buffers store virtio-block request headers, status bytes and chain requests.
+	// They are indexed by the index of the chain's first descriptor.
+	std::unique_ptr<VirtRequest[]> virtRequestBuffer;
+	std::unique_ptr<uint8_t[]> statusBuffer;
+	std::unique_ptr<ChainRequest[]> chainBuffer;
+
+	// Statistics.
+	uint64_t numChains = 0;
+	uint64_t numMerged = 0;
+};
+
 // --------------------------------------------------------
 // Device
 // --------------------------------------------------------
@@ -63,25 +113,28 @@ struct Device : blockfs::BlockDevice {
 	async::result<void> writeSectors(uint64_t sector,
 			const void *buffer, size_t num_sectors) override;
 
+	// Splits the transfers into UserRequests and waits until all of them complete.
+	async::result<void> transferSectors(std::span<const blockfs::SectorTransfer> transfers) override;
+
 	async::result<size_t> getSize() override;
 
 private:
-	// Submits requests from _pendingQueue to the device.
-	async::detached _processRequests();
+	// Returns the RequestQueue that is associated with the current CPU.
+	RequestQueue *_currentQueue();
+
+	// Submits requests from the pending queue of a RequestQueue to the device.
+	async::detached _processRequests(RequestQueue *queue);
 
 	std::unique_ptr<virtio_core::Transport> _transport;
 
-	// The single virtq of this device.
-	virtio_core::Queue *_requestQueue;
+	// One RequestQueue per virtq; with VIRTIO_BLK_F_MQ, there is one virtq per CPU.
+	std::vector<std::unique_ptr<RequestQueue>> _queues;
 
-	// Stores UserRequest objects that have not been submitted yet.
-	std::queue<UserRequest *> _pendingQueue;
-	async::recurring_event _pendingDoorbell;
+	// Maximal number of data descriptors per chain.
+	size_t _maxSegments;
 
-	// these two buffer store virtio-block request header and status bytes
-	// they are indexed by the index of the request's first descriptor
-	VirtRequest *virtRequestBuffer;
-	uint8_t *statusBuffer;
+	// Physical block size reported by the device (in bytes).
+	size_t _physicalBlockSize;
 
 	// The size of the disk
 	size_t _size;
@@ -78,7 +78,7 @@ struct GfxDevice final : drm_core::Device, std::enable_shared_from_this<GfxDevic
 
 		GfxDevice::BufferObject *getBufferObject();
 		uint32_t getPixelPitch();
-		void notifyDirty() override;
+		void notifyDirty(std::span<const drm_clip_rect> clips) override;
 		uint32_t getWidth() override;
 		uint32_t getHeight() override;
 
@@ -366,8 +366,8 @@ uint32_t GfxDevice::FrameBuffer::getHeight() {
 	return _bo->getHeight();
 }
 
-void GfxDevice::FrameBuffer::notifyDirty() {
-
+void GfxDevice::FrameBuffer::notifyDirty(std::span<const drm_clip_rect>) {
+	// Buffer objects live in VRAM and are scanned out directly; there is nothing to copy.
 }
 
 // ----------------------------------------------------------------
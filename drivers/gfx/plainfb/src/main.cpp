@@ -219,27 +219,9 @@ async::detached GfxDevice::Configuration::_dispatch(std::unique_ptr<drm_core::At
 
 		if(plane_state->fb != nullptr) {
 			auto fb = static_pointer_cast<GfxDevice::FrameBuffer>(plane_state->fb);
-
-			auto bo = fb->getBufferObject();
-			auto dest = reinterpret_cast<char *>(_device->_fbMapping.get());
-			auto src = reinterpret_cast<char *>(bo->accessMapping());
-
-			auto minWidth = std::min(bo->getWidth(), _device->_screenWidth);
-			auto minHeight = std::min(bo->getHeight(), _device->_screenHeight);
-
-			if(fb->fastScanout()) {
-				for(unsigned int k = 0; k < minHeight; k++) {
-					drm_core::fastCopy16(dest, src, minWidth * 4);
-					dest += _device->_screenPitch;
-					src += fb->getPitch();
-				}
-			}else{
-				for(unsigned int k = 0; k < minHeight; k++) {
-					memcpy(dest, src, minWidth * 4);
-					dest += _device->_screenPitch;
-					src += fb->getPitch();
-				}
-			}
+			fb->blit(drm_clip_rect{0, 0,
+					static_cast<unsigned short>(std::min(fb->getWidth(), uint32_t{0xFFFF})),
+					static_cast<unsigned short>(std::min(fb->getHeight(), uint32_t{0xFFFF}))});
 		}
 	} else {
 		std::cout << "gfx/plainfb: Disable scanout" << std::endl;
@@ -303,9 +285,53 @@ GfxDevice::BufferObject *GfxDevice::FrameBuffer::getBufferObject() {
 	return _bo.get();
 }
 
-void GfxDevice::FrameBuffer::notifyDirty() {
-	// TODO: Re-blit the FrameBuffer if it is currently displayed.
-	std::cout << "gfx/plainfb: notifyDirty() is not implemented correctly" << std::endl;
+void GfxDevice::FrameBuffer::notifyDirty(std::span<const drm_clip_rect> clips) {
+	// Only the framebuffer that is currently scanned out needs to be blitted.
+	auto crtc_state = _device->_theCrtc->drmState();
+	auto plane_state = _device->_plane->drmState();
+	if(!crtc_state || !crtc_state->mode || !plane_state || plane_state->fb.get() != this)
+		return;
+
+	drm_core::Damage damage;
+	damage.add(clips, getWidth(), getHeight());
+	for(auto &rect : damage.take())
+		blit(rect);
+}
+
+void GfxDevice::FrameBuffer::blit(drm_clip_rect rect) {
+	auto minWidth = std::min(_bo->getWidth(), _device->_screenWidth);
+	auto minHeight = std::min(_bo->getHeight(), _device->_screenHeight);
+
+	unsigned int x1 = rect.x1;
+	unsigned int x2 = std::min(static_cast<unsigned int>(rect.x2), minWidth);
+	unsigned int y1 = rect.y1;
+	unsigned int y2 = std::min(static_cast<unsigned int>(rect.y2), minHeight);
+	if(_fastScanout) {
+		// fastCopy16() needs 16-byte aligned rows, i.e., multiples of 4 pixels.
+		x1 &= ~3u;
+		x2 = std::min((x2 + 3) & ~3u, minWidth);
+	}
+	if(x1 >= x2 || y1 >= y2)
+		return;
+
+	auto dest = reinterpret_cast<char *>(_device->_fbMapping.get())
+			+ y1 * _device->_screenPitch + x1 * 4;
+	auto src = reinterpret_cast<char *>(_bo->accessMapping())
+			+ y1 * _pitch + x1 * 4;
+
+	if(_fastScanout) {
+		for(unsigned int k = y1; k < y2; k++) {
+			drm_core::fastCopy16(dest, src, (x2 - x1) * 4);
+			dest += _device->_screenPitch;
+			src += _pitch;
+		}
+	}else{
+		for(unsigned int k = y1; k < y2; k++) {
+			memcpy(dest, src, (x2 - x1) * 4);
+			dest += _device->_screenPitch;
+			src += _pitch;
+		}
+	}
 }
 
 uint32_t GfxDevice::FrameBuffer::getWidth() {
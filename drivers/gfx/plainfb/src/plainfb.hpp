@@ -76,10 +76,13 @@ struct GfxDevice final : drm_core::Device, std::enable_shared_from_this<GfxDevic
 		bool fastScanout() { return _fastScanout; }
 
 		GfxDevice::BufferObject *getBufferObject();
-		void notifyDirty() override;
+		void notifyDirty(std::span<const drm_clip_rect> clips) override;
 		uint32_t getWidth() override;
 		uint32_t getHeight() override;
 
+		// Copies a rectangle of the framebuffer to the hardware framebuffer.
+		void blit(drm_clip_rect rect);
+
 	private:
 		GfxDevice *_device;
 		std::shared_ptr<GfxDevice::BufferObject> _bo;
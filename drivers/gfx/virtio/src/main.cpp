@@ -301,9 +301,9 @@ async::detached GfxDevice::Configuration::_dispatch(std::unique_ptr<drm_core::At
 
 			co_await fb->getBufferObject()->wait();
 
-			co_await Cmd::transferToHost2d(pps->src_w, pps->src_h, resourceId, _device);
+			co_await Cmd::transferToHost2d(spec::Rect{0, 0, pps->src_w, pps->src_h}, 0, resourceId, _device);
 			co_await Cmd::setScanout(pps->src_w, pps->src_h, scanoutId, resourceId, _device);
-			co_await Cmd::resourceFlush(pps->src_w, pps->src_h, resourceId, _device);
+			co_await Cmd::resourceFlush(spec::Rect{0, 0, pps->src_w, pps->src_h}, resourceId, _device);
 		}
 	}
 
@@ -319,10 +319,10 @@ async::detached GfxDevice::Configuration::_dispatch(std::unique_ptr<drm_core::At
 			co_await fb->getBufferObject()->wait();
 
 			// TODO: if(!fb->getBufferObject()->is3D())
-				co_await Cmd::transferToHost2d(ps->src_w, ps->src_h, resourceId, _device);
+				co_await Cmd::transferToHost2d(spec::Rect{0, 0, ps->src_w, ps->src_h}, 0, resourceId, _device);
 
 			co_await Cmd::setScanout(ps->src_w, ps->src_h, static_pointer_cast<GfxDevice::Plane>(ps->plane)->scanoutId(), resourceId, _device);
-			co_await Cmd::resourceFlush(ps->src_w, ps->src_h, resourceId, _device);
+			co_await Cmd::resourceFlush(spec::Rect{0, 0, ps->src_w, ps->src_h}, resourceId, _device);
 		}
 	}
 
@@ -380,8 +380,10 @@ GfxDevice::BufferObject *GfxDevice::FrameBuffer::getBufferObject() {
 	return _bo.get();
 }
 
-void GfxDevice::FrameBuffer::notifyDirty() {
-	_xferAndFlush();
+void GfxDevice::FrameBuffer::notifyDirty(std::span<const drm_clip_rect> clips) {
+	_damage.add(clips, _bo->getWidth(), _bo->getHeight());
+	if(!_flushing)
+		_xferAndFlush();
 }
 
 uint32_t GfxDevice::FrameBuffer::getWidth() {
@@ -393,8 +395,20 @@ uint32_t GfxDevice::FrameBuffer::getHeight() {
 }
 
 async::detached GfxDevice::FrameBuffer::_xferAndFlush() {
-	co_await Cmd::transferToHost2d(_bo->getWidth(), _bo->getHeight(), _bo->resourceId(), _device);
-	co_await Cmd::resourceFlush(_bo->getWidth(), _bo->getHeight(), _bo->resourceId(), _device);
+	// Damage that arrives while we transfer is coalesced and handled by the next iteration.
+	_flushing = true;
+	while(!_damage.empty()) {
+		for(auto &clip : _damage.take()) {
+			spec::Rect rect{clip.x1, clip.y1,
+					static_cast<uint32_t>(clip.x2 - clip.x1),
+					static_cast<uint32_t>(clip.y2 - clip.y1)};
+			// The backing of 2D resources is tightly packed with 4 bytes per pixel.
+			uint64_t offset = (uint64_t{rect.y} * _bo->getWidth() + rect.x) * 4;
+			co_await Cmd::transferToHost2d(rect, offset, _bo->resourceId(), _device);
+			co_await Cmd::resourceFlush(rect, _bo->resourceId(), _device);
+		}
+	}
+	_flushing = false;
 }
 
 // ----------------------------------------------------------------
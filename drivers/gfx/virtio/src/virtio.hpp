@@ -104,7 +104,7 @@ struct GfxDevice final : drm_core::Device, std::enable_shared_from_this<GfxDevic
 		FrameBuffer(GfxDevice *device, std::shared_ptr<GfxDevice::BufferObject> bo);
 
 		GfxDevice::BufferObject *getBufferObject();
-		void notifyDirty() override;
+		void notifyDirty(std::span<const drm_clip_rect> clips) override;
 		uint32_t getWidth() override;
 		uint32_t getHeight() override;
 		async::detached _xferAndFlush();
@@ -112,6 +112,10 @@ struct GfxDevice final : drm_core::Device, std::enable_shared_from_this<GfxDevic
 	private:
 		std::shared_ptr<GfxDevice::BufferObject> _bo;
 		GfxDevice *_device;
+
+		drm_core::Damage _damage;
+		// True while _xferAndFlush() is running.
+		bool _flushing = false;
 	};
 
 	GfxDevice(std::unique_ptr<virtio_core::Transport> transport);
@@ -664,6 +664,7 @@ drm_core::Plane *GfxDevice::Crtc::Crtc::cursorPlane() {
 GfxDevice::FrameBuffer::FrameBuffer(GfxDevice *dev,
 		std::shared_ptr<GfxDevice::BufferObject> bo, uint32_t pixel_pitch)
 	: drm_core::FrameBuffer { dev, dev->allocator.allocate() } {
+	_device = dev;
 	_bo = bo;
 	_pixelPitch = pixel_pitch;
 }
@@ -676,8 +677,40 @@ uint32_t GfxDevice::FrameBuffer::getPixelPitch() {
 	return _pixelPitch;
 }
 
-void GfxDevice::FrameBuffer::notifyDirty() {
+void GfxDevice::FrameBuffer::notifyDirty(std::span<const drm_clip_rect> clips) {
+	_damage.add(clips, getWidth(), getHeight());
+	if(!_flushing)
+		_flushDamage();
+}
+
+async::detached GfxDevice::FrameBuffer::_flushDamage() {
+	// Damage that arrives while we flush is coalesced and handled by the next iteration.
+	_flushing = true;
+	while(!_damage.empty()) {
+		auto rects = _damage.take();
+
+		// Only the framebuffer that is currently scanned out needs to be copied.
+		auto plane_state = _device->_primaryPlane->drmState();
+		if(!plane_state || plane_state->fb.get() != this)
+			continue;
+
+		// Like commitConfiguration(), assume that the hardware pitch matches the BO.
+		helix::Mapping user_fb{_bo->getMemory().first, 0, _bo->getSize()};
+		for(auto &rect : rects) {
+			auto offset = rect.y1 * _pixelPitch + rect.x1 * 4;
+			auto dest = reinterpret_cast<char *>(_device->_fbMapping.get()) + offset;
+			auto src = reinterpret_cast<const char *>(user_fb.get()) + offset;
+			for(unsigned int k = rect.y1; k < rect.y2; k++) {
+				memcpy(dest, src, (rect.x2 - rect.x1) * 4);
+				dest += _pixelPitch;
+				src += _pixelPitch;
+			}
 
+			co_await _device->_fifo.updateRectangle(rect.x1, rect.y1,
+					rect.x2 - rect.x1, rect.y2 - rect.y1);
+		}
+	}
+	_flushing = false;
 }
 
 uint32_t GfxDevice::FrameBuffer::getWidth() {
@@ -76,13 +76,21 @@ struct GfxDevice final : drm_core::Device, std::enable_shared_from_this<GfxDevic
 
 		GfxDevice::BufferObject *getBufferObject();
 		uint32_t getPixelPitch();
-		void notifyDirty() override;
+		void notifyDirty(std::span<const drm_clip_rect> clips) override;
 		uint32_t getWidth() override;
 		uint32_t getHeight() override;
 
 	private:
+		// Copies damaged rectangles to the hardware framebuffer and updates them.
+		async::detached _flushDamage();
+
+		GfxDevice *_device;
 		std::shared_ptr<GfxDevice::BufferObject> _bo;
 		uint32_t _pixelPitch;
+
+		drm_core::Damage _damage;
+		// True while _flushDamage() is running.
+		bool _flushing = false;
 	};
 
 	struct DeviceFifo {
@@ -4,10 +4,30 @@
 #include <protocols/fs/common.hpp>
 #include <protocols/mbus/client.hpp>
 #include <protocols/ostrace/ostrace.hpp>
+#include <span>
 #include <stdint.h>
 
 namespace blockfs {
 
+// Describes a single transfer for BlockDevice::transferSectors().
+struct SectorTransfer {
+	bool write;
+	uint64_t sector;
+	void *buffer;
+	size_t numSectors;
+};
+
+// Policy that libblockfs uses to order requests before they reach the device.
+// The values match managarm::fs::IoScheduler.
+enum class IoScheduler {
+	// FIFO order; only merges requests with the most recently queued one.
+	noop = 0,
+	// Sector-sorted order with expiry times for reads and writes.
+	deadline = 1,
+	// Per-CPU FIFOs without sorting; intended for devices with deep queues such as NVMe.
+	multiQueue = 2
+};
+
 struct BlockDevice {
 	BlockDevice(size_t sector_size, int64_t parent_id);
 
@@ -20,6 +40,10 @@ struct BlockDevice {
 		throw std::runtime_error("BlockDevice does not support writeSectors()");
 	}
 
+	// Performs multiple transfers. Implementations may reorder and merge them.
+	// The default implementation performs them one by one.
+	virtual async::result<void> transferSectors(std::span<const SectorTransfer> transfers);
+
 	virtual async::result<size_t> getSize() = 0;
 
 	virtual async::result<void> handleIoctl(managarm::fs::GenericIoctlRequest &req, helix::UniqueDescriptor conversation) {
@@ -38,6 +62,16 @@ struct BlockDevice {
 	std::string diskNamePrefix = "sd";
 	std::string diskNameSuffix = "";
 	std::string partNameSuffix = "";
+
+	// Initial scheduling policy and number of requests that libblockfs keeps in flight.
+	// Both can be changed at runtime through sysfs.
+	IoScheduler ioScheduler = IoScheduler::deadline;
+	size_t queueDepth = 32;
+
+	// Set by drivers whose transferSectors() does not perform the transfers one by one.
+	// libblockfs only merges requests for such devices; otherwise, merging would
+	// serialize transfers that could be in flight concurrently.
+	bool vectoredTransfers = false;
 protected:
 };
 
@@ -64,6 +64,9 @@ struct StorageDevice : Interface, blockfs::BlockDevice {
 
 	size_t storageSize{};
 
+	// Number of commands that sendScsiCommand() can handle concurrently.
+	size_t commandSlots{1};
+
 private:
 	struct Request {
 		Request(bool isWrite, uint64_t sector, void *buffer, size_t numSectors)
@@ -77,7 +80,10 @@ private:
 		frg::default_list_hook<Request> requestHook;
 	};
 
+	async::detached handleRequest_(Request *req);
+
 	async::recurring_event doorbell_;
+	size_t inFlight_{0};
 
 	frg::intrusive_list<
 		Request,
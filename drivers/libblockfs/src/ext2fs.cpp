@@ -1,8 +1,10 @@
 
+#include <dirent.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <algorithm>
+#include <bit>
 #include <iostream>
 #include <sys/stat.h>
 
@@ -23,6 +25,206 @@ namespace {
 
 	constexpr int pageShift = 12;
 	constexpr size_t pageSize = size_t{1} << pageShift;
+
+	// Upper bits of DxEntry::block are reserved.
+	constexpr uint32_t dxBlockMask = 0x0FFFFFFF;
+	// ext3 supports up to two levels of index nodes (incl. the root).
+	constexpr int dxMaxIndirectLevels = 1;
+
+	// Maximal number of entries in the name cache of an indexed directory.
+	constexpr size_t maxCachedNames = 4096;
+
+	DirEntry makeDirEntry(DiskDirEntry *disk_entry) {
+		DirEntry entry;
+		entry.inode = disk_entry->inode;
+
+		switch(disk_entry->fileType) {
+		case EXT2_FT_REG_FILE:
+			entry.fileType = kTypeRegular; break;
+		case EXT2_FT_DIR:
+			entry.fileType = kTypeDirectory; break;
+		case EXT2_FT_SYMLINK:
+			entry.fileType = kTypeSymlink; break;
+		default:
+			entry.fileType = kTypeNone;
+		}
+
+		return entry;
+	}
+
+	uint8_t direntType(DiskDirEntry *disk_entry) {
+		switch(disk_entry->fileType) {
+		case EXT2_FT_REG_FILE:
+			return DT_REG;
+		case EXT2_FT_DIR:
+			return DT_DIR;
+		case EXT2_FT_SYMLINK:
+			return DT_LNK;
+		default:
+			return DT_UNKNOWN;
+		}
+	}
+
+	// ----------------------------------------------------------------
+	// Directory index hash functions.
+	// These need to match the ones in Linux' fs/ext4/hash.c bit by bit.
+	// Char is either signed char or unsigned char, depending on the variant.
+	// ----------------------------------------------------------------
+
+	template<typename Char>
+	uint32_t legacyHash(const char *name, int length) {
+		uint32_t hash0 = 0x12a3fe2d;
+		uint32_t hash1 = 0x37abe8f9;
+		while(length--) {
+			uint32_t c = static_cast<int>(static_cast<Char>(*name++));
+			uint32_t hash = hash1 + (hash0 ^ (c * 7152373));
+			if(hash & 0x80000000)
+				hash -= 0x7fffffff;
+			hash1 = hash0;
+			hash0 = hash;
+		}
+		return hash0 << 1;
+	}
+
+	template<typename Char>
+	void stringToHashBuffer(const char *msg, int length, uint32_t *buffer, int num) {
+		uint32_t pad = static_cast<uint32_t>(length) | (static_cast<uint32_t>(length) << 8);
+		pad |= pad << 16;
+
+		uint32_t value = pad;
+		if(length > num * 4)
+			length = num * 4;
+		for(int i = 0; i < length; i++) {
+			value = static_cast<uint32_t>(static_cast<int>(static_cast<Char>(msg[i])))
+					+ (value << 8);
+			if((i % 4) == 3) {
+				*buffer++ = value;
+				value = pad;
+				num--;
+			}
+		}
+		if(--num >= 0)
+			*buffer++ = value;
+		while(--num >= 0)
+			*buffer++ = pad;
+	}
+
+	void teaTransform(uint32_t buffer[4], const uint32_t in[4]) {
+		uint32_t sum = 0;
+		uint32_t b0 = buffer[0], b1 = buffer[1];
+		uint32_t a = in[0], b = in[1], c = in[2], d = in[3];
+
+		for(int n = 0; n < 16; n++) {
+			sum += 0x9E3779B9;
+			b0 += ((b1 << 4) + a) ^ (b1 + sum) ^ ((b1 >> 5) + b);
+			b1 += ((b0 << 4) + c) ^ (b0 + sum) ^ ((b0 >> 5) + d);
+		}
+
+		buffer[0] += b0;
+		buffer[1] += b1;
+	}
+
+	void halfMd4Transform(uint32_t buffer[4], const uint32_t in[8]) {
+		auto f = [] (uint32_t x, uint32_t y, uint32_t z) { return z ^ (x & (y ^ z)); };
+		auto g = [] (uint32_t x, uint32_t y, uint32_t z) { return (x & y) + ((x ^ y) & z); };
+		auto h = [] (uint32_t x, uint32_t y, uint32_t z) { return x ^ y ^ z; };
+		auto round = [] (auto fn, uint32_t &a, uint32_t b, uint32_t c, uint32_t d,
+				uint32_t x, int s) {
+			a = std::rotl(a + fn(b, c, d) + x, s);
+		};
+		constexpr uint32_t k2 = 013240474631;
+		constexpr uint32_t k3 = 015666365641;
+
+		uint32_t a = buffer[0], b = buffer[1], c = buffer[2], d = buffer[3];
+
+		round(f, a, b, c, d, in[0], 3);
+		round(f, d, a, b, c, in[1], 7);
+		round(f, c, d, a, b, in[2], 11);
+		round(f, b, c, d, a, in[3], 19);
+		round(f, a, b, c, d, in[4], 3);
+		round(f, d, a, b, c, in[5], 7);
+		round(f, c, d, a, b, in[6], 11);
+		round(f, b, c, d, a, in[7], 19);
+
+		round(g, a, b, c, d, in[1] + k2, 3);
+		round(g, d, a, b, c, in[3] + k2, 5);
+		round(g, c, d, a, b, in[5] + k2, 9);
+		round(g, b, c, d, a, in[7] + k2, 13);
+		round(g, a, b, c, d, in[0] + k2, 3);
+		round(g, d, a, b, c, in[2] + k2, 5);
+		round(g, c, d, a, b, in[4] + k2, 9);
+		round(g, b, c, d, a, in[6] + k2, 13);
+
+		round(h, a, b, c, d, in[3] + k3, 3);
+		round(h, d, a, b, c, in[7] + k3, 9);
+		round(h, c, d, a, b, in[2] + k3, 11);
+		round(h, b, c, d, a, in[6] + k3, 15);
+		round(h, a, b, c, d, in[1] + k3, 3);
+		round(h, d, a, b, c, in[5] + k3, 9);
+		round(h, c, d, a, b, in[0] + k3, 11);
+		round(h, b, c, d, a, in[4] + k3, 15);
+
+		buffer[0] += a;
+		buffer[1] += b;
+		buffer[2] += c;
+		buffer[3] += d;
+	}
+
+	template<typename Char>
+	uint32_t halfMd4Hash(uint32_t buffer[4], const char *name, int length) {
+		uint32_t in[8];
+		while(length > 0) {
+			stringToHashBuffer<Char>(name, length, in, 8);
+			halfMd4Transform(buffer, in);
+			length -= 32;
+			name += 32;
+		}
+		return buffer[1];
+	}
+
+	template<typename Char>
+	uint32_t teaHash(uint32_t buffer[4], const char *name, int length) {
+		uint32_t in[4];
+		while(length > 0) {
+			stringToHashBuffer<Char>(name, length, in, 4);
+			teaTransform(buffer, in);
+			length -= 16;
+			name += 16;
+		}
+		return buffer[0];
+	}
+
+	uint32_t dirHash(int version, const uint32_t seed[4], std::string_view name) {
+		uint32_t buffer[4] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476};
+		if(seed[0] || seed[1] || seed[2] || seed[3])
+			memcpy(buffer, seed, sizeof(buffer));
+
+		uint32_t hash;
+		switch(version) {
+		case DX_HASH_LEGACY:
+			hash = legacyHash<signed char>(name.data(), name.size()); break;
+		case DX_HASH_HALF_MD4:
+			hash = halfMd4Hash<signed char>(buffer, name.data(), name.size()); break;
+		case DX_HASH_TEA:
+			hash = teaHash<signed char>(buffer, name.data(), name.size()); break;
+		case DX_HASH_LEGACY_UNSIGNED:
+			hash = legacyHash<unsigned char>(name.data(), name.size()); break;
+		case DX_HASH_HALF_MD4_UNSIGNED:
+			hash = halfMd4Hash<unsigned char>(buffer, name.data(), name.size()); break;
+		case DX_HASH_TEA_UNSIGNED:
+			hash = teaHash<unsigned char>(buffer, name.data(), name.size()); break;
+		default:
+			assert(!"unexpected directory hash version");
+			__builtin_unreachable();
+		}
+
+		// The lowest bit is used to mark hash collisions in the index.
+		// The largest hash value is reserved as an end-of-directory marker.
+		hash &= ~uint32_t(1);
+		if(hash == (uint32_t(0x7fffffff) << 1))
+			hash = uint32_t(0x7fffffff - 1) << 1;
+		return hash;
+	}
 }
 
 // --------------------------------------------------------
@@ -45,15 +247,35 @@ Inode::findEntry(std::string name) {
 		co_return protocols::fs::Error::notDirectory;
 	assert(fileMapping.size() == fileSize());
 
-	helix::LockMemoryView lock_memory;
-	auto map_size = (fileSize() + 0xFFF) & ~size_t(0xFFF);
-	auto &&submit = helix::submitLockMemoryView(helix::BorrowedDescriptor(frontalMemory),
-			&lock_memory,
-			0, map_size, helix::Dispatcher::global());
-	co_await submit.async_wait();
-	HEL_CHECK(lock_memory.error());
+	if(auto it = nameCache.find(name); it != nameCache.end())
+		co_return it->second;
+	if(nameCacheComplete)
+		co_return std::nullopt;
+
+	auto lock = co_await lockDirectory();
+
+	if(isIndexed()) {
+		uint32_t hash;
+		std::vector<DxFrame> frames;
+		if(dxProbe(name, hash, frames)) {
+			do {
+				auto disk_entry = findInBlock(frames.back().at->block & dxBlockMask, name);
+				if(disk_entry) {
+					auto entry = makeDirEntry(disk_entry);
+					cacheName(name, entry);
+					co_return entry;
+				}
+			} while(dxNextLeaf(frames, hash));
 
-	// Read the directory structure.
+			co_return std::nullopt;
+		}
+
+		std::cout << "\e[33m" "ext2fs: Invalid directory index in inode " << number
+				<< ", falling back to linear search" "\e[39m" << std::endl;
+	}
+
+	// Read the directory structure and fill the name cache on the way.
+	std::optional<DirEntry> result;
 	uintptr_t offset = 0;
 	while(offset < fileSize()) {
 		assert(!(offset & 3));
@@ -62,31 +284,21 @@ Inode::findEntry(std::string name) {
 				reinterpret_cast<char *>(fileMapping.get()) + offset);
 		assert(disk_entry->recordLength);
 
-		if(disk_entry->inode
-				&& name.length() == disk_entry->nameLength
-				&& !memcmp(disk_entry->name, name.data(), name.length())) {
-			DirEntry entry;
-			entry.inode = disk_entry->inode;
-
-			switch(disk_entry->fileType) {
-			case EXT2_FT_REG_FILE:
-				entry.fileType = kTypeRegular; break;
-			case EXT2_FT_DIR:
-				entry.fileType = kTypeDirectory; break;
-			case EXT2_FT_SYMLINK:
-				entry.fileType = kTypeSymlink; break;
-			default:
-				entry.fileType = kTypeNone;
-			}
+		if(disk_entry->inode) {
+			auto entry = makeDirEntry(disk_entry);
+			nameCache.insert({std::string(disk_entry->name, disk_entry->nameLength), entry});
 
-			co_return entry;
+			if(name.length() == disk_entry->nameLength
+					&& !memcmp(disk_entry->name, name.data(), name.length()))
+				result = entry;
 		}
 
 		offset += disk_entry->recordLength;
 	}
 	assert(offset == fileSize());
+	nameCacheComplete = true;
 
-	co_return std::nullopt;
+	co_return result;
 }
 
 async::result<std::optional<DirEntry>>
@@ -143,16 +355,11 @@ Inode::link(std::string name, int64_t ino, blockfs::FileType type) {
 		DirEntry entry;
 		entry.inode = ino;
 		entry.fileType = type;
+		cacheName(name, entry);
 		co_return entry;
 	};
 
-	helix::LockMemoryView lock_memory;
-	auto map_size = (fileSize() + 0xFFF) & ~size_t(0xFFF);
-	auto &&submit = helix::submitLockMemoryView(helix::BorrowedDescriptor(frontalMemory),
-			&lock_memory,
-			0, map_size, helix::Dispatcher::global());
-	co_await submit.async_wait();
-	HEL_CHECK(lock_memory.error());
+	auto lock = co_await lockDirectory();
 
 	auto time = clk::getRealtime();
 	diskInode()->mtime = time.tv_sec;
@@ -166,51 +373,31 @@ Inode::link(std::string name, int64_t ino, blockfs::FileType type) {
 	// We use name.size() + 1 for the entry name length to account for the null terminator
 	auto required = (sizeof(DiskDirEntry) + name.size() + 1 + 3) & ~size_t(3);
 
-	// Walk the directory structure.
-	uintptr_t offset = 0;
-	while(offset < fileSize()) {
-		assert(!(offset & 3));
-		assert(offset + sizeof(DiskDirEntry) <= fileSize());
-		auto previous_entry = reinterpret_cast<DiskDirEntry *>(
-				reinterpret_cast<char *>(fileMapping.get()) + offset);
-		assert(previous_entry->recordLength);
-
-		// Calculate available space after we contract previous_entry.
-		auto contracted = (sizeof(DiskDirEntry) + previous_entry->nameLength + 3) & ~size_t(3);
-		assert(previous_entry->recordLength >= contracted);
-		auto available = previous_entry->recordLength - contracted;
-
-		// Check whether we can shrink previous_entry and insert a new entry after it.
-		if(available >= required) {
-			// Update the existing dentry.
-			previous_entry->recordLength = contracted;
-
-			co_return co_await appendDirEntry(offset + contracted, available);
+	if(isIndexed()) {
+		auto space = co_await dxFindSpace(name, required);
+		if(space) {
+			// dxFindSpace() might have grown the directory.
+			auto grownLock = co_await lockDirectory();
+			co_return co_await appendDirEntry(space->first, space->second);
 		}
-
-		offset += previous_entry->recordLength;
 	}
-	assert(offset == fileSize());
+
+	// Inserting entries without updating the index would corrupt it.
+	if(diskInode()->flags & EXT2_INDEX_FL)
+		co_await dropIndex();
+
+	// Walk the directory structure.
+	auto space = findSpace(0, fileSize(), required);
+	if(space)
+		co_return co_await appendDirEntry(space->first, space->second);
 
 	// If we made it this far, we ran out of space in the directory. Resize it.
-	auto blockOffset = (offset & ~(fs.blockSize - 1)) >> fs.blockShift;
-	auto newSize = (offset + fs.blockSize + 0xFFF) & ~size_t(0xFFF);
-	setFileSize(newSize);
-	co_await fs.assignDataBlocks(this, blockOffset, 1);
-	HEL_CHECK(helResizeMemory(backingMemory, newSize));
-	fileMapping = helix::Mapping{helix::BorrowedDescriptor{frontalMemory},
-			0, newSize,
-			kHelMapProtRead | kHelMapProtWrite | kHelMapDontRequireBacking};
+	auto offset = fileSize();
+	co_await appendDirectoryBlock();
 
 	// Now append the entry that we couldn't add before.
 	{
-		helix::LockMemoryView lock_memory;
-		auto &&submit = helix::submitLockMemoryView(helix::BorrowedDescriptor(frontalMemory),
-				&lock_memory,
-				0, newSize, helix::Dispatcher::global());
-		co_await submit.async_wait();
-		HEL_CHECK(lock_memory.error());
-
+		auto grownLock = co_await lockDirectory();
 		co_return co_await appendDirEntry(offset, fileSize() - offset);
 	}
 }
@@ -224,99 +411,87 @@ async::result<frg::expected<protocols::fs::Error>> Inode::unlink(std::string nam
 		co_return protocols::fs::Error::notDirectory;
 	assert(fileMapping.size() == fileSize());
 
-	helix::LockMemoryView lock_memory;
-	auto map_size = (fileSize() + 0xFFF) & ~size_t(0xFFF);
-	auto &&submit = helix::submitLockMemoryView(helix::BorrowedDescriptor(frontalMemory),
-			&lock_memory,
-			0, map_size, helix::Dispatcher::global());
-	co_await submit.async_wait();
-	HEL_CHECK(lock_memory.error());
+	auto lock = co_await lockDirectory();
 
-	// Read the directory structure.
+	// Find the entry and its predecessor in the same block.
+	DiskDirEntry *disk_entry = nullptr;
 	DiskDirEntry *previous_entry = nullptr;
-	uintptr_t offset = 0;
-	while(offset < fileSize()) {
-		assert(!(offset & 3));
-		assert(offset + sizeof(DiskDirEntry) <= fileSize());
-		auto disk_entry = reinterpret_cast<DiskDirEntry *>(
-				reinterpret_cast<char *>(fileMapping.get()) + offset);
-		assert(disk_entry->recordLength);
-
-		if(disk_entry->inode
-				&& name.length() == disk_entry->nameLength
-				&& !memcmp(disk_entry->name, name.data(), name.length())) {
+	uint32_t hash;
+	std::vector<DxFrame> frames;
+	if(isIndexed() && dxProbe(name, hash, frames)) {
+		do {
+			disk_entry = findInBlock(frames.back().at->block & dxBlockMask,
+					name, &previous_entry);
+		} while(!disk_entry && dxNextLeaf(frames, hash));
+	}else{
+		auto numBlocks = fileSize() >> fs.blockShift;
+		for(uint64_t block = 0; block < numBlocks && !disk_entry; block++)
+			disk_entry = findInBlock(block, name, &previous_entry);
+	}
+	if(!disk_entry)
+		co_return protocols::fs::Error::fileNotFound;
 
-			auto target = fs.accessInode(disk_entry->inode);
-			co_await target->readyJump.wait();
+	auto target = fs.accessInode(disk_entry->inode);
+	co_await target->readyJump.wait();
 
-			if(target->fileType == kTypeDirectory) {
-				if(target->diskInode()->linksCount > 2) {
-					co_return protocols::fs::Error::directoryNotEmpty;
-				}
+	if(target->fileType == kTypeDirectory) {
+		if(target->diskInode()->linksCount > 2) {
+			co_return protocols::fs::Error::directoryNotEmpty;
+		}
 
-				helix::LockMemoryView target_lock_memory;
-				auto target_map_size = (target->fileSize() + 0xFFF) & ~size_t(0xFFF);
-				auto &&target_submit = helix::submitLockMemoryView(helix::BorrowedDescriptor(target->frontalMemory),
-						&target_lock_memory,
-						0, target_map_size, helix::Dispatcher::global());
-				co_await target_submit.async_wait();
-				HEL_CHECK(target_lock_memory.error());
-
-				// Check the directory entries for anything other than "." and "..".
-				uintptr_t target_offset = 0;
-				while(target_offset < target->fileSize()) {
-					assert(!(target_offset & 3));
-					assert(target_offset + sizeof(DiskDirEntry) <= target->fileSize());
-					auto target_disk_entry = reinterpret_cast<DiskDirEntry *>(
-						reinterpret_cast<char*>(target->fileMapping.get()) + target_offset);
-					assert(target_disk_entry);
-					assert(target_disk_entry->recordLength);
-
-					if(target_disk_entry->inode
-						&& target_disk_entry->nameLength == 2
-						&& target_disk_entry->name[0] == '.'
-						&& target_disk_entry->name[1] == '.') {
-						// ".."
-					} else if(target_disk_entry->inode
-						&& target_disk_entry->nameLength == 1
-						&& target_disk_entry->name[0] == '.') {
-						// "."
-					} else {
-						// Directory has stuff in it, do not delete it.
-						co_return protocols::fs::Error::directoryNotEmpty;
-					}
-
-					target_offset += target_disk_entry->recordLength;
-				}
+		auto target_lock = co_await target->lockDirectory();
+
+		// Check the directory entries for anything other than "." and "..".
+		uintptr_t target_offset = 0;
+		while(target_offset < target->fileSize()) {
+			assert(!(target_offset & 3));
+			assert(target_offset + sizeof(DiskDirEntry) <= target->fileSize());
+			auto target_disk_entry = reinterpret_cast<DiskDirEntry *>(
+				reinterpret_cast<char*>(target->fileMapping.get()) + target_offset);
+			assert(target_disk_entry);
+			assert(target_disk_entry->recordLength);
+
+			if(target_disk_entry->inode
+				&& target_disk_entry->nameLength == 2
+				&& target_disk_entry->name[0] == '.'
+				&& target_disk_entry->name[1] == '.') {
+				// ".."
+			} else if(target_disk_entry->inode
+				&& target_disk_entry->nameLength == 1
+				&& target_disk_entry->name[0] == '.') {
+				// "."
+			} else if(target_disk_entry->inode) {
+				// Directory has stuff in it, do not delete it.
+				co_return protocols::fs::Error::directoryNotEmpty;
 			}
 
-			// The directory should start with "." and "..". As those entries are never deleted,
-			// we can assume that a previous entry exists.
-			assert(previous_entry);
-			previous_entry->recordLength += disk_entry->recordLength;
-
-			// Flush the data to disk.
-			// TODO: It would be enough to flush only one or two pages here.
-			auto syncDir = co_await helix_ng::synchronizeSpace(
-					helix::BorrowedDescriptor{kHelNullHandle}, fileMapping.get(), fileSize());
-			HEL_CHECK(syncDir.error());
-
-			// Decrement the inode's link count
-			target->diskInode()->linksCount--;
-			auto syncInode = co_await helix_ng::synchronizeSpace(
-					helix::BorrowedDescriptor{kHelNullHandle},
-					target->diskMapping.get(), fs.inodeSize);
-			HEL_CHECK(syncInode.error());
-
-			co_return {};
+			target_offset += target_disk_entry->recordLength;
 		}
+	}
 
-		offset += disk_entry->recordLength;
-		previous_entry = disk_entry;
+	// Entries must not span multiple blocks. Hence, we merge the entry into its
+	// predecessor within the same block; the first entry of a block is marked as unused.
+	if(previous_entry) {
+		previous_entry->recordLength += disk_entry->recordLength;
+	}else{
+		disk_entry->inode = 0;
 	}
-	assert(offset == fileSize());
+	nameCache.erase(name);
 
-	co_return protocols::fs::Error::fileNotFound;
+	// Flush the data to disk.
+	// TODO: It would be enough to flush only one or two pages here.
+	auto syncDir = co_await helix_ng::synchronizeSpace(
+			helix::BorrowedDescriptor{kHelNullHandle}, fileMapping.get(), fileSize());
+	HEL_CHECK(syncDir.error());
+
+	// Decrement the inode's link count
+	target->diskInode()->linksCount--;
+	auto syncInode = co_await helix_ng::synchronizeSpace(
+			helix::BorrowedDescriptor{kHelNullHandle},
+			target->diskMapping.get(), fs.inodeSize);
+	HEL_CHECK(syncInode.error());
+
+	co_return {};
 }
 
 async::result<std::optional<DirEntry>> Inode::mkdir(std::string name) {
@@ -438,6 +613,308 @@ async::result<protocols::fs::Error> Inode::utimensat(std::optional<timespec> ati
 	co_return protocols::fs::Error::none;
 }
 
+async::result<helix::UniqueDescriptor> Inode::lockDirectory() {
+	helix::LockMemoryView lock_memory;
+	auto map_size = (fileSize() + 0xFFF) & ~size_t(0xFFF);
+	auto &&submit = helix::submitLockMemoryView(helix::BorrowedDescriptor(frontalMemory),
+			&lock_memory,
+			0, map_size, helix::Dispatcher::global());
+	co_await submit.async_wait();
+	HEL_CHECK(lock_memory.error());
+	co_return lock_memory.descriptor();
+}
+
+std::shared_ptr<helix::Mapping> Inode::accessReadMapping() {
+	auto mapSize = (fileSize() + 0xFFF) & ~size_t(0xFFF);
+	if(!readMapping || readMapping->size() != mapSize)
+		readMapping = std::make_shared<helix::Mapping>(helix::BorrowedDescriptor{frontalMemory},
+				0, mapSize, kHelMapProtRead | kHelMapDontRequireBacking);
+	return readMapping;
+}
+
+async::result<uint64_t> Inode::appendDirectoryBlock() {
+	auto offset = fileSize();
+	assert(!(offset & (fs.blockSize - 1)));
+	auto blockOffset = offset >> fs.blockShift;
+	auto newSize = offset + fs.blockSize;
+
+	setFileSize(newSize);
+	co_await fs.assignDataBlocks(this, blockOffset, 1);
+	HEL_CHECK(helResizeMemory(backingMemory, (newSize + 0xFFF) & ~size_t(0xFFF)));
+	fileMapping = helix::Mapping{helix::BorrowedDescriptor{frontalMemory},
+			0, newSize,
+			kHelMapProtRead | kHelMapProtWrite | kHelMapDontRequireBacking};
+
+	co_return blockOffset;
+}
+
+std::optional<std::pair<size_t, size_t>> Inode::findSpace(size_t begin, size_t end,
+		size_t required) {
+	uintptr_t offset = begin;
+	while(offset < end) {
+		assert(!(offset & 3));
+		assert(offset + sizeof(DiskDirEntry) <= end);
+		auto previous_entry = reinterpret_cast<DiskDirEntry *>(
+				reinterpret_cast<char *>(fileMapping.get()) + offset);
+		assert(previous_entry->recordLength);
+
+		// Unused entries can be overwritten.
+		if(!previous_entry->inode && previous_entry->recordLength >= required)
+			return std::pair<size_t, size_t>{offset, previous_entry->recordLength};
+
+		// Calculate available space after we contract previous_entry.
+		auto contracted = (sizeof(DiskDirEntry) + previous_entry->nameLength + 3) & ~size_t(3);
+		assert(previous_entry->recordLength >= contracted);
+		auto available = previous_entry->recordLength - contracted;
+
+		// Check whether we can shrink previous_entry and insert a new entry after it.
+		if(available >= required) {
+			// Update the existing dentry.
+			previous_entry->recordLength = contracted;
+			return std::pair<size_t, size_t>{offset + contracted, available};
+		}
+
+		offset += previous_entry->recordLength;
+	}
+	assert(offset == end);
+
+	return std::nullopt;
+}
+
+DiskDirEntry *Inode::findInBlock(uint64_t block, std::string_view name,
+		DiskDirEntry **previous) {
+	auto begin = block << fs.blockShift;
+	auto end = begin + fs.blockSize;
+	assert(end <= fileSize());
+
+	DiskDirEntry *previous_entry = nullptr;
+	uintptr_t offset = begin;
+	while(offset < end) {
+		assert(!(offset & 3));
+		assert(offset + sizeof(DiskDirEntry) <= end);
+		auto disk_entry = reinterpret_cast<DiskDirEntry *>(
+				reinterpret_cast<char *>(fileMapping.get()) + offset);
+		assert(disk_entry->recordLength);
+
+		if(disk_entry->inode
+				&& name.length() == disk_entry->nameLength
+				&& !memcmp(disk_entry->name, name.data(), name.length())) {
+			if(previous)
+				*previous = previous_entry;
+			return disk_entry;
+		}
+
+		offset += disk_entry->recordLength;
+		previous_entry = disk_entry;
+	}
+	assert(offset == end);
+
+	return nullptr;
+}
+
+bool Inode::isIndexed() {
+	return fs.dirIndex && (diskInode()->flags & EXT2_INDEX_FL);
+}
+
+bool Inode::dxProbe(std::string_view name, uint32_t &hash, std::vector<DxFrame> &frames) {
+	auto base = reinterpret_cast<char *>(fileMapping.get());
+
+	// The root needs at least one leaf.
+	if(fileSize() < 2 * fs.blockSize)
+		return false;
+
+	// The root info follows the "." (12 bytes) and ".." (12 bytes) entries.
+	auto info = reinterpret_cast<DxRootInfo *>(base + 24);
+	if(info->reservedZero
+			|| info->infoLength != sizeof(DxRootInfo)
+			|| info->indirectLevels > dxMaxIndirectLevels
+			|| info->hashVersion > DX_HASH_TEA)
+		return false;
+
+	hash = dirHash(dxHashVersion(), fs.hashSeed, name);
+
+	frames.clear();
+	auto entries = reinterpret_cast<DxEntry *>(base + 24 + info->infoLength);
+	auto nodeEnd = base + fs.blockSize;
+	for(int level = 0; ; level++) {
+		auto countLimit = reinterpret_cast<DxCountLimit *>(entries);
+		if(!countLimit->count
+				|| countLimit->count > countLimit->limit
+				|| entries + countLimit->limit > reinterpret_cast<DxEntry *>(nodeEnd))
+			return false;
+
+		// Find the last entry whose hash is <= the target hash.
+		// The first entry does not store a hash; it covers all hashes below the second one.
+		auto p = entries + 1;
+		auto q = entries + countLimit->count - 1;
+		while(p <= q) {
+			auto m = p + (q - p) / 2;
+			if(m->hash > hash) {
+				q = m - 1;
+			}else{
+				p = m + 1;
+			}
+		}
+		frames.push_back({entries, p - 1});
+
+		auto block = static_cast<uint64_t>((p - 1)->block & dxBlockMask);
+		if(!block || ((block + 1) << fs.blockShift) > fileSize())
+			return false;
+		if(level == info->indirectLevels)
+			return true;
+
+		// Interior nodes start with an 8 byte fake directory entry.
+		entries = reinterpret_cast<DxEntry *>(base + (block << fs.blockShift) + 8);
+		nodeEnd = base + ((block + 1) << fs.blockShift);
+	}
+}
+
+int Inode::dxHashVersion() {
+	auto info = reinterpret_cast<DxRootInfo *>(
+			reinterpret_cast<char *>(fileMapping.get()) + 24);
+	int version = info->hashVersion;
+	if(fs.unsignedHash)
+		version += DX_HASH_LEGACY_UNSIGNED;
+	return version;
+}
+
+bool Inode::dxNextLeaf(std::vector<DxFrame> &frames, uint32_t hash) {
+	auto base = reinterpret_cast<char *>(fileMapping.get());
+
+	// Go up until we find a node that has more entries.
+	size_t level = frames.size() - 1;
+	while(true) {
+		auto &frame = frames[level];
+		auto countLimit = reinterpret_cast<DxCountLimit *>(frame.entries);
+		if(++frame.at < frame.entries + countLimit->count)
+			break;
+		if(!level)
+			return false;
+		level--;
+	}
+
+	// The next leaf is only relevant if it continues our hash.
+	if((frames[level].at->hash & ~uint32_t(1)) != hash)
+		return false;
+
+	// Go down to the leftmost leaf below the new position.
+	for(; level + 1 < frames.size(); level++) {
+		auto block = static_cast<uint64_t>(frames[level].at->block & dxBlockMask);
+		if(((block + 1) << fs.blockShift) > fileSize())
+			return false;
+		auto entries = reinterpret_cast<DxEntry *>(base + (block << fs.blockShift) + 8);
+		frames[level + 1] = {entries, entries};
+	}
+	auto leaf = static_cast<uint64_t>(frames.back().at->block & dxBlockMask);
+	return ((leaf + 1) << fs.blockShift) <= fileSize();
+}
+
+async::result<std::optional<std::pair<size_t, size_t>>>
+Inode::dxFindSpace(std::string_view name, size_t required) {
+	uint32_t hash;
+	std::vector<DxFrame> frames;
+	if(!dxProbe(name, hash, frames)) {
+		std::cout << "\e[33m" "ext2fs: Invalid directory index in inode " << number
+				<< "\e[39m" << std::endl;
+		co_return std::nullopt;
+	}
+
+	auto leafBlock = static_cast<uint64_t>(frames.back().at->block & dxBlockMask);
+	auto leafBegin = leafBlock << fs.blockShift;
+	if(auto space = findSpace(leafBegin, leafBegin + fs.blockSize, required); space)
+		co_return space;
+
+	// The leaf is full. We split it if the parent node can take another index entry.
+	// TODO: Split index nodes (or add another level) instead of giving up.
+	auto parent = frames.back();
+	auto parentCountLimit = reinterpret_cast<DxCountLimit *>(parent.entries);
+	if(parentCountLimit->count >= parentCountLimit->limit) {
+		std::cout << "ext2fs: Directory index of inode " << number << " is full" << std::endl;
+		co_return std::nullopt;
+	}
+
+	// Copy the live entries of the leaf and sort them by hash.
+	auto base = reinterpret_cast<char *>(fileMapping.get());
+	std::vector<char> leafCopy(base + leafBegin, base + leafBegin + fs.blockSize);
+	auto version = dxHashVersion();
+	std::vector<std::pair<uint32_t, size_t>> records;
+	for(size_t offset = 0; offset < fs.blockSize; ) {
+		auto disk_entry = reinterpret_cast<DiskDirEntry *>(leafCopy.data() + offset);
+		assert(disk_entry->recordLength);
+		if(disk_entry->inode) {
+			std::string_view entryName{disk_entry->name, disk_entry->nameLength};
+			records.push_back({dirHash(version, fs.hashSeed, entryName), offset});
+		}
+		offset += disk_entry->recordLength;
+	}
+	if(records.size() < 2)
+		co_return std::nullopt;
+	std::stable_sort(records.begin(), records.end(),
+			[] (const auto &a, const auto &b) { return a.first < b.first; });
+
+	auto split = records.size() / 2;
+	auto splitHash = records[split].first;
+	// If the split happens within a range of equal hashes, lookups need to visit both leaves.
+	uint32_t continued = (records[split - 1].first == splitHash) ? 1 : 0;
+
+	// Offsets stay valid when the directory is remapped.
+	auto parentOffset = reinterpret_cast<char *>(parent.entries) - base;
+	auto atIndex = parent.at - parent.entries;
+
+	auto newBlock = co_await appendDirectoryBlock();
+	auto lock = co_await lockDirectory();
+	base = reinterpret_cast<char *>(fileMapping.get());
+
+	// Rewrite both leaves. The last entry in each block extends to the end of the block.
+	auto writeLeaf = [&] (uint64_t block, size_t first, size_t last) {
+		auto blockBase = base + (block << fs.blockShift);
+		size_t offset = 0;
+		DiskDirEntry *previous_entry = nullptr;
+		for(size_t i = first; i < last; i++) {
+			auto source = reinterpret_cast<DiskDirEntry *>(leafCopy.data() + records[i].second);
+			auto length = (sizeof(DiskDirEntry) + source->nameLength + 3) & ~size_t(3);
+			memcpy(blockBase + offset, source, length);
+			previous_entry = reinterpret_cast<DiskDirEntry *>(blockBase + offset);
+			previous_entry->recordLength = length;
+			offset += length;
+		}
+		assert(previous_entry);
+		previous_entry->recordLength += fs.blockSize - offset;
+	};
+	writeLeaf(leafBlock, 0, split);
+	writeLeaf(newBlock, split, records.size());
+
+	// Insert the new leaf into the parent, right after the split leaf.
+	auto entries = reinterpret_cast<DxEntry *>(base + parentOffset);
+	auto countLimit = reinterpret_cast<DxCountLimit *>(entries);
+	memmove(entries + atIndex + 2, entries + atIndex + 1,
+			(countLimit->count - atIndex - 1) * sizeof(DxEntry));
+	entries[atIndex + 1].hash = splitHash | continued;
+	entries[atIndex + 1].block = newBlock;
+	countLimit->count++;
+
+	auto targetBlock = (hash < (splitHash | continued)) ? leafBlock : newBlock;
+	auto targetBegin = targetBlock << fs.blockShift;
+	co_return findSpace(targetBegin, targetBegin + fs.blockSize, required);
+}
+
+async::result<void> Inode::dropIndex() {
+	std::cout << "ext2fs: Dropping directory index of inode " << number << std::endl;
+
+	diskInode()->flags &= ~EXT2_INDEX_FL;
+	auto syncInode = co_await helix_ng::synchronizeSpace(
+			helix::BorrowedDescriptor{kHelNullHandle},
+			diskMapping.get(), fs.inodeSize);
+	HEL_CHECK(syncInode.error());
+}
+
+void Inode::cacheName(const std::string &name, DirEntry entry) {
+	// Bound the size of partial caches.
+	if(!nameCacheComplete && nameCache.size() >= maxCachedNames)
+		nameCache.clear();
+	nameCache[name] = entry;
+}
+
 // --------------------------------------------------------
 // FileSystem
 // --------------------------------------------------------
@@ -464,6 +941,9 @@ async::result<void> FileSystem::init() {
 	blocksCount = sb.blocksCount;
 	inodesCount = sb.inodesCount;
 	numBlockGroups = (sb.blocksCount + (sb.blocksPerGroup - 1)) / sb.blocksPerGroup;
+	dirIndex = sb.featureCompat & EXT2_FEATURE_COMPAT_DIR_INDEX;
+	unsignedHash = sb.flags & EXT2_FLAGS_UNSIGNED_HASH;
+	memcpy(hashSeed, sb.hashSeed, sizeof(hashSeed));
 
 	if(logSuperblock) {
 		std::cout << "ext2fs: Revision is: " << sb.revLevel << std::endl;
@@ -475,6 +955,8 @@ async::result<void> FileSystem::init() {
 		std::cout << "ext2fs: Optional features: " << sb.featureCompat
 				<< ", w-required features: " << sb.featureRoCompat
 				<< ", r/w-required features: " << sb.featureIncompat << std::endl;
+		std::cout << "ext2fs: Directory indices are "
+				<< (dirIndex ? "enabled" : "disabled") << std::endl;
 		std::cout << "ext2fs: There are " << numBlockGroups << " block groups" << std::endl;
 		std::cout << "ext2fs:     Blocks per group: " << blocksPerGroup << std::endl;
 		std::cout << "ext2fs:     Inodes per group: " << inodesPerGroup << std::endl;
@@ -1242,6 +1724,7 @@ async::result<void> FileSystem::readDataBlocks(std::shared_ptr<Inode> inode,
 
 	std::array<uint32_t, indirectBufferSize> indirectBuffer;
 
+	std::vector<SectorTransfer> transfers;
 	size_t progress = 0;
 	while(progress < num_blocks) {
 		// Block number and block count of the readSectors() command that we will issue here.
@@ -1321,14 +1804,18 @@ async::result<void> FileSystem::readDataBlocks(std::shared_ptr<Inode> inode,
 //				<< " blocks, starting at " << issue.first << std::endl;
 
 		if (issue.first) {
-			co_await device->readSectors(issue.first * sectorsPerBlock,
+			transfers.push_back({false, issue.first * sectorsPerBlock,
 					(uint8_t *)buffer + progress * blockSize,
-					issue.second * sectorsPerBlock);
+					issue.second * sectorsPerBlock});
 		} else {
 			memset((uint8_t *)buffer + progress * blockSize, 0, issue.second * blockSize);
 		}
 		progress += issue.second;
 	}
+
+	// Submit all reads at once such that the device's request queue can merge them.
+	if(!transfers.empty())
+		co_await device->transferSectors(transfers);
 }
 
 // TODO: There is a lot of overlap between this method and readDataBlocks.
@@ -1359,6 +1846,7 @@ async::result<void> FileSystem::writeDataBlocks(std::shared_ptr<Inode> inode,
 	co_await inode->readyJump.wait();
 	// TODO: Assert that we do not write past the EOF.
 
+	std::vector<SectorTransfer> transfers;
 	size_t progress = 0;
 	while(progress < num_blocks) {
 		// Block number and block count of the writeSectors() command that we will issue here.
@@ -1413,11 +1901,15 @@ async::result<void> FileSystem::writeDataBlocks(std::shared_ptr<Inode> inode,
 //				<< " blocks, starting at " << issue.first << std::endl;
 
 		assert(issue.first);
-		co_await device->writeSectors(issue.first * sectorsPerBlock,
-				(const uint8_t *)buffer + progress * blockSize,
-				issue.second * sectorsPerBlock);
+		transfers.push_back({true, issue.first * sectorsPerBlock,
+				const_cast<uint8_t *>((const uint8_t *)buffer + progress * blockSize),
+				issue.second * sectorsPerBlock});
 		progress += issue.second;
 	}
+
+	// Submit all writes at once such that the device's request queue can merge them.
+	if(!transfers.empty())
+		co_await device->transferSectors(transfers);
 }
 
 
@@ -1489,5 +1981,48 @@ OpenFile::readEntries() {
 	co_return std::nullopt;
 }
 
+async::result<protocols::fs::ReadEntriesBatchResult>
+OpenFile::readEntriesBatch(size_t max_size) {
+	co_await inode->readyJump.wait();
+
+	if(inode->fileType != kTypeDirectory)
+		co_return protocols::fs::Error::notDirectory;
+
+	auto map_size = (inode->fileSize() + 0xFFF) & ~size_t(0xFFF);
+
+	helix::LockMemoryView lock_memory;
+	auto &&submit = helix::submitLockMemoryView(helix::BorrowedDescriptor(inode->frontalMemory),
+			&lock_memory, 0, map_size, helix::Dispatcher::global());
+	co_await submit.async_wait();
+	HEL_CHECK(lock_memory.error());
+
+	helix::Mapping file_map{helix::BorrowedDescriptor{inode->frontalMemory},
+			0, map_size,
+			kHelMapProtRead | kHelMapDontRequireBacking};
+
+	// Only advance the offset past entries that made it into the response.
+	protocols::fs::DirentBuilder builder{max_size};
+	assert(offset <= inode->fileSize());
+	while(offset < inode->fileSize()) {
+		assert(!(offset & 3));
+		assert(offset + sizeof(DiskDirEntry) <= inode->fileSize());
+		auto disk_entry = reinterpret_cast<DiskDirEntry *>(
+				reinterpret_cast<char *>(file_map.get()) + offset);
+		assert(offset + disk_entry->recordLength <= inode->fileSize());
+
+		auto next = offset + disk_entry->recordLength;
+		if(disk_entry->inode) {
+			if(!builder.entry(disk_entry->inode, next, direntType(disk_entry),
+					{disk_entry->name, disk_entry->nameLength}))
+				break;
+		}
+		offset = next;
+	}
+
+	if(offset < inode->fileSize() && !builder.numEntries())
+		co_return protocols::fs::Error::illegalArguments;
+	co_return builder.buffer();
+}
+
 } } // namespace blockfs::ext2fs
 
@@ -4,6 +4,7 @@
 #include <optional>
 #include <memory>
 #include <optional>
+#include <string_view>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -93,7 +94,16 @@ struct DiskSuperblock {
 	//-- Other options --
 	uint32_t defaultMountOptions;
 	uint32_t firstMetaBg;
-	uint8_t unused[760];
+	uint32_t mkfsTime;
+	uint32_t jnlBlocks[17];
+	//-- 64bit Support --
+	uint32_t blocksCountHi;
+	uint32_t rBlocksCountHi;
+	uint32_t freeBlocksCountHi;
+	uint16_t minExtraIsize;
+	uint16_t wantExtraIsize;
+	uint32_t flags;
+	uint8_t unused[668];
 };
 static_assert(sizeof(DiskSuperblock) == 1024, "Bad DiskSuperblock struct size");
 
@@ -135,6 +145,21 @@ enum {
 	EXT2_ROOT_INO = 2
 };
 
+// Superblock feature flags.
+enum {
+	EXT2_FEATURE_COMPAT_DIR_INDEX = 0x20
+};
+
+// Superblock flags.
+enum {
+	EXT2_FLAGS_UNSIGNED_HASH = 0x2
+};
+
+// Inode flags.
+enum {
+	EXT2_INDEX_FL = 0x1000
+};
+
 enum {
 	EXT2_S_IFMT = 0xF000,
 	EXT2_S_IFLNK = 0xA000,
@@ -156,6 +181,52 @@ enum {
 	EXT2_FT_SYMLINK = 7
 };
 
+// --------------------------------------------------------
+// Directory index (htree) structures
+// --------------------------------------------------------
+
+// Index nodes are disguised as unused directory entries that span the whole block.
+// Hence, implementations that do not know about the index can read the directory linearly.
+
+enum {
+	DX_HASH_LEGACY = 0,
+	DX_HASH_HALF_MD4 = 1,
+	DX_HASH_TEA = 2,
+	DX_HASH_LEGACY_UNSIGNED = 3,
+	DX_HASH_HALF_MD4_UNSIGNED = 4,
+	DX_HASH_TEA_UNSIGNED = 5
+};
+
+// Follows the "." and ".." entries in the first block of the directory.
+struct DxRootInfo {
+	uint32_t reservedZero;
+	uint8_t hashVersion;
+	uint8_t infoLength;
+	uint8_t indirectLevels;
+	uint8_t unusedFlags;
+};
+static_assert(sizeof(DxRootInfo) == 8, "Bad DxRootInfo struct size");
+
+struct DxEntry {
+	uint32_t hash;
+	uint32_t block;
+};
+static_assert(sizeof(DxEntry) == 8, "Bad DxEntry struct size");
+
+// Overlays the hash of the first DxEntry of each index node.
+// The first DxEntry covers all hashes below the hash of the second one.
+struct DxCountLimit {
+	uint16_t limit;
+	uint16_t count;
+};
+static_assert(sizeof(DxCountLimit) == 4, "Bad DxCountLimit struct size");
+
+// Position within an index node during a lookup.
+struct DxFrame {
+	DxEntry *entries;
+	DxEntry *at;
+};
+
 // --------------------------------------------------------
 // DirEntry
 // --------------------------------------------------------
@@ -195,6 +266,47 @@ struct Inode : std::enable_shared_from_this<Inode> {
 	async::result<protocols::fs::Error> chmod(int mode);
 	async::result<protocols::fs::Error> utimensat(std::optional<timespec> atime, std::optional<timespec> mtime, timespec ctime);
 
+	// Locks the page cache of a directory into memory (until the descriptor is dropped).
+	async::result<helix::UniqueDescriptor> lockDirectory();
+
+	// Appends an empty block to a directory and returns its block index.
+	async::result<uint64_t> appendDirectoryBlock();
+
+	// Finds space for an entry of the given size in [begin, end), contracting an existing
+	// entry if necessary. Returns the offset and length of the space.
+	// The directory must be locked.
+	std::optional<std::pair<size_t, size_t>> findSpace(size_t begin, size_t end, size_t required);
+
+	// Returns the entry with the given name in a directory block (or nullptr).
+	// If previous is given, it is set to the preceding entry in the same block.
+	// The directory must be locked.
+	DiskDirEntry *findInBlock(uint64_t block, std::string_view name,
+			DiskDirEntry **previous = nullptr);
+
+	// Returns true if the directory uses a hashed index (htree).
+	bool isIndexed();
+
+	// Walks the index down to the leaf that contains the hash of the name.
+	// Returns false if the index is corrupted or uses unsupported features.
+	// The directory must be locked.
+	bool dxProbe(std::string_view name, uint32_t &hash, std::vector<DxFrame> &frames);
+
+	// Returns the DX_HASH_* variant used by the index.
+	int dxHashVersion();
+
+	// Moves to the next leaf if it might also contain the hash (due to hash collisions).
+	bool dxNextLeaf(std::vector<DxFrame> &frames, uint32_t hash);
+
+	// Like findSpace() but for indexed directories; splits the leaf if it is full.
+	// Returns std::nullopt if the index cannot be extended.
+	async::result<std::optional<std::pair<size_t, size_t>>>
+	dxFindSpace(std::string_view name, size_t required);
+
+	// Turns an indexed directory into a linear one.
+	async::result<void> dropIndex();
+
+	void cacheName(const std::string &name, DirEntry entry);
+
 	FileSystem &fs;
 
 	// ext2fs on-disk inode number
@@ -214,6 +326,13 @@ struct Inode : std::enable_shared_from_this<Inode> {
 	HelHandle frontalMemory;
 	helix::Mapping fileMapping;
 
+	// Read-only mapping of the page cache of a regular file that is used to serve reads.
+	// Shared with reads that are in progress since it is replaced when the file is resized.
+	std::shared_ptr<helix::Mapping> readMapping;
+
+	// Returns readMapping, after re-creating it if it does not match the file size.
+	std::shared_ptr<helix::Mapping> accessReadMapping();
+
 	// Caches indirection blocks reachable from the inode.
 	// - Indirection level 1/1 for single indirect blocks.
 	// - Indirection level 1/2 for double indirect blocks.
@@ -235,6 +354,13 @@ struct Inode : std::enable_shared_from_this<Inode> {
 	FlockManager flockManager;
 
 	std::unordered_set<std::string> obstructedLinks;
+
+	// Maps names to directory entries. Built lazily by findEntry().
+	// For linear directories, the cache is filled on the first lookup and becomes complete,
+	// i.e., names that are not in the cache do not exist. For indexed directories,
+	// only names that were found through the index are cached.
+	std::unordered_map<std::string, DirEntry> nameCache;
+	bool nameCacheComplete = false;
 };
 
 // --------------------------------------------------------
@@ -293,6 +419,11 @@ struct FileSystem {
 	std::vector<std::byte> blockGroupDescriptorBuffer;
 	DiskGroupDesc *bgdt;
 
+	// Parameters of directory indices.
+	bool dirIndex;
+	bool unsignedHash;
+	uint32_t hashSeed[4];
+
 	helix::UniqueDescriptor blockBitmap;
 	helix::UniqueDescriptor inodeBitmap;
 	helix::UniqueDescriptor inodeTable;
@@ -309,6 +440,9 @@ struct OpenFile {
 
 	async::result<std::optional<std::string>> readEntries();
 
+	// Returns as many entries as fit into max_size bytes.
+	async::result<protocols::fs::ReadEntriesBatchResult> readEntriesBatch(size_t max_size);
+
 	std::shared_ptr<Inode> inode;
 	uint64_t offset;
 	Flock flock;
@@ -84,6 +84,15 @@ async::result<void> Partition::writeSectors(uint64_t sector, const void *buffer,
 			buffer, count);
 }
 
+async::result<void> Partition::transferSectors(std::span<const SectorTransfer> transfers) {
+	std::vector<SectorTransfer> translated{transfers.begin(), transfers.end()};
+	for(auto &transfer : translated) {
+		assert(transfer.sector + transfer.numSectors <= _numSectors);
+		transfer.sector += _startLba;
+	}
+	co_await _table.getDevice()->transferSectors(translated);
+}
+
 async::result<size_t> Partition::getSize() {
 	co_return _numSectors * sectorSize;
 }
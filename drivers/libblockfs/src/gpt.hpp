@@ -104,6 +104,8 @@ struct Partition : public BlockDevice {
 	async::result<void> writeSectors(uint64_t sector, const void *buffer,
 			size_t num_sectors) override;
 
+	async::result<void> transferSectors(std::span<const SectorTransfer> transfers) override;
+
 	async::result<size_t> getSize() override;
 
 	Guid id();
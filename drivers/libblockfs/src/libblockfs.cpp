@@ -18,6 +18,7 @@
 #include "gpt.hpp"
 #include "ext2fs.hpp"
 #include "raw.hpp"
+#include "queue.hpp"
 #include "fs.bragi.hpp"
 #include <bragi/helpers-std.hpp>
 
@@ -152,7 +153,9 @@ async::result<protocols::fs::ReadResult> pread(void *object, int64_t offset, hel
 	auto self = static_cast<ext2fs::OpenFile *>(object);
 	co_await self->inode->readyJump.wait();
 
-	if(self->offset >= self->inode->fileSize())
+	if(offset < 0)
+		co_return protocols::fs::Error::illegalArguments;
+	if(static_cast<uint64_t>(offset) >= self->inode->fileSize())
 		co_return size_t{0};
 
 	auto remaining = self->inode->fileSize() - offset;
@@ -187,6 +190,59 @@ async::result<protocols::fs::ReadResult> pread(void *object, int64_t offset, hel
 	co_return chunk_size;
 }
 
+// Serves reads directly from a mapping of the page cache, such that the data is copied
+// to the client only once (instead of being copied into an intermediate buffer first).
+// Writes are not served from the page cache: write() and pwrite() still receive the data
+// into a buffer since they may need to allocate blocks and resize the file.
+async::result<protocols::fs::ReadViewResult> readView(void *object, helix_ng::CredentialsView,
+		std::optional<int64_t> offset, size_t length) {
+	protocols::ostrace::Timer timer;
+	auto self = static_cast<ext2fs::OpenFile *>(object);
+
+	if(offset && *offset < 0)
+		co_return protocols::fs::Error::illegalArguments;
+
+	co_await self->inode->readyJump.wait();
+
+	// The file type is only known once the inode is ready.
+	if(self->inode->fileType == FileType::kTypeDirectory)
+		co_return protocols::fs::Error::isDirectory;
+
+	uint64_t position = offset ? *offset : self->offset;
+	if(!length || position >= self->inode->fileSize())
+		co_return protocols::fs::ReadView{};
+
+	auto chunkSize = std::min<uint64_t>(length, self->inode->fileSize() - position);
+	if(!offset)
+		self->offset += chunkSize;
+
+	// Lock the pages such that they are present (and stay present) until the data is sent.
+	auto lockOffset = position & ~uint64_t(0xFFF);
+	auto lockSize = ((position & 0xFFF) + chunkSize + 0xFFF) & ~uint64_t(0xFFF);
+
+	helix::LockMemoryView lockMemory;
+	auto &&submit = helix::submitLockMemoryView(helix::BorrowedDescriptor(self->inode->frontalMemory),
+			&lockMemory, lockOffset, lockSize, helix::Dispatcher::global());
+	co_await submit.async_wait();
+	HEL_CHECK(lockMemory.error());
+
+	struct Hold {
+		helix::UniqueDescriptor lock;
+		std::shared_ptr<helix::Mapping> mapping;
+	};
+	auto mapping = self->inode->accessReadMapping();
+	auto data = reinterpret_cast<const char *>(mapping->get()) + position;
+	auto hold = std::make_shared<Hold>(lockMemory.descriptor(), std::move(mapping));
+
+	ostContext.emit(
+		ostEvtRead,
+		ostAttrNumBytes(chunkSize),
+		ostAttrTime(timer.elapsed())
+	);
+
+	co_return protocols::fs::ReadView{data, chunkSize, std::move(hold)};
+}
+
 async::result<frg::expected<protocols::fs::Error, size_t>> write(void *object, helix_ng::CredentialsView,
 		const void *buffer, size_t length) {
 	if(!length) {
@@ -241,6 +297,17 @@ readEntries(void *object) {
 	co_return co_await self->readEntries();
 }
 
+async::result<protocols::fs::ReadEntriesBatchResult>
+readEntriesBatch(void *object, size_t max_size) {
+	auto self = static_cast<ext2fs::OpenFile *>(object);
+
+	ostContext.emit(
+		ostEvtReadDir
+	);
+
+	co_return co_await self->readEntriesBatch(max_size);
+}
+
 async::result<frg::expected<protocols::fs::Error>>
 truncate(void *object, size_t size) {
 	auto self = static_cast<ext2fs::OpenFile *>(object);
@@ -264,9 +331,11 @@ constexpr protocols::fs::FileOperations fileOperations {
 	.seekEof      = &seekEof,
 	.read         = &read,
 	.pread        = &pread,
+	.readView     = &readView,
 	.write        = &write,
 	.pwrite       = &pwrite,
 	.readEntries  = &readEntries,
+	.readEntriesBatch = &readEntriesBatch,
 	.accessMemory = &accessMemory,
 	.truncate     = &truncate,
 	.flock        = &flock,
@@ -661,6 +730,16 @@ constexpr protocols::fs::FileOperations rawOperations {
 BlockDevice::BlockDevice(size_t sector_size, int64_t parent_id)
 : size(0), sectorSize(sector_size), parentId(parent_id) { }
 
+async::result<void> BlockDevice::transferSectors(std::span<const SectorTransfer> transfers) {
+	for(auto &transfer : transfers) {
+		if(transfer.write) {
+			co_await writeSectors(transfer.sector, transfer.buffer, transfer.numSectors);
+		}else{
+			co_await readSectors(transfer.sector, transfer.buffer, transfer.numSectors);
+		}
+	}
+}
+
 async::detached servePartition(helix::UniqueLane lane, gpt::Partition *partition, std::unique_ptr<raw::RawFs> rawFs) {
 	std::cout << "unix device: Connection" << std::endl;
 
@@ -889,7 +968,8 @@ async::detached servePartition(helix::UniqueLane lane, gpt::Partition *partition
 	}
 }
 
-async::detached serveDevice(helix::UniqueLane lane, std::unique_ptr<raw::RawFs> rawFs) {
+async::detached serveDevice(helix::UniqueLane lane, std::unique_ptr<raw::RawFs> rawFs,
+		RequestQueue *queue) {
 	std::cout << "unix device: Connection" << std::endl;
 
 	while(true) {
@@ -985,6 +1065,56 @@ async::detached serveDevice(helix::UniqueLane lane, std::unique_ptr<raw::RawFs>
 					conversation, helix_ng::dismiss());
 				HEL_CHECK(dismiss.error());
 			}
+		} else if(preamble.id() == managarm::fs::BlockQueueStatsRequest::message_id) {
+			auto stats = queue->stats();
+
+			managarm::fs::BlockQueueStatsReply resp;
+			resp.set_error(managarm::fs::Errors::SUCCESS);
+			resp.set_scheduler(static_cast<int32_t>(queue->scheduler()));
+			resp.set_queue_depth(queue->depth());
+			resp.set_in_flight(stats.inFlight);
+			resp.set_read_ios(stats.ios[0]);
+			resp.set_read_merges(stats.merges[0]);
+			resp.set_read_sectors(stats.sectors[0]);
+			resp.set_read_ticks(stats.ticks[0] / 1'000'000);
+			resp.set_write_ios(stats.ios[1]);
+			resp.set_write_merges(stats.merges[1]);
+			resp.set_write_sectors(stats.sectors[1]);
+			resp.set_write_ticks(stats.ticks[1] / 1'000'000);
+			resp.set_io_ticks(stats.ioTicks / 1'000'000);
+
+			auto [send_resp] = co_await helix_ng::exchangeMsgs(
+				conversation,
+				helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
+			);
+			HEL_CHECK(send_resp.error());
+		} else if(preamble.id() == managarm::fs::BlockQueueConfigureRequest::message_id) {
+			auto req = bragi::parse_head_only<managarm::fs::BlockQueueConfigureRequest>(recv_head);
+
+			if(!req) {
+				std::cout << "libblockfs: Rejecting request due to decoding failure" << std::endl;
+				break;
+			}
+
+			managarm::fs::BlockQueueConfigureReply resp;
+			resp.set_error(managarm::fs::Errors::SUCCESS);
+			if(req->scheduler() == managarm::fs::IoScheduler::IOSCHED_NOOP) {
+				queue->setScheduler(IoScheduler::noop);
+			}else if(req->scheduler() == managarm::fs::IoScheduler::IOSCHED_DEADLINE) {
+				queue->setScheduler(IoScheduler::deadline);
+			}else if(req->scheduler() == managarm::fs::IoScheduler::IOSCHED_MQ) {
+				queue->setScheduler(IoScheduler::multiQueue);
+			}else if(req->scheduler() != -1) {
+				resp.set_error(managarm::fs::Errors::ILLEGAL_ARGUMENT);
+			}
+			if(req->queue_depth())
+				queue->setDepth(req->queue_depth());
+
+			auto [send_resp] = co_await helix_ng::exchangeMsgs(
+				conversation,
+				helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
+			);
+			HEL_CHECK(send_resp.error());
 		}else{
 			std::cout << "Unexpected request type " + std::to_string((int)req.req_type()) << " to device" << std::endl;
 			auto [dismiss] = co_await helix_ng::exchangeMsgs(
@@ -1003,10 +1133,14 @@ async::detached runDevice(BlockDevice *device) {
 	if(!clkInitialized)
 		co_await clk::enumerateTracker();
 
+	// All I/O from the file systems goes through the request queue.
+	// Like the table below, the queue is never deleted.
+	auto queue = new RequestQueue(device);
+
 	// TODO(qookie): Don't leak the table.
 	// Currently it should be fine to leak it since neither it nor
 	// the device gets deleted anyway.
-	auto table = new gpt::Table(device);
+	auto table = new gpt::Table(queue);
 	co_await table->parse();
 
 	int64_t diskId = 0;
@@ -1023,20 +1157,21 @@ async::detached runDevice(BlockDevice *device) {
 					"disk", descriptor)).unwrap();
 		diskId = entity.id();
 
-		auto rawFs = std::make_unique<raw::RawFs>(device);
+		auto rawFs = std::make_unique<raw::RawFs>(queue);
 		co_await rawFs->init();
 
 		// See comment in mbus_ng::~EntityManager as to why this is necessary.
-		[] (mbus_ng::EntityManager entity, std::unique_ptr<raw::RawFs> rawFs) -> async::detached {
+		[] (mbus_ng::EntityManager entity, std::unique_ptr<raw::RawFs> rawFs,
+				RequestQueue *queue) -> async::detached {
 			while (true) {
 				auto [localLane, remoteLane] = helix::createStream();
 
 				// If this fails, too bad!
 				(void)(co_await entity.serveRemoteLane(std::move(remoteLane)));
 
-				serveDevice(std::move(localLane), std::move(rawFs));
+				serveDevice(std::move(localLane), std::move(rawFs), queue);
 			}
-		}(std::move(entity), std::move(rawFs));
+		}(std::move(entity), std::move(rawFs), queue);
 	}
 
 	int partId = 0;
@@ -0,0 +1,398 @@
+#include <assert.h>
+#include <iostream>
+
+#include <hel.h>
+#include <hel-syscalls.h>
+
+#include "queue.hpp"
+
+namespace blockfs {
+
+namespace {
+
+// Limits for merged batches.
+constexpr size_t maxBatchBytes = 512 * 1024;
+constexpr size_t maxBatchParts = 128;
+
+// Expiry times of the deadline policy.
+constexpr uint64_t readExpiry = 500'000'000;
+constexpr uint64_t writeExpiry = 5'000'000'000;
+
+// Number of read batches that the deadline policy issues while writes are pending.
+constexpr int writesStarvedLimit = 2;
+
+uint64_t currentClock() {
+	uint64_t now;
+	HEL_CHECK(helGetClock(&now));
+	return now;
+}
+
+// --------------------------------------------------------
+// NoopPolicy
+// --------------------------------------------------------
+
+struct NoopPolicy final : IoPolicy {
+	NoopPolicy(RequestQueue *queue)
+	: _queue{queue} { }
+
+	bool tryMerge(IoRequest *req) override {
+		if(_fifo.empty() || !_queue->canAppend(_fifo.back(), req))
+			return false;
+		auto batch = _fifo.back();
+		batch->parts.push_back(req);
+		batch->numSectors += req->transfer.numSectors;
+		return true;
+	}
+
+	void insert(IoBatch *batch) override {
+		_fifo.push_back(batch);
+	}
+
+	IoBatch *dispatch(uint64_t) override {
+		if(_fifo.empty())
+			return nullptr;
+		auto batch = _fifo.front();
+		_fifo.pop_front();
+		return batch;
+	}
+
+private:
+	RequestQueue *_queue;
+	std::deque<IoBatch *> _fifo;
+};
+
+// --------------------------------------------------------
+// DeadlinePolicy
+// --------------------------------------------------------
+
+struct DeadlinePolicy final : IoPolicy {
+	DeadlinePolicy(RequestQueue *queue)
+	: _queue{queue} { }
+
+	bool tryMerge(IoRequest *req) override {
+		auto &sorted = _sorted[req->transfer.write];
+
+		// Back merge: find the batch that starts right before the request.
+		auto it = sorted.upper_bound(req->transfer.sector);
+		if(it != sorted.begin()) {
+			auto batch = std::prev(it)->second;
+			if(_queue->canAppend(batch, req)) {
+				batch->parts.push_back(req);
+				batch->numSectors += req->transfer.numSectors;
+				return true;
+			}
+		}
+
+		// Front merge: find a batch that starts right after the request.
+		auto [begin, end] = sorted.equal_range(req->transfer.sector + req->transfer.numSectors);
+		for(it = begin; it != end; ++it) {
+			auto batch = it->second;
+			if(!_queue->canPrepend(batch, req))
+				continue;
+			sorted.erase(it);
+			batch->parts.push_front(req);
+			batch->sector = req->transfer.sector;
+			batch->numSectors += req->transfer.numSectors;
+			batch->sortIt = sorted.insert({batch->sector, batch});
+			return true;
+		}
+
+		return false;
+	}
+
+	void insert(IoBatch *batch) override {
+		batch->sortIt = _sorted[batch->write].insert({batch->sector, batch});
+		batch->fifoIt = _fifo[batch->write].insert(_fifo[batch->write].end(), batch);
+	}
+
+	IoBatch *dispatch(uint64_t now) override {
+		bool haveReads = !_sorted[0].empty();
+		bool haveWrites = !_sorted[1].empty();
+		if(!haveReads && !haveWrites)
+			return nullptr;
+
+		// Prefer reads but do not starve writes.
+		bool write;
+		if(haveReads && (!haveWrites || _writesStarved < writesStarvedLimit)) {
+			write = false;
+			if(haveWrites)
+				_writesStarved++;
+		}else{
+			write = true;
+			_writesStarved = 0;
+		}
+
+		// Serve expired batches in FIFO order; otherwise continue the elevator sweep.
+		IoBatch *batch;
+		if(_fifo[write].front()->deadline <= now) {
+			batch = _fifo[write].front();
+		}else{
+			auto it = _sorted[write].lower_bound(_headPosition);
+			if(it == _sorted[write].end())
+				it = _sorted[write].begin();
+			batch = it->second;
+		}
+
+		_sorted[write].erase(batch->sortIt);
+		_fifo[write].erase(batch->fifoIt);
+		_headPosition = batch->sector + batch->numSectors;
+		return batch;
+	}
+
+private:
+	RequestQueue *_queue;
+	std::multimap<uint64_t, IoBatch *> _sorted[2];
+	std::list<IoBatch *> _fifo[2];
+	uint64_t _headPosition = 0;
+	int _writesStarved = 0;
+};
+
+// --------------------------------------------------------
+// MultiQueuePolicy
+// --------------------------------------------------------
+
+struct MultiQueuePolicy final : IoPolicy {
+	MultiQueuePolicy(RequestQueue *queue)
+	: _queue{queue} { }
+
+	bool tryMerge(IoRequest *req) override {
+		auto &fifo = _fifoFor(_currentCpu());
+		if(fifo.empty() || !_queue->canAppend(fifo.back(), req))
+			return false;
+		auto batch = fifo.back();
+		batch->parts.push_back(req);
+		batch->numSectors += req->transfer.numSectors;
+		return true;
+	}
+
+	void insert(IoBatch *batch) override {
+		batch->cpu = _currentCpu();
+		_fifoFor(batch->cpu).push_back(batch);
+	}
+
+	IoBatch *dispatch(uint64_t) override {
+		// Round-robin over the per-CPU FIFOs.
+		for(size_t i = 0; i < _fifos.size(); i++) {
+			auto &fifo = _fifos[(_next + i) % _fifos.size()];
+			if(fifo.empty())
+				continue;
+			auto batch = fifo.front();
+			fifo.pop_front();
+			_next = (_next + i + 1) % _fifos.size();
+			return batch;
+		}
+		return nullptr;
+	}
+
+private:
+	int _currentCpu() {
+		int cpu;
+		HEL_CHECK(helGetCurrentCpu(&cpu));
+		return cpu;
+	}
+
+	std::deque<IoBatch *> &_fifoFor(int cpu) {
+		if(static_cast<size_t>(cpu) >= _fifos.size())
+			_fifos.resize(cpu + 1);
+		return _fifos[cpu];
+	}
+
+	RequestQueue *_queue;
+	std::vector<std::deque<IoBatch *>> _fifos;
+	size_t _next = 0;
+};
+
+std::unique_ptr<IoPolicy> makePolicy(RequestQueue *queue, IoScheduler scheduler) {
+	switch(scheduler) {
+	case IoScheduler::noop:
+		return std::make_unique<NoopPolicy>(queue);
+	case IoScheduler::deadline:
+		return std::make_unique<DeadlinePolicy>(queue);
+	case IoScheduler::multiQueue:
+		return std::make_unique<MultiQueuePolicy>(queue);
+	}
+	__builtin_unreachable();
+}
+
+} // anonymous namespace
+
+const char *schedulerName(IoScheduler scheduler) {
+	switch(scheduler) {
+	case IoScheduler::noop: return "noop";
+	case IoScheduler::deadline: return "deadline";
+	case IoScheduler::multiQueue: return "mq";
+	}
+	__builtin_unreachable();
+}
+
+// --------------------------------------------------------
+// RequestQueue
+// --------------------------------------------------------
+
+RequestQueue::RequestQueue(BlockDevice *device)
+: BlockDevice{device->sectorSize, device->parentId}, _device{device},
+		_scheduler{device->ioScheduler}, _policy{makePolicy(this, device->ioScheduler)},
+		_depth{std::max(device->queueDepth, size_t{1})} {
+	diskNamePrefix = device->diskNamePrefix;
+	diskNameSuffix = device->diskNameSuffix;
+	partNameSuffix = device->partNameSuffix;
+	ioScheduler = device->ioScheduler;
+	queueDepth = _depth;
+
+	_dispatchRequests();
+}
+
+async::result<void> RequestQueue::readSectors(uint64_t sector, void *buffer,
+		size_t num_sectors) {
+	SectorTransfer transfer{false, sector, buffer, num_sectors};
+	co_await transferSectors({&transfer, 1});
+}
+
+async::result<void> RequestQueue::writeSectors(uint64_t sector, const void *buffer,
+		size_t num_sectors) {
+	SectorTransfer transfer{true, sector, const_cast<void *>(buffer), num_sectors};
+	co_await transferSectors({&transfer, 1});
+}
+
+async::result<void> RequestQueue::transferSectors(std::span<const SectorTransfer> transfers) {
+	auto now = currentClock();
+
+	// All requests are queued before the dispatcher runs. This way, bursts of
+	// requests are sorted and merged before the first one reaches the device.
+	auto requests = std::make_unique<IoRequest[]>(transfers.size());
+	for(size_t i = 0; i < transfers.size(); i++) {
+		requests[i].transfer = transfers[i];
+		requests[i].submitTime = now;
+		_queueRequest(&requests[i], now);
+	}
+	_doorbell.raise();
+
+	for(size_t i = 0; i < transfers.size(); i++)
+		co_await requests[i].done.wait();
+}
+
+async::result<size_t> RequestQueue::getSize() {
+	return _device->getSize();
+}
+
+async::result<void> RequestQueue::handleIoctl(managarm::fs::GenericIoctlRequest &req,
+		helix::UniqueDescriptor conversation) {
+	return _device->handleIoctl(req, std::move(conversation));
+}
+
+void RequestQueue::setScheduler(IoScheduler scheduler) {
+	if(scheduler == _scheduler)
+		return;
+
+	auto policy = makePolicy(this, scheduler);
+	while(auto batch = _policy->dispatch(0))
+		policy->insert(batch);
+	_policy = std::move(policy);
+	_scheduler = scheduler;
+	ioScheduler = scheduler;
+}
+
+void RequestQueue::setDepth(size_t depth) {
+	_depth = std::max(depth, size_t{1});
+	queueDepth = _depth;
+	_doorbell.raise();
+}
+
+IoStats RequestQueue::stats() {
+	auto stats = _stats;
+	stats.inFlight = _inFlight;
+	if(_inFlight)
+		stats.ioTicks += currentClock() - _busySince;
+	return stats;
+}
+
+bool RequestQueue::canAppend(IoBatch *batch, IoRequest *req) {
+	return batch->write == req->transfer.write
+			&& batch->sector + batch->numSectors == req->transfer.sector
+			&& (batch->numSectors + req->transfer.numSectors) * sectorSize <= maxBatchBytes
+			&& batch->parts.size() < maxBatchParts;
+}
+
+bool RequestQueue::canPrepend(IoBatch *batch, IoRequest *req) {
+	return batch->write == req->transfer.write
+			&& req->transfer.sector + req->transfer.numSectors == batch->sector
+			&& (batch->numSectors + req->transfer.numSectors) * sectorSize <= maxBatchBytes
+			&& batch->parts.size() < maxBatchParts;
+}
+
+void RequestQueue::_queueRequest(IoRequest *req, uint64_t now) {
+	assert(req->transfer.numSectors);
+	auto write = req->transfer.write;
+
+	if(_device->vectoredTransfers && _policy->tryMerge(req)) {
+		_stats.merges[write]++;
+		return;
+	}
+
+	auto batch = _allocateBatch();
+	batch->write = write;
+	batch->sector = req->transfer.sector;
+	batch->numSectors = req->transfer.numSectors;
+	batch->deadline = now + (write ? writeExpiry : readExpiry);
+	batch->parts.push_back(req);
+	_policy->insert(batch);
+}
+
+async::detached RequestQueue::_dispatchRequests() {
+	while(true) {
+		if(_inFlight >= _depth) {
+			co_await _doorbell.async_wait();
+			continue;
+		}
+
+		auto batch = _policy->dispatch(currentClock());
+		if(!batch) {
+			co_await _doorbell.async_wait();
+			continue;
+		}
+
+		_issueBatch(batch);
+	}
+}
+
+async::detached RequestQueue::_issueBatch(IoBatch *batch) {
+	if(!_inFlight++)
+		_busySince = currentClock();
+
+	std::vector<SectorTransfer> transfers;
+	transfers.reserve(batch->parts.size());
+	for(auto req : batch->parts)
+		transfers.push_back(req->transfer);
+	co_await _device->transferSectors(transfers);
+
+	auto now = currentClock();
+	auto write = batch->write;
+	_stats.ios[write]++;
+	_stats.sectors[write] += batch->numSectors * (sectorSize / 512);
+	if(!--_inFlight)
+		_stats.ioTicks += now - _busySince;
+
+	for(auto req : batch->parts) {
+		_stats.ticks[write] += now - req->submitTime;
+		// This can destroy the request.
+		req->done.raise();
+	}
+
+	_freeBatch(batch);
+	_doorbell.raise();
+}
+
+IoBatch *RequestQueue::_allocateBatch() {
+	if(_freeBatches.empty())
+		return new IoBatch;
+	auto batch = _freeBatches.back().release();
+	_freeBatches.pop_back();
+	return batch;
+}
+
+void RequestQueue::_freeBatch(IoBatch *batch) {
+	batch->parts.clear();
+	_freeBatches.emplace_back(batch);
+}
+
+} // namespace blockfs
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <deque>
+#include <list>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <async/oneshot-event.hpp>
+#include <async/recurring-event.hpp>
+#include <blockfs.hpp>
+
+namespace blockfs {
+
+// A single transfer as submitted by a file system.
+struct IoRequest {
+	SectorTransfer transfer;
+	uint64_t submitTime = 0;
+	async::oneshot_event done;
+};
+
+// A set of IoRequests that cover a contiguous range of sectors.
+// Batches are passed to the device in a single transferSectors() call.
+struct IoBatch {
+	bool write = false;
+	uint64_t sector = 0;
+	size_t numSectors = 0;
+	uint64_t deadline = 0;
+	std::deque<IoRequest *> parts;
+
+	// Private state of the IoPolicy that currently owns the batch.
+	int cpu = 0;
+	std::multimap<uint64_t, IoBatch *>::iterator sortIt;
+	std::list<IoBatch *>::iterator fifoIt;
+};
+
+struct IoPolicy {
+	virtual ~IoPolicy() = default;
+
+	// Tries to add the request to a batch that is already queued.
+	virtual bool tryMerge(IoRequest *req) = 0;
+
+	virtual void insert(IoBatch *batch) = 0;
+
+	// Removes the next batch that should be issued. Returns nullptr if the policy is empty.
+	virtual IoBatch *dispatch(uint64_t now) = 0;
+};
+
+// Statistics in the format of Linux' /sys/block/<dev>/stat.
+// Index 0 refers to reads, index 1 refers to writes. Times are in nanoseconds.
+struct IoStats {
+	uint64_t ios[2] = {};
+	uint64_t merges[2] = {};
+	uint64_t sectors[2] = {};
+	uint64_t ticks[2] = {};
+	uint64_t inFlight = 0;
+	uint64_t ioTicks = 0;
+};
+
+// Sits between the file systems and a BlockDevice driver.
+// Requests are queued according to an IoPolicy and adjacent requests are merged
+// (if the device supports vectored transfers).
+struct RequestQueue final : BlockDevice {
+	RequestQueue(BlockDevice *device);
+
+	async::result<void> readSectors(uint64_t sector, void *buffer,
+			size_t num_sectors) override;
+
+	async::result<void> writeSectors(uint64_t sector, const void *buffer,
+			size_t num_sectors) override;
+
+	async::result<void> transferSectors(std::span<const SectorTransfer> transfers) override;
+
+	async::result<size_t> getSize() override;
+
+	async::result<void> handleIoctl(managarm::fs::GenericIoctlRequest &req,
+			helix::UniqueDescriptor conversation) override;
+
+	IoScheduler scheduler() {
+		return _scheduler;
+	}
+
+	// Switches to a different policy; queued requests are moved to the new policy.
+	void setScheduler(IoScheduler scheduler);
+
+	size_t depth() {
+		return _depth;
+	}
+
+	void setDepth(size_t depth);
+
+	IoStats stats();
+
+	// Returns true if the request can be appended (or prepended) to the batch.
+	bool canAppend(IoBatch *batch, IoRequest *req);
+	bool canPrepend(IoBatch *batch, IoRequest *req);
+
+private:
+	void _queueRequest(IoRequest *req, uint64_t now);
+
+	async::detached _dispatchRequests();
+
+	async::detached _issueBatch(IoBatch *batch);
+
+	IoBatch *_allocateBatch();
+	void _freeBatch(IoBatch *batch);
+
+	BlockDevice *_device;
+
+	IoScheduler _scheduler;
+	std::unique_ptr<IoPolicy> _policy;
+
+	// Maximal number of batches that are passed to the device concurrently.
+	size_t _depth;
+	size_t _inFlight = 0;
+	async::recurring_event _doorbell;
+
+	std::vector<std::unique_ptr<IoBatch>> _freeBatches;
+
+	IoStats _stats;
+	uint64_t _busySince = 0;
+};
+
+const char *schedulerName(IoScheduler scheduler);
+
+} // namespace blockfs
@@ -182,84 +182,91 @@ async::result<frg::expected<Error, std::vector<uint64_t>>> Interface::reportLuns
 
 async::detached StorageDevice::runScsi() {
 	while (true) {
-		if (queue_.empty()) {
+		if (queue_.empty() || inFlight_ >= commandSlots) {
 			co_await doorbell_.async_wait();
 			continue;
 		}
 
 		auto req = queue_.pop_front();
+		inFlight_++;
+		handleRequest_(req);
+	}
+}
 
-		if (logRequests)
-			std::println(std::cout, "block-scsi: Reading {} sectors", req->numSectors);
-		assert(req->numSectors);
-		assert(req->numSectors <= 0xffff);
-
-		uint8_t commandData[16];
-		uint8_t commandLength;
-
-		if (!req->isWrite) {
-			if (enableRead6 && req->sector <= 0x1fffff && req->numSectors <= 0xff) {
-				Read6 command{};
-				command.opCode = 0x08;
-				command.lba[0] = req->sector >> 16;
-				command.lba[1] = (req->sector >> 8) & 0xff;
-				command.lba[2] = req->sector & 0xff;
-				command.transferLength = req->numSectors;
-
-				commandLength = sizeof(Read6);
-				memcpy(commandData, &command, sizeof(Read6));
-			} else if (req->sector <= 0xffffffff) {
-				Read10 command{};
-				command.opCode = 0x28;
-				command.lba[0] = req->sector >> 24;
-				command.lba[1] = (req->sector >> 16) & 0xff;
-				command.lba[2] = (req->sector >> 8) & 0xff;
-				command.lba[3] = req->sector & 0xff;
-				command.transferLength[0] = req->numSectors >> 8;
-				command.transferLength[1] = req->numSectors & 0xff;
-
-				commandLength = sizeof(Read10);
-				memcpy(commandData, &command, sizeof(Read10));
-			} else {
-				logPanic("block-scsi: High LBAs are not supported!");
-			}
+async::detached StorageDevice::handleRequest_(Request *req) {
+	if (logRequests)
+		std::println(std::cout, "block-scsi: Reading {} sectors", req->numSectors);
+	assert(req->numSectors);
+	assert(req->numSectors <= 0xffff);
+
+	uint8_t commandData[16];
+	uint8_t commandLength;
+
+	if (!req->isWrite) {
+		if (enableRead6 && req->sector <= 0x1fffff && req->numSectors <= 0xff) {
+			Read6 command{};
+			command.opCode = 0x08;
+			command.lba[0] = req->sector >> 16;
+			command.lba[1] = (req->sector >> 8) & 0xff;
+			command.lba[2] = req->sector & 0xff;
+			command.transferLength = req->numSectors;
+
+			commandLength = sizeof(Read6);
+			memcpy(commandData, &command, sizeof(Read6));
+		} else if (req->sector <= 0xffffffff) {
+			Read10 command{};
+			command.opCode = 0x28;
+			command.lba[0] = req->sector >> 24;
+			command.lba[1] = (req->sector >> 16) & 0xff;
+			command.lba[2] = (req->sector >> 8) & 0xff;
+			command.lba[3] = req->sector & 0xff;
+			command.transferLength[0] = req->numSectors >> 8;
+			command.transferLength[1] = req->numSectors & 0xff;
+
+			commandLength = sizeof(Read10);
+			memcpy(commandData, &command, sizeof(Read10));
 		} else {
-			if (req->sector <= 0xffffffff) {
-				Write10 command{};
-				command.opCode = 0x2a;
-				command.lba[0] = req->sector >> 24;
-				command.lba[1] = (req->sector >> 16) & 0xff;
-				command.lba[2] = (req->sector >> 8) & 0xff;
-				command.lba[3] = req->sector & 0xff;
-				command.transferLength[0] = req->numSectors >> 8;
-				command.transferLength[1] = req->numSectors & 0xff;
-
-				commandLength = sizeof(Write10);
-				memcpy(commandData, &command, sizeof(Write10));
-			} else {
-				logPanic("block-scsi: High LBAs are not supported!");
-			}
+			logPanic("block-scsi: High LBAs are not supported!");
 		}
-
-		if (logSteps)
-			std::println(std::cout, "block-scsi: Sending command");
-
-		CommandInfo info{
-			.command{nullptr, commandData, commandLength},
-			.data{nullptr, req->buffer, req->numSectors * sectorSize},
-			.isWrite = req->isWrite
-		};
-		auto result = co_await sendScsiCommand(info);
-		if (!result) {
-			logPanic("block-scsi: Request failed with error {}",
-					result.error().toString());
+	} else {
+		if (req->sector <= 0xffffffff) {
+			Write10 command{};
+			command.opCode = 0x2a;
+			command.lba[0] = req->sector >> 24;
+			command.lba[1] = (req->sector >> 16) & 0xff;
+			command.lba[2] = (req->sector >> 8) & 0xff;
+			command.lba[3] = req->sector & 0xff;
+			command.transferLength[0] = req->numSectors >> 8;
+			command.transferLength[1] = req->numSectors & 0xff;
+
+			commandLength = sizeof(Write10);
+			memcpy(commandData, &command, sizeof(Write10));
+		} else {
+			logPanic("block-scsi: High LBAs are not supported!");
 		}
+	}
 
-		if (logSteps)
-			std::println(std::cout, "block-scsi: Request complete");
+	if (logSteps)
+		std::println(std::cout, "block-scsi: Sending command");
 
-		req->event.raise();
+	CommandInfo info{
+		.command{nullptr, commandData, commandLength},
+		.data{nullptr, req->buffer, req->numSectors * sectorSize},
+		.isWrite = req->isWrite
+	};
+	auto result = co_await sendScsiCommand(info);
+	if (!result) {
+		logPanic("block-scsi: Request failed with error {}",
+				result.error().toString());
 	}
+
+	if (logSteps)
+		std::println(std::cout, "block-scsi: Request complete");
+
+	req->event.raise();
+
+	inFlight_--;
+	doorbell_.raise();
 }
 
 async::result<void> StorageDevice::readSectors(uint64_t sector,
@@ -49,6 +49,7 @@ struct E1000Nic : nic::Link {
 
 private:
 	async::detached processIrqs();
+	void handleIrqStatus(uint32_t status);
 
 	async::result<void> identifyHardware();
 	async::result<void> txInit();
@@ -62,6 +63,8 @@ private:
 
 	int setPromiscuousMode(struct e1000_hw *hw, int flags);
 
+	// Kept around so that the IRQ kernlet can access the registers.
+	helix::UniqueDescriptor _mmio_bar;
 	helix::Mapping _mmio_mapping;
 	arch::mem_space _mmio;
 
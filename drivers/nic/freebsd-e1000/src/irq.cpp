@@ -1,6 +1,67 @@
+#include <fafnir/dsl.hpp>
 #include <nic/freebsd-e1000/common.hpp>
+#include <protocols/kernlet/compiler.hpp>
 
 async::detached E1000Nic::processIrqs() {
+#ifdef __x86_64__ // TODO: implement kernlet compilation for aarch64
+	co_await connectKernletCompiler();
+
+	// Reading ICR deasserts the (possibly shared) IRQ, hence the kernlet passes the bits on.
+	std::vector<uint8_t> kernlet_program;
+	fnr::emit_to(std::back_inserter(kernlet_program),
+		// Load the ICR register.
+		fnr::scope_push{} (
+			fnr::intrin{"__mmio_read32", 2, 1} (
+				fnr::binding{0}, // MMIO region (bound to slot 0).
+				fnr::binding{1} // MMIO offset (bound to slot 1).
+					+ fnr::literal{E1000_ICR} // Offset of ICR.
+			)
+		),
+		// Ack the IRQ iff one of the bits was set.
+		fnr::check_if{},
+			fnr::scope_get{0},
+		fnr::then{},
+			// Trigger the bitset event (bound to slot 2).
+			fnr::intrin{"__trigger_bitset", 2, 0} (
+				fnr::binding{2},
+				fnr::scope_get{0}
+			),
+			fnr::scope_push{} ( fnr::literal{1} ),
+		fnr::else_then{},
+			fnr::scope_push{} ( fnr::literal{2} ),
+		fnr::end{}
+	);
+
+	auto kernlet_object = co_await compile(kernlet_program.data(),
+			kernlet_program.size(), {BindType::memoryView, BindType::offset,
+			BindType::bitsetEvent});
+
+	HelHandle event_handle;
+	HEL_CHECK(helCreateBitsetEvent(&event_handle));
+	helix::UniqueDescriptor event{event_handle};
+
+	HelKernletData data[3];
+	data[0].handle = _mmio_bar.getHandle();
+	data[1].handle = _mmio_mapping.offset();
+	data[2].handle = event.getHandle();
+	HelHandle bound_handle;
+	HEL_CHECK(helBindKernlet(kernlet_object.getHandle(), data, 3, &bound_handle));
+	HEL_CHECK(helAutomateIrq(_irq.getHandle(), 0, bound_handle));
+
+	co_await _device.enableBusIrq();
+
+	// Clear the IRQ in case it was pending while we attached the kernlet.
+	HEL_CHECK(helAcknowledgeIrq(_irq.getHandle(), kHelAckKick | kHelAckClear, 0));
+
+	uint64_t sequence = 0;
+	while(true) {
+		auto await = co_await helix_ng::awaitEvent(event, sequence);
+		HEL_CHECK(await.error());
+		sequence = await.sequence();
+
+		handleIrqStatus(await.bitset());
+	}
+#else
 	co_await _device.enableBusIrq();
 
 	// TODO: The kick here should not be required.
@@ -15,26 +76,31 @@ async::detached E1000Nic::processIrqs() {
 		auto status = E1000_READ_REG(&_hw, E1000_ICR);
 		HEL_CHECK(helAcknowledgeIrq(_irq.getHandle(), kHelAckAcknowledge, sequence));
 
-		if(status & E1000_ICR_LSC) {
-			printf("e1000: link up\n");
-			status &= ~E1000_ICR_LSC;
-		}
+		handleIrqStatus(status);
+	}
+#endif
 
-		/* Ignore TX queue empty and TX writeback interrupts for now */
-		if(status & (E1000_ICR_TXQE | E1000_ICR_TXDW))
-			status &= ~(E1000_ICR_TXQE | E1000_ICR_TXDW);
+	co_return;
+}
 
-		if(status & E1000_ICR_RXT0) {
-			printf("e1000: handling packet RX irq\n");
-			while(eth_rx_pop());
-			status &= ~E1000_ICR_RXT0;
-		}
+void E1000Nic::handleIrqStatus(uint32_t status) {
+	if(status & E1000_ICR_LSC) {
+		printf("e1000: link up\n");
+		status &= ~E1000_ICR_LSC;
+	}
 
-		status &= ~E1000_ICR_INT_ASSERTED;
+	/* Ignore TX queue empty and TX writeback interrupts for now */
+	if(status & (E1000_ICR_TXQE | E1000_ICR_TXDW))
+		status &= ~(E1000_ICR_TXQE | E1000_ICR_TXDW);
 
-		if(status)
-			printf("e1000: unhandled IRQ status 0x%08x\n", status);
+	if(status & E1000_ICR_RXT0) {
+		printf("e1000: handling packet RX irq\n");
+		while(eth_rx_pop());
+		status &= ~E1000_ICR_RXT0;
 	}
 
-	co_return;
+	status &= ~E1000_ICR_INT_ASSERTED;
+
+	if(status)
+		printf("e1000: unhandled IRQ status 0x%08x\n", status);
 }
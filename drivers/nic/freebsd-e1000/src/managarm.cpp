@@ -56,9 +56,9 @@ async::result<void> E1000Nic::init() {
 
 	auto &barInfo = info.barInfo[0];
 	assert(barInfo.ioType == protocols::hw::IoType::kIoTypeMemory);
-	auto bar0 = co_await _device.accessBar(0);
+	_mmio_bar = co_await _device.accessBar(0);
 
-	_mmio_mapping = {bar0, barInfo.offset, barInfo.length};
+	_mmio_mapping = {_mmio_bar, barInfo.offset, barInfo.length};
 	_mmio = _mmio_mapping.get();
 
 	_hw.back = &_osdep;
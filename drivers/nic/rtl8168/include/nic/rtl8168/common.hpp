@@ -215,6 +215,8 @@ private:
 
 	async::detached processIrqs();
 
+	// Kept around so that the IRQ kernlet can access the registers.
+	helix::UniqueDescriptor _mmio_bar;
 	helix::Mapping _mmio_mapping;
 	arch::mem_space _mmio;
 
@@ -1,6 +1,7 @@
 #include <async/basic.hpp>
 #include <cctype>
 #include <cstdint>
+#include <fafnir/dsl.hpp>
 #include <initializer_list>
 #include <nic/rtl8168/common.hpp>
 #include <nic/rtl8168/rtl8168.hpp>
@@ -9,6 +10,7 @@
 #include <frg/logging.hpp>
 #include <helix/timer.hpp>
 #include <memory>
+#include <protocols/kernlet/compiler.hpp>
 #include <unistd.h>
 
 static const std::unordered_map<RealtekNic::MacRevision, std::string> rtl_chip_infos = {
@@ -90,9 +92,9 @@ async::result<void> RealtekNic::getMmio() {
 
 	auto &barInfo = info.barInfo[bar_index];
 	assert(barInfo.ioType == protocols::hw::IoType::kIoTypeMemory);
-	auto bar = co_await _device.accessBar(bar_index);
+	_mmio_bar = co_await _device.accessBar(bar_index);
 
-	_mmio_mapping = {bar, barInfo.offset, barInfo.length};
+	_mmio_mapping = {_mmio_bar, barInfo.offset, barInfo.length};
 	_mmio = _mmio_mapping.get();
 }
 
@@ -534,6 +536,44 @@ async::result<void> RealtekNic::send(arch::dma_buffer_view payload) {
 
 
 async::detached RealtekNic::processIrqs() {
+#ifdef __x86_64__ // TODO: implement kernlet compilation for aarch64
+	co_await connectKernletCompiler();
+
+	// The IRQ line can be shared with other devices. Let the kernel NAK IRQs
+	// while no interrupt status bits are set, such that they do not wake us up.
+	bool wideStatus = _model == PciModel::RTL8125;
+	std::vector<uint8_t> kernlet_program;
+	fnr::emit_to(std::back_inserter(kernlet_program),
+		// Load the interrupt status register.
+		fnr::scope_push{} (
+			fnr::intrin{wideStatus ? "__mmio_read32" : "__mmio_read16", 2, 1} (
+				fnr::binding{0}, // MMIO region (bound to slot 0).
+				fnr::binding{1} // MMIO offset (bound to slot 1).
+					+ fnr::literal{wideStatus ? regs::rtl8125::interrupt_status.offset()
+							: regs::interrupt_status.offset()}
+			)
+		),
+		// Wake up the driver iff one of the bits was set.
+		fnr::check_if{},
+			fnr::scope_get{0},
+		fnr::then{},
+			fnr::scope_push{} ( fnr::literal{0} ),
+		fnr::else_then{},
+			fnr::scope_push{} ( fnr::literal{2} ),
+		fnr::end{}
+	);
+
+	auto kernlet_object = co_await compile(kernlet_program.data(),
+			kernlet_program.size(), {BindType::memoryView, BindType::offset});
+
+	HelKernletData data[2];
+	data[0].handle = _mmio_bar.getHandle();
+	data[1].handle = _mmio_mapping.offset();
+	HelHandle bound_handle;
+	HEL_CHECK(helBindKernlet(kernlet_object.getHandle(), data, 2, &bound_handle));
+	HEL_CHECK(helAutomateIrq(_irq.getHandle(), 0, bound_handle));
+#endif
+
 	co_await _device.enableBusIrq();
 
 	// TODO: The kick here should not be required.
@@ -7,6 +7,7 @@
 #include <assert.h>
 #include <stdio.h>
 
+#include <async/algorithm.hpp>
 #include <async/result.hpp>
 #include <protocols/mbus/client.hpp>
 #include <protocols/usb/usb.hpp>
@@ -22,7 +23,7 @@ namespace {
 
 namespace proto = protocols::usb;
 
-async::detached StorageDevice::run(int config_num, int intf_num) {
+async::detached StorageDevice::run(int config_num, int intf_num, int alternative) {
 	// I own a USB key that does not support the READ6 command. ~AvdG
 	enableRead6 = false;
 
@@ -32,6 +33,9 @@ async::detached StorageDevice::run(int config_num, int intf_num) {
 	std::optional<int> out_endp_number;
 
 	proto::walkConfiguration(descriptor, [&] (int type, size_t, void *, const auto &info) {
+		if(info.interfaceNumber != intf_num || info.interfaceAlternative != alternative)
+			return;
+
 		if(type == proto::descriptor_type::endpoint) {
 			if(info.endpointIn.value()) {
 				in_endp_number = info.endpointNumber.value();
@@ -50,9 +54,11 @@ async::detached StorageDevice::run(int config_num, int intf_num) {
 		std::cout << "block-usb: Setting up configuration" << std::endl;
 
 	auto config = (co_await usbDevice_.useConfiguration(0, config_num)).unwrap();
-	auto intf = (co_await config.useInterface(intf_num, 0)).unwrap();
+	auto intf = (co_await config.useInterface(intf_num, alternative)).unwrap();
 	endp_in_ = (co_await intf.getEndpoint(proto::PipeType::in, in_endp_number.value())).unwrap();
 	endp_out_ = (co_await intf.getEndpoint(proto::PipeType::out, out_endp_number.value())).unwrap();
+	inAddress_ = in_endp_number.value() | 0x80;
+	outAddress_ = out_endp_number.value();
 
 	if(logSteps)
 		std::cout << "block-usb: Device is ready" << std::endl;
@@ -60,10 +66,28 @@ async::detached StorageDevice::run(int config_num, int intf_num) {
 	runScsi();
 }
 
+async::result<void> submitTransfer(const proto::Endpoint &endpoint, proto::BulkTransfer info,
+		frg::expected<proto::UsbError, size_t> &outcome) {
+	outcome = co_await endpoint.transfer(info);
+}
+
+async::result<frg::expected<proto::UsbError, size_t>> StorageDevice::clearHalt_(int address) {
+	arch::dma_object<proto::SetupPacket> clearHalt{usbDevice_.setupPool()};
+	clearHalt->type = proto::setup_type::targetEndpoint | proto::setup_type::byStandard
+			| proto::setup_type::toDevice;
+	clearHalt->request = proto::request_type::clearFeature;
+	clearHalt->value = proto::features::endpointHalt;
+	clearHalt->index = address;
+	clearHalt->length = 0;
+
+	co_return co_await usbDevice_.transfer(proto::ControlTransfer{proto::kXferToDevice,
+			clearHalt, arch::dma_buffer_view{}});
+}
+
 async::result<frg::expected<scsi::Error, size_t>> StorageDevice::sendScsiCommand(const scsi::CommandInfo &info) {
 	CommandBlockWrapper cbw{};
 	cbw.signature = Signatures::kSignCbw;
-	cbw.tag = 1;
+	cbw.tag = nextTag_++;
 	cbw.transferLength = info.data.size();
 	if(!info.isWrite) {
 		cbw.flags = 0x80; // Direction: Device-to-Host.
@@ -77,43 +101,73 @@ async::result<frg::expected<scsi::Error, size_t>> StorageDevice::sendScsiCommand
 
 	// TODO: Respect USB device DMA requirements.
 
-	// TODO: Ideally, we want to post the IN-transfer first.
-	// We do this to try to avoid unnecessary IRQs
-	// and round-trips to the device and host-controller driver.
-	CommandStatusWrapper csw;
+	CommandStatusWrapper csw{};
 
-	if(logSteps)
-		std::cout << "block-usb: Sending CBW" << std::endl;
-	(co_await endp_out_.transfer(proto::BulkTransfer{proto::XferFlags::kXferToDevice,
-			arch::dma_buffer_view{nullptr, &cbw, sizeof(CommandBlockWrapper)}})).unwrap();
+	// The CBW, data and CSW transfers are all queued at once. Only the CSW transfer
+	// requests an interrupt: HCDs complete the other transfers when it arrives.
+	// This avoids round-trips to the HCD and saves two IRQs per command.
+	// HCDs report a stall regardless of lazyNotification and skip the stalled transfer,
+	// hence the queued CSW transfer still completes if the data phase stalls.
+	proto::BulkTransfer cbwInfo{proto::XferFlags::kXferToDevice,
+			arch::dma_buffer_view{nullptr, &cbw, sizeof(CommandBlockWrapper)}};
+	cbwInfo.lazyNotification = true;
+
+	proto::BulkTransfer dataInfo{info.isWrite ? proto::XferFlags::kXferToDevice
+			: proto::XferFlags::kXferToHost, info.data};
+	dataInfo.lazyNotification = true;
+
+	proto::BulkTransfer cswInfo{proto::XferFlags::kXferToHost,
+			arch::dma_buffer_view{nullptr, &csw, sizeof(CommandStatusWrapper)}};
+
+	frg::expected<proto::UsbError, size_t> cbwOutcome{size_t{0}};
+	frg::expected<proto::UsbError, size_t> dataOutcome{size_t{0}};
+	frg::expected<proto::UsbError, size_t> cswOutcome{size_t{0}};
 
 	if(logSteps)
-		std::cout << "block-usb: Waiting for data" << std::endl;
-	if(!info.isWrite) {
-		proto::BulkTransfer data_info{proto::XferFlags::kXferToHost, info.data};
-		// TODO: We want this to be lazy but that only works if can ensure that
-		// the next transaction is also posted to the queue.
-//			data_info.lazyNotification = true;
-		(co_await endp_in_.transfer(data_info)).unwrap();
+		std::cout << "block-usb: Sending command " << cbw.tag << std::endl;
+	if(info.data.size()) {
+		co_await async::when_all(
+			submitTransfer(endp_out_, cbwInfo, cbwOutcome),
+			submitTransfer(info.isWrite ? endp_out_ : endp_in_, dataInfo, dataOutcome),
+			submitTransfer(endp_in_, cswInfo, cswOutcome)
+		);
 	}else{
-		(co_await endp_out_.transfer(proto::BulkTransfer{proto::XferFlags::kXferToDevice, info.data})).unwrap();
+		co_await async::when_all(
+			submitTransfer(endp_out_, cbwInfo, cbwOutcome),
+			submitTransfer(endp_in_, cswInfo, cswOutcome)
+		);
 	}
 
-	if(logSteps)
-		std::cout << "block-usb: Waiting for CSW" << std::endl;
-	(co_await endp_in_.transfer(proto::BulkTransfer{proto::XferFlags::kXferToHost,
-			arch::dma_buffer_view{nullptr, &csw, sizeof(CommandStatusWrapper)}})).unwrap();
+	// The device stalls the data phase if it transfers less data than requested.
+	// The host then clears the halt and reads the CSW (see BOT specification, 6.7.2/6.7.3).
+	// If reading the CSW stalls, the host clears the halt and retries once (see 5.3.3).
+	std::move(cbwOutcome).unwrap();
+	if(!dataOutcome && dataOutcome.error() == proto::UsbError::stall) {
+		if(logSteps)
+			std::cout << "block-usb: Data phase stalled" << std::endl;
+		(co_await clearHalt_(info.isWrite ? outAddress_ : inAddress_)).unwrap();
+	}else{
+		std::move(dataOutcome).unwrap();
+	}
+	if(!cswOutcome && cswOutcome.error() == proto::UsbError::stall) {
+		if(logSteps)
+			std::cout << "block-usb: CSW stalled" << std::endl;
+		(co_await clearHalt_(inAddress_)).unwrap();
+		cswInfo.lazyNotification = false;
+		co_await submitTransfer(endp_in_, cswInfo, cswOutcome);
+	}
 
 	if(logSteps)
 		std::cout << "block-usb: Request complete" << std::endl;
+	std::move(cswOutcome).unwrap();
 	assert(csw.signature == Signatures::kSignCsw);
-	assert(csw.tag == 1);
-	assert(!csw.dataResidue);
+	assert(csw.tag == cbw.tag);
+	assert(csw.dataResidue <= info.data.size());
 	if(csw.status) {
 		co_return scsi::statusToError(csw.status);
 	}
 
-	co_return info.data.size();
+	co_return info.data.size() - csw.dataResidue;
 }
 
 async::detached bindDevice(mbus_ng::Entity entity) {
@@ -122,9 +176,8 @@ async::detached bindDevice(mbus_ng::Entity entity) {
 
 	std::optional<int> config_number;
 	std::optional<int> intf_number;
-	std::optional<int> intf_class;
-	std::optional<int> intf_subclass;
-	std::optional<int> intf_protocol;
+	std::optional<int> bot_alternative;
+	std::optional<int> uas_alternative;
 
 	if(logEnumeration)
 		std::cout << "block-usb: Getting configuration descriptor" << std::endl;
@@ -135,47 +188,53 @@ async::detached bindDevice(mbus_ng::Entity entity) {
 		co_return;
 	}
 
+	// UAS devices usually expose a BOT alternate setting for compatibility.
 	proto::walkConfiguration(descriptorOrError.value(), [&] (int type, size_t, void *p, const auto &info) {
 		if(type == proto::descriptor_type::configuration) {
 			assert(!config_number);
 			config_number = info.configNumber.value();
 		}else if(type == proto::descriptor_type::interface) {
-			if(intf_number) {
+			if(intf_number && info.interfaceNumber.value() != intf_number.value()) {
 				std::cout << "block-usb: Ignoring interface "
 						<< info.interfaceNumber.value() << std::endl;
 				return;
 			}
+
+			auto desc = (proto::InterfaceDescriptor *)p;
 			if(logEnumeration)
 				std::cout << "block-usb: Found interface: " << info.interfaceNumber.value()
-						<< ", alternative: " << info.interfaceAlternative.value() << std::endl;
-			intf_number = info.interfaceNumber.value();
+						<< ", alternative: " << info.interfaceAlternative.value()
+						<< ", class: 0x" << std::hex << (int)desc->interfaceClass
+						<< ", subclass: 0x" << (int)desc->interfaceSubClass
+						<< ", protocol: 0x" << (int)desc->interfaceProtocol
+						<< std::dec << std::endl;
+			if(desc->interfaceClass != protocols::usb::usb_class::mass_storage
+					|| desc->interfaceSubClass != 0x06)
+				return;
 
-			assert(!intf_class);
-			assert(!intf_subclass);
-			assert(!intf_protocol);
-			auto desc = (proto::InterfaceDescriptor *)p;
-			intf_class = desc->interfaceClass;
-			intf_subclass = desc->interfaceSubClass;
-			intf_protocol = desc->interfaceProtocol;
+			intf_number = info.interfaceNumber.value();
+			if(desc->interfaceProtocol == 0x50 && !bot_alternative)
+				bot_alternative = info.interfaceAlternative.value();
+			if(desc->interfaceProtocol == 0x62 && !uas_alternative)
+				uas_alternative = info.interfaceAlternative.value();
 		}
 	});
 
-	if(logEnumeration)
-		std::cout << "block-usb: Device class: 0x" << std::hex << intf_class.value()
-				<< ", subclass: 0x" << intf_subclass.value()
-				<< ", protocol: 0x" << intf_protocol.value()
-				<< std::dec << std::endl;
-	if(intf_class.value() != protocols::usb::usb_class::mass_storage
-			|| intf_subclass.value() != 0x06
-			|| intf_protocol.value() != 0x50)
-		co_return;
+	if(uas_alternative) {
+		if(logEnumeration)
+			std::cout << "block-usb: Detected UAS device" << std::endl;
 
-	if(logEnumeration)
-		std::cout << "block-usb: Detected USB device" << std::endl;
+		auto storage_device = new UasStorageDevice(device, entity.id());
+		storage_device->run(config_number.value(), intf_number.value(), uas_alternative.value());
+		blockfs::runDevice(storage_device);
+	}else if(bot_alternative) {
+		if(logEnumeration)
+			std::cout << "block-usb: Detected USB device" << std::endl;
 
-	auto storage_device = new StorageDevice(device, entity.id());
-	storage_device->run(config_number.value(), intf_number.value());
-	blockfs::runDevice(storage_device);
+		auto storage_device = new StorageDevice(device, entity.id());
+		storage_device->run(config_number.value(), intf_number.value(), bot_alternative.value());
+		blockfs::runDevice(storage_device);
+	}
 }
 
 async::detached observeDevices() {
@@ -2,9 +2,22 @@
 #include <async/oneshot-event.hpp>
 #include <async/result.hpp>
 #include <blockfs.hpp>
+#include <protocols/usb/api.hpp>
 #include <scsi.hpp>
 #include <boost/intrusive/list.hpp>
 
+#include <vector>
+
+// Performs a transfer and stores its outcome. Used to queue multiple transfers
+// at once via async::when_all().
+async::result<void> submitTransfer(const protocols::usb::Endpoint &endpoint,
+		protocols::usb::BulkTransfer info,
+		frg::expected<protocols::usb::UsbError, size_t> &outcome);
+
+// --------------------------------------------------------
+// Bulk-Only Transport (BOT)
+// --------------------------------------------------------
+
 enum Signatures {
 	kSignCbw = 0x43425355,
 	kSignCsw = 0x53425355
@@ -34,13 +47,127 @@ struct StorageDevice : scsi::StorageDevice {
 	: scsi::StorageDevice(512, parent_id), usbDevice_(std::move(usb_device)),
 		endp_in_{nullptr}, endp_out_{nullptr} { }
 
-	async::detached run(int config_num, int intf_num);
+	async::detached run(int config_num, int intf_num, int alternative);
 
 	async::result<frg::expected<scsi::Error, size_t>> sendScsiCommand(const scsi::CommandInfo &info) override;
 
 private:
+	// Clears the halt feature of an endpoint (given by its address) on the device.
+	async::result<frg::expected<protocols::usb::UsbError, size_t>> clearHalt_(int address);
+
 	protocols::usb::Device usbDevice_;
 	protocols::usb::Endpoint endp_in_;
 	protocols::usb::Endpoint endp_out_;
+	// Endpoint addresses (i.e., including the direction bit).
+	int inAddress_ = 0;
+	int outAddress_ = 0;
+
+	uint32_t nextTag_ = 1;
+};
+
+// --------------------------------------------------------
+// USB Attached SCSI (UAS)
+// --------------------------------------------------------
+
+namespace uas {
+
+// Descriptors that are used to identify the UAS pipes.
+inline constexpr int pipeUsageDescriptor = 0x24;
+inline constexpr int ssEndpointCompanionDescriptor = 0x30;
+
+enum PipeId : uint8_t {
+	commandPipe = 1,
+	statusPipe = 2,
+	dataInPipe = 3,
+	dataOutPipe = 4
+};
+
+enum IuId : uint8_t {
+	commandIu = 0x01,
+	senseIu = 0x03,
+	responseIu = 0x04,
+	readReadyIu = 0x06,
+	writeReadyIu = 0x07
+};
+
+// Multi-byte fields of IUs are big endian.
+struct [[ gnu::packed ]] CommandIu {
+	uint8_t iuId;
+	uint8_t reserved0;
+	uint16_t tag;
+	uint8_t priorityAttribute;
+	uint8_t reserved1;
+	uint8_t additionalCdbLength;
+	uint8_t reserved2;
+	uint8_t lun[8];
+	uint8_t cdb[16];
+};
+static_assert(sizeof(CommandIu) == 32);
+
+// IUs that are received on the status pipe all start with the ID and the tag.
+// We receive them into a buffer that is large enough for any Sense IU that we handle.
+struct [[ gnu::packed ]] StatusIu {
+	uint8_t iuId;
+	uint8_t reserved0;
+	uint16_t tag;
+	uint16_t statusQualifier;
+	uint8_t status;
+	uint8_t reserved1[7];
+	uint16_t senseLength;
+	uint8_t senseData[96];
+};
+static_assert(sizeof(StatusIu) == 112);
+
+// For Response IUs, the response code is at the same offset as the status of Sense IUs.
+inline constexpr size_t responseCodeOffset = 7;
+
+// Number of tags that we use if the device does not use streams.
+inline constexpr size_t maxTags = 32;
+
+} // namespace uas
+
+struct UasStorageDevice : scsi::StorageDevice {
+	UasStorageDevice(protocols::usb::Device usb_device, int64_t parent_id)
+	: scsi::StorageDevice(512, parent_id), usbDevice_(std::move(usb_device)),
+		commandPipe_{nullptr}, statusPipe_{nullptr}, dataInPipe_{nullptr}, dataOutPipe_{nullptr} { }
+
+	async::detached run(int config_num, int intf_num, int alternative);
+
+	async::result<frg::expected<scsi::Error, size_t>> sendScsiCommand(const scsi::CommandInfo &info) override;
+
+private:
+	// Lives in the frame of sendScsiCommand().
+	struct Command {
+		const scsi::CommandInfo *info;
+		uas::StatusIu status{};
+
+		// Set by READ READY and WRITE READY IUs (i.e., only used without streams).
+		bool dataPending = false;
+		frg::expected<protocols::usb::UsbError, size_t> dataOutcome{size_t{0}};
+		async::oneshot_event statusEvent;
+		async::oneshot_event dataEvent;
+	};
+
+	// Without streams, the device announces data phases via READ READY and WRITE READY IUs
+	// on the status pipe. This coroutine receives all IUs and dispatches them to the commands.
+	async::detached receiveStatus_();
+
+	// Uses stream 0 if streams are not used.
+	async::detached transferData_(Command *command, uint16_t streamId);
+
+	uint16_t allocateTag_();
+
+	protocols::usb::Device usbDevice_;
+	protocols::usb::Endpoint commandPipe_;
+	protocols::usb::Endpoint statusPipe_;
+	protocols::usb::Endpoint dataInPipe_;
+	protocols::usb::Endpoint dataOutPipe_;
+
+	// If this is true, commands are tagged with the stream ID that their
+	// status and data transfers use (USB 3 only).
+	bool useStreams_ = false;
+
+	// Indexed by tag; tag 0 is not used (as stream 0 is reserved).
+	std::vector<Command *> commands_;
 };
 
@@ -0,0 +1,235 @@
+#include <algorithm>
+#include <iostream>
+#include <optional>
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <arch/bit.hpp>
+#include <async/algorithm.hpp>
+#include <async/result.hpp>
+#include <protocols/usb/usb.hpp>
+#include <protocols/usb/api.hpp>
+
+#include "storage.hpp"
+
+namespace {
+	constexpr bool logEnumeration = false;
+	constexpr bool logSteps = false;
+}
+
+namespace proto = protocols::usb;
+
+using arch::convert_endian;
+using arch::endian;
+
+async::detached UasStorageDevice::run(int config_num, int intf_num, int alternative) {
+	enableRead6 = false;
+
+	auto descriptor = (co_await usbDevice_.configurationDescriptor(0)).unwrap();
+
+	// Pipe usage descriptors follow the endpoint descriptor that they refer to.
+	std::optional<int> pipes[5];
+	std::optional<int> endp_number;
+	int max_streams = 0;
+
+	proto::walkConfiguration(descriptor, [&] (int type, size_t, void *p, const auto &info) {
+		if(info.interfaceNumber != intf_num || info.interfaceAlternative != alternative)
+			return;
+
+		auto bytes = static_cast<uint8_t *>(p);
+		if(type == proto::descriptor_type::endpoint) {
+			endp_number = info.endpointNumber.value();
+		}else if(type == uas::ssEndpointCompanionDescriptor) {
+			// Bits 0-4 of bmAttributes encode the maximal number of streams (log2).
+			if(auto n = bytes[3] & 0x1F)
+				max_streams = std::max(max_streams, 1 << n);
+		}else if(type == uas::pipeUsageDescriptor) {
+			auto pipe = bytes[2];
+			if(pipe >= uas::commandPipe && pipe <= uas::dataOutPipe && endp_number)
+				pipes[pipe] = endp_number;
+		}else{
+			if(logEnumeration)
+				printf("block-uas: Unexpected descriptor type: %d!\n", type);
+		}
+	});
+
+	if(!pipes[uas::commandPipe] || !pipes[uas::statusPipe]
+			|| !pipes[uas::dataInPipe] || !pipes[uas::dataOutPipe]) {
+		std::cout << "block-uas: Device lacks pipe usage descriptors" << std::endl;
+		co_return;
+	}
+
+	if(logSteps)
+		std::cout << "block-uas: Setting up configuration" << std::endl;
+
+	auto config = (co_await usbDevice_.useConfiguration(0, config_num)).unwrap();
+	auto intf = (co_await config.useInterface(intf_num, alternative)).unwrap();
+	commandPipe_ = (co_await intf.getEndpoint(proto::PipeType::out,
+			pipes[uas::commandPipe].value())).unwrap();
+	statusPipe_ = (co_await intf.getEndpoint(proto::PipeType::in,
+			pipes[uas::statusPipe].value())).unwrap();
+	dataInPipe_ = (co_await intf.getEndpoint(proto::PipeType::in,
+			pipes[uas::dataInPipe].value())).unwrap();
+	dataOutPipe_ = (co_await intf.getEndpoint(proto::PipeType::out,
+			pipes[uas::dataOutPipe].value())).unwrap();
+
+	// USB 3 devices tag commands by bulk streams; the HCD might support fewer streams.
+	size_t num_tags = uas::maxTags;
+	if(max_streams) {
+		auto status_streams = co_await statusPipe_.allocateStreams(max_streams);
+		auto in_streams = co_await dataInPipe_.allocateStreams(max_streams);
+		auto out_streams = co_await dataOutPipe_.allocateStreams(max_streams);
+		if(status_streams && in_streams && out_streams) {
+			useStreams_ = true;
+			num_tags = std::min({status_streams.value(), in_streams.value(),
+					out_streams.value(), uas::maxTags});
+		}else{
+			std::cout << "block-uas: HCD does not support streams,"
+					" falling back to READ/WRITE READY IUs" << std::endl;
+		}
+	}
+
+	commands_.resize(num_tags + 1, nullptr);
+	commandSlots = num_tags;
+
+	if(!useStreams_)
+		receiveStatus_();
+
+	std::cout << "block-uas: Device is ready (" << num_tags << " tags"
+			<< (useStreams_ ? ", using streams" : "") << ")" << std::endl;
+
+	runScsi();
+}
+
+uint16_t UasStorageDevice::allocateTag_() {
+	// runScsi() never submits more than commandSlots commands at once.
+	for(size_t tag = 1; tag < commands_.size(); tag++) {
+		if(!commands_[tag])
+			return tag;
+	}
+	assert(!"block-uas: No free tags");
+	__builtin_unreachable();
+}
+
+async::result<frg::expected<scsi::Error, size_t>> UasStorageDevice::sendScsiCommand(const scsi::CommandInfo &info) {
+	auto tag = allocateTag_();
+	Command command{&info};
+	commands_[tag] = &command;
+
+	uas::CommandIu iu{};
+	iu.iuId = uas::commandIu;
+	iu.tag = convert_endian<endian::big, endian::native>(tag);
+	assert(info.command.size() <= sizeof(iu.cdb));
+	memcpy(iu.cdb, info.command.data(), info.command.size());
+
+	proto::BulkTransfer commandInfo{proto::XferFlags::kXferToDevice,
+			arch::dma_buffer_view{nullptr, &iu, sizeof(uas::CommandIu)}};
+
+	if(logSteps)
+		std::cout << "block-uas: Sending command " << tag << std::endl;
+
+	if(useStreams_) {
+		// Queue the status and data transfers on the command's stream before
+		// sending the command; the device then completes them without further
+		// interaction with the host.
+		proto::BulkTransfer statusInfo{proto::XferFlags::kXferToHost,
+				arch::dma_buffer_view{nullptr, &command.status, sizeof(uas::StatusIu)}};
+		statusInfo.streamId = tag;
+
+		frg::expected<proto::UsbError, size_t> statusOutcome{size_t{0}};
+		frg::expected<proto::UsbError, size_t> commandOutcome{size_t{0}};
+
+		// The data transfer is awaited separately: if the command fails before
+		// its data phase, the device never serves it.
+		if(info.data.size())
+			transferData_(&command, tag);
+		co_await async::when_all(
+			submitTransfer(statusPipe_, statusInfo, statusOutcome),
+			submitTransfer(commandPipe_, commandInfo, commandOutcome)
+		);
+
+		std::move(statusOutcome).unwrap();
+		std::move(commandOutcome).unwrap();
+
+		if(info.data.size()) {
+			// Abort the data transfer unless the command succeeded (like Linux does).
+			// Aborting a transfer that already completed is harmless.
+			if(command.status.iuId != uas::senseIu || command.status.status) {
+				auto &dataPipe = info.isWrite ? dataOutPipe_ : dataInPipe_;
+				if(auto outcome = co_await dataPipe.abortStream(tag); !outcome)
+					std::cout << "block-uas: Failed to abort data transfer of command "
+							<< tag << std::endl;
+			}
+			co_await command.dataEvent.wait();
+		}
+	}else{
+		(co_await commandPipe_.transfer(commandInfo)).unwrap();
+
+		co_await command.statusEvent.wait();
+		if(command.dataPending)
+			co_await command.dataEvent.wait();
+	}
+
+	commands_[tag] = nullptr;
+
+	if(logSteps)
+		std::cout << "block-uas: Command " << tag << " complete" << std::endl;
+
+	if(command.status.iuId == uas::responseIu) {
+		auto code = reinterpret_cast<uint8_t *>(&command.status)[uas::responseCodeOffset];
+		std::cout << "block-uas: Command " << tag << " failed with response code "
+				<< static_cast<int>(code) << std::endl;
+		co_return scsi::Error{.type = scsi::ErrorType::deviceSpecific, .code = code};
+	}
+	assert(command.status.iuId == uas::senseIu);
+	if(command.status.status)
+		co_return scsi::statusToError(command.status.status);
+
+	co_return std::move(command.dataOutcome).unwrap();
+}
+
+async::detached UasStorageDevice::receiveStatus_() {
+	uas::StatusIu iu;
+	while(true) {
+		auto outcome = co_await statusPipe_.transfer(proto::BulkTransfer{proto::XferFlags::kXferToHost,
+				arch::dma_buffer_view{nullptr, &iu, sizeof(uas::StatusIu)}});
+		if(!outcome) {
+			std::cout << "block-uas: Failed to receive IU on status pipe" << std::endl;
+			continue;
+		}
+
+		auto tag = convert_endian<endian::native, endian::big>(iu.tag);
+		auto command = tag < commands_.size() ? commands_[tag] : nullptr;
+		if(!command) {
+			std::cout << "block-uas: IU " << static_cast<int>(iu.iuId)
+					<< " for unknown tag " << tag << std::endl;
+			continue;
+		}
+
+		switch(iu.iuId) {
+		case uas::readReadyIu:
+		case uas::writeReadyIu:
+			command->dataPending = true;
+			transferData_(command, 0);
+			break;
+		case uas::senseIu:
+		case uas::responseIu:
+			memcpy(&command->status, &iu, outcome.value());
+			command->statusEvent.raise();
+			break;
+		default:
+			std::cout << "block-uas: Unexpected IU " << static_cast<int>(iu.iuId) << std::endl;
+		}
+	}
+}
+
+async::detached UasStorageDevice::transferData_(Command *command, uint16_t streamId) {
+	auto info = command->info;
+	proto::BulkTransfer transfer{info->isWrite ? proto::XferFlags::kXferToDevice
+			: proto::XferFlags::kXferToHost, info->data};
+	transfer.streamId = streamId;
+	command->dataOutcome = co_await (info->isWrite ? dataOutPipe_ : dataInPipe_).transfer(transfer);
+	command->dataEvent.raise();
+}
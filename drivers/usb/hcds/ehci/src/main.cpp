@@ -222,6 +222,12 @@ async::detached Controller::initialize() {
 	_operational.store(op_regs::usbcmd, usbcmd::run(true) | usbcmd::irqThreshold(0x08));
 	_operational.store(op_regs::configflag, 0x01);
 
+	// Companion controllers (i.e., UHCI) wait for this before they are started.
+	auto entity = co_await _entity.intoEntity();
+	co_await entity.updateProperties({
+		{"ehci.ports-routed", mbus_ng::StringItem{"1"}}
+	});
+
 	_rootHub = std::make_shared<RootHub>(this);
 	_enumerator.observeHub(_rootHub);
 
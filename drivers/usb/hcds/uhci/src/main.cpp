@@ -6,6 +6,7 @@
 #include <functional>
 #include <iostream>
 #include <memory>
+#include <optional>
 
 #include <arch/bits.hpp>
 #include <arch/register.hpp>
@@ -1023,7 +1024,55 @@ void Controller::_dump(Transaction *transaction) {
 // Freestanding PCI discovery functions.
 // ----------------------------------------------------------------
 
+// UHCI controllers are companions of the EHCI function in the same PCI slot (if any).
+// They must not be started before EHCI has claimed its ports (see ehci.ports-routed).
+async::result<void> waitForEhciCompanion(const mbus_ng::Entity &entity) {
+	auto properties = (co_await entity.getProperties()).unwrap();
+	auto getString = [&] (const std::string &key) -> std::string {
+		if(auto item = std::get_if<mbus_ng::StringItem>(&properties[key]); item)
+			return item->value;
+		return {};
+	};
+
+	// The kernel publishes all PCI functions before drivers are started,
+	// hence a single enumeration of the slot sees the EHCI function.
+	auto slotFilter = mbus_ng::Conjunction{{
+		mbus_ng::EqualsFilter{"pci-segment", getString("pci-segment")},
+		mbus_ng::EqualsFilter{"pci-bus", getString("pci-bus")},
+		mbus_ng::EqualsFilter{"pci-slot", getString("pci-slot")}
+	}};
+
+	std::optional<mbus_ng::EntityId> ehciId;
+	auto enumerator = mbus_ng::Instance::global().enumerate(slotFilter);
+	while(true) {
+		auto [paginated, events] = (co_await enumerator.nextEvents()).unwrap();
+		for(auto &event : events) {
+			auto isString = [&] (const std::string &key, std::string_view value) {
+				auto item = std::get_if<mbus_ng::StringItem>(&event.properties[key]);
+				return item && item->value == value;
+			};
+			if(isString("pci-class", "0c") && isString("pci-subclass", "03")
+					&& isString("pci-interface", "20"))
+				ehciId = event.id;
+		}
+		if(!paginated)
+			break;
+	}
+	if(!ehciId)
+		co_return;
+
+	std::cout << "uhci: Waiting for EHCI companion controller" << std::endl;
+	auto routedFilter = mbus_ng::Conjunction{{
+		mbus_ng::EqualsFilter{"usb.root.parent", std::to_string(*ehciId)},
+		mbus_ng::EqualsFilter{"ehci.ports-routed", "1"}
+	}};
+	auto routedEnumerator = mbus_ng::Instance::global().enumerate(routedFilter);
+	(co_await routedEnumerator.nextEvents()).unwrap();
+}
+
 async::detached bindController(mbus_ng::Entity entity) {
+	co_await waitForEhciCompanion(entity);
+
 	protocols::hw::Device device((co_await entity.getRemoteLane()).unwrap());
 	auto info = co_await device.getPciInfo();
 	assert(info.barInfo[4].ioType == protocols::hw::IoType::kIoTypePort);
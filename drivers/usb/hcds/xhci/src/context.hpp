@@ -157,6 +157,14 @@ namespace SlotFields {
 } // namespace SlotFields
 
 namespace EpFields {
+	constexpr ContextField maxPStreams(uint8_t v) {
+		return {0, uint32_t{v & 0x1Fu} << 10};
+	}
+
+	constexpr ContextField linearStreamArray(bool v) {
+		return {0, uint32_t{v} << 15};
+	}
+
 	constexpr ContextField interval(uint8_t v) {
 		return {0, uint32_t{v} << 16};
 	}
@@ -199,3 +207,14 @@ namespace EpFields {
 		return {4, uint32_t{v & 0xFFFF} << 16};
 	}
 } // namespace EpFields
+
+// Entry of a stream context array.
+struct StreamContext {
+	uint32_t val[4];
+};
+static_assert(sizeof(StreamContext) == 16);
+
+namespace StreamFields {
+	// Stream context type 1: the entry points to a primary transfer ring.
+	inline constexpr uint32_t primaryRing = 1 << 1;
+} // namespace StreamFields
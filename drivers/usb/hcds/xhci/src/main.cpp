@@ -1,4 +1,5 @@
 
+#include <algorithm>
 #include <assert.h>
 #include <stdio.h>
 #include <unistd.h>
@@ -41,7 +42,7 @@ Controller::Controller(protocols::hw::Device hw_device, mbus_ng::Entity entity,
 		_space{_mapping.get()}, _name{name}, _memoryPool{},
 		_dcbaa{&_memoryPool, 256}, _cmdRing{this},
 		_eventRing{this},
-		_enumerator{this}, _largeCtx{false},
+		_enumerator{this}, _largeCtx{false}, _maxPsaSize{0},
 		_entity{std::move(entity)} {
 	auto doorbell_offset = _space.load(cap_regs::dboff);
 	_doorbells = _space.subspace(doorbell_offset);
@@ -122,6 +123,7 @@ async::detached Controller::initialize() {
 	std::cout << this << "Controller reset done" << std::endl;
 
 	_largeCtx = _space.load(cap_regs::hccparams1) & hccparams1::contextSize;
+	_maxPsaSize = _space.load(cap_regs::hccparams1) & hccparams1::maxPsaSize;
 
 	_maxDeviceSlots = _space.load(cap_regs::hcsparams1) & hcsparams1::maxDevSlots;
 	operational.store(op_regs::config, config::enabledDeviceSlots(_maxDeviceSlots));
@@ -327,7 +329,7 @@ void Controller::processEvent(Event ev) {
 
 		case transferEvent:
 			if (auto ep = _devices[ev.slotId]->endpoint(ev.endpointId))
-				ep->transferRing().processEvent(ev);
+				ep->processEvent(ev);
 			else
 				std::cout << this << "Event for missing endpoint ID " << ev.endpointId
 					<< " on slot " << ev.slotId << std::endl;
@@ -666,9 +668,9 @@ Device::transfer(proto::ControlTransfer info) {
 	co_return co_await _endpoints[0]->transfer(info);
 }
 
-void Device::submit(int endpoint) {
+void Device::submit(int endpoint, uint16_t streamId) {
 	assert(_slotId != -1);
-	_controller->ringDoorbell(_slotId, endpoint);
+	_controller->ringDoorbell(_slotId, endpoint, streamId);
 }
 
 static inline uint8_t getHcdSpeedId(proto::DeviceSpeed speed) {
@@ -918,6 +920,44 @@ Device::updateEp0PacketSize(size_t maxPacketSize) {
 	co_return frg::success;
 }
 
+async::result<frg::expected<proto::UsbError>>
+Device::configureStreams(int endpointId, uintptr_t streamArray, uint8_t maxPStreams) {
+	InputContext inputCtx{_controller->largeCtx(), _controller->memoryPool()};
+
+	// Dropping and adding the endpoint in the same command reconfigures it.
+	inputCtx.get(inputCtxCtrl) |= InputControlFields::add(0); // Slot Context
+	inputCtx.get(inputCtxCtrl) |= InputControlFields::drop(endpointId);
+	inputCtx.get(inputCtxCtrl) |= InputControlFields::add(endpointId);
+	inputCtx.get(inputCtxSlot) = _devCtx.get(deviceCtxSlot);
+
+	auto &epCtx = inputCtx.get(inputCtxEp0 + endpointId - 1);
+	epCtx = _devCtx.get(deviceCtxEp0 + endpointId - 1);
+
+	// Clear the endpoint state (which is owned by the xHC) and the TR dequeue pointer.
+	epCtx &= ~ContextField{0, 0b111};
+	epCtx &= ~EpFields::dequeCycle(true);
+	epCtx &= ~EpFields::trPointerLo(0xFFFFFFF0);
+	epCtx &= ~EpFields::trPointerHi(0xFFFFFFFF00000000);
+
+	// For streams, the TR dequeue pointer points to the stream context array.
+	epCtx |= EpFields::maxPStreams(maxPStreams);
+	epCtx |= EpFields::linearStreamArray(true);
+	epCtx |= EpFields::trPointerLo(streamArray);
+	epCtx |= EpFields::trPointerHi(streamArray);
+
+	auto event = co_await _controller->submitCommand(
+			Command::configureEndpoint(_slotId,
+				helix::ptrToPhysical(inputCtx.rawData())));
+
+	if (event.completionCode != 1)
+		std::cout << _controller << "Failed to configure streams for EP " << endpointId
+			<< ", completion code: " << completionCodeNames[event.completionCode] << std::endl;
+
+	FRG_CO_TRY(completionToError(event));
+
+	co_return frg::success;
+}
+
 // ------------------------------------------------------------------------
 // ConfigurationState
 // ------------------------------------------------------------------------
@@ -976,22 +1016,23 @@ EndpointState::transfer(proto::ControlTransfer info) {
 }
 
 async::result<frg::expected<proto::UsbError, size_t>>
-EndpointState::_bulkOrInterruptXfer(arch::dma_buffer_view buffer) {
+EndpointState::_bulkOrInterruptXfer(arch::dma_buffer_view buffer, uint16_t streamId) {
 	ProducerRing::Transaction tx;
+	auto &ring = _ringFor(streamId);
 
 	Transfer::buildNormalChain([&] (RawTrb trb) {
-		_transferRing.pushRawTrb(trb, &tx);
+		ring.pushRawTrb(trb, &tx);
 	}, buffer, _maxPacketSize);
 
-	size_t nextDequeue = _transferRing.enqueuePtr();
-	bool nextCycle = _transferRing.producerCycle();
+	size_t nextDequeue = ring.enqueuePtr();
+	bool nextCycle = ring.producerCycle();
 
-	_device->submit(_endpointId);
+	_device->submit(_endpointId, streamId);
 
 	auto maybeResidue = co_await tx.normal();
 
 	if (!maybeResidue && maybeResidue.error() == proto::UsbError::stall) {
-		auto res = co_await _resetAfterError(nextDequeue, nextCycle);
+		auto res = co_await _resetAfterError(nextDequeue, nextCycle, streamId);
 		if (!res) {
 			std::cout << _device->controller() << "Failed to reset EP " << _endpointId
 				<< " after stall: " << (int)res.error() << std::endl;
@@ -1008,11 +1049,112 @@ EndpointState::transfer(proto::InterruptTransfer info) {
 
 async::result<frg::expected<proto::UsbError, size_t>>
 EndpointState::transfer(proto::BulkTransfer info) {
-	co_return co_await _bulkOrInterruptXfer(info.buffer);
+	if (info.streamId > _streamRings.size())
+		co_return proto::UsbError::other;
+
+	co_return co_await _bulkOrInterruptXfer(info.buffer, info.streamId);
+}
+
+async::result<frg::expected<proto::UsbError, size_t>>
+EndpointState::allocateStreams(size_t count) {
+	auto maxPsaSize = _device->controller()->maxPsaSize();
+	if (_type != proto::EndpointType::bulk || !maxPsaSize || !count)
+		co_return proto::UsbError::unsupported;
+	if (!_streamRings.empty())
+		co_return std::min(count, _streamRings.size());
+
+	// The array has 2^(maxPStreams + 1) entries but stream 0 is reserved.
+	uint8_t maxPStreams = 0;
+	while (maxPStreams < maxPsaSize
+			&& (size_t{2} << maxPStreams) < maxStreamContexts
+			&& (size_t{2} << maxPStreams) < count + 1)
+		maxPStreams++;
+	size_t numStreams = (size_t{2} << maxPStreams) - 1;
+
+	_streamContexts = arch::dma_object<StreamContextArray>{_device->controller()->memoryPool()};
+	_streamContexts->ent[0] = {{0, 0, 0, 0}};
+	for (size_t i = 0; i < numStreams; i++) {
+		auto ring = std::make_unique<ProducerRing>(_device->controller());
+		auto ptr = ring->getPtr();
+		// New rings start with a producer cycle state of 1.
+		_streamContexts->ent[i + 1] = {{
+			static_cast<uint32_t>(ptr & 0xFFFFFFF0) | StreamFields::primaryRing | 1,
+			static_cast<uint32_t>(ptr >> 32), 0, 0
+		}};
+		_streamRings.push_back(std::move(ring));
+	}
+
+	auto res = co_await _device->configureStreams(_endpointId,
+			helix::ptrToPhysical(_streamContexts.data()), maxPStreams);
+	if (!res) {
+		_streamRings.clear();
+		co_return res.error();
+	}
+
+	std::cout << _device->controller() << "Allocated " << numStreams
+		<< " streams for EP " << _endpointId << std::endl;
+
+	co_return std::min(count, numStreams);
+}
+
+async::result<frg::expected<proto::UsbError>>
+EndpointState::abortStream(uint16_t streamId) {
+	if (!streamId || streamId > _streamRings.size())
+		co_return proto::UsbError::other;
+	auto &ring = _ringFor(streamId);
+
+	// Stop the endpoint such that the xHC does not access the ring while we modify it.
+	// A context state error means that the endpoint is already stopped (or halted).
+	auto event = co_await _device->controller()->submitCommand(
+		Command::stopEndpoint(_device->slot(), _endpointId));
+
+	if (event.completionCode != 1 && event.completionCode != 19) {
+		std::cout << _device->controller() << "Failed to stop EP " << _endpointId
+			<< ", completion code: " << completionCodeNames[event.completionCode] << std::endl;
+		co_return proto::UsbError::other;
+	}
+
+	ring.abortTransactions(26); // Stopped.
+
+	// Skip the aborted TDs.
+	auto dequeue = ring.getPtr() + ring.enqueuePtr() * sizeof(RawTrb);
+	event = co_await _device->controller()->submitCommand(
+		Command::setTransferRingDequeue(_device->slot(), _endpointId,
+				dequeue | StreamFields::primaryRing | ring.producerCycle(), streamId));
+
+	if (event.completionCode != 1)
+		std::cout << _device->controller() << "Failed to set TR dequeue pointer"
+			<< ", completion code: " << completionCodeNames[event.completionCode] << std::endl;
+
+	FRG_CO_TRY(completionToError(event));
+
+	// Restart the streams that still have TDs queued.
+	for (size_t i = 0; i < _streamRings.size(); i++) {
+		if (_streamRings[i]->hasPendingTransactions())
+			_device->submit(_endpointId, i + 1);
+	}
+
+	co_return frg::success;
+}
+
+void EndpointState::processEvent(Event ev) {
+	// abortStream() stops the endpoint, which interrupts TDs of other streams.
+	// These TDs are resumed when the doorbell is rung again.
+	if (ev.completionCode >= 26 && ev.completionCode <= 28) // Stopped.
+		return;
+
+	for (auto &ring : _streamRings) {
+		if (ring->containsTrb(ev.trbPointer)) {
+			ring->processEvent(ev);
+			return;
+		}
+	}
+
+	_transferRing.processEvent(ev);
 }
 
 async::result<frg::expected<proto::UsbError>>
-EndpointState::_resetAfterError(size_t nextDequeue, bool cycle) {
+EndpointState::_resetAfterError(size_t nextDequeue, bool cycle, uint16_t streamId) {
 	// Issue the Reset Endpoint command to reset the xHC state
 	auto event = co_await _device->controller()->submitCommand(
 		Command::resetEndpoint(_device->slot(), _endpointId));
@@ -1036,7 +1178,8 @@ EndpointState::_resetAfterError(size_t nextDequeue, bool cycle) {
 		clearHalt->type = proto::setup_type::targetEndpoint | proto::setup_type::byStandard | proto::setup_type::toDevice;
 		clearHalt->request = proto::request_type::clearFeature;
 		clearHalt->value = proto::features::endpointHalt;
-		clearHalt->index = _endpointId >> 1; // Our ID is EP no. * 2 + direction
+		// Our ID is EP no. * 2 + direction; the index is the endpoint address.
+		clearHalt->index = (_endpointId >> 1) | ((_endpointId & 1) ? 0x80 : 0);
 		clearHalt->length = 0;
 
 		FRG_CO_TRY(co_await _device->transfer({protocols::usb::kXferToDevice, clearHalt, {}}));
@@ -1044,10 +1187,12 @@ EndpointState::_resetAfterError(size_t nextDequeue, bool cycle) {
 
 	// Issue the Set TR Dequeue Pointer command to skip the failed
 	// transfer
-	auto dequeue = _transferRing.getPtr() + nextDequeue * sizeof(RawTrb);
+	auto dequeue = _ringFor(streamId).getPtr() + nextDequeue * sizeof(RawTrb);
+	if (streamId)
+		dequeue |= StreamFields::primaryRing;
 	event = co_await _device->controller()->submitCommand(
 		Command::setTransferRingDequeue(_device->slot(), _endpointId,
-				dequeue | cycle));
+				dequeue | cycle, streamId));
 
 	if (event.completionCode != 1)
 		std::cout << _device->controller() << "Failed to set TR dequeue pointer"
@@ -1056,7 +1201,7 @@ EndpointState::_resetAfterError(size_t nextDequeue, bool cycle) {
 	FRG_CO_TRY(completionToError(event));
 
 	// Ring the doorbell to restart the pipe
-	_device->submit(_endpointId);
+	_device->submit(_endpointId, streamId);
 
 	co_return frg::success;
 }
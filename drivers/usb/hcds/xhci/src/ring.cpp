@@ -1,3 +1,5 @@
+#include <algorithm>
+
 #include "ring.hpp"
 #include "xhci.hpp"
 
@@ -238,6 +240,35 @@ void ProducerRing::processEvent(Event ev) {
 	}
 }
 
+bool ProducerRing::hasPendingTransactions() {
+	for (auto tx : _transactions) {
+		if (tx)
+			return true;
+	}
+	return false;
+}
+
+void ProducerRing::abortTransactions(int completionCode) {
+	// Transactions span multiple TRBs but they must only complete once.
+	std::vector<std::pair<Transaction *, size_t>> aborted;
+	for (size_t i = 0; i < ringSize; i++) {
+		auto tx = std::exchange(_transactions[i], nullptr);
+		if (!tx)
+			continue;
+		if (std::ranges::find(aborted, tx, &std::pair<Transaction *, size_t>::first) == aborted.end())
+			aborted.push_back({tx, i});
+	}
+
+	for (auto [tx, idx] : aborted) {
+		Event ev{};
+		ev.type = TrbType::transferEvent;
+		ev.completionCode = completionCode;
+		ev.trbPointer = getPtr() + idx * sizeof(RawTrb);
+		// This can destroy the transaction.
+		tx->onEvent(_controller, ev, _ring->ent[idx]);
+	}
+}
+
 void ProducerRing::updateLink() {
 	_ring->ent[ringSize - 1] = {{
 		static_cast<uint32_t>(getPtr() & 0xFFFFFFFF),
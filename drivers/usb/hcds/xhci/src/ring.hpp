@@ -129,10 +129,21 @@ struct ProducerRing {
 	size_t enqueuePtr() const { return _enqueuePtr; }
 	bool producerCycle() const { return _pcs; }
 
+	// Returns true if the TRB at the given physical address is part of this ring.
+	bool containsTrb(uintptr_t ptr) {
+		return ptr >= getPtr() && ptr < getPtr() + sizeof(RingEntries);
+	}
+
 	void pushRawTrb(RawTrb cmd, Transaction *tx);
 
 	void processEvent(Event ev);
 
+	bool hasPendingTransactions();
+
+	// Completes all pending transactions with the given completion code.
+	// The xHC must not access the ring while this is called (e.g., the endpoint is stopped).
+	void abortTransactions(int completionCode);
+
 private:
 	std::array<Transaction *, ringSize> _transactions;
 	arch::dma_object<RingEntries> _ring;
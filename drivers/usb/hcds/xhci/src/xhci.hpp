@@ -121,7 +121,7 @@ struct Device final : proto::DeviceData, std::enable_shared_from_this<Device> {
 	transfer(proto::ControlTransfer info) override;
 
 
-	void submit(int endpoint);
+	void submit(int endpoint, uint16_t streamId = 0);
 
 	async::result<frg::expected<proto::UsbError>>
 	enumerate(size_t rootPort, size_t port, uint32_t route, std::shared_ptr<proto::Hub> hub, proto::DeviceSpeed speed, int slotType);
@@ -138,6 +138,10 @@ struct Device final : proto::DeviceData, std::enable_shared_from_this<Device> {
 	async::result<frg::expected<proto::UsbError>>
 	updateEp0PacketSize(size_t maxPacketSize);
 
+	// Re-adds the endpoint with a linear primary stream array of 2^(maxPStreams + 1) entries.
+	async::result<frg::expected<proto::UsbError>>
+	configureStreams(int endpointId, uintptr_t streamArray, uint8_t maxPStreams);
+
 
 	size_t slot() const {
 		return _slotId;
@@ -180,11 +184,28 @@ struct EndpointState final : proto::EndpointData {
 	async::result<frg::expected<proto::UsbError, size_t>>
 	transfer(proto::BulkTransfer info) override;
 
+	async::result<frg::expected<proto::UsbError, size_t>>
+	allocateStreams(size_t count) override;
+
+	async::result<frg::expected<proto::UsbError>>
+	abortStream(uint16_t streamId) override;
+
 	ProducerRing &transferRing() {
 		return _transferRing;
 	}
 
+	// Dispatches a transfer event to the ring that contains the TRB.
+	void processEvent(Event ev);
+
 private:
+	// Primary stream arrays are limited to 256 entries (i.e., 255 streams),
+	// such that they fit into a single page.
+	static constexpr size_t maxStreamContexts = 256;
+
+	struct alignas(64) StreamContextArray {
+		StreamContext ent[maxStreamContexts];
+	};
+
 	Device *_device;
 	int _endpointId;
 	proto::EndpointType _type;
@@ -192,11 +213,22 @@ private:
 	size_t _maxPacketSize;
 	ProducerRing _transferRing;
 
+	// If streams are allocated, _streamRings[i] is the transfer ring of stream i + 1.
+	// _transferRing is unused in that case.
+	std::vector<std::unique_ptr<ProducerRing>> _streamRings;
+	arch::dma_object<StreamContextArray> _streamContexts;
+
+	ProducerRing &_ringFor(uint16_t streamId) {
+		if (!streamId)
+			return _transferRing;
+		return *_streamRings[streamId - 1];
+	}
+
 	async::result<frg::expected<proto::UsbError, size_t>>
-	_bulkOrInterruptXfer(arch::dma_buffer_view buffer);
+	_bulkOrInterruptXfer(arch::dma_buffer_view buffer, uint16_t streamId = 0);
 
 	async::result<frg::expected<proto::UsbError>>
-	_resetAfterError(size_t nextDequeue, bool nextCycle);
+	_resetAfterError(size_t nextDequeue, bool nextCycle, uint16_t streamId = 0);
 };
 
 
@@ -265,6 +297,11 @@ struct Controller final : proto::BaseController {
 		return _largeCtx;
 	}
 
+	// Maximum primary stream array size (as in the MaxPStreams field); 0 if streams are unsupported.
+	uint8_t maxPsaSize() const {
+		return _maxPsaSize;
+	}
+
 	void setDeviceContext(size_t slot, DeviceContext &ctx) {
 		_dcbaa[slot] = helix::ptrToPhysical(ctx.rawData());
 	}
@@ -395,6 +432,7 @@ private:
 	proto::Enumerator _enumerator;
 
 	bool _largeCtx;
+	uint8_t _maxPsaSize;
 
 	mbus_ng::Entity _entity;
 };
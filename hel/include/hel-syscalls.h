@@ -158,6 +158,14 @@ extern inline __attribute__ (( always_inline )) HelError helCreateSpace(HelHandl
 	return error;
 };
 
+extern inline __attribute__ (( always_inline )) HelError helForkSpace(HelHandle handle,
+		HelHandle *forked_handle) {
+	HelWord handle_word;
+	HelError error = helSyscall1_1(kHelCallForkSpace, (HelWord)handle, &handle_word);
+	*forked_handle = (HelHandle)handle_word;
+	return error;
+};
+
 extern inline __attribute__ (( always_inline )) HelError helCreateVirtualizedSpace(HelHandle *handle) {
 	HelWord handle_word;
 	HelError error = helSyscall0_1(kHelCallCreateVirtualizedSpace, &handle_word);
@@ -295,6 +303,16 @@ extern inline __attribute__ (( always_inline )) HelError helSetPriority(HelHandl
 	return helSyscall2(kHelCallSetPriority, (HelWord)handle, (HelWord)priority);
 };
 
+extern inline __attribute__ (( always_inline )) HelError helSetSchedulingPolicy(HelHandle handle,
+		const struct HelSchedulingParameters *params) {
+	return helSyscall2(kHelCallSetSchedulingPolicy, (HelWord)handle, (HelWord)params);
+};
+
+extern inline __attribute__ (( always_inline )) HelError helGetSchedulingPolicy(HelHandle handle,
+		struct HelSchedulingParameters *params) {
+	return helSyscall2(kHelCallGetSchedulingPolicy, (HelWord)handle, (HelWord)params);
+};
+
 extern inline __attribute__ (( always_inline )) HelError helSubmitObserve(HelHandle handle,
 		uint64_t in_seq, HelHandle queue, uintptr_t context) {
 	return helSyscall4(kHelCallSubmitObserve, (HelWord)handle, (HelWord)in_seq,
@@ -353,6 +371,13 @@ extern inline __attribute__ (( always_inline )) HelError helGetClock(uint64_t *c
 	return error;
 };
 
+extern inline __attribute__ (( always_inline )) HelError helGetClockPage(HelHandle *handle) {
+	HelWord handle_word;
+	HelError error = helSyscall0_1(kHelCallGetClockPage, &handle_word);
+	*handle = (HelHandle)handle_word;
+	return error;
+};
+
 extern inline __attribute__ (( always_inline )) HelError helSubmitAwaitClock(uint64_t counter,
 		HelHandle queue, uintptr_t context, uint64_t *async_id) {
 	HelWord async_word;
@@ -362,6 +387,15 @@ extern inline __attribute__ (( always_inline )) HelError helSubmitAwaitClock(uin
 	return error;
 };
 
+extern inline __attribute__ (( always_inline )) HelError helSubmitAwaitClockSlack(uint64_t counter,
+		uint64_t slack, HelHandle queue, uintptr_t context, uint64_t *async_id) {
+	HelWord async_word;
+	HelError error = helSyscall4_1(kHelCallSubmitAwaitClockSlack, (HelWord)counter, (HelWord)slack,
+			(HelWord)queue, (HelWord)context, &async_word);
+	*async_id = (uint64_t)async_word;
+	return error;
+};
+
 extern inline __attribute__ (( always_inline )) HelError helCreateStream(HelHandle *lane1,
 		HelHandle *lane2, uint32_t attach_credentials) {
 	HelWord out_lane1;
@@ -393,6 +427,32 @@ extern inline __attribute__ (( always_inline )) HelError helFutexWake(int *point
 	return helSyscall1(kHelCallFutexWake, (HelWord)pointer);
 };
 
+extern inline __attribute__ (( always_inline )) HelError helFutexWaitBitset(int *pointer,
+		int expected, int64_t deadline, uint32_t bitset, uint32_t flags) {
+	return helSyscall5(kHelCallFutexWaitBitset, (HelWord)pointer, (HelWord)expected,
+			(HelWord)deadline, (HelWord)bitset, (HelWord)flags);
+};
+
+extern inline __attribute__ (( always_inline )) HelError helFutexWakeBitset(int *pointer,
+		uint32_t count, uint32_t bitset, uint32_t flags, size_t *numWoken) {
+	HelWord woken;
+	HelError error = helSyscall4_1(kHelCallFutexWakeBitset, (HelWord)pointer, (HelWord)count,
+			(HelWord)bitset, (HelWord)flags, &woken);
+	*numWoken = (size_t)woken;
+	return error;
+};
+
+extern inline __attribute__ (( always_inline )) HelError helFutexRequeue(int *pointer,
+		int *target, int expected, uint32_t wakeCount, uint32_t requeueCount,
+		uint32_t flags, size_t *numAffected) {
+	HelWord affected;
+	HelError error = helSyscall6_1(kHelCallFutexRequeue, (HelWord)pointer, (HelWord)target,
+			(HelWord)expected, (HelWord)wakeCount, (HelWord)requeueCount, (HelWord)flags,
+			&affected);
+	*numAffected = (size_t)affected;
+	return error;
+};
+
 extern inline __attribute__ (( always_inline )) HelError helCreateOneshotEvent(HelHandle *handle) {
 	HelWord handle_word;
 	HelError error = helSyscall0_1(kHelCallCreateOneshotEvent, &handle_word);
@@ -437,6 +497,11 @@ extern inline __attribute__ (( always_inline )) HelError helAutomateIrq(HelHandl
 			(HelWord)kernlet);
 };
 
+extern inline __attribute__ (( always_inline )) HelError helSetIrqAffinity(HelHandle handle,
+		int cpu) {
+	return helSyscall2(kHelCallSetIrqAffinity, (HelWord)handle, (HelWord)cpu);
+};
+
 extern inline __attribute__ (( always_inline )) HelError helAccessIo(uintptr_t *port_array,
 		size_t num_ports, HelHandle *handle) {
 	HelWord out_handle;
@@ -18,7 +18,7 @@
 
 enum {
 	// largest system call number plus 1
-	kHelNumCalls = 105,
+	kHelNumCalls = 114,
 
 	kHelCallLog = 1,
 	kHelCallPanic = 10,
@@ -43,6 +43,7 @@ enum {
 	kHelCallCreateSliceView = 88,
 	kHelCallForkMemory = 40,
 	kHelCallCreateSpace = 27,
+	kHelCallForkSpace = 105,
 	kHelCallCreateIndirectMemory = 45,
 	kHelCallAlterMemoryIndirection = 52,
 	kHelCallMapMemory = 44,
@@ -62,6 +63,8 @@ enum {
 	kHelCallCreateThread = 67,
 	kHelCallQueryThreadStats = 95,
 	kHelCallSetPriority = 85,
+	kHelCallSetSchedulingPolicy = 111,
+	kHelCallGetSchedulingPolicy = 112,
 	kHelCallYield = 34,
 	kHelCallSubmitObserve = 74,
 	kHelCallKillThread = 87,
@@ -73,6 +76,8 @@ enum {
 	kHelCallWriteFsBase = 41,
 	kHelCallGetClock = 42,
 	kHelCallSubmitAwaitClock = 80,
+	kHelCallSubmitAwaitClockSlack = 113,
+	kHelCallGetClockPage = 110,
 	kHelCallCreateVirtualizedCpu = 37,
 	kHelCallRunVirtualizedCpu = 38,
 	kHelCallGetRandomBytes = 101,
@@ -87,6 +92,9 @@ enum {
 
 	kHelCallFutexWait = 73,
 	kHelCallFutexWake = 71,
+	kHelCallFutexWaitBitset = 107,
+	kHelCallFutexWakeBitset = 108,
+	kHelCallFutexRequeue = 109,
 
 	kHelCallCreateOneshotEvent = 96,
 	kHelCallCreateBitsetEvent = 97,
@@ -95,6 +103,7 @@ enum {
 	kHelCallAcknowledgeIrq = 81,
 	kHelCallSubmitAwaitEvent = 82,
 	kHelCallAutomateIrq = 94,
+	kHelCallSetIrqAffinity = 106,
 
 	kHelCallAccessIo = 11,
 	kHelCallEnableIo = 12,
@@ -131,7 +140,8 @@ enum {
 	kHelErrRemoteFault = 21,
 	kHelErrNoHardwareSupport = 16,
 	kHelErrNoMemory = 17,
-	kHelErrAlreadyExists = 22
+	kHelErrAlreadyExists = 22,
+	kHelErrFutexRace = 23
 };
 
 struct HelX86SegmentRegister {
@@ -553,6 +563,15 @@ struct HelEventResult {
 	uint64_t sequence;
 };
 
+enum HelFutexFlags {
+	//! The futex is only shared between threads of the same address space.
+	kHelFutexPrivate = 1,
+	//! helFutexRequeue() only proceeds if the futex has the expected value.
+	kHelFutexCompare = 2,
+	//! The deadline of helFutexWaitBitset() may elapse late by up to 1/8 of the timeout.
+	kHelFutexCoarse = 4
+};
+
 enum HelAckFlags {
 	kHelAckAcknowledge = 2,
 	kHelAckNack = 3,
@@ -568,6 +587,49 @@ struct HelThreadStats {
 	uint64_t userTime;
 };
 
+enum HelSchedulingPolicy {
+	//! Default policy; threads share the CPU fairly (weighted by their priority).
+	kHelSchedFair = 0,
+	//! Real-time; runs until it blocks or yields, or a higher priority becomes runnable.
+	kHelSchedFifo = 1,
+	//! Like ::kHelSchedFifo but round-robin among threads of the same priority.
+	kHelSchedRoundRobin = 2,
+	//! Earliest deadline first with a reserved bandwidth of runtime / period.
+	kHelSchedDeadline = 3
+};
+
+//! Scheduling class of a thread (see ::helSetSchedulingPolicy).
+//! Deadline threads take precedence over real-time threads,
+//! which take precedence over fair threads.
+struct HelSchedulingParameters {
+	//! One of ::HelSchedulingPolicy.
+	uint32_t policy;
+	//! Priority within the class. Must be in [1, 99] for real-time policies.
+	int32_t priority;
+	//! Deadline policy only: the thread receives runtime ns of CPU time
+	//! within deadline ns after the start of each period (all in ns).
+	uint64_t runtime;
+	uint64_t deadline;
+	uint64_t period;
+};
+
+enum HelClockPageMode {
+	//! The clock cannot be read from user space; use ::helGetClock.
+	kHelClockPageNone = 0,
+	//! The clock is ((factor * counter) >> shift) where counter is the
+	//! hardware timestamp counter (i.e., RDTSC on x86).
+	kHelClockPageCounter = 1
+};
+
+//! Layout of the page returned by ::helGetClockPage.
+//! Readers retry if seqlock is odd or changes while the page is read.
+struct HelClockPage {
+	uint64_t seqlock;
+	uint32_t mode;
+	int32_t shift;
+	uint64_t factor;
+};
+
 enum {
   kHelVmexitHlt = 0,
   kHelVmexitTranslationFault = 1,
@@ -752,6 +814,7 @@ HEL_C_LINKAGE HelError helCreateIndirectMemory(size_t numSlots, HelHandle *handl
 //!    	@p numSlots (see ::helCreateIndirectMemory).
 //! @param[in] memoryHandle
 //!    	Handle to the memory object that @p indirectHandle should delegate to.
+//!    	Must not be read-only (e.g., the clock page, see ::helGetClockPage).
 //! @param[in] offset
 //!    	Offset in bytes, relative to @p memoryHandle.
 //!    	Must be aligned to the system's page size.
@@ -778,6 +841,22 @@ HEL_C_LINKAGE HelError helForkMemory(HelHandle handle, HelHandle *forkedHandle);
 //!     Handle to the new address space.
 HEL_C_LINKAGE HelError helCreateSpace(HelHandle *handle);
 
+//! Creates a copy of an address space.
+//!
+//! All mappings are copied to the new address space (at the same addresses).
+//! Mappings of memory objects created by ::helCopyOnWrite are forked
+//! (as if by ::helForkMemory); all other mappings are shared, i.e.,
+//! writes through them are visible in both address spaces.
+//! Callers that need private pages at such addresses (e.g., per-process
+//! pages that are mapped by a POSIX server) have to replace these mappings
+//! in the new address space (e.g., by ::helMapMemory with ::kHelMapFixed).
+//! @param[in] handle
+//!     Handle to the address space that is copied.
+//!     Can be ::kHelNullHandle to copy the address space of the current thread.
+//! @param[out] forkedHandle
+//!     Handle to the new address space.
+HEL_C_LINKAGE HelError helForkSpace(HelHandle handle, HelHandle *forkedHandle);
+
 //! Maps memory objects into an address space.
 //! @param[in] memoryHandle
 //!     Handle to the memory object.
@@ -872,6 +951,9 @@ HEL_C_LINKAGE HelError helSubmitReadMemory(HelHandle handle, uintptr_t address,
 //!     Address that is accessed, relative to @p handle.
 //! @param[in] length
 //!     Length of the copied memory region.
+//!
+//! Writes to read-only memory (e.g., the clock page, see ::helGetClockPage)
+//! fail with ::kHelErrIllegalArgs or ::kHelErrFault (for address spaces).
 HEL_C_LINKAGE HelError helSubmitWriteMemory(HelHandle handle, uintptr_t address,
 		size_t length, const void *buffer,
 		HelHandle queue, uintptr_t context);
@@ -932,12 +1014,35 @@ HEL_C_LINKAGE HelError helQueryThreadStats(HelHandle handle, struct HelThreadSta
 //!
 //! Managarm always runs the runnable thread with highest priority.
 //! The default priority of a thread is zero.
+//! This only affects threads of the ::kHelSchedFair policy;
+//! threads of other policies keep their policy and parameters.
 //! @param[in] handle
 //!     Handle to the thread.
 //! @param[in] priority
 //!     New priority value of the thread.
 HEL_C_LINKAGE HelError helSetPriority(HelHandle handle, int priority);
 
+//! Set the scheduling policy and parameters of a thread.
+//!
+//! Fails with ::kHelErrIllegalState if the deadline policy cannot
+//! reserve the requested bandwidth (admission control).
+//! Threads of the deadline policy that exhaust their runtime are throttled
+//! until their next period starts.
+//! @param[in] handle
+//!     Handle to the thread.
+//! @param[in] params
+//!     New scheduling parameters.
+HEL_C_LINKAGE HelError helSetSchedulingPolicy(HelHandle handle,
+		const struct HelSchedulingParameters *params);
+
+//! Query the scheduling policy and parameters of a thread.
+//! @param[in] handle
+//!     Handle to the thread.
+//! @param[out] params
+//!     Current scheduling parameters.
+HEL_C_LINKAGE HelError helGetSchedulingPolicy(HelHandle handle,
+		struct HelSchedulingParameters *params);
+
 //! Yields the current thread.
 HEL_C_LINKAGE HelError helYield();
 
@@ -1014,6 +1119,16 @@ HEL_C_LINKAGE HelError helGetCurrentCpu(int *cpu);
 //!     Current value of the system-wide clock in nanoseconds since boot.
 HEL_C_LINKAGE HelError helGetClock(uint64_t *counter);
 
+//! Obtains the clock page that allows reading the system-wide monotone clock
+//! without entering the kernel.
+//!
+//! The page (see ::HelClockPage) is written by the kernel;
+//! it can only be mapped without ::kHelMapProtWrite and it cannot be written
+//! by ::helSubmitWriteMemory or through indirect memory.
+//! @param[out] handle
+//!     Handle to the memory object that contains the page.
+HEL_C_LINKAGE HelError helGetClockPage(HelHandle *handle);
+
 //! Wait until time passes.
 //!
 //! This is an asynchronous operation.
@@ -1024,6 +1139,22 @@ HEL_C_LINKAGE HelError helGetClock(uint64_t *counter);
 HEL_C_LINKAGE HelError helSubmitAwaitClock(uint64_t counter,
 		HelHandle queue, uintptr_t context, uint64_t *asyncId);
 
+//! Wait until time passes (with a tolerance).
+//!
+//! Like ::helSubmitAwaitClock but the operation may complete up to @p slack
+//! nanoseconds after the deadline. This allows the kernel to batch timers
+//! and is preferable for timeouts that are usually cancelled.
+//!
+//! This is an asynchronous operation.
+//! @param[in] counter
+//!     Deadline (absolute, see ::helGetClock).
+//! @param[in] slack
+//!     Maximal delay (in nanoseconds) that is tolerated after the deadline.
+//! @param[out] asyncId
+//!     ID to identify the asynchronous operation (absolute, see ::helCancelAsync).
+HEL_C_LINKAGE HelError helSubmitAwaitClockSlack(uint64_t counter, uint64_t slack,
+		HelHandle queue, uintptr_t context, uint64_t *asyncId);
+
 HEL_C_LINKAGE HelError helCreateVirtualizedCpu(HelHandle handle, HelHandle *out_handle);
 
 HEL_C_LINKAGE HelError helRunVirtualizedCpu(HelHandle handle, struct HelVmexitReason *reason);
@@ -1103,6 +1234,56 @@ HEL_C_LINKAGE HelError helFutexWait(int *pointer, int expected, int64_t deadline
 //!     Pointer that identifies the futex.
 HEL_C_LINKAGE HelError helFutexWake(int *pointer);
 
+//! Waits on a futex (with additional options).
+//! @param[in] pointer
+//!     Pointer that identifies the futex.
+//! @param[in] expected
+//!     Expected value of the futex. This function does nothing unless
+//!     the futex pointed to by @pointer matches this value.
+//! @param[in] deadline
+//!     Timeout (in absolute monotone time, see ::helGetClock).
+//! @param[in] bitset
+//!     Only wakeups with a bitset that intersects this (non-zero) bitset
+//!     wake the caller.
+//! @param[in] flags
+//!     May contain ::kHelFutexPrivate and ::kHelFutexCoarse.
+HEL_C_LINKAGE HelError helFutexWaitBitset(int *pointer, int expected, int64_t deadline,
+		uint32_t bitset, uint32_t flags);
+
+//! Wakes up a limited number of waiters of a futex (in FIFO order).
+//! @param[in] pointer
+//!     Pointer that identifies the futex.
+//! @param[in] count
+//!     Maximal number of waiters to wake.
+//! @param[in] bitset
+//!     Only waiters whose bitset intersects this bitset are woken.
+//! @param[in] flags
+//!     May contain ::kHelFutexPrivate.
+//! @param[out] numWoken
+//!     Number of waiters that were woken.
+HEL_C_LINKAGE HelError helFutexWakeBitset(int *pointer, uint32_t count, uint32_t bitset,
+		uint32_t flags, size_t *numWoken);
+
+//! Wakes up waiters of a futex and moves further waiters to another futex.
+//! Requeued waiters are woken by wakeups of the @p target futex.
+//! @param[in] pointer
+//!     Pointer that identifies the futex.
+//! @param[in] target
+//!     Pointer that identifies the futex that waiters are moved to.
+//! @param[in] expected
+//!     If ::kHelFutexCompare is given, the call fails with ::kHelErrFutexRace
+//!     unless the futex pointed to by @p pointer matches this value.
+//! @param[in] wakeCount
+//!     Maximal number of waiters to wake.
+//! @param[in] requeueCount
+//!     Maximal number of waiters to move to @p target.
+//! @param[in] flags
+//!     May contain ::kHelFutexPrivate and ::kHelFutexCompare.
+//! @param[out] numAffected
+//!     Number of waiters that were woken or moved.
+HEL_C_LINKAGE HelError helFutexRequeue(int *pointer, int *target, int expected,
+		uint32_t wakeCount, uint32_t requeueCount, uint32_t flags, size_t *numAffected);
+
 //! @}
 //! @name Event Handling
 //! @{
@@ -1136,8 +1317,30 @@ HEL_C_LINKAGE HelError helAcknowledgeIrq(HelHandle handle, uint32_t flags, uint6
 HEL_C_LINKAGE HelError helSubmitAwaitEvent(HelHandle handle, uint64_t sequence,
 		HelHandle queue, uintptr_t context);
 
+//! Run a kernlet whenever an IRQ is raised.
+//!
+//! The kernlet's return value determines how the IRQ is handled:
+//! 1 acknowledges the IRQ in the kernel, 2 rejects it (e.g., because
+//! another device on a shared line raised it) and 0 forwards it to
+//! user space (i.e., to helSubmitAwaitEvent() and helAcknowledgeIrq()).
+//! IRQs that are not forwarded do not advance the IRQ's sequence number.
+//! @param[in] handle
+//!     Handle to the IRQ.
+//! @param[in] flags
+//!     Must be zero.
+//! @param[in] kernlet
+//!     Handle to the bound kernlet.
 HEL_C_LINKAGE HelError helAutomateIrq(HelHandle handle, uint32_t flags, HelHandle kernlet);
 
+//! Route an IRQ to a specific CPU.
+//!
+//! Only IRQs that the interrupt controller can retarget (e.g., MSIs) are supported.
+//! @param[in] handle
+//!     Handle to the IRQ.
+//! @param[in] cpu
+//!     Index of the CPU that will receive the IRQ.
+HEL_C_LINKAGE HelError helSetIrqAffinity(HelHandle handle, int cpu);
+
 //! @}
 //! @name Input/Output
 //! @{
@@ -1212,6 +1415,8 @@ extern inline __attribute__ (( always_inline )) const char *_helErrorString(HelE
 		return "Out of bounds";
 	case kHelErrAlreadyExists:
 		return "Already exists";
+	case kHelErrFutexRace:
+		return "Futex value changed";
 	default:
 		return 0;
 	}
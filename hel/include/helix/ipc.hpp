@@ -453,10 +453,10 @@ private:
 
 struct Submission : private Context {
 	Submission(AwaitClock *operation,
-			uint64_t counter, Dispatcher &dispatcher)
+			uint64_t counter, uint64_t slack, Dispatcher &dispatcher)
 	: _result(operation) {
 		uint64_t async_id;
-		HEL_CHECK(helSubmitAwaitClock(counter, dispatcher.acquire(),
+		HEL_CHECK(helSubmitAwaitClockSlack(counter, slack, dispatcher.acquire(),
 				reinterpret_cast<uintptr_t>(context()), &async_id));
 		operation->setAsyncId(async_id);
 	}
@@ -520,7 +520,13 @@ private:
 
 inline Submission submitAwaitClock(AwaitClock *operation, uint64_t counter,
 		Dispatcher &dispatcher) {
-	return {operation, counter, dispatcher};
+	return {operation, counter, 0, dispatcher};
+}
+
+// The operation may complete up to slack ns after the deadline.
+inline Submission submitAwaitClock(AwaitClock *operation, uint64_t counter,
+		uint64_t slack, Dispatcher &dispatcher) {
+	return {operation, counter, slack, dispatcher};
 }
 
 inline Submission submitProtectMemory(BorrowedDescriptor memory, ProtectMemory *operation,
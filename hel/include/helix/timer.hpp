@@ -5,15 +5,23 @@
 #include <async/result.hpp>
 #include <async/oneshot-event.hpp>
 
+#include <algorithm>
 #include <functional>
 
 namespace helix {
 
+// Slack for timeouts that do not need to be precise (e.g., timeouts of poll()
+// or of network protocols): 1/8 of the duration but at most 100 ms.
+// Such timeouts are usually cancelled; the kernel can handle them more cheaply.
+inline uint64_t coarseSlack(uint64_t duration) {
+	return std::min(duration >> 3, uint64_t{100'000'000});
+}
+
 template<typename F>
 struct TimeoutCallback {
-	TimeoutCallback(uint64_t duration, F function)
+	TimeoutCallback(uint64_t duration, F function, uint64_t slack = 0)
 	: _function{std::move(function)} {
-		_runTimer(duration);
+		_runTimer(duration, slack);
 	}
 
 	TimeoutCallback(const TimeoutCallback &other) = delete;
@@ -26,12 +34,12 @@ struct TimeoutCallback {
 	}
 
 private:
-	async::detached _runTimer(uint64_t duration) {
+	async::detached _runTimer(uint64_t duration, uint64_t slack) {
 		uint64_t tick;
 		HEL_CHECK(helGetClock(&tick));
 
 		helix::AwaitClock await;
-		auto &&submit = helix::submitAwaitClock(&await, tick + duration,
+		auto &&submit = helix::submitAwaitClock(&await, tick + duration, slack,
 				helix::Dispatcher::global());
 		auto async_id = await.asyncId();
 
@@ -57,8 +65,8 @@ private:
 };
 
 struct TimeoutCancellation {
-	TimeoutCancellation(uint64_t duration, async::cancellation_event &ev)
-	:_tb{duration, Functor{&ev}} {
+	TimeoutCancellation(uint64_t duration, async::cancellation_event &ev, uint64_t slack = 0)
+	:_tb{duration, Functor{&ev}, slack} {
 	}
 
 	auto retire() {
@@ -77,12 +85,13 @@ private:
 	TimeoutCallback<Functor> _tb;
 };
 
-inline async::result<bool> sleepFor(uint64_t duration, async::cancellation_token cancel = {}) {
+inline async::result<bool> sleepFor(uint64_t duration, async::cancellation_token cancel = {},
+		uint64_t slack = 0) {
 	uint64_t tick;
 	HEL_CHECK(helGetClock(&tick));
 
 	helix::AwaitClock await;
-	auto &&submit = helix::submitAwaitClock(&await, tick + duration,
+	auto &&submit = helix::submitAwaitClock(&await, tick + duration, slack,
 			helix::Dispatcher::global());
 	auto async_id = await.asyncId();
 
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Format of compressed initrd files (as written by tools/gen-initrd.py --compress).
+// The file is split into chunks of (1 << chunkShift) bytes that are compressed
+// independently using the LZ4 block format. This allows us to decompress
+// arbitrary page ranges without decompressing the entire file.
+//
+// The header is followed by (numChunks + 1) uint32_t offsets (relative to the start
+// of the header) that delimit the compressed chunks. Chunks whose compressed size
+// equals their uncompressed size are stored without compression.
+// All integers are little endian.
+
+inline constexpr char compressedModuleMagic[4] = {'\x89', 'M', 'Z', '4'};
+
+struct CompressedModuleHeader {
+	char magic[4];
+	uint32_t chunkShift;
+	uint64_t size;
+	uint32_t numChunks;
+	uint32_t reserved;
+};
+static_assert(sizeof(CompressedModuleHeader) == 24);
+
+// Returns true if the image is a well-formed compressed module.
+// On success, the header is copied to *header.
+inline bool parseCompressedModule(const void *image, size_t imageSize,
+		CompressedModuleHeader *header) {
+	if(imageSize < sizeof(CompressedModuleHeader))
+		return false;
+	memcpy(header, image, sizeof(CompressedModuleHeader));
+	if(memcmp(header->magic, compressedModuleMagic, 4))
+		return false;
+	if(header->chunkShift < 12 || header->chunkShift > 24)
+		return false;
+
+	size_t chunkSize = size_t{1} << header->chunkShift;
+	if(header->numChunks != (header->size + chunkSize - 1) / chunkSize)
+		return false;
+	auto tableSize = (size_t{header->numChunks} + 1) * sizeof(uint32_t);
+	if(imageSize < sizeof(CompressedModuleHeader) + tableSize)
+		return false;
+
+	// Verify that the offsets are monotonic and within the image.
+	auto table = static_cast<const char *>(image) + sizeof(CompressedModuleHeader);
+	uint32_t previous = sizeof(CompressedModuleHeader) + tableSize;
+	for(size_t i = 0; i <= header->numChunks; i++) {
+		uint32_t offset;
+		memcpy(&offset, table + i * sizeof(uint32_t), sizeof(uint32_t));
+		if(offset < previous || offset > imageSize)
+			return false;
+		previous = offset;
+	}
+	return true;
+}
+
+// Returns the compressed data of a chunk of a module that passed parseCompressedModule().
+inline void getCompressedChunk(const void *image,
+		size_t index, const uint8_t **data, size_t *length) {
+	auto table = static_cast<const char *>(image) + sizeof(CompressedModuleHeader);
+	uint32_t begin, end;
+	memcpy(&begin, table + index * sizeof(uint32_t), sizeof(uint32_t));
+	memcpy(&end, table + (index + 1) * sizeof(uint32_t), sizeof(uint32_t));
+	*data = static_cast<const uint8_t *>(image) + begin;
+	*length = end - begin;
+}
+
+// Decompresses a single LZ4 block. Returns the number of bytes that were written
+// to dst or -1 if the input is malformed or does not fit into dst.
+inline ptrdiff_t decompressLz4Block(const uint8_t *src, size_t srcSize,
+		uint8_t *dst, size_t dstSize) {
+	auto ip = src;
+	auto iend = src + srcSize;
+	auto op = dst;
+	auto oend = dst + dstSize;
+
+	// Reads a length that is continued in the following bytes.
+	auto extendLength = [&] (size_t &length) -> bool {
+		uint8_t b;
+		do {
+			if(ip == iend)
+				return false;
+			b = *ip++;
+			length += b;
+		} while(b == 255);
+		return true;
+	};
+
+	while(ip < iend) {
+		uint8_t token = *ip++;
+
+		size_t literals = token >> 4;
+		if(literals == 15 && !extendLength(literals))
+			return -1;
+		if(literals > size_t(iend - ip) || literals > size_t(oend - op))
+			return -1;
+		memcpy(op, ip, literals);
+		ip += literals;
+		op += literals;
+
+		// The last sequence only consists of literals.
+		if(ip == iend)
+			break;
+
+		if(iend - ip < 2)
+			return -1;
+		size_t offset = ip[0] | (size_t{ip[1]} << 8);
+		ip += 2;
+		if(!offset || offset > size_t(op - dst))
+			return -1;
+
+		size_t length = token & 15;
+		if(length == 15 && !extendLength(length))
+			return -1;
+		length += 4;
+		if(length > size_t(oend - op))
+			return -1;
+
+		// Matches can overlap the output, hence we cannot use memcpy().
+		auto match = op - offset;
+		for(size_t i = 0; i < length; i++)
+			op[i] = match[i];
+		op += length;
+	}
+
+	return op - dst;
+}
@@ -69,9 +69,13 @@ struct CpioRange {
 			auto nameSize = parseHex(hdr.nameSize, 8);
 			auto fileSize = parseHex(hdr.fileSize, 8);
 
-			frg::string_view path{
-			    reinterpret_cast<char *>(ptr_) + sizeof(CpioHeader), nameSize - 1
-			};
+			// The name may be padded with NUL bytes (to align the file data).
+			auto name = reinterpret_cast<char *>(ptr_) + sizeof(CpioHeader);
+			size_t nameLength = 0;
+			while (nameLength < nameSize - 1 && name[nameLength])
+				nameLength++;
+
+			frg::string_view path{name, nameLength};
 			frg::span<uint8_t> data{
 			    ptr_ + ((sizeof(CpioHeader) + nameSize + 3) & ~uint32_t{3}), fileSize
 			};
@@ -193,6 +193,13 @@ void doRunOnStack(void (*function) (void *, void *), void *sp, void *argument) {
 
 Error getEntropyFromCpu(void *buffer, size_t size) { return Error::noHardwareSupport; }
 
+// TODO: Parse the topology from the device tree (cpu-map) or ACPI (PPTT).
+//       For now, we assume that CPUs do not share cores or caches.
+CpuTopology getCpuTopology(CpuData *cpu) {
+	uint32_t index = cpu->cpuIndex;
+	return CpuTopology{.coreId = index, .llcId = index, .numaNode = 0};
+}
+
 namespace {
 	constinit frg::manual_box<ReentrantRecordRing> bootLogRing;
 }
@@ -15,12 +15,34 @@ void initializeIrqVectors() {
 	asm volatile ("msr vbar_el1, %0" :: "r"(&thorExcVectors));
 }
 
-extern "C" void enableIntsAndHaltForever();
+namespace {
+	constexpr IdleState wfiState{"WFI", 1'000, 1'000, false};
+}
+
+size_t getNumIdleStates() {
+	return 1;
+}
+
+const IdleState &getIdleState(size_t index) {
+	assert(!index);
+	return wfiState;
+}
+
+void enterIdleState(size_t index, std::atomic<uint32_t> *, uint32_t) {
+	assert(!index);
+	assert(!intsAreEnabled());
+	// WFI also wakes up if the pending IRQ is masked; we take it after unmasking.
+	asm volatile ("wfi" : : : "memory");
+	enableInts();
+	asm volatile ("isb" : : : "memory");
+	disableInts();
+}
 
-void suspendSelf() {
+void runInIdleDomain(void (*fn)()) {
 	assert(!intsAreEnabled());
 	getCpuData()->currentDomain = static_cast<uint64_t>(Domain::idle);
-	enableIntsAndHaltForever();
+	fn();
+	__builtin_trap();
 }
 
 void sendPingIpi(CpuData *dstData) {
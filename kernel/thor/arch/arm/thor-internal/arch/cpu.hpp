@@ -287,4 +287,9 @@ initgraph::Stage *getBootProcessorReadyStage();
 struct CpuData;
 void prepareCpuDataFor(CpuData *context, int cpu);
 
+// Hint for spin loops.
+inline void pause() {
+	asm volatile ("yield");
+}
+
 } // namespace thor
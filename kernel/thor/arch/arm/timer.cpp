@@ -34,6 +34,11 @@ struct GenericTimerSink : IrqSink {
 	}
 };
 
+frg::optional<FreqFraction> getUserClockFraction() {
+	// TODO: Enable user space access to CNTVCT_EL0.
+	return frg::null_opt;
+}
+
 uint64_t getClockNanos() {
 	return timerInverseFreq * getRawTimestampCounter();
 }
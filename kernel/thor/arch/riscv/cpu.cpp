@@ -117,6 +117,13 @@ void scrubStack(Executor *executor, Continuation cont) {
 
 Error getEntropyFromCpu(void *buffer, size_t size) { return Error::noHardwareSupport; }
 
+// TODO: Parse the topology from the device tree (cpu-map) or ACPI (PPTT).
+//       For now, we assume that CPUs do not share cores or caches.
+CpuTopology getCpuTopology(CpuData *cpu) {
+	uint32_t index = cpu->cpuIndex;
+	return CpuTopology{.coreId = index, .llcId = index, .numaNode = 0};
+}
+
 void doRunOnStack(void (*function)(void *, void *), void *sp, void *argument) {
 	assert(!intsAreEnabled());
 
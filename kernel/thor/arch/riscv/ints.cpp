@@ -44,10 +44,32 @@ void sendSelfCallIpi() {
 		doSendIpi(selfData);
 }
 
-void suspendSelf() {
+namespace {
+
+constexpr IdleState wfiState{"WFI", 1'000, 1'000, false};
+
+} // namespace
+
+size_t getNumIdleStates() { return 1; }
+
+const IdleState &getIdleState(size_t index) {
+	assert(!index);
+	return wfiState;
+}
+
+void enterIdleState(size_t index, std::atomic<uint32_t> *, uint32_t) {
+	assert(!index);
+	assert(!intsAreEnabled());
+	// WFI also wakes up if sstatus.SIE is clear; we take the IRQ after enabling it.
+	asm volatile("wfi" : : : "memory");
 	enableInts();
-	while (true)
-		asm volatile("wfi");
+	disableInts();
+}
+
+void runInIdleDomain(void (*fn)()) {
+	assert(!intsAreEnabled());
+	fn();
+	__builtin_trap();
 }
 
 } // namespace thor
@@ -237,4 +237,8 @@ void initializeThisProcessor();
 
 initgraph::Stage *getBootProcessorReadyStage();
 
+// Hint for spin loops. This is the Zihintpause PAUSE instruction,
+// which is encoded as a FENCE that is a no-op on CPUs without the extension.
+inline void pause() { asm volatile(".insn i 0x0F, 0, x0, x0, 0x010"); }
+
 } // namespace thor
@@ -60,6 +60,11 @@ uint64_t getRawTimestampCounter() {
 	return v;
 }
 
+frg::optional<FreqFraction> getUserClockFraction() {
+	// TODO: Enable user space access to the time CSR.
+	return frg::null_opt;
+}
+
 uint64_t getClockNanos() {
 	return inverseFreq * getRawTimestampCounter();
 }
@@ -1,6 +1,7 @@
 #include <thor-internal/arch/hpet.hpp>
 #include <thor-internal/arch/vmx.hpp>
 #include <thor-internal/arch/svm.hpp>
+#include <thor-internal/acpi/acpi.hpp>
 #include <thor-internal/debug.hpp>
 #include <thor-internal/fiber.hpp>
 #include <thor-internal/kasan.hpp>
@@ -419,6 +420,63 @@ static initgraph::Task enumerateCpuFeaturesTask{&globalInitEngine, "x86.enumerat
 					<< frg::endlog;
 		}
 
+		if(common::x86::cpuid(0x01)[2] & (1 << 3)) {
+			auto mwaitLeaf = common::x86::cpuid(0x05);
+			debugLogger() << "thor: CPUs support MONITOR/MWAIT" << frg::endlog;
+			globalCpuFeatures.haveMwait = true;
+			// Without the enumeration extension, only C1 can be used.
+			globalCpuFeatures.mwaitSubstates = (mwaitLeaf[2] & 1) ? mwaitLeaf[3] : 0x10;
+		}
+		if(common::x86::cpuid(0x06)[0] & (1 << 2)) {
+			debugLogger() << "thor: CPUs support always running APIC timer" << frg::endlog;
+			globalCpuFeatures.haveArat = true;
+		}
+		if(common::x86::cpuid(0x01)[2] & (uint32_t(1) << 31)) {
+			debugLogger() << "thor: Running under a hypervisor" << frg::endlog;
+			globalCpuFeatures.haveHypervisor = true;
+		}
+
+		// Determine which APIC ID bits identify SMT siblings and LLC domains.
+		auto ceilLog2 = [] (uint32_t n) -> uint32_t {
+			uint32_t shift = 0;
+			while((uint32_t(1) << shift) < n)
+				shift++;
+			return shift;
+		};
+		// Returns the number of logical CPUs that share the highest level cache.
+		auto llcSharing = [] (uint32_t leaf) -> uint32_t {
+			uint32_t level = 0;
+			uint32_t sharing = 0;
+			for(uint32_t i = 0; i < 16; i++) {
+				auto cacheLeaf = common::x86::cpuid(leaf, i);
+				if(!(cacheLeaf[0] & 0x1F)) // No more caches.
+					break;
+				auto cacheLevel = (cacheLeaf[0] >> 5) & 7;
+				if(cacheLevel >= level) {
+					level = cacheLevel;
+					sharing = ((cacheLeaf[0] >> 14) & 0xFFF) + 1;
+				}
+			}
+			return sharing;
+		};
+
+		auto maxLeaf = common::x86::cpuid(0)[0];
+		if(maxLeaf >= 0xB) {
+			auto smtLeaf = common::x86::cpuid(0xB, 0);
+			if(smtLeaf[1])
+				globalCpuFeatures.smtShift = smtLeaf[0] & 0x1F;
+		}
+		uint32_t sharing = 0;
+		if(maxLeaf >= 4)
+			sharing = llcSharing(4);
+		// AMD reports caches in a separate leaf (with the topology extension).
+		if(!sharing && (common::x86::cpuid(0x8000'0001)[2] & (1 << 22)))
+			sharing = llcSharing(0x8000'001D);
+		globalCpuFeatures.llcShift = frg::max(ceilLog2(frg::max(sharing, uint32_t(1))),
+				globalCpuFeatures.smtShift);
+		debugLogger() << "thor: APIC ID bits: " << globalCpuFeatures.smtShift
+				<< " for SMT, " << globalCpuFeatures.llcShift << " for LLC" << frg::endlog;
+
 		auto intelPmLeaf = common::x86::cpuid(0xA)[0];
 		if(intelPmLeaf & 0xFF) {
 			debugLogger() << "thor: CPUs support Intel performance counters"
@@ -845,6 +903,20 @@ void bootSecondary(unsigned int apic_id) {
 	debugLogger() << "thor: AP finished booting." << frg::endlog;
 }
 
+CpuTopology getCpuTopology(CpuData *cpu) {
+	uint32_t apicId = cpu->localApicId;
+	// The BSP joins load balancing before we enumerate CPU features.
+	if(!cpuFeaturesKnown)
+		return CpuTopology{.coreId = apicId, .llcId = apicId, .numaNode = 0};
+
+	auto features = getGlobalCpuFeatures();
+	return CpuTopology{
+		.coreId = apicId >> features->smtShift,
+		.llcId = apicId >> features->llcShift,
+		.numaNode = acpi::getNumaNode(apicId)
+	};
+}
+
 Error getEntropyFromCpu(void *buffer, size_t size) {
 	using word_type = uint32_t;
 	auto p = reinterpret_cast<char *>(buffer);
@@ -1,5 +1,6 @@
 #include <thor-internal/cpu-data.hpp>
 #include <thor-internal/int-call.hpp>
+#include <thor-internal/main.hpp>
 #include <thor-internal/profile.hpp>
 #include <thor-internal/thread.hpp>
 #include <thor-internal/arch-generic/cpu.hpp>
@@ -607,11 +608,96 @@ extern "C" void onPlatformNmi(NmiImageAccessor image) {
 			reinterpret_cast<uintptr_t>(gs));
 }
 
-extern "C" void enableIntsAndHaltForever();
+// --------------------------------------------------------
+// Idle states
+// --------------------------------------------------------
 
-void suspendSelf() {
+namespace {
+	constexpr size_t maxIdleStates = 4;
+
+	// State 0 is replaced by MWAIT C1 if MWAIT is available.
+	IdleState idleStates[maxIdleStates] = {
+		{"HLT", 2'000, 2'000, false}
+	};
+	uint32_t mwaitHints[maxIdleStates];
+	size_t numIdleStates = 1;
+
+	// We do not parse ACPI _CST; hence we use conservative values for C-states beyond C1.
+	// Entry k corresponds to MWAIT hint (k << 4).
+	constexpr IdleState mwaitStates[maxIdleStates] = {
+		{"MWAIT-C1", 2'000, 2'000, true},
+		{"MWAIT-C2", 80'000, 200'000, true},
+		{"MWAIT-C3", 100'000, 400'000, true},
+		{"MWAIT-C4", 150'000, 600'000, true},
+	};
+}
+
+static initgraph::Task discoverIdleStatesTask{&globalInitEngine, "x86.discover-idle-states",
+	initgraph::Requires{getCpuFeaturesKnownStage()},
+	[] {
+		auto features = getGlobalCpuFeatures();
+		if(!features->haveMwait) {
+			// HLT exits to the hypervisor; resuming the vCPU takes much longer than on bare metal.
+			if(features->haveHypervisor) {
+				idleStates[0].exitLatency = 50'000;
+				idleStates[0].targetResidency = 100'000;
+			}
+			return;
+		}
+
+		size_t n = 0;
+		for(size_t k = 0; k < maxIdleStates; k++) {
+			// EDX[4 * (k + 1) + 3 : 4 * (k + 1)] is the number of sub-states of hint (k << 4).
+			if(!((features->mwaitSubstates >> (4 * (k + 1))) & 0xF))
+				continue;
+			// The APIC timer may stop in C-states deeper than C1.
+			if(k && !features->haveArat)
+				break;
+			mwaitHints[n] = k << 4;
+			idleStates[n] = mwaitStates[k];
+			n++;
+		}
+		if(n)
+			__atomic_store_n(&numIdleStates, n, __ATOMIC_RELEASE);
+
+		for(size_t i = 0; i < n; i++)
+			debugLogger() << "thor: Using idle state " << idleStates[i].name
+					<< " (MWAIT hint 0x" << frg::hex_fmt(mwaitHints[i]) << ")" << frg::endlog;
+	}
+};
+
+size_t getNumIdleStates() {
+	return __atomic_load_n(&numIdleStates, __ATOMIC_ACQUIRE);
+}
+
+const IdleState &getIdleState(size_t index) {
+	assert(index < getNumIdleStates());
+	return idleStates[index];
+}
+
+void enterIdleState(size_t index, std::atomic<uint32_t> *word, uint32_t value) {
+	assert(!intsAreEnabled());
+	auto &state = getIdleState(index);
+
+	// STI only takes effect after the following instruction. Hence, IRQs cannot
+	// arrive between STI and HLT/MWAIT; they are handled before the CLI.
+	if(!state.monitorsStores) {
+		asm volatile ("sti\n\thlt\n\tcli" : : : "memory");
+		return;
+	}
+
+	asm volatile ("monitor" : : "a"(word), "c"(0), "d"(0) : "memory");
+	// Do not wait if the word was written before MONITOR armed the monitor.
+	if(word->load(std::memory_order_relaxed) != value)
+		return;
+	asm volatile ("sti\n\tmwait\n\tcli" : : "a"(mwaitHints[index]), "c"(0) : "memory");
+}
+
+extern "C" [[noreturn]] void enterIdleDomain(void (*fn)());
+
+void runInIdleDomain(void (*fn)()) {
 	assert(!intsAreEnabled());
-	enableIntsAndHaltForever();
+	enterIdleDomain(fn);
 }
 
 } // namespace thor
@@ -337,6 +337,15 @@ uint64_t getClockNanos() {
 	}
 }
 
+frg::optional<FreqFraction> getUserClockFraction() {
+	// Without invariant TSC, getClockNanos() reads the HPET.
+	// Invariant TSCs are globally synchronized (see calibrateApicTimer()).
+	if(!getGlobalCpuFeatures()->haveInvariantTsc)
+		return frg::null_opt;
+	assert(apicContext.getFor(0).timersAreCalibrated);
+	return apicContext.getFor(0).tscInverseFreq;
+}
+
 void acknowledgeIpi() {
 	picBase.store(lApicEoi, 0);
 }
@@ -459,8 +468,8 @@ extern IrqSpinlock globalIrqSlotsLock;
 
 namespace {
 	struct ApicMsiPin final : MsiPin {
-		ApicMsiPin(frg::string<KernelAlloc> name, unsigned int vector)
-		: MsiPin{std::move(name)}, vector_{vector} { }
+		ApicMsiPin(frg::string<KernelAlloc> name, unsigned int vector, int apicId)
+		: MsiPin{std::move(name)}, vector_{vector}, apicId_{apicId} { }
 
 		IrqStrategy program(TriggerMode mode, Polarity) override {
 			assert(mode == TriggerMode::edge);
@@ -480,16 +489,34 @@ namespace {
 		}
 
 		uint64_t getMessageAddress() override {
-			return 0xFEE00000;
+			// Physical destination mode, fixed delivery.
+			return 0xFEE00000 | (static_cast<uint64_t>(apicId_) << 12);
 		}
 
 		uint32_t getMessageData() override {
 			return vector_;
 		}
 
+	protected:
+		Error retarget(size_t cpu) override {
+			if(cpu >= getCpuCount())
+				return Error::illegalArgs;
+
+			// Without interrupt remapping, MSIs can only address 8-bit APIC IDs.
+			auto apicId = getCpuData(cpu)->localApicId;
+			if(apicId > 0xFF)
+				return Error::noHardwareSupport;
+			apicId_ = apicId;
+			return Error::success;
+		}
+
 	private:
 		unsigned int vector_;
+		int apicId_;
 	};
+
+	// Next CPU that allocateApicMsi() routes an MSI to.
+	size_t nextMsiCpu = 0;
 }
 
 MsiPin *allocateApicMsi(frg::string<KernelAlloc> name) {
@@ -505,16 +532,28 @@ MsiPin *allocateApicMsi(frg::string<KernelAlloc> name) {
 	if(slotIndex == -1)
 		return nullptr;
 
+	// Spread MSIs across CPUs (such that multi-queue devices can process IRQs in parallel).
+	// Since IRQ slots are shared by all CPUs, the vector stays valid if the MSI is retargeted.
+	// CPUs with APIC IDs that MSIs cannot address receive no MSIs by default.
+	int apicId = 0;
+	for(size_t n = 0; n < getCpuCount(); n++) {
+		auto cpu = nextMsiCpu++ % getCpuCount();
+		if(getCpuData(cpu)->localApicId <= 0xFF) {
+			apicId = getCpuData(cpu)->localApicId;
+			break;
+		}
+	}
+
 	// Create an IRQ pin for the MSI.
 	auto pin = frg::construct<ApicMsiPin>(*kernelAlloc,
-			std::move(name), 64 + slotIndex);
+			std::move(name), 64 + slotIndex, apicId);
 	pin->configure(IrqConfiguration{
 		.trigger = TriggerMode::edge,
 		.polarity = Polarity::high
 	});
 
 	infoLogger() << "thor: Allocating IRQ slot " << slotIndex
-			<< " to " << pin->name() << frg::endlog;
+			<< " to " << pin->name() << " (APIC " << apicId << ")" << frg::endlog;
 	globalIrqSlots[slotIndex]->link(pin);
 
 	return pin;
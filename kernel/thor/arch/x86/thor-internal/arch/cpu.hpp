@@ -512,10 +512,21 @@ struct CpuFeatures {
 	bool haveZmm;
 	bool haveInvariantTsc;
 	bool haveTscDeadline;
+	bool haveMwait;
+	// The APIC timer keeps running in deep C-states.
+	bool haveArat;
+	// Whether we run inside a virtual machine.
+	bool haveHypervisor;
 	bool haveVmx;
 	bool haveSvm;
 	uint32_t profileFlags;
 	size_t xsaveRegionSize;
+	// Number of MWAIT sub-states per C-state (CPUID leaf 5, EDX).
+	uint32_t mwaitSubstates;
+	// Number of low APIC ID bits that identify the SMT thread within a core
+	// and the CPU within the last level cache domain.
+	uint32_t smtShift;
+	uint32_t llcShift;
 };
 
 extern bool cpuFeaturesKnown;
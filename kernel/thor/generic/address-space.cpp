@@ -5,6 +5,7 @@
 #include <thor-internal/physical.hpp>
 #include <thor-internal/fiber.hpp>
 #include <frg/container_of.hpp>
+#include <frg/hash_map.hpp>
 #include <thor-internal/types.hpp>
 
 namespace thor {
@@ -399,6 +400,8 @@ VirtualSpace::map(smarter::borrowed_ptr<MemorySlice> slice,
 
 	if(offset + length > slice->length())
 		co_return Error::bufferTooSmall;
+	if((flags & kMapProtWrite) && slice->getView()->isReadOnly())
+		co_return Error::illegalArgs;
 
 	co_await _consistencyMutex.async_lock();
 	frg::unique_lock consistencyLock{frg::adopt_lock, _consistencyMutex};
@@ -542,6 +545,15 @@ VirtualSpace::protect(VirtualAddr address, size_t length, uint32_t flags) {
 
 	auto [start, end] = co_await _splitMappings(address, length);
 	assert(start || (!start && !end));
+
+	// Check all mappings before changing any of them.
+	if(mappingFlags & MappingFlags::protWrite) {
+		for (auto it = start; it != end; it = MappingTree::successor(it)) {
+			if(it->view->isReadOnly())
+				co_return Error::illegalArgs;
+		}
+	}
+
 	for (auto it = start; it != end;) {
 		auto mapping = it->selfPtr.lock();
 		it = MappingTree::successor(it);
@@ -585,38 +597,109 @@ coroutine<frg::expected<Error>> VirtualSpace::unmap(VirtualAddr address, size_t
 }
 
 coroutine<frg::expected<Error>>
-VirtualSpace::synchronize(VirtualAddr address, size_t size) {
+VirtualSpace::fork(VirtualSpace *target) {
+	// map(), protect() and unmap() take _consistencyMutex exclusively;
+	// hence, the mapping tree does not change while we hold it.
 	co_await _consistencyMutex.async_lock_shared();
 	frg::shared_lock consistencyLock{frg::adopt_lock, _consistencyMutex};
 
-	auto misalign = address & (kPageSize - 1);
-	auto alignedAddress = address & ~(kPageSize - 1);
-	auto alignedSize = (size + misalign + kPageSize - 1) & ~(kPageSize - 1);
+	// Mappings that were split by protect() or unmap() share their view.
+	// Such views must only be forked once.
+	frg::hash_map<
+		uintptr_t,
+		smarter::shared_ptr<MemorySlice>,
+		frg::hash<uintptr_t>,
+		KernelAlloc
+	> forkedSlices{frg::hash<uintptr_t>{}, *kernelAlloc};
 
-	size_t overallProgress = 0;
-	while(overallProgress < alignedSize) {
-		smarter::shared_ptr<Mapping> mapping;
-		{
-			auto irqLock = frg::guard(&irqMutex());
-			auto spaceGuard = frg::guard(&_snapshotMutex);
+	auto mapping = _mappings.first();
+	while(mapping) {
+		assert(mapping->state == MappingState::active);
 
-			mapping = _findMapping(alignedAddress + overallProgress);
+		auto key = reinterpret_cast<uintptr_t>(mapping->view.get());
+		auto slice = forkedSlices.get(key);
+		if(!slice) {
+			auto [error, forkedView] = co_await mapping->view->fork();
+			if(error == Error::illegalObject) {
+				forkedView = mapping->view;
+			}else if(error != Error::success) {
+				co_return error;
+			}
+
+			auto length = forkedView->getLength();
+			forkedSlices.insert(key, smarter::allocate_shared<MemorySlice>(*kernelAlloc,
+					std::move(forkedView), 0, length));
+			slice = forkedSlices.get(key);
 		}
-		assert(mapping);
 
-		auto mappingOffset = alignedAddress + overallProgress - mapping->address;
-		auto mappingChunk = frg::min(alignedSize - overallProgress,
-				mapping->length - mappingOffset);
-		assert(mapping->state == MappingState::active);
-		assert(mappingOffset + mappingChunk <= mapping->length);
+		uint32_t flags = kMapFixedNoReplace;
+		if(mapping->flags & MappingFlags::protRead)
+			flags |= kMapProtRead;
+		if(mapping->flags & MappingFlags::protWrite)
+			flags |= kMapProtWrite;
+		if(mapping->flags & MappingFlags::protExecute)
+			flags |= kMapProtExecute;
+		if(mapping->flags & MappingFlags::dontRequireBacking)
+			flags |= kMapDontRequireBacking;
+
+		FRG_CO_TRY(co_await target->map(*slice, mapping->address,
+				mapping->viewOffset, mapping->length, flags));
+
+		mapping = MappingTree::successor(mapping);
+	}
 
-		auto cleanOutcome = _ops->cleanPages(mapping->address + mappingOffset, mapping->view.get(),
-				mapping->viewOffset + mappingOffset, mappingChunk);
-		assert(cleanOutcome);
+	co_return {};
+}
+
+coroutine<frg::expected<Error>>
+VirtualSpace::synchronize(VirtualAddr address, size_t size) {
+	struct Range {
+		smarter::shared_ptr<MemoryView> view;
+		uintptr_t offset;
+		size_t size;
+	};
+	frg::vector<Range, KernelAlloc> ranges{*kernelAlloc};
+
+	{
+		co_await _consistencyMutex.async_lock_shared();
+		frg::shared_lock consistencyLock{frg::adopt_lock, _consistencyMutex};
+
+		auto misalign = address & (kPageSize - 1);
+		auto alignedAddress = address & ~(kPageSize - 1);
+		auto alignedSize = (size + misalign + kPageSize - 1) & ~(kPageSize - 1);
+
+		size_t overallProgress = 0;
+		while(overallProgress < alignedSize) {
+			smarter::shared_ptr<Mapping> mapping;
+			{
+				auto irqLock = frg::guard(&irqMutex());
+				auto spaceGuard = frg::guard(&_snapshotMutex);
+
+				mapping = _findMapping(alignedAddress + overallProgress);
+			}
+			assert(mapping);
+
+			auto mappingOffset = alignedAddress + overallProgress - mapping->address;
+			auto mappingChunk = frg::min(alignedSize - overallProgress,
+					mapping->length - mappingOffset);
+			assert(mapping->state == MappingState::active);
+			assert(mappingOffset + mappingChunk <= mapping->length);
+
+			auto cleanOutcome = _ops->cleanPages(mapping->address + mappingOffset,
+					mapping->view.get(), mapping->viewOffset + mappingOffset, mappingChunk);
+			assert(cleanOutcome);
+			ranges.push_back({mapping->view, mapping->viewOffset + mappingOffset, mappingChunk});
 
-		overallProgress += mappingChunk;
+			overallProgress += mappingChunk;
+		}
+		co_await _ops->shootdown(alignedAddress, alignedSize);
 	}
-	co_await _ops->shootdown(alignedAddress, alignedSize);
+
+	// Do not wait for the dirty pages to expire; write them back now.
+	// This is done without holding _consistencyMutex since the writeback might be
+	// performed by a thread that needs to change this address space.
+	for(auto &range : ranges)
+		co_await range.view->writeback(range.offset, range.size);
 
 	co_return {};
 }
@@ -652,6 +735,8 @@ VirtualSpace::handleFault(VirtualAddr address, uint32_t faultFlags,
 		FetchFlags fetchFlags = 0;
 		if(mapping->flags & MappingFlags::dontRequireBacking)
 			fetchFlags |= fetchDisallowBacking;
+		if(faultFlags & VirtualSpace::kFaultWrite)
+			fetchFlags |= fetchWrite;
 
 		FRG_CO_TRY(co_await mapping->view->fetchRange(
 				mapping->viewOffset + offset, fetchFlags, wq));
@@ -1164,7 +1249,8 @@ coroutine<size_t> VirtualSpace::writePartialSpace(uintptr_t address,
 
 			mapping = _findMapping(address + progress);
 		}
-		if(!mapping)
+		// Read-only views are only written by the kernel, even if user space has a handle.
+		if(!mapping || mapping->view->isReadOnly())
 			co_return progress;
 
 		auto startInMapping = address + progress - mapping->address;
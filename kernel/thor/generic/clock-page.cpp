@@ -0,0 +1,55 @@
+#include <string.h>
+#include <frg/manual_box.hpp>
+#include <hel.h>
+#include <thor-internal/clock-page.hpp>
+#include <thor-internal/main.hpp>
+#include <thor-internal/physical.hpp>
+#include <thor-internal/arch-generic/timer.hpp>
+
+namespace thor {
+
+namespace {
+	HelClockPage *clockPage;
+	frg::manual_box<smarter::shared_ptr<MemoryView>> clockPageMemory;
+
+	// Updates the clock page using the seqlock protocol.
+	void publishClockParameters(frg::optional<FreqFraction> fraction) {
+		auto seq = __atomic_load_n(&clockPage->seqlock, __ATOMIC_RELAXED);
+		__atomic_store_n(&clockPage->seqlock, seq + 1, __ATOMIC_RELAXED);
+		__atomic_thread_fence(__ATOMIC_RELEASE);
+
+		if(fraction) {
+			__atomic_store_n(&clockPage->factor, fraction->f, __ATOMIC_RELAXED);
+			__atomic_store_n(&clockPage->shift, fraction->s, __ATOMIC_RELAXED);
+			__atomic_store_n(&clockPage->mode, kHelClockPageCounter, __ATOMIC_RELAXED);
+		}else{
+			__atomic_store_n(&clockPage->mode, kHelClockPageNone, __ATOMIC_RELAXED);
+		}
+
+		__atomic_store_n(&clockPage->seqlock, seq + 2, __ATOMIC_RELEASE);
+	}
+
+	initgraph::Task initClockPage{&globalInitEngine, "generic.init-clock-page",
+		initgraph::Requires{getTaskingAvailableStage()},
+		[] {
+			auto physical = physicalAllocator->allocate(kPageSize);
+			assert(physical != static_cast<PhysicalAddr>(-1) && "OOM");
+			clockPage = reinterpret_cast<HelClockPage *>(mapDirectPhysical(physical));
+			memset(clockPage, 0, kPageSize);
+
+			publishClockParameters(getUserClockFraction());
+
+			// HardwareMemory never frees the page; it lives as long as the kernel.
+			auto memory = smarter::allocate_shared<HardwareMemory>(*kernelAlloc,
+					physical, kPageSize, CachingMode::null);
+			memory->setReadOnly();
+			clockPageMemory.initialize(std::move(memory));
+		}
+	};
+} // anonymous namespace
+
+smarter::shared_ptr<MemoryView> getClockPageMemory() {
+	return *clockPageMemory;
+}
+
+} // namespace thor
@@ -0,0 +1,228 @@
+#include <thor-internal/arch-generic/cpu.hpp>
+#include <thor-internal/arch-generic/ints.hpp>
+#include <thor-internal/cpu-data.hpp>
+#include <thor-internal/cpuidle.hpp>
+#include <thor-internal/debug.hpp>
+#include <thor-internal/schedule.hpp>
+#include <thor-internal/timer.hpp>
+
+namespace thor {
+
+namespace {
+	constexpr bool logIdle = false;
+
+	// Values of IdleContext::wakeWord.
+	constexpr uint32_t wakeNone = 0;
+	// The CPU polls or monitors wakeWord; wakeCpu() stores wakeRequested instead of sending an IPI.
+	constexpr uint32_t wakeMonitored = 1;
+	constexpr uint32_t wakeRequested = 2;
+
+	// Weight of new samples in the moving average of idle durations (as a shift).
+	constexpr int averageShift = 3;
+
+	// Prediction if there is no pending timer, in ns.
+	constexpr uint64_t maxPrediction = 1'000'000'000;
+
+	// Deeper states are only used if their exit latency is at most
+	// (predicted idle duration >> exitLatencyShift).
+	constexpr int exitLatencyShift = 2;
+
+	struct IdleContext {
+		std::atomic<uint32_t> wakeWord{wakeNone};
+		// Time of the last wakeCpu() call.
+		std::atomic<uint64_t> wakeClock{0};
+
+		// The following fields are only accessed by the owning CPU.
+		bool idle = false;
+		size_t state = 0;
+		// Start of the idle period and of the current state within the period.
+		uint64_t periodClock = 0;
+		uint64_t stateClock = 0;
+		frg::optional<uint64_t> timerDeadline;
+		// Moving average of recent idle durations, in ns.
+		uint64_t averageIdle = 0;
+
+		// Written only by the owning CPU but read by getCpuIdleStatistics().
+		CpuIdleStatistics stats{};
+	};
+
+	extern PerCpu<IdleContext> idleContext;
+	THOR_DEFINE_PERCPU(idleContext);
+
+	void bumpCounter(uint64_t &counter, uint64_t delta) {
+		__atomic_store_n(&counter, counter + delta, __ATOMIC_RELAXED);
+	}
+
+	void enterState(IdleContext &ctx, size_t state, uint64_t now) {
+		assert(state < maxCpuIdleStates);
+		if(ctx.idle) {
+			bumpCounter(ctx.stats.residency[ctx.state], now - ctx.stateClock);
+		}else{
+			ctx.idle = true;
+			ctx.periodClock = now;
+		}
+		ctx.state = state;
+		ctx.stateClock = now;
+		bumpCounter(ctx.stats.entries[state], 1);
+	}
+
+	// Ends the current idle period (if any) and updates the statistics.
+	void leaveIdle(IdleContext &ctx) {
+		if(!ctx.idle)
+			return;
+		ctx.idle = false;
+
+		auto now = getClockNanos();
+		bumpCounter(ctx.stats.residency[ctx.state], now - ctx.stateClock);
+
+		auto duration = now - ctx.periodClock;
+		ctx.averageIdle += (duration >> averageShift) - (ctx.averageIdle >> averageShift);
+
+		// We only know the wakeup latency if we know when the wakeup was requested.
+		frg::optional<uint64_t> cause;
+		if(auto wakeClock = ctx.wakeClock.load(std::memory_order_relaxed);
+				wakeClock >= ctx.periodClock) {
+			cause = wakeClock;
+		}else if(ctx.timerDeadline && *ctx.timerDeadline <= now) {
+			cause = *ctx.timerDeadline;
+		}
+		if(cause) {
+			bumpCounter(ctx.stats.wakeups, 1);
+			bumpCounter(ctx.stats.wakeupLatency, now > *cause ? now - *cause : 0);
+		}
+
+		if(logIdle)
+			infoLogger() << "thor: CPU " << getCpuData()->cpuIndex << " was idle for "
+					<< duration / 1000 << " us in state " << getCpuIdleStateName(ctx.state)
+					<< frg::endlog;
+	}
+
+	// Picks the deepest hardware state that pays off within the predicted idle duration.
+	// Since the wakeup that ends the idle period is delayed by the exit latency,
+	// states whose exit latency is large compared to the prediction are skipped.
+	size_t selectState(uint64_t predicted) {
+		size_t index = 0;
+		for(size_t i = 1; i < getNumIdleStates(); i++) {
+			auto &state = getIdleState(i);
+			if(state.targetResidency > predicted
+					|| state.exitLatency > (predicted >> exitLatencyShift))
+				break;
+			index = i;
+		}
+		return index;
+	}
+
+	void idleLoop() {
+		auto &ctx = idleContext.get();
+		auto *scheduler = &localScheduler.get();
+
+		while(true) {
+			assert(!intsAreEnabled());
+
+			auto now = getClockNanos();
+			ctx.timerDeadline = generalTimerEngine()->nextDeadline();
+			auto timerDistance = maxPrediction;
+			if(ctx.timerDeadline)
+				timerDistance = *ctx.timerDeadline > now ? *ctx.timerDeadline - now : 0;
+
+			// IRQs and IPIs often end idle periods long before the next timer expires.
+			auto predicted = frg::min(timerDistance, ctx.averageIdle);
+
+			// Poll if we expect to be woken up before the shallowest state pays off.
+			// Wakers only store to wakeWord; this saves both the IPI and the exit latency.
+			auto &shallowest = getIdleState(0);
+			bool polled = false;
+			if(predicted < shallowest.targetResidency) {
+				enterState(ctx, 0, now);
+				ctx.wakeWord.store(wakeMonitored);
+
+				auto pollEnd = now + frg::min(timerDistance, shallowest.targetResidency);
+				enableInts();
+				while(ctx.idle && ctx.wakeWord.load(std::memory_order_acquire) == wakeMonitored
+						&& getClockNanos() < pollEnd)
+					pause();
+				disableInts();
+
+				// An IRQ ended the idle period (see interruptIdle()).
+				if(!ctx.idle)
+					continue;
+				polled = true;
+
+				// The prediction was wrong; only rely on the timer from now on.
+				now = getClockNanos();
+				predicted = maxPrediction;
+				if(ctx.timerDeadline)
+					predicted = *ctx.timerDeadline > now ? *ctx.timerDeadline - now : 0;
+			}
+
+			// Wakers need to send IPIs unless the state monitors wakeWord.
+			// The exchange fails if wakeCpu() already requested a wakeup while we polled.
+			auto index = selectState(predicted);
+			auto expected = polled ? wakeMonitored : wakeNone;
+			if(ctx.wakeWord.compare_exchange_strong(expected,
+					getIdleState(index).monitorsStores ? wakeMonitored : wakeNone)) {
+				enterState(ctx, index + 1, now);
+				enterIdleState(index, &ctx.wakeWord, wakeMonitored);
+			}
+
+			leaveIdle(ctx);
+
+			if(ctx.wakeWord.exchange(wakeNone) == wakeRequested) {
+				// wakeCpu() did not send an IPI; do what the IPI handler would do.
+				scheduler->update();
+				if(scheduler->maybeReschedule())
+					scheduler->commitReschedule();
+				scheduler->renewSchedule();
+			}
+		}
+	}
+}
+
+void runIdleLoop() {
+	runInIdleDomain(idleLoop);
+}
+
+void interruptIdle() {
+	auto &ctx = idleContext.get();
+	// Wakers need to send IPIs again since we might not return to the idle loop.
+	// The caller updates the scheduler, which handles requests that we swallow here.
+	ctx.wakeWord.exchange(wakeNone);
+	leaveIdle(ctx);
+}
+
+void wakeCpu(CpuData *cpu) {
+	auto &ctx = idleContext.get(cpu);
+	ctx.wakeClock.store(getClockNanos(), std::memory_order_relaxed);
+
+	auto expected = wakeMonitored;
+	if(ctx.wakeWord.compare_exchange_strong(expected, wakeRequested))
+		return;
+	// If the wakeup is already requested, the CPU updates its scheduler anyway.
+	if(expected == wakeRequested)
+		return;
+	sendPingIpi(cpu);
+}
+
+size_t getNumCpuIdleStates() {
+	return getNumIdleStates() + 1;
+}
+
+const char *getCpuIdleStateName(size_t index) {
+	if(!index)
+		return "poll";
+	return getIdleState(index - 1).name;
+}
+
+CpuIdleStatistics getCpuIdleStatistics(size_t cpu) {
+	auto &ctx = idleContext.getFor(cpu);
+	CpuIdleStatistics stats;
+	for(size_t i = 0; i < maxCpuIdleStates; i++) {
+		stats.entries[i] = __atomic_load_n(&ctx.stats.entries[i], __ATOMIC_RELAXED);
+		stats.residency[i] = __atomic_load_n(&ctx.stats.residency[i], __ATOMIC_RELAXED);
+	}
+	stats.wakeups = __atomic_load_n(&ctx.stats.wakeups, __ATOMIC_RELAXED);
+	stats.wakeupLatency = __atomic_load_n(&ctx.stats.wakeupLatency, __ATOMIC_RELAXED);
+	return stats;
+}
+
+} // namespace thor
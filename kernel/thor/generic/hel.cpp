@@ -7,6 +7,7 @@
 #include <frg/formatting.hpp>
 #include <frg/dyn_array.hpp>
 #include <frg/small_vector.hpp>
+#include <thor-internal/clock-page.hpp>
 #include <thor-internal/event.hpp>
 #include <thor-internal/coroutine.hpp>
 #include <thor-internal/io.hpp>
@@ -105,6 +106,7 @@ size_t ipcSourceSize(size_t size) {
 HelError translateError(Error error) {
 	switch(error) {
 	case Error::success: return kHelErrNone;
+	case Error::illegalArgs: return kHelErrIllegalArgs;
 	case Error::threadExited: return kHelErrThreadTerminated;
 	case Error::transmissionMismatch: return kHelErrTransmissionMismatch;
 	case Error::laneShutdown: return kHelErrLaneShutdown;
@@ -113,6 +115,8 @@ HelError translateError(Error error) {
 	case Error::bufferTooSmall: return kHelErrBufferTooSmall;
 	case Error::fault: return kHelErrFault;
 	case Error::remoteFault: return kHelErrRemoteFault;
+	case Error::noMemory: return kHelErrNoMemory;
+	case Error::alreadyExists: return kHelErrAlreadyExists;
 	default:
 		assert(!"Unexpected error");
 		__builtin_unreachable();
@@ -626,6 +630,8 @@ HelError helAlterMemoryIndirection(HelHandle indirectHandle, size_t slot,
 			e != Error::success) {
 		if(e == Error::illegalObject) {
 			return kHelErrUnsupportedOperation;
+		}else if(e == Error::illegalArgs) {
+			return kHelErrIllegalArgs;
 		}else{
 			assert(e == Error::outOfBounds);
 			return kHelErrOutOfBounds;
@@ -718,6 +724,41 @@ HelError helCreateSpace(HelHandle *handle) {
 	return kHelErrNone;
 }
 
+HelError helForkSpace(HelHandle handle, HelHandle *forkedHandle) {
+	auto this_thread = getCurrentThread();
+	auto this_universe = this_thread->getUniverse();
+
+	smarter::shared_ptr<AddressSpace, BindableHandle> space;
+	if(handle == kHelNullHandle) {
+		space = this_thread->getAddressSpace().lock();
+	}else{
+		auto irq_lock = frg::guard(&irqMutex());
+		Universe::Guard universe_guard(this_universe->lock);
+
+		auto spaceWrapper = this_universe->getDescriptor(universe_guard, handle);
+		if(!spaceWrapper)
+			return kHelErrNoDescriptor;
+		if(!spaceWrapper->is<AddressSpaceDescriptor>())
+			return kHelErrBadDescriptor;
+		space = spaceWrapper->get<AddressSpaceDescriptor>().space;
+	}
+
+	auto forked = AddressSpace::create();
+	auto outcome = Thread::asyncBlockCurrent(space->fork(forked.get()));
+	if(!outcome)
+		return translateError(outcome.error());
+
+	{
+		auto irq_lock = frg::guard(&irqMutex());
+		Universe::Guard universe_guard(this_universe->lock);
+
+		*forkedHandle = this_universe->attachDescriptor(universe_guard,
+				AddressSpaceDescriptor(std::move(forked)));
+	}
+
+	return kHelErrNone;
+}
+
 HelError helCreateVirtualizedSpace(HelHandle *handle) {
 #ifdef __x86_64__
 	if(!getCpuData()->haveVirtualization) {
@@ -929,10 +970,13 @@ HelError helMapMemory(HelHandle memory_handle, HelHandle space_handle,
 	}
 
 	if(!mapResult) {
-		assert(mapResult.error() == Error::bufferTooSmall || mapResult.error() == Error::alreadyExists || mapResult.error() == Error::noMemory);
+		assert(mapResult.error() == Error::bufferTooSmall || mapResult.error() == Error::alreadyExists
+				|| mapResult.error() == Error::noMemory || mapResult.error() == Error::illegalArgs);
 
 		if(mapResult.error() == Error::bufferTooSmall)
 			return kHelErrBufferTooSmall;
+		else if(mapResult.error() == Error::illegalArgs)
+			return kHelErrIllegalArgs;
 		else if(mapResult.error() == Error::noMemory)
 			return kHelErrNoMemory;
 		else if(mapResult.error() == Error::alreadyExists)
@@ -991,10 +1035,13 @@ HelError helSubmitProtectMemory(HelHandle space_handle,
 			uint32_t protectFlags, uintptr_t context,
 			enable_detached_coroutine = {}) -> void {
 		auto outcome = co_await space->protect(pointer, length, protectFlags);
-		// TODO: handle errors after propagating them through VirtualSpace::protect.
-		assert(outcome);
+		// Only read-only views are rejected by VirtualSpace::protect for now.
+		assert(outcome || outcome.error() == Error::illegalArgs);
 
-		HelSimpleResult helResult{.error = kHelErrNone, .reserved = {}};
+		HelSimpleResult helResult{
+			.error = outcome ? kHelErrNone : kHelErrIllegalArgs,
+			.reserved = {}
+		};
 		QueueSource ipcSource{&helResult, sizeof(HelSimpleResult), nullptr};
 		co_await queue->submit(&ipcSource, context);
 	}(std::move(space), std::move(queue), reinterpret_cast<VirtualAddr>(pointer),
@@ -1716,6 +1763,88 @@ HelError helSetPriority(HelHandle handle, int priority) {
 	return kHelErrNone;
 }
 
+namespace {
+	HelError resolveThreadHandle(HelHandle handle, smarter::shared_ptr<Thread> &thread) {
+		auto this_thread = getCurrentThread();
+		auto this_universe = this_thread->getUniverse();
+
+		if(handle == kHelThisThread) {
+			thread = this_thread.lock();
+			return kHelErrNone;
+		}
+
+		auto irq_lock = frg::guard(&irqMutex());
+		Universe::Guard universe_guard(this_universe->lock);
+
+		auto thread_wrapper = this_universe->getDescriptor(universe_guard, handle);
+		if(!thread_wrapper)
+			return kHelErrNoDescriptor;
+		if(!thread_wrapper->is<ThreadDescriptor>())
+			return kHelErrBadDescriptor;
+		thread = remove_tag_cast(thread_wrapper->get<ThreadDescriptor>().thread);
+		return kHelErrNone;
+	}
+}
+
+HelError helSetSchedulingPolicy(HelHandle handle, const HelSchedulingParameters *paramsPtr) {
+	HelSchedulingParameters userParams;
+	if(!readUserObject(paramsPtr, userParams))
+		return kHelErrFault;
+
+	smarter::shared_ptr<Thread> thread;
+	if(auto error = resolveThreadHandle(handle, thread); error != kHelErrNone)
+		return error;
+
+	ScheduleParameters params;
+	switch(userParams.policy) {
+	case kHelSchedFair: params.policy = SchedulePolicy::fair; break;
+	case kHelSchedFifo: params.policy = SchedulePolicy::fifo; break;
+	case kHelSchedRoundRobin: params.policy = SchedulePolicy::roundRobin; break;
+	case kHelSchedDeadline: params.policy = SchedulePolicy::deadline; break;
+	default:
+		return kHelErrIllegalArgs;
+	}
+	params.priority = userParams.priority;
+	params.runtime = userParams.runtime;
+	params.deadline = userParams.deadline;
+	params.period = userParams.period;
+
+	auto error = Scheduler::setParameters(thread.get(), params);
+	if(error == Error::illegalArgs)
+		return kHelErrIllegalArgs;
+	if(error == Error::illegalState)
+		return kHelErrIllegalState;
+	assert(error == Error::success);
+
+	return kHelErrNone;
+}
+
+HelError helGetSchedulingPolicy(HelHandle handle, HelSchedulingParameters *paramsPtr) {
+	smarter::shared_ptr<Thread> thread;
+	if(auto error = resolveThreadHandle(handle, thread); error != kHelErrNone)
+		return error;
+
+	auto params = Scheduler::getParameters(thread.get());
+
+	HelSchedulingParameters userParams;
+	memset(&userParams, 0, sizeof(HelSchedulingParameters));
+	switch(params.policy) {
+	case SchedulePolicy::fair: userParams.policy = kHelSchedFair; break;
+	case SchedulePolicy::fifo: userParams.policy = kHelSchedFifo; break;
+	case SchedulePolicy::roundRobin: userParams.policy = kHelSchedRoundRobin; break;
+	case SchedulePolicy::deadline: userParams.policy = kHelSchedDeadline; break;
+	}
+	userParams.priority = params.priority;
+	userParams.runtime = params.runtime;
+	userParams.deadline = params.deadline;
+	userParams.period = params.period;
+
+	if(!writeUserObject(paramsPtr, userParams))
+		return kHelErrFault;
+
+	return kHelErrNone;
+}
+
 HelError helYield() {
 	Thread::deferCurrent();
 
@@ -2245,13 +2374,34 @@ HelError helGetClock(uint64_t *counter) {
 	return kHelErrNone;
 }
 
+HelError helGetClockPage(HelHandle *handle) {
+	auto this_thread = getCurrentThread();
+	auto this_universe = this_thread->getUniverse();
+
+	{
+		auto irq_lock = frg::guard(&irqMutex());
+		Universe::Guard universe_guard(this_universe->lock);
+
+		*handle = this_universe->attachDescriptor(universe_guard,
+				MemoryViewDescriptor(getClockPageMemory()));
+	}
+
+	return kHelErrNone;
+}
+
 HelError helSubmitAwaitClock(uint64_t counter, HelHandle queue_handle, uintptr_t context,
 		uint64_t *async_id) {
+	return helSubmitAwaitClockSlack(counter, 0, queue_handle, context, async_id);
+}
+
+HelError helSubmitAwaitClockSlack(uint64_t counter, uint64_t slack, HelHandle queue_handle,
+		uintptr_t context, uint64_t *async_id) {
 	struct Closure final : CancelNode, PrecisionTimerNode, IpcNode {
-		static void issue(uint64_t nanos, smarter::shared_ptr<IpcQueue> queue,
+		static void issue(uint64_t nanos, uint64_t slack, smarter::shared_ptr<IpcQueue> queue,
 				uintptr_t context, uint64_t *async_id) {
 			auto closure = frg::construct<Closure>(*kernelAlloc, nanos,
 					std::move(queue), context);
+			closure->setSlack(slack);
 			closure->queue->registerNode(closure);
 			*async_id = closure->asyncId();
 			generalTimerEngine()->installTimer(closure);
@@ -2311,7 +2461,7 @@ HelError helSubmitAwaitClock(uint64_t counter, HelHandle queue_handle, uintptr_t
 	if(!queue->validSize(ipcSourceSize(sizeof(HelSimpleResult))))
 		return kHelErrQueueTooSmall;
 
-	Closure::issue(counter, std::move(queue), context, async_id);
+	Closure::issue(counter, slack, std::move(queue), context, async_id);
 
 	return kHelErrNone;
 }
@@ -2961,53 +3111,144 @@ HelError helShutdownLane(HelHandle handle) {
 	return kHelErrNone;
 }
 
+namespace {
+	template<Futex F>
+	void blockOnFutex(F futex, int expected, int64_t deadline, uint64_t slack, uint32_t bitset) {
+		if(deadline == -1) {
+			Thread::asyncBlockCurrent(
+				getGlobalFutexRealm()->wait(std::move(futex), expected, {}, bitset)
+			);
+		}else{
+			Thread::asyncBlockCurrent(
+				async::race_and_cancel(
+					[&] (async::cancellation_token cancellation) {
+						return getGlobalFutexRealm()->wait(std::move(futex), expected,
+								cancellation, bitset);
+					},
+					[&] (async::cancellation_token cancellation) {
+						return generalTimerEngine()->coarseSleep(deadline, slack, cancellation);
+					}
+				)
+			);
+		}
+	}
+
+	frg::expected<Error, FutexIdentity> resolveFutex(VirtualSpace *space,
+			uintptr_t address, uint32_t flags) {
+		if(flags & kHelFutexPrivate)
+			return space->privateFutexIdentity(address);
+		return space->resolveGlobalFutex(address);
+	}
+}
+
 HelError helFutexWait(int *pointer, int expected, int64_t deadline) {
+	return helFutexWaitBitset(pointer, expected, deadline, FutexRealm::allBits, 0);
+}
+
+HelError helFutexWake(int *pointer) {
+	size_t woken;
+	return helFutexWakeBitset(pointer, UINT32_MAX, FutexRealm::allBits, 0, &woken);
+}
+
+HelError helFutexWaitBitset(int *pointer, int expected, int64_t deadline,
+		uint32_t bitset, uint32_t flags) {
 	auto thisThread = getCurrentThread();
 	auto space = thisThread->getAddressSpace();
 
-	auto futexOrError = Thread::asyncBlockCurrent(
-			space->grabGlobalFutex(reinterpret_cast<uintptr_t>(pointer),
-					thisThread->mainWorkQueue()->take()));
-	if(!futexOrError)
-		return kHelErrFault;
-	GlobalFutex futex = std::move(futexOrError.value());
+	if(flags & ~(kHelFutexPrivate | kHelFutexCoarse))
+		return kHelErrIllegalArgs;
+	if(!bitset)
+		return kHelErrIllegalArgs;
+	if(deadline < 0 && deadline != -1)
+		return kHelErrIllegalArgs;
 
-	if(deadline < 0) {
-		if(deadline != -1)
-			return kHelErrIllegalArgs;
+	uint64_t slack = 0;
+	if((flags & kHelFutexCoarse) && deadline != -1) {
+		auto now = getClockNanos();
+		if(static_cast<uint64_t>(deadline) > now)
+			slack = (deadline - now) >> 3;
+	}
 
-		Thread::asyncBlockCurrent(
-			getGlobalFutexRealm()->wait(std::move(futex), expected)
-		);
+	auto address = reinterpret_cast<uintptr_t>(pointer);
+	if(flags & kHelFutexPrivate) {
+		auto futexOrError = Thread::asyncBlockCurrent(
+				space->grabPrivateFutex(address, thisThread->mainWorkQueue()->take()));
+		if(!futexOrError)
+			return kHelErrFault;
+		blockOnFutex(std::move(futexOrError.value()), expected, deadline, slack, bitset);
 	}else{
-		Thread::asyncBlockCurrent(
-			async::race_and_cancel(
-				[&] (async::cancellation_token cancellation) {
-					return getGlobalFutexRealm()->wait(std::move(futex), expected,
-							cancellation);
-				},
-				[&] (async::cancellation_token cancellation) {
-					return generalTimerEngine()->sleep(deadline, cancellation);
-				}
-			)
-		);
+		auto futexOrError = Thread::asyncBlockCurrent(
+				space->grabGlobalFutex(address, thisThread->mainWorkQueue()->take()));
+		if(!futexOrError)
+			return kHelErrFault;
+		blockOnFutex(std::move(futexOrError.value()), expected, deadline, slack, bitset);
 	}
 
 	return kHelErrNone;
 }
 
-HelError helFutexWake(int *pointer) {
-	auto this_thread = getCurrentThread();
-	auto space = this_thread->getAddressSpace();
+HelError helFutexWakeBitset(int *pointer, uint32_t count, uint32_t bitset,
+		uint32_t flags, size_t *numWoken) {
+	auto thisThread = getCurrentThread();
+	auto space = thisThread->getAddressSpace();
+
+	if(flags & ~kHelFutexPrivate)
+		return kHelErrIllegalArgs;
 
-	auto identityOrError = space->resolveGlobalFutex(reinterpret_cast<uintptr_t>(pointer));
+	auto identityOrError = resolveFutex(space.get(),
+			reinterpret_cast<uintptr_t>(pointer), flags);
 	if(!identityOrError)
 		return kHelErrFault;
-	getGlobalFutexRealm()->wake(identityOrError.value());
+	*numWoken = getGlobalFutexRealm()->wake(identityOrError.value(), count, bitset);
 
 	return kHelErrNone;
 }
 
+HelError helFutexRequeue(int *pointer, int *target, int expected,
+		uint32_t wakeCount, uint32_t requeueCount, uint32_t flags, size_t *numAffected) {
+	auto thisThread = getCurrentThread();
+	auto space = thisThread->getAddressSpace();
+
+	if(flags & ~(kHelFutexPrivate | kHelFutexCompare))
+		return kHelErrIllegalArgs;
+
+	auto targetOrError = resolveFutex(space.get(),
+			reinterpret_cast<uintptr_t>(target), flags);
+	if(!targetOrError)
+		return kHelErrFault;
+
+	frg::optional<unsigned int> expectedValue;
+	if(flags & kHelFutexCompare)
+		expectedValue = expected;
+
+	// We need to grab the source futex (even without kHelFutexCompare) since requeue()
+	// reads it under the bucket lock.
+	auto address = reinterpret_cast<uintptr_t>(pointer);
+	frg::expected<Error, size_t> outcome{size_t{0}};
+	if(flags & kHelFutexPrivate) {
+		auto futexOrError = Thread::asyncBlockCurrent(
+				space->grabPrivateFutex(address, thisThread->mainWorkQueue()->take()));
+		if(!futexOrError)
+			return kHelErrFault;
+		outcome = getGlobalFutexRealm()->requeue(std::move(futexOrError.value()),
+				targetOrError.value(), expectedValue, wakeCount, requeueCount);
+	}else{
+		auto futexOrError = Thread::asyncBlockCurrent(
+				space->grabGlobalFutex(address, thisThread->mainWorkQueue()->take()));
+		if(!futexOrError)
+			return kHelErrFault;
+		outcome = getGlobalFutexRealm()->requeue(std::move(futexOrError.value()),
+				targetOrError.value(), expectedValue, wakeCount, requeueCount);
+	}
+
+	if(!outcome) {
+		assert(outcome.error() == Error::futexRace);
+		return kHelErrFutexRace;
+	}
+	*numAffected = outcome.value();
+	return kHelErrNone;
+}
+
 HelError helCreateOneshotEvent(HelHandle *handle) {
 	auto this_thread = getCurrentThread();
 	auto this_universe = this_thread->getUniverse();
@@ -3295,6 +3536,43 @@ HelError helAutomateIrq(HelHandle handle, uint32_t flags, HelHandle kernlet_hand
 	return kHelErrNone;
 }
 
+HelError helSetIrqAffinity(HelHandle handle, int cpu) {
+	auto thisThread = getCurrentThread();
+	auto thisUniverse = thisThread->getUniverse();
+
+	if(cpu < 0 || static_cast<size_t>(cpu) >= getCpuCount())
+		return kHelErrIllegalArgs;
+
+	smarter::shared_ptr<IrqObject> irq;
+	{
+		auto irqLock = frg::guard(&irqMutex());
+		Universe::Guard universeGuard(thisUniverse->lock);
+
+		auto irqWrapper = thisUniverse->getDescriptor(universeGuard, handle);
+		if(!irqWrapper)
+			return kHelErrNoDescriptor;
+		if(!irqWrapper->is<IrqDescriptor>())
+			return kHelErrBadDescriptor;
+		irq = irqWrapper->get<IrqDescriptor>().irq;
+	}
+
+	auto pin = irq->getPin();
+	if(!pin)
+		return kHelErrIllegalState;
+
+	auto error = pin->setAffinity(cpu);
+	if(error == Error::illegalArgs) {
+		return kHelErrIllegalArgs;
+	}else if(error == Error::illegalState) {
+		return kHelErrIllegalState;
+	}else if(error == Error::noHardwareSupport) {
+		return kHelErrNoHardwareSupport;
+	}else{
+		assert(error == Error::success);
+		return kHelErrNone;
+	}
+}
+
 HelError helAccessIo(uintptr_t *port_array, size_t num_ports,
 		HelHandle *handle) {
 	auto this_thread = getCurrentThread();
@@ -3404,8 +3682,11 @@ HelError helBindKernlet(HelHandle handle, const HelKernletData *data, size_t num
 				memory = wrapper->get<MemoryViewDescriptor>().memory;
 			}
 
-			auto window = reinterpret_cast<char *>(KernelVirtualMemory::global().allocate(0x10000));
-			assert(memory->getLength() <= 0x10000);
+			// Large enough for the register BARs of NICs (e.g., e1000 uses 128 KiB).
+			if(!memory->getLength() || memory->getLength() > 0x100000)
+				return kHelErrIllegalArgs;
+			auto windowSize = (memory->getLength() + kPageSize - 1) & ~(kPageSize - 1);
+			auto window = reinterpret_cast<char *>(KernelVirtualMemory::global().allocate(windowSize));
 
 			for(size_t off = 0; off < memory->getLength(); off += kPageSize) {
 				auto range = memory->peekRange(off);
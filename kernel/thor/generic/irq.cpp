@@ -8,6 +8,29 @@ namespace thor {
 
 namespace {
 	constexpr bool logService = false;
+
+	// Maximal number of pins that we record IRQ statistics for.
+	constexpr int maxRegisteredPins = 256;
+
+	struct IrqCounters {
+		// Only written by the owning CPU (with IRQs disabled) but read by all CPUs.
+		std::atomic<uint64_t> counts[maxRegisteredPins]{};
+	};
+
+	std::atomic<IrqPin *> registeredPins[maxRegisteredPins];
+	std::atomic<int> numRegisteredPins{0};
+}
+
+extern PerCpu<IrqCounters> irqCounters;
+THOR_DEFINE_PERCPU(irqCounters);
+
+size_t getNumRegisteredIrqPins() {
+	return frg::min(numRegisteredPins.load(std::memory_order_relaxed), maxRegisteredPins);
+}
+
+// Returns nullptr if the pin at the given index is still being constructed.
+IrqPin *getRegisteredIrqPin(size_t index) {
+	return registeredPins[index].load(std::memory_order_acquire);
 }
 
 // --------------------------------------------------------
@@ -125,6 +148,14 @@ IrqPin::IrqPin(frg::string<KernelAlloc> name)
 		_maskState{0} {
 	_hash = frg::hash<frg::string<KernelAlloc>>{}(_name);
 
+	_statisticsIndex = numRegisteredPins.fetch_add(1, std::memory_order_relaxed);
+	if(_statisticsIndex < maxRegisteredPins) {
+		registeredPins[_statisticsIndex].store(this, std::memory_order_release);
+	}else{
+		infoLogger() << "thor: No IRQ statistics for " << _name << frg::endlog;
+		_statisticsIndex = -1;
+	}
+
 	[] (IrqPin *self, enable_detached_coroutine = {}) -> void {
 		while(true) {
 			co_await self->_unstallEvent.async_wait_if([&] () -> bool {
@@ -189,6 +220,12 @@ void IrqPin::configure(IrqConfiguration desired) {
 
 void IrqPin::raise() {
 	assert(!intsAreEnabled());
+
+	if(_statisticsIndex >= 0) {
+		auto &count = irqCounters.get().counts[_statisticsIndex];
+		count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	}
+
 	auto lock = frg::guard(&_mutex);
 
 	if(!_strategy) {
@@ -374,6 +411,24 @@ void IrqPin::endOfService() {
 	// Default implementation is a no-op: not all IRQ controllers need endOfService().
 }
 
+uint64_t IrqPin::raiseCount(size_t cpu) {
+	if(_statisticsIndex < 0)
+		return 0;
+	return irqCounters.getFor(cpu).counts[_statisticsIndex].load(std::memory_order_relaxed);
+}
+
+uint64_t IrqPin::wakeupCount() {
+	return _numWakeups.load(std::memory_order_relaxed);
+}
+
+void IrqPin::countWakeup() {
+	_numWakeups.store(_numWakeups.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+Error IrqPin::setAffinity(size_t) {
+	return Error::noHardwareSupport;
+}
+
 void IrqPin::_doService() {
 	assert(!_inService);
 	assert(!_raiseBuffered);
@@ -404,6 +459,9 @@ void IrqPin::_doService() {
 		++((*it)->_currentSequence);
 		auto status = (*it)->raise();
 		(*it)->_status = status;
+		// Nobody observed the sequence number unless the sink forwarded the raise.
+		if(status != IrqStatus::indefinite)
+			--((*it)->_currentSequence);
 
 		if(status == IrqStatus::acked) {
 			anyAck = true;
@@ -464,6 +522,30 @@ void IrqPin::_updateMask() {
 	}
 }
 
+// --------------------------------------------------------
+// MsiPin
+// --------------------------------------------------------
+
+void MsiPin::attachDevice(MsiDevice *device, size_t index) {
+	auto lock = frg::guard(&_deviceMutex);
+
+	_device = device;
+	_deviceIndex = index;
+	_device->setupMsi(this, _deviceIndex);
+}
+
+Error MsiPin::setAffinity(size_t cpu) {
+	auto lock = frg::guard(&_deviceMutex);
+
+	if(!_device)
+		return Error::illegalState;
+
+	if(auto error = retarget(cpu); error != Error::success)
+		return error;
+	_device->setupMsi(this, _deviceIndex);
+	return Error::success;
+}
+
 // --------------------------------------------------------
 // IrqObject
 // --------------------------------------------------------
@@ -477,30 +559,41 @@ IrqObject::IrqObject(frg::string<KernelAlloc> name)
 // TODO: Add a sequence parameter to this function and run the kernlet if the sequence advanced.
 //       This would prevent races between automate() and IRQs.
 void IrqObject::automate(smarter::shared_ptr<BoundKernlet> kernlet) {
-	_automationKernlet = std::move(kernlet);
+	// Destruct the previous kernlet outside of the locks.
+	smarter::shared_ptr<BoundKernlet> previous;
+	{
+		auto irqLock = frg::guard(&irqMutex());
+		auto lock = frg::guard(sinkMutex());
+
+		previous = std::exchange(_automationKernlet, std::move(kernlet));
+	}
 }
 
 IrqStatus IrqObject::raise() {
+	// Kernlets can reject spurious (or shared) IRQs without waking up user space.
+	if(_automationKernlet) {
+		bool triggeredEvents;
+		auto result = _automationKernlet->invokeIrqAutomation(triggeredEvents);
+		if(result) {
+			// Events that the kernlet triggered are the only wakeups of handled IRQs.
+			if(triggeredEvents)
+				getPin()->countWakeup();
+			if(result == 1)
+				return IrqStatus::acked;
+			assert(result == 2);
+			return IrqStatus::nacked;
+		}
+	}
+
+	// Forwarded IRQs count as a single wakeup, even if the kernlet also triggered events.
+	getPin()->countWakeup();
 	while(!_waitQueue.empty()) {
 		auto node = _waitQueue.pop_front();
 		node->_error = Error::success;
 		node->_sequence = currentSequence();
 		WorkQueue::post(node->_awaited);
 	}
-
-	if(_automationKernlet) {
-		auto result = _automationKernlet->invokeIrqAutomation();
-		if(result == 1) {
-			return IrqStatus::acked;
-		}else if(result == 2) {
-			return IrqStatus::nacked;
-		}else{
-			assert(!result);
-			infoLogger() << "thor: IRQ automation does not handle the IRQ?" << frg::endlog;
-			return IrqStatus::indefinite;
-		}
-	}else
-		return IrqStatus::indefinite;
+	return IrqStatus::indefinite;
 }
 
 void IrqObject::submitAwait(AwaitIrqNode *node, uint64_t sequence) {
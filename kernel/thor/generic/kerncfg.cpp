@@ -3,10 +3,14 @@
 #include <thor-internal/universe.hpp>
 #include <thor-internal/coroutine.hpp>
 #include <thor-internal/fiber.hpp>
+#include <thor-internal/irq.hpp>
 #include <thor-internal/kerncfg.hpp>
 #include <thor-internal/ostrace.hpp>
 #include <thor-internal/kernel-log.hpp>
+#include <thor-internal/memory-view.hpp>
 #include <thor-internal/profile.hpp>
+#include <thor-internal/cpuidle.hpp>
+#include <thor-internal/schedule.hpp>
 #include <thor-internal/stream.hpp>
 #include <thor-internal/timer.hpp>
 #include <thor-internal/mbus.hpp>
@@ -84,6 +88,8 @@ private:
 			resp.set_total_usable_memory(physicalAllocator->numTotalPages());
 			resp.set_available_memory(physicalAllocator->numFreePages());
 			resp.set_memory_unit(kPageSize);
+			resp.set_dirty_memory(numDirtyPages());
+			resp.set_writeback_memory(numWritebackPages());
 
 			frg::unique_memory<KernelAlloc> respBuffer{*kernelAlloc, resp.size_of_head()};
 			bragi::write_head_only(resp, respBuffer);
@@ -107,6 +113,96 @@ private:
 			if(respError != Error::success) {
 				co_return respError;
 			}
+		}else if(preamble.id() == bragi::message_id<managarm::kerncfg::GetIrqStatisticsRequest>) {
+			auto req = bragi::parse_head_only<managarm::kerncfg::GetIrqStatisticsRequest>(reqBuffer, *kernelAlloc);
+
+			if (!req)
+				co_return Error::protocolViolation;
+
+			auto numCpu = getCpuCount();
+			managarm::kerncfg::GetIrqStatisticsResponse<KernelAlloc> resp(*kernelAlloc);
+			resp.set_error(managarm::kerncfg::Error::SUCCESS);
+			resp.set_num_cpu(numCpu);
+
+			for(size_t i = 0; i < getNumRegisteredIrqPins(); i++) {
+				auto pin = getRegisteredIrqPin(i);
+				if(!pin)
+					continue;
+				resp.add_names(frg::string<KernelAlloc>{*kernelAlloc, pin->name()});
+				for(size_t cpu = 0; cpu < numCpu; cpu++)
+					resp.add_counts(pin->raiseCount(cpu));
+				resp.add_wakeups(pin->wakeupCount());
+			}
+
+			frg::unique_memory<KernelAlloc> respHeadBuffer{*kernelAlloc, resp.head_size};
+			frg::unique_memory<KernelAlloc> respTailBuffer{*kernelAlloc, resp.size_of_tail()};
+			bragi::write_head_tail(resp, respHeadBuffer, respTailBuffer);
+			auto respHeadError = co_await SendBufferSender{lane, std::move(respHeadBuffer)};
+			if(respHeadError != Error::success)
+				co_return respHeadError;
+			auto respTailError = co_await SendBufferSender{lane, std::move(respTailBuffer)};
+			if(respTailError != Error::success)
+				co_return respTailError;
+		}else if(preamble.id() == bragi::message_id<managarm::kerncfg::GetSchedLatencyRequest>) {
+			auto req = bragi::parse_head_only<managarm::kerncfg::GetSchedLatencyRequest>(reqBuffer, *kernelAlloc);
+
+			if (!req)
+				co_return Error::protocolViolation;
+
+			managarm::kerncfg::GetSchedLatencyResponse<KernelAlloc> resp(*kernelAlloc);
+			resp.set_error(managarm::kerncfg::Error::SUCCESS);
+			resp.set_num_buckets(numLatencyBuckets);
+
+			for(size_t c = 0; c < static_cast<size_t>(LatencyClass::count); c++) {
+				uint64_t buckets[numLatencyBuckets];
+				Scheduler::getLatencyHistogram(static_cast<LatencyClass>(c), buckets);
+				for(size_t b = 0; b < numLatencyBuckets; b++)
+					resp.add_counts(buckets[b]);
+			}
+
+			frg::unique_memory<KernelAlloc> respHeadBuffer{*kernelAlloc, resp.head_size};
+			frg::unique_memory<KernelAlloc> respTailBuffer{*kernelAlloc, resp.size_of_tail()};
+			bragi::write_head_tail(resp, respHeadBuffer, respTailBuffer);
+			auto respHeadError = co_await SendBufferSender{lane, std::move(respHeadBuffer)};
+			if(respHeadError != Error::success)
+				co_return respHeadError;
+			auto respTailError = co_await SendBufferSender{lane, std::move(respTailBuffer)};
+			if(respTailError != Error::success)
+				co_return respTailError;
+		}else if(preamble.id() == bragi::message_id<managarm::kerncfg::GetIdleStatisticsRequest>) {
+			auto req = bragi::parse_head_only<managarm::kerncfg::GetIdleStatisticsRequest>(reqBuffer, *kernelAlloc);
+
+			if (!req)
+				co_return Error::protocolViolation;
+
+			auto numCpu = getCpuCount();
+			auto numStates = getNumCpuIdleStates();
+			managarm::kerncfg::GetIdleStatisticsResponse<KernelAlloc> resp(*kernelAlloc);
+			resp.set_error(managarm::kerncfg::Error::SUCCESS);
+			resp.set_num_cpu(numCpu);
+			resp.set_num_states(numStates);
+
+			for(size_t s = 0; s < numStates; s++)
+				resp.add_names(frg::string<KernelAlloc>{*kernelAlloc, getCpuIdleStateName(s)});
+			for(size_t cpu = 0; cpu < numCpu; cpu++) {
+				auto stats = getCpuIdleStatistics(cpu);
+				for(size_t s = 0; s < numStates; s++) {
+					resp.add_entries(stats.entries[s]);
+					resp.add_residency(stats.residency[s]);
+				}
+				resp.add_wakeups(stats.wakeups);
+				resp.add_wakeup_latency(stats.wakeupLatency);
+			}
+
+			frg::unique_memory<KernelAlloc> respHeadBuffer{*kernelAlloc, resp.head_size};
+			frg::unique_memory<KernelAlloc> respTailBuffer{*kernelAlloc, resp.size_of_tail()};
+			bragi::write_head_tail(resp, respHeadBuffer, respTailBuffer);
+			auto respHeadError = co_await SendBufferSender{lane, std::move(respHeadBuffer)};
+			if(respHeadError != Error::success)
+				co_return respHeadError;
+			auto respTailError = co_await SendBufferSender{lane, std::move(respTailBuffer)};
+			if(respTailError != Error::success)
+				co_return respTailError;
 		}else{
 			managarm::kerncfg::SvrResponse<KernelAlloc> resp(*kernelAlloc);
 			resp.set_error(managarm::kerncfg::Error::ILLEGAL_REQUEST);
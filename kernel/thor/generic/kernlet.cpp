@@ -9,6 +9,7 @@
 #include <elf.h>
 #include <thor-internal/universe.hpp>
 #include <thor-internal/coroutine.hpp>
+#include <thor-internal/cpu-data.hpp>
 #include <thor-internal/fiber.hpp>
 #include <thor-internal/kernlet.hpp>
 #include <thor-internal/physical.hpp>
@@ -24,8 +25,16 @@ namespace thor {
 namespace {
 	constexpr bool logBinding = false;
 	constexpr bool logIo = false;
+
+	struct KernletContext {
+		// Number of __trigger_bitset calls by the kernlet that currently runs on this CPU.
+		unsigned int numTriggers = 0;
+	};
 }
 
+extern PerCpu<KernletContext> kernletContext;
+THOR_DEFINE_PERCPU(kernletContext);
+
 // ------------------------------------------------------------------------
 // KernletObject class.
 // ------------------------------------------------------------------------
@@ -101,9 +110,15 @@ void BoundKernlet::setupBitsetEventBinding(size_t index, smarter::shared_ptr<Bit
 	memcpy(_instance + defn.offset, &p, sizeof(void *));
 }
 
-int BoundKernlet::invokeIrqAutomation() {
+int BoundKernlet::invokeIrqAutomation(bool &triggeredEvents) {
+	assert(!intsAreEnabled());
+	auto &ctx = kernletContext.get();
+	ctx.numTriggers = 0;
+
 	auto entry = reinterpret_cast<int (*)(const void *)>(_object->_entry);
-	return entry(_instance);
+	auto result = entry(_instance);
+	triggeredEvents = ctx.numTriggers > 0;
+	return result;
 }
 
 // ------------------------------------------------------------------------
@@ -226,6 +241,16 @@ smarter::shared_ptr<KernletObject> processElfDso(const char *buffer,
 				return value;
 			};
 
+		uint8_t (*abi_pio_read8)(ptrdiff_t) =
+			[] (ptrdiff_t offset) -> uint8_t {
+				if(logIo)
+					infoLogger() << "__pio_read8 on offset: " << offset << frg::endlog;
+				auto value = arch::io_ops<uint8_t>::load(offset);
+				if(logIo)
+					infoLogger() << "    Read " << (unsigned int)value << frg::endlog;
+				return value;
+			};
+
 		void (*abi_pio_write16)(ptrdiff_t, uint16_t) =
 			[] (ptrdiff_t offset, uint16_t value) {
 				if(logIo)
@@ -247,6 +272,17 @@ smarter::shared_ptr<KernletObject> processElfDso(const char *buffer,
 					infoLogger() << "    Read " << (unsigned int)value << frg::endlog;
 				return value;
 			};
+		uint16_t (*abi_mmio_read16)(const char *, ptrdiff_t) =
+			[] (const char *base, ptrdiff_t offset) -> uint16_t {
+				if(logIo)
+					infoLogger() << "__mmio_read16 on " << (void *)base
+							<< ", offset: " << offset << frg::endlog;
+				auto p = reinterpret_cast<const uint16_t *>(base + offset);
+				auto value = arch::mem_ops<uint16_t>::load(p);
+				if(logIo)
+					infoLogger() << "    Read " << (unsigned int)value << frg::endlog;
+				return value;
+			};
 		uint32_t (*abi_mmio_read32)(const char *, ptrdiff_t) =
 			[] (const char *base, ptrdiff_t offset) -> uint32_t {
 				if(logIo)
@@ -277,10 +313,13 @@ smarter::shared_ptr<KernletObject> processElfDso(const char *buffer,
 							<< p << ", bits: " << bits << frg::endlog;
 				auto event = static_cast<BitsetEvent *>(p);
 				event->trigger(bits);
+				kernletContext.get().numTriggers++;
 			};
 
 #ifdef THOR_ARCH_SUPPORTS_PIO
-		if(name == "__pio_read16")
+		if(name == "__pio_read8")
+			return reinterpret_cast<void *>(abi_pio_read8);
+		else if(name == "__pio_read16")
 			return reinterpret_cast<void *>(abi_pio_read16);
 		else if(name == "__pio_write16")
 			return reinterpret_cast<void *>(abi_pio_write16);
@@ -289,6 +328,8 @@ smarter::shared_ptr<KernletObject> processElfDso(const char *buffer,
 		if(name == "__mmio_read8")
 #endif
 			return reinterpret_cast<void *>(abi_mmio_read8);
+		else if(name == "__mmio_read16")
+			return reinterpret_cast<void *>(abi_mmio_read16);
 		else if(name == "__mmio_read32")
 			return reinterpret_cast<void *>(abi_mmio_read32);
 		else if(name == "__mmio_write32")
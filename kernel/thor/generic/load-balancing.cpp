@@ -1,5 +1,6 @@
 #include <frg/unique.hpp>
 #include <thor-internal/load-balancing.hpp>
+#include <thor-internal/schedule.hpp>
 #include <thor-internal/timer.hpp>
 
 namespace thor {
@@ -16,8 +17,42 @@ constexpr uint64_t lbInterval = 100'000'000;
 constexpr uint64_t lbDecay = 184;
 constexpr uint64_t lbDecayInterval = 1'000'000'000;
 
+// Moving threads to other NUMA nodes requires an imbalance of idealLoad >> lbRemoteMarginShift.
+constexpr int lbRemoteMarginShift = 2;
+
+// Wake-affine placement and the minimal time between two wake-affine migrations of a thread.
+constexpr bool enableWakeAffine = true;
+constexpr uint64_t wakeMoveInterval = 1'000'000;
+
 frg::eternal<LoadBalancer> loadBalancer;
 
+CpuTopology loadTopology(LbNode *node) {
+	return CpuTopology{
+		.coreId = node->coreId.load(std::memory_order_relaxed),
+		.llcId = node->llcId.load(std::memory_order_relaxed),
+		.numaNode = node->numaNode.load(std::memory_order_relaxed)
+	};
+}
+
+void storeTopology(LbNode *node, CpuTopology topology) {
+	node->coreId.store(topology.coreId, std::memory_order_relaxed);
+	node->llcId.store(topology.llcId, std::memory_order_relaxed);
+	node->numaNode.store(topology.numaNode, std::memory_order_relaxed);
+}
+
+// Distance levels between CPUs.
+constexpr int distanceLlc = 0;
+constexpr int distanceNode = 1;
+constexpr int distanceRemote = 2;
+
+int getDistance(CpuTopology a, CpuTopology b) {
+	if (a.llcId == b.llcId && a.numaNode == b.numaNode)
+		return distanceLlc;
+	if (a.numaNode == b.numaNode)
+		return distanceNode;
+	return distanceRemote;
+}
+
 } // namespace
 
 THOR_DEFINE_PERCPU(lbNode);
@@ -31,6 +66,7 @@ LoadBalancer::LoadBalancer()
 
 void LoadBalancer::setOnline(CpuData *cpu) {
 	auto *node = &lbNode.get(cpu);
+	storeTopology(node, getCpuTopology(cpu));
 	node->cpu = cpu;
 	async::detach_with_allocator(*kernelAlloc, loadBalancer->run_(cpu));
 }
@@ -79,8 +115,18 @@ coroutine<void> LoadBalancer::run_(CpuData *cpu) {
 			lastDecay = now;
 		}
 
+		storeTopology(thisNode, getCpuTopology(cpu));
+
 		// On this CPU, estimate the load.
 		uint64_t load = 0;
+		frg::intrusive_list<
+			LbControlBlock,
+			frg::locate_member<
+				LbControlBlock,
+				frg::default_list_hook<LbControlBlock>,
+				&LbControlBlock::hook_
+			>
+		> handoverTasks;
 		{
 			auto irqLock = frg::guard(&irqMutex());
 			auto lock = frg::guard(&thisNode->mutex);
@@ -104,10 +150,32 @@ coroutine<void> LoadBalancer::run_(CpuData *cpu) {
 				if (applyDecay)
 					thread->decayLoad(lbDecay, 8);
 				cb->load_ = thread->loadLevel();
+
+				// placeWakee() assigned the thread to another CPU.
+				if (cb->getAssignedCpu() != cpu) {
+					thisNode->tasks.erase(currentIt);
+					cb->node_ = nullptr;
+					handoverTasks.push_back(cb);
+					continue;
+				}
+
 				load += cb->load_;
 			}
 		}
 
+		// Move ownership to the assigned CPUs. Their loads are only accounted
+		// for if they did not estimate their load yet (see balanceBetween_()).
+		while (!handoverTasks.empty()) {
+			auto *cb = handoverTasks.pop_front();
+			auto *dstNode = &lbNode.get(cb->getAssignedCpu());
+
+			auto irqLock = frg::guard(&irqMutex());
+			auto lock = frg::guard(&dstNode->mutex);
+
+			cb->node_ = dstNode;
+			dstNode->tasks.push_back(cb);
+		}
+
 		thisNode->totalLoad = load;
 		thisNode->currentLoad = load;
 
@@ -133,26 +201,42 @@ coroutine<void> LoadBalancer::run_(CpuData *cpu) {
 
 		if (enableLb) {
 			// Distribute load from other CPUs to this CPU.
+			// We pull from CPUs that share our LLC first, then from CPUs on our NUMA node
+			// and from remote nodes only if their load is clearly above the ideal load,
+			// since threads lose more cache (and memory) locality the further they move.
 			// TODO: This loop probably does not scale very well since all CPUs try to pull from
 			//       all other CPUs in the same order (and this can cause lock contention).
+			auto thisTopology = loadTopology(thisNode);
 			uint64_t newLoad = thisNode->totalLoad;
-			for (size_t i = 0; i < getCpuCount(); ++i) {
-				auto *toCpu = getCpuData(i);
-				if (cpu != toCpu)
-					balanceBetween_(&lbNode.get(toCpu), thisNode, newLoad, idealLoad);
+			for (int distance = distanceLlc; distance <= distanceRemote; ++distance) {
+				uint64_t margin = 0;
+				if (distance == distanceRemote)
+					margin = idealLoad >> lbRemoteMarginShift;
+
+				for (size_t i = 0; i < getCpuCount(); ++i) {
+					auto *toCpu = getCpuData(i);
+					if (cpu == toCpu)
+						continue;
+					auto *toNode = &lbNode.get(toCpu);
+					if (getDistance(thisTopology, loadTopology(toNode)) != distance)
+						continue;
+					balanceBetween_(toNode, thisNode, newLoad, idealLoad, margin);
+				}
 			}
 		}
 
 		// Balance load again after some time has passed.
 		// Note that we only wait on CPU zero. All other CPUs wait on the barrier instead.
 		if (!cpu->cpuIndex)
-			co_await generalTimerEngine()->sleep(getClockNanos() + lbInterval);
+			co_await generalTimerEngine()->coarseSleep(getClockNanos() + lbInterval,
+					lbInterval >> 3);
 	}
 
 	co_return;
 }
 
-void LoadBalancer::balanceBetween_(LbNode *srcNode, LbNode *dstNode, uint64_t &newLoad, uint64_t idealLoad) {
+void LoadBalancer::balanceBetween_(LbNode *srcNode, LbNode *dstNode, uint64_t &newLoad, uint64_t idealLoad,
+		uint64_t margin) {
 	auto improvesBalance = [] (uint64_t srcLoad, uint64_t dstLoad, uint64_t stolenLoad) -> bool {
 		uint64_t srcLoadPostMove = srcLoad - stolenLoad;
 		uint64_t dstLoadPostMove = dstLoad + stolenLoad;
@@ -187,10 +271,17 @@ void LoadBalancer::balanceBetween_(LbNode *srcNode, LbNode *dstNode, uint64_t &n
 			if (srcNode->currentLoad < idealLoad && newLoad < idealLoad)
 				break;
 
+			if (srcNode->currentLoad < idealLoad + margin)
+				break;
+
 			// Do not move threads with tiny contributions to the total load.
 			if (!cb->load_)
 				continue;
 
+			// Handed over threads might not be accounted for in currentLoad.
+			if (cb->load_ > srcNode->currentLoad)
+				continue;
+
 			if (!cb->inAffinityMask(dstNode->cpu->cpuIndex))
 				continue;
 
@@ -205,7 +296,7 @@ void LoadBalancer::balanceBetween_(LbNode *srcNode, LbNode *dstNode, uint64_t &n
 			// Move ownership from srcNode to dstNode.
 			assert(cb->node_ == srcNode);
 			srcNode->tasks.erase(currentIt);
-			cb->node_ = dstNode;
+			cb->node_ = nullptr;
 			cb->_assignedCpu.store(dstNode->cpu, std::memory_order_relaxed);
 			stolenTasks.push_back(cb);
 
@@ -219,8 +310,80 @@ void LoadBalancer::balanceBetween_(LbNode *srcNode, LbNode *dstNode, uint64_t &n
 		auto irqLock = frg::guard(&irqMutex());
 		auto lock = frg::guard(&dstNode->mutex);
 
+		for (auto *cb : stolenTasks)
+			cb->node_ = dstNode;
 		dstNode->tasks.splice(dstNode->tasks.end(), stolenTasks);
 	}
 }
 
+CpuData *LoadBalancer::placeWakee(Thread *thread) {
+	if (!enableWakeAffine)
+		return nullptr;
+
+	auto *cb = thread->_lbCb;
+	if (!cb)
+		return nullptr;
+
+	auto *wakerCpu = getCpuData();
+	auto *prevCpu = cb->getAssignedCpu();
+	if (prevCpu == wakerCpu)
+		return nullptr;
+	auto *wakerNode = &lbNode.get(wakerCpu);
+	auto *prevNode = &lbNode.get(prevCpu);
+	if (!wakerNode->cpu)
+		return nullptr;
+
+	// Avoid bouncing threads that are woken up by multiple CPUs.
+	auto now = getClockNanos();
+	if (now - cb->lastWakeMove_ < wakeMoveInterval)
+		return nullptr;
+
+	// Note that all loads and hints below are racy; they are only used as heuristics.
+	auto wakerTopology = loadTopology(wakerNode);
+	bool prevIdle = localScheduler.get(prevCpu).idleHint();
+
+	// Keep the thread on its (cache-hot) CPU if that CPU can run it immediately and
+	// it shares the LLC with the waker (such that shared data is still close).
+	if (prevIdle && loadTopology(prevNode).llcId == wakerTopology.llcId)
+		return nullptr;
+
+	// Prefer idle CPUs that share the LLC with the waker. Among those, prefer CPUs that
+	// are not SMT siblings of the waker since siblings compete for execution units.
+	CpuData *target = nullptr;
+	for (size_t i = 0; i < getCpuCount(); ++i) {
+		auto *node = &lbNode.getFor(i);
+		if (!node->cpu || node->cpu == wakerCpu)
+			continue;
+		auto topology = loadTopology(node);
+		if (topology.llcId != wakerTopology.llcId
+				|| !localScheduler.get(node->cpu).idleHint()
+				|| !cb->inAffinityMask(i))
+			continue;
+		target = node->cpu;
+		if (topology.coreId != wakerTopology.coreId)
+			break;
+	}
+
+	// Otherwise, run the thread on the waker's CPU if no other thread waits for that CPU.
+	// This is the common case for synchronous IPC where the waker blocks soon after
+	// the wakeup and both threads operate on the same data.
+	if (!target && !prevIdle
+			&& !localScheduler.get().numWaiting()
+			&& wakerNode->totalLoad <= prevNode->totalLoad
+			&& cb->inAffinityMask(wakerCpu->cpuIndex))
+		target = wakerCpu;
+
+	if (!target || target == prevCpu)
+		return nullptr;
+
+	if (debugLb)
+		infoLogger() << "Waking thread on CPU " << target->cpuIndex
+				<< " instead of CPU " << prevCpu->cpuIndex << frg::endlog;
+
+	// The node that owns cb hands it over during the next load balancing round.
+	cb->lastWakeMove_ = now;
+	cb->_assignedCpu.store(target, std::memory_order_relaxed);
+	return target;
+}
+
 } // namespace thor
@@ -1,5 +1,7 @@
 #include <algorithm>
 #include <frg/string.hpp>
+#include <frg/tuple.hpp>
+#include <frg/vector.hpp>
 #include <elf.h>
 #include <hel.h>
 #include <thor-internal/arch-generic/cpu.hpp>
@@ -10,6 +12,7 @@
 #include <initgraph.hpp>
 #include <thor-internal/irq.hpp>
 #include <thor-internal/kerncfg.hpp>
+#include <thor-internal/kernel_heap.hpp>
 #include <thor-internal/kernlet.hpp>
 #include <thor-internal/kernel-log.hpp>
 #include <thor-internal/load-balancing.hpp>
@@ -178,6 +181,27 @@ initgraph::Edge fibersTaskingEdge{
 	getTaskingAvailableStage()
 };
 
+namespace {
+
+// Frees the kernel virtual memory of the initrd mapping once TLB shootdown completes.
+// The pages must already be unmapped.
+void releaseInitrdWindow(const char *window, size_t size) {
+	struct Closure final : ShootNode {
+		void complete() override {
+			KernelVirtualMemory::global().deallocate(reinterpret_cast<void *>(address), size);
+			frg::destruct(*kernelAlloc, this);
+		}
+	};
+
+	auto p = frg::construct<Closure>(*kernelAlloc);
+	p->address = reinterpret_cast<VirtualAddr>(window);
+	p->size = size;
+	if(KernelPageSpace::global().submitShootdown(p))
+		p->complete();
+}
+
+} // anonymous namespace
+
 extern "C" void thorMain() {
 	initializeGlobalLog();
 	infoLogger() << "thor: Entering main function" << frg::endlog;
@@ -237,10 +261,25 @@ extern "C" void thorMain() {
 					initrdLength));
 			for(size_t pg = 0; pg < initrdLength; pg += kPageSize)
 				KernelPageSpace::global().mapSingle4k(reinterpret_cast<VirtualAddr>(base) + pg,
-				initrdBase + pg, 0, CachingMode::null);
+				initrdBase + pg, page_access::write, CachingMode::null);
 
 			base += initrdMisalign;
 
+			// Physical ranges of the initrd that are used in place (in ascending order)
+			// and the parts of their last pages that follow the end of the file.
+			frg::vector<frg::tuple<PhysicalAddr, size_t>, KernelAlloc> keptPages{*kernelAlloc};
+			frg::vector<frg::tuple<const char *, size_t>, KernelAlloc> keptTails{*kernelAlloc};
+
+			// Eir only includes allocatable regions in the direct physical mapping.
+			// Kept pages are accessed through it but they are never freed, so they are
+			// mapped read-only such that stray writes fault instead of corrupting the initrd.
+			auto keep = [&] (PhysicalAddr physical, size_t size) {
+				for(size_t pg = 0; pg < size; pg += kPageSize)
+					KernelPageSpace::global().mapSingle4k(directPhysicalOffset() + physical + pg,
+							physical + pg, page_access::read, CachingMode::null);
+				keptPages.push({physical, size});
+			};
+
 			struct Header {
 				char magic[6];
 				char inode[8];
@@ -282,6 +321,9 @@ extern "C" void thorMain() {
 				return v;
 			};
 
+			auto parseStart = getClockNanos();
+			size_t numCompressed = 0;
+
 			auto p = base;
 			auto limit = base + modules[0].length;
 			while(true) {
@@ -297,7 +339,12 @@ extern "C" void thorMain() {
 				auto file_size = parseHex(header.fileSize, 8);
 				auto data = p + ((sizeof(Header) + name_size + 3) & ~uint32_t{3});
 
-				frg::string_view path{p + sizeof(Header), name_size - 1};
+				// The name may be padded with NUL bytes (to align the file data).
+				size_t name_length = 0;
+				while(name_length < name_size - 1 && p[sizeof(Header) + name_length])
+					name_length++;
+
+				frg::string_view path{p + sizeof(Header), name_length};
 				if(path == "TRAILER!!!")
 					break;
 
@@ -329,22 +376,92 @@ extern "C" void thorMain() {
 	//				if(logInitialization)
 						debugLogger() << "thor: initrd file " << path << frg::endlog;
 
-					auto memory = smarter::allocate_shared<AllocatedMemory>(*kernelAlloc,
-							(file_size + (kPageSize - 1)) & ~size_t{kPageSize - 1});
-					memory->selfPtr = memory;
-					auto copyOutcome = KernelFiber::asyncBlockCurrent(memory->copyTo(0,
-							data, file_size,
-							thisFiber()->associatedWorkQueue()->take()));
-					assert(copyOutcome);
+					auto alignedSize = (file_size + (kPageSize - 1)) & ~size_t{kPageSize - 1};
+					auto dataPhysical = modules[0].physicalBase + (data - base);
+
+#ifndef THOR_KASAN
+					bool inPlace = file_size && !(dataPhysical & (kPageSize - 1))
+							&& (data - base) + alignedSize <= modules[0].length;
+#else
+					// There is no KASAN shadow for initrd pages in the direct physical mapping.
+					bool inPlace = false;
+#endif
+
+					// Map kept pages before createCompressedModule() sees them.
+					if(inPlace)
+						keep(dataPhysical, alignedSize);
+
+					smarter::shared_ptr<MemoryView> memory;
+					size_t moduleSize = file_size;
+					if(auto compressed = createCompressedModule(data, file_size,
+							inPlace ? dataPhysical : PhysicalAddr(-1), &moduleSize); compressed) {
+						// Compressed files are decompressed on demand. Page aligned compressed
+						// data is kept in place (but it is never mapped into user space).
+						memory = std::move(compressed);
+						numCompressed++;
+					}else if(inPlace) {
+						// Page aligned files are used in place. The pages are shared with
+						// all mappings of the file, so the view must never be written.
+						auto hardware = smarter::allocate_shared<HardwareMemory>(*kernelAlloc,
+								dataPhysical, alignedSize, CachingMode::null);
+						hardware->setReadOnly();
+						memory = std::move(hardware);
+						if(alignedSize > file_size)
+							keptTails.push({data + file_size, alignedSize - file_size});
+					}else{
+						auto allocated = smarter::allocate_shared<AllocatedMemory>(*kernelAlloc,
+								alignedSize);
+						allocated->selfPtr = allocated;
+						auto copyOutcome = KernelFiber::asyncBlockCurrent(allocated->copyTo(0,
+								data, file_size,
+								thisFiber()->associatedWorkQueue()->take()));
+						assert(copyOutcome);
+						memory = std::move(allocated);
+					}
 
 					auto name = frg::string<KernelAlloc>{*kernelAlloc,
 							path.sub_string(it - path.data(), end - it)};
 					dir->link(std::move(name), frg::construct<MfsRegular>(*kernelAlloc,
-							std::move(memory), file_size));
+							std::move(memory), moduleSize));
 				}
 
 				p = data + ((file_size + 3) & ~uint32_t{3});
 			}
+
+			// The last page of a file that is used in place also contains the following
+			// CPIO header. Clear it such that user space sees zeros after the end of the file.
+			for(auto &tail : keptTails)
+				memset(const_cast<char *>(tail.get<0>()), 0, tail.get<1>());
+
+			// Unmap the initrd; all other pages are returned to the physical allocator.
+			for(size_t pg = 0; pg < initrdLength; pg += kPageSize)
+				KernelPageSpace::global().unmapSingle4k(
+						reinterpret_cast<VirtualAddr>(base - initrdMisalign) + pg);
+			releaseInitrdWindow(base - initrdMisalign, initrdLength);
+
+			// Pages that are only partially covered by the initrd are not released.
+			size_t numReleased = 0;
+			PhysicalAddr current = initrdBase + (initrdMisalign ? kPageSize : 0);
+			auto release = [&] (PhysicalAddr end) {
+				if(end <= current)
+					return;
+				physicalAllocator->donate(current, end - current);
+				numReleased += (end - current) / kPageSize;
+			};
+			for(auto &kept : keptPages) {
+				release(kept.get<0>());
+				current = kept.get<0>() + kept.get<1>();
+			}
+			release((initrdBase + initrdLength) & ~PhysicalAddr{kPageSize - 1});
+
+			size_t numKept = 0;
+			for(auto &kept : keptPages)
+				numKept += kept.get<1>() / kPageSize;
+			infoLogger() << "thor: " << numKept << " initrd pages are used in place, "
+					<< numReleased << " pages were released" << frg::endlog;
+			infoLogger() << "thor: Parsed initrd in "
+					<< (getClockNanos() - parseStart) / 1000 << " us, "
+					<< numCompressed << " files are decompressed on demand" << frg::endlog;
 		}
 
 		if(logInitialization)
@@ -637,6 +754,11 @@ void handleSyscall(SyscallImageAccessor image) {
 		*image.error() = helCreateSpace(&handle);
 		*image.out0() = handle;
 	} break;
+	case kHelCallForkSpace: {
+		HelHandle forkedHandle;
+		*image.error() = helForkSpace((HelHandle)arg0, &forkedHandle);
+		*image.out0() = forkedHandle;
+	} break;
 	case kHelCallMapMemory: {
 		void *actual_pointer;
 		*image.error() = helMapMemory((HelHandle)arg0, (HelHandle)arg1,
@@ -721,6 +843,14 @@ void handleSyscall(SyscallImageAccessor image) {
 	case kHelCallSetPriority: {
 		*image.error() = helSetPriority((HelHandle)arg0, (int)arg1);
 	} break;
+	case kHelCallSetSchedulingPolicy: {
+		*image.error() = helSetSchedulingPolicy((HelHandle)arg0,
+				(const HelSchedulingParameters *)arg1);
+	} break;
+	case kHelCallGetSchedulingPolicy: {
+		*image.error() = helGetSchedulingPolicy((HelHandle)arg0,
+				(HelSchedulingParameters *)arg1);
+	} break;
 	case kHelCallYield: {
 		*image.error() = helYield();
 	} break;
@@ -764,12 +894,23 @@ void handleSyscall(SyscallImageAccessor image) {
 		*image.error() = helGetClock(&counter);
 		*image.out0() = counter;
 	} break;
+	case kHelCallGetClockPage: {
+		HelHandle handle;
+		*image.error() = helGetClockPage(&handle);
+		*image.out0() = handle;
+	} break;
 	case kHelCallSubmitAwaitClock: {
 		uint64_t async_id;
 		*image.error() = helSubmitAwaitClock((uint64_t)arg0,
 				(HelHandle)arg1, (uintptr_t)arg2, &async_id);
 		*image.out0() = async_id;
 	} break;
+	case kHelCallSubmitAwaitClockSlack: {
+		uint64_t async_id;
+		*image.error() = helSubmitAwaitClockSlack((uint64_t)arg0, (uint64_t)arg1,
+				(HelHandle)arg2, (uintptr_t)arg3, &async_id);
+		*image.out0() = async_id;
+	} break;
 
 	case kHelCallCreateStream: {
 		HelHandle lane1;
@@ -792,6 +933,22 @@ void handleSyscall(SyscallImageAccessor image) {
 	case kHelCallFutexWake: {
 		*image.error() = helFutexWake((int *)arg0);
 	} break;
+	case kHelCallFutexWaitBitset: {
+		*image.error() = helFutexWaitBitset((int *)arg0, (int)arg1, (int64_t)arg2,
+				(uint32_t)arg3, (uint32_t)arg4);
+	} break;
+	case kHelCallFutexWakeBitset: {
+		size_t woken;
+		*image.error() = helFutexWakeBitset((int *)arg0, (uint32_t)arg1, (uint32_t)arg2,
+				(uint32_t)arg3, &woken);
+		*image.out0() = woken;
+	} break;
+	case kHelCallFutexRequeue: {
+		size_t affected;
+		*image.error() = helFutexRequeue((int *)arg0, (int *)arg1, (int)arg2,
+				(uint32_t)arg3, (uint32_t)arg4, (uint32_t)arg5, &affected);
+		*image.out0() = affected;
+	} break;
 
 	case kHelCallCreateOneshotEvent: {
 		HelHandle handle;
@@ -821,6 +978,9 @@ void handleSyscall(SyscallImageAccessor image) {
 	case kHelCallAutomateIrq: {
 		*image.error() = helAutomateIrq((HelHandle)arg0, (uint32_t)arg1, (HelHandle)arg2);
 	} break;
+	case kHelCallSetIrqAffinity: {
+		*image.error() = helSetIrqAffinity((HelHandle)arg0, (int)arg1);
+	} break;
 
 	case kHelCallAccessIo: {
 		HelHandle handle;
@@ -14,6 +14,24 @@ namespace {
 	// The following flags are debugging options to debug the correctness of various components.
 	constexpr bool tortureUncaching = false;
 	constexpr bool disableUncaching = false;
+
+	// Dirty pages are written back once they are older than this.
+	constexpr uint64_t dirtyExpireNanos = 5'000'000'000;
+	// Interval in which the flusher looks for expired dirty pages.
+	constexpr uint64_t flushIntervalNanos = 1'000'000'000;
+	// Percentage of physical memory that can be dirty (or under writeback) before
+	// writeback starts regardless of page age and before writers are throttled.
+	constexpr size_t dirtyBackgroundRatio = 5;
+	constexpr size_t dirtyRatio = 10;
+	// Maximal delay that is imposed on a writer per page.
+	constexpr uint64_t maxDirtyPauseNanos = 10'000'000;
+	// Maximal number of pages per writeback request.
+	constexpr size_t maxWritebackRun = 512;
+
+	// Start to reclaim pages once the physical memory usage exceeds this number of pages.
+	size_t reclaimWatermark() {
+		return physicalAllocator->numTotalPages() * 3 / 4;
+	}
 }
 
 // --------------------------------------------------------
@@ -116,7 +134,7 @@ struct MemoryReclaimer {
 				return false;
 
 			if(!tortureUncaching) {
-				auto pagesWatermark = physicalAllocator->numTotalPages() * 3 / 4;
+				auto pagesWatermark = reclaimWatermark();
 				auto usedPages = physicalAllocator->numUsedPages();
 				if(usedPages < pagesWatermark) {
 					return false;
@@ -188,6 +206,170 @@ static initgraph::Task initReclaim{&globalInitEngine, "generic.init-reclaim",
 	}
 };
 
+// --------------------------------------------------------
+// Writeback implementation.
+// --------------------------------------------------------
+
+struct WritebackController {
+	// Outstanding pages are pages that are either dirty or under writeback.
+	size_t numOutstanding() {
+		return dirtyPages.load(std::memory_order_relaxed)
+				+ writebackPages.load(std::memory_order_relaxed);
+	}
+
+	size_t dirtyLimit() {
+		return physicalAllocator->numTotalPages() * dirtyRatio / 100;
+	}
+
+	size_t backgroundThreshold() {
+		return physicalAllocator->numTotalPages() * dirtyBackgroundRatio / 100;
+	}
+
+	// Returns true if dirty pages should be written back without waiting for them to expire.
+	bool needsBackgroundWriteback() {
+		if(numOutstanding() >= backgroundThreshold())
+			return true;
+		// Dirty pages cannot be reclaimed; write them back early if memory is tight.
+		return physicalAllocator->numUsedPages() >= reclaimWatermark();
+	}
+
+	// Delays writers in proportion to the amount of outstanding pages.
+	// Writers run freely until the outstanding pages are halfway between the background
+	// threshold and the limit; the delay then increases linearly up to maxDirtyPauseNanos.
+	// Note that we never block writers indefinitely: the writer might be the
+	// same thread that has to perform the writeback.
+	// Callers should check needsThrottling() first to avoid the coroutine in the common case.
+	bool needsThrottling() {
+		return numOutstanding() > (backgroundThreshold() + dirtyLimit()) / 2;
+	}
+
+	coroutine<void> throttle() {
+		auto outstanding = numOutstanding();
+		auto limit = dirtyLimit();
+		auto freerun = (backgroundThreshold() + limit) / 2;
+		if(outstanding <= freerun)
+			co_return;
+
+		uint64_t pause = maxDirtyPauseNanos;
+		if(outstanding < limit)
+			pause = maxDirtyPauseNanos * (outstanding - freerun) / (limit - freerun);
+		if(pause)
+			co_await generalTimerEngine()->sleepFor(pause);
+	}
+
+	// Called with the ManagedSpace's mutex held.
+	void registerSpace(ManagedSpace *space) {
+		auto irqLock = frg::guard(&irqMutex());
+		auto lock = frg::guard(&_mutex);
+
+		if(space->_dirtyRegistered)
+			return;
+		_spaces.push_back(space);
+		space->_dirtyRegistered = true;
+	}
+
+	// Called with the ManagedSpace's mutex held.
+	void unregisterSpace(ManagedSpace *space) {
+		auto irqLock = frg::guard(&irqMutex());
+		auto lock = frg::guard(&_mutex);
+
+		assert(space->_dirtyRegistered);
+		_spaces.erase(_spaces.iterator_to(space));
+		space->_dirtyRegistered = false;
+	}
+
+	void runFlushFiber() {
+		KernelFiber::run([this] {
+			while(true) {
+				KernelFiber::asyncBlockCurrent(generalTimerEngine()->sleepFor(flushIntervalNanos));
+				flush();
+			}
+		});
+	}
+
+	std::atomic<size_t> dirtyPages{0};
+	std::atomic<size_t> writebackPages{0};
+
+private:
+	struct Candidate {
+		ManagedSpace *space;
+		size_t numDirty;
+	};
+
+	// Starts writeback on all ManagedSpaces that have expired dirty pages.
+	// If background writeback is necessary, spaces with more dirty pages go first
+	// since they are the most likely to yield long contiguous runs.
+	void flush() {
+		auto now = getClockNanos();
+
+		// ManagedSpaces are never destructed (see ~ManagedSpace()),
+		// hence it is safe to use the pointers after dropping the lock.
+		frg::vector<ManagedSpace *, KernelAlloc> spaces{*kernelAlloc};
+		{
+			auto irqLock = frg::guard(&irqMutex());
+			auto lock = frg::guard(&_mutex);
+
+			for(auto space : _spaces)
+				spaces.push_back(space);
+		}
+
+		frg::vector<Candidate, KernelAlloc> candidates{*kernelAlloc};
+		for(auto space : spaces) {
+			auto irqLock = frg::guard(&irqMutex());
+			auto lock = frg::guard(&space->mutex);
+
+			if(!space->_numDirtyPages) {
+				unregisterSpace(space);
+				continue;
+			}
+			if(!space->_isWritebackDue(now))
+				continue;
+
+			// Insertion sort by descending number of dirty pages.
+			size_t i = candidates.size();
+			candidates.push_back({space, space->_numDirtyPages});
+			while(i > 0 && candidates[i - 1].numDirty < candidates[i].numDirty) {
+				auto tmp = candidates[i - 1];
+				candidates[i - 1] = candidates[i];
+				candidates[i] = tmp;
+				i--;
+			}
+		}
+
+		for(auto &candidate : candidates)
+			candidate.space->_deferredManagement.invoke();
+	}
+
+	frg::ticket_spinlock _mutex;
+
+	frg::intrusive_list<
+		ManagedSpace,
+		frg::locate_member<
+			ManagedSpace,
+			frg::default_list_hook<ManagedSpace>,
+			&ManagedSpace::_dirtyHook
+		>
+	> _spaces;
+};
+
+static frg::manual_box<WritebackController> globalWriteback;
+
+static initgraph::Task initWriteback{&globalInitEngine, "generic.init-writeback",
+	initgraph::Requires{getFibersAvailableStage()},
+	[] {
+		globalWriteback.initialize();
+		globalWriteback->runFlushFiber();
+	}
+};
+
+size_t numDirtyPages() {
+	return globalWriteback->dirtyPages.load(std::memory_order_relaxed);
+}
+
+size_t numWritebackPages() {
+	return globalWriteback->writebackPages.load(std::memory_order_relaxed);
+}
+
 // --------------------------------------------------------
 // MemoryView.
 // --------------------------------------------------------
@@ -206,6 +388,10 @@ void MemoryView::fork(async::any_receiver<frg::tuple<Error, smarter::shared_ptr<
 coroutine<frg::expected<Error>> MemoryView::copyTo(uintptr_t offset,
 		const void *pointer, size_t size,
 		smarter::shared_ptr<WorkQueue> wq) {
+	// Only the kernel writes to read-only views (and it does not use copyTo()).
+	if(readOnly_)
+		co_return Error::illegalArgs;
+
 	struct Node {
 		MemoryView *view;
 		uintptr_t offset;
@@ -230,7 +416,7 @@ coroutine<frg::expected<Error>> MemoryView::copyTo(uintptr_t offset,
 				[&nd] {
 					auto fetchOffset = (nd.offset + nd.progress) & ~(kPageSize - 1);
 					return async::sequence(
-						async::transform(nd.view->fetchRange(fetchOffset, 0, nd.wq),
+						async::transform(nd.view->fetchRange(fetchOffset, fetchWrite, nd.wq),
 								[&nd] (frg::expected<Error, PhysicalRange> resultOrError) {
 							assert(resultOrError);
 							auto range = resultOrError.value();
@@ -341,6 +527,10 @@ MemoryView::touchRange(uintptr_t offset, size_t size,
 	co_return {};
 }
 
+coroutine<void> MemoryView::writeback(uintptr_t, size_t) {
+	co_return;
+}
+
 Error MemoryView::updateRange(ManageRequest, size_t, size_t) {
 	return Error::illegalObject;
 }
@@ -873,23 +1063,15 @@ void ManagedSpace::_progressManagement(ManageList &pending) {
 	// "Proper" priorization should probably be done in the userspace driver
 	// (we do not want to store per-page priorities here).
 
+	// Dirty pages are not written back immediately; see _isWritebackDue().
+	auto now = getClockNanos();
 	while(!_writebackList.empty() && !_managementQueue.empty()) {
-		auto page = _writebackList.front();
-		auto index = page->identity;
+		if(!_isWritebackDue(now))
+			break;
 
-		// Fuse the request with adjacent pages in the list.
-		ptrdiff_t count = 0;
-		while(!_writebackList.empty()) {
-			auto fuse_cache_page = _writebackList.front();
-			auto fuse_index = fuse_cache_page->identity;
-			auto fuse_managed_page = frg::container_of(fuse_cache_page, &ManagedPage::cachePage);
-			if(fuse_index != index + count)
-				break;
-			assert(fuse_managed_page->loadState == kStateWantWriteback);
-			fuse_managed_page->loadState = kStateWriteback;
-			count++;
-			_writebackList.pop_front();
-		}
+		auto run = _takeWritebackRun();
+		auto index = run.get<0>();
+		auto count = run.get<1>();
 		assert(count);
 
 		auto node = _managementQueue.pop_front();
@@ -924,6 +1106,65 @@ void ManagedSpace::_progressManagement(ManageList &pending) {
 	}
 }
 
+void ManagedSpace::_queueWriteback(ManagedPage *page, uint64_t dirtyTime) {
+	page->loadState = kStateWantWriteback;
+	page->dirtyTime = dirtyTime;
+	_writebackList.push_back(&page->cachePage);
+
+	if(!_numDirtyPages++)
+		globalWriteback->registerSpace(this);
+	globalWriteback->dirtyPages.fetch_add(1, std::memory_order_relaxed);
+}
+
+// Writeback is delayed until the oldest dirty page expires or until the
+// amount of outstanding pages requires background writeback.
+// This gives writers a chance to complete contiguous runs of pages.
+bool ManagedSpace::_isWritebackDue(uint64_t now) {
+	if(_writebackList.empty())
+		return false;
+	if(_numWritebackWaiters)
+		return true;
+	if(globalWriteback->needsBackgroundWriteback())
+		return true;
+
+	// Pages that are re-queued after kStateAnotherWriteback are not in dirtyTime order.
+	// For simplicity, we only check the front of the list.
+	auto page = frg::container_of(_writebackList.front(), &ManagedPage::cachePage);
+	return now - page->dirtyTime >= dirtyExpireNanos;
+}
+
+// Takes the longest contiguous run of dirty pages that contains the front
+// of the writeback list (i.e., the oldest dirty page).
+// Unlike the order of _writebackList, this does not depend on the order in which
+// pages are dirtied; hence, random writes to adjacent pages still yield long runs.
+frg::tuple<uint64_t, size_t> ManagedSpace::_takeWritebackRun() {
+	auto isDirty = [&] (uint64_t index) -> bool {
+		auto pit = pages.find(index);
+		return pit && pit->loadState == kStateWantWriteback;
+	};
+
+	auto index = _writebackList.front()->identity;
+	uint64_t first = index;
+	while(first > 0 && index - first + 1 < maxWritebackRun && isDirty(first - 1))
+		first--;
+	size_t count = index - first + 1;
+	while(count < maxWritebackRun && isDirty(first + count))
+		count++;
+
+	for(size_t i = 0; i < count; i++) {
+		auto pit = pages.find(first + i);
+		assert(pit);
+		assert(pit->loadState == kStateWantWriteback);
+		pit->loadState = kStateWriteback;
+		_writebackList.erase(_writebackList.iterator_to(&pit->cachePage));
+	}
+
+	_numDirtyPages -= count;
+	globalWriteback->dirtyPages.fetch_sub(count, std::memory_order_relaxed);
+	globalWriteback->writebackPages.fetch_add(count, std::memory_order_relaxed);
+	return frg::tuple<uint64_t, size_t>{first, count};
+}
+
 void ManagedSpace::_progressMonitors(MonitorList &pending) {
 	// TODO: Accelerate this by storing the monitors in a RB tree ordered by their progress.
 	auto progressNode = [&] (MonitorNode *node) -> bool {
@@ -1099,14 +1340,14 @@ Error BackingMemory::updateRange(ManageRequest type, size_t offset, size_t lengt
 				auto pit = _managed->pages.find(index);
 				assert(pit);
 
+				globalWriteback->writebackPages.fetch_sub(1, std::memory_order_relaxed);
 				if(pit->loadState == ManagedSpace::kStateWriteback) {
 					pit->loadState = ManagedSpace::kStatePresent;
 					if(!pit->lockCount)
 						globalReclaimer->addPage(&pit->cachePage);
 				}else{
 					assert(pit->loadState == ManagedSpace::kStateAnotherWriteback);
-					pit->loadState = ManagedSpace::kStateWantWriteback;
-					_managed->_writebackList.push_back(&pit->cachePage);
+					_managed->_queueWriteback(pit, pit->dirtyTime);
 				}
 			}
 		}
@@ -1119,6 +1360,9 @@ Error BackingMemory::updateRange(ManageRequest type, size_t offset, size_t lengt
 		node->event.raise();
 	}
 
+	if(type == ManageRequest::writeback)
+		_managed->_writebackEvent.raise();
+
 	return Error::success;
 }
 
@@ -1177,6 +1421,10 @@ frg::tuple<PhysicalAddr, CachingMode> FrontalMemory::peekRange(uintptr_t offset)
 
 coroutine<frg::expected<Error, PhysicalRange>>
 FrontalMemory::fetchRange(uintptr_t offset, FetchFlags flags, smarter::shared_ptr<WorkQueue>) {
+	// Balance the rate of writers with the rate of writeback.
+	if((flags & fetchWrite) && globalWriteback->needsThrottling())
+		co_await globalWriteback->throttle();
+
 	auto index = offset >> kPageShift;
 	auto misalign = offset & (kPageSize - 1);
 
@@ -1222,24 +1470,28 @@ FrontalMemory::fetchRange(uintptr_t offset, FetchFlags flags, smarter::shared_pt
 		}
 
 		// We have to take the slow-path, i.e., perform the fetch asynchronously.
-		if(pit->loadState == ManagedSpace::kStateMissing) {
-			pit->loadState = ManagedSpace::kStateWantInitialization;
-			_managed->_initializationList.push_back(&pit->cachePage);
+		// Perform readahead by also initializing the following pages (or the aligned
+		// window around the page). Pages are queued in ascending order such that
+		// _progressManagement() can fuse them into a single request.
+		size_t first = index;
+		size_t last = index + 1;
+		if(_managed->readahead) {
+			if(auto window = _managed->readaheadWindow; window) {
+				first = index & ~(window - 1);
+				last = first + window;
+			}else{
+				last = index + 4;
+			}
 		}
-
-		// Perform readahead.
-		if(_managed->readahead)
-			for(size_t i = 1; i < 4; ++i) {
-				if(!(index + i < _managed->numPages))
-					break;
-				auto [pit, wasInserted] = _managed->pages.find_or_insert(
-						index + i, _managed.get(), index + i);
-				assert(pit);
-				if(pit->loadState == ManagedSpace::kStateMissing) {
-					pit->loadState = ManagedSpace::kStateWantInitialization;
-					_managed->_initializationList.push_back(&pit->cachePage);
-				}
+		for(size_t i = first; i < frg::min(last, _managed->numPages); ++i) {
+			auto [pit, wasInserted] = _managed->pages.find_or_insert(
+					i, _managed.get(), i);
+			assert(pit);
+			if(pit->loadState == ManagedSpace::kStateMissing) {
+				pit->loadState = ManagedSpace::kStateWantInitialization;
+				_managed->_initializationList.push_back(&pit->cachePage);
 			}
+		}
 
 		_managed->_progressManagement(pendingManagement);
 
@@ -1285,21 +1537,21 @@ void FrontalMemory::markDirty(uintptr_t offset, size_t size) {
 		auto lock = frg::guard(&_managed->mutex);
 
 		// Put the pages into the dirty state.
+		auto now = getClockNanos();
 		for(size_t pg = 0; pg < size; pg += kPageSize) {
 			auto index = (offset + pg) >> kPageShift;
 			auto pit = _managed->pages.find(index);
 			assert(pit);
 			if(pit->loadState == ManagedSpace::kStatePresent) {
-				pit->loadState = ManagedSpace::kStateWantWriteback;
 				if(!pit->lockCount)
 					globalReclaimer->removePage(&pit->cachePage);
-				_managed->_writebackList.push_back(&pit->cachePage);
+				_managed->_queueWriteback(pit, now);
 			}else if(pit->loadState == ManagedSpace::kStateEvicting) {
-				pit->loadState = ManagedSpace::kStateWantWriteback;
 				assert(!pit->lockCount);
-				_managed->_writebackList.push_back(&pit->cachePage);
+				_managed->_queueWriteback(pit, now);
 			}else if(pit->loadState == ManagedSpace::kStateWriteback) {
 				pit->loadState = ManagedSpace::kStateAnotherWriteback;
+				pit->dirtyTime = now;
 			}else{
 				assert(pit->loadState == ManagedSpace::kStateWantWriteback
 						|| pit->loadState == ManagedSpace::kStateAnotherWriteback);
@@ -1312,6 +1564,57 @@ void FrontalMemory::markDirty(uintptr_t offset, size_t size) {
 	_managed->_deferredManagement.invoke();
 }
 
+coroutine<void> FrontalMemory::writeback(uintptr_t offset, size_t size) {
+	assert(!(offset % kPageSize));
+	assert(!(size % kPageSize));
+
+	// Called with the mutex held.
+	auto isClean = [&] () -> bool {
+		for(size_t pg = 0; pg < size; pg += kPageSize) {
+			auto pit = _managed->pages.find((offset + pg) >> kPageShift);
+			if(!pit)
+				continue;
+			if(pit->loadState == ManagedSpace::kStateWantWriteback
+					|| pit->loadState == ManagedSpace::kStateWriteback
+					|| pit->loadState == ManagedSpace::kStateAnotherWriteback)
+				return false;
+		}
+		return true;
+	};
+
+	{
+		auto irqLock = frg::guard(&irqMutex());
+		auto lock = frg::guard(&_managed->mutex);
+
+		if(isClean())
+			co_return;
+		_managed->_numWritebackWaiters++;
+	}
+
+	// Start writeback of pages that have not expired yet.
+	_managed->_deferredManagement.invoke();
+
+	bool stillWaiting = true;
+	while(stillWaiting) {
+		stillWaiting = co_await _managed->_writebackEvent.async_wait_if([&] () -> bool {
+			auto irqLock = frg::guard(&irqMutex());
+			auto lock = frg::guard(&_managed->mutex);
+
+			return !isClean();
+		});
+		// updateRange() raises the event from user space requests; leave its context.
+		co_await WorkQueue::generalQueue()->schedule();
+	}
+
+	{
+		auto irqLock = frg::guard(&irqMutex());
+		auto lock = frg::guard(&_managed->mutex);
+
+		assert(_managed->_numWritebackWaiters);
+		_managed->_numWritebackWaiters--;
+	}
+}
+
 size_t FrontalMemory::getLength() {
 	// Size is constant so we do not need to lock.
 	return _managed->numPages << kPageShift;
@@ -1426,12 +1729,35 @@ void IndirectMemory::markDirty(uintptr_t offset, size_t size) {
 			+ inSlotOffset, size);
 }
 
+coroutine<void> IndirectMemory::writeback(uintptr_t offset, size_t size) {
+	smarter::shared_ptr<MemoryView> memory;
+	uintptr_t memoryOffset;
+	{
+		auto irqLock = frg::guard(&irqMutex());
+		auto lock = frg::guard(&mutex_);
+
+		auto slot = offset >> 32;
+		auto inSlotOffset = offset & ((uintptr_t(1) << 32) - 1);
+		assert(slot < indirections_.size()); // TODO: Return Error::fault.
+		assert(indirections_[slot]); // TODO: Return Error::fault.
+		assert(inSlotOffset + size <= indirections_[slot]->size); // TODO: Return Error::fault.
+		memory = indirections_[slot]->memory;
+		memoryOffset = indirections_[slot]->offset + inSlotOffset;
+	}
+
+	co_await memory->writeback(memoryOffset, size);
+}
+
 size_t IndirectMemory::getLength() {
 	return indirections_.size() << 32;
 }
 
 Error IndirectMemory::setIndirection(size_t slot, smarter::shared_ptr<MemoryView> memory,
 		uintptr_t offset, size_t size) {
+	// IndirectMemory can be mapped writable, so it cannot contain read-only views.
+	if(memory->isReadOnly())
+		return Error::illegalArgs;
+
 	auto irqLock = frg::guard(&irqMutex());
 	auto lock = frg::guard(&mutex_);
 
@@ -0,0 +1,135 @@
+#include <compressed-module.hpp>
+#include <async/algorithm.hpp>
+#include <thor-internal/coroutine.hpp>
+#include <thor-internal/debug.hpp>
+#include <thor-internal/module.hpp>
+#include <thor-internal/physical.hpp>
+#include <thor-internal/work-queue.hpp>
+
+namespace thor {
+
+namespace {
+	constexpr bool logDecompression = false;
+
+	struct CompressedImage {
+		CompressedImage(const char *image, size_t size, const CompressedModuleHeader &header)
+		: header{header}, image{image}, size{size} {
+			chunkBuffer = static_cast<uint8_t *>(kernelAlloc->allocate(chunkSize()));
+		}
+
+		size_t chunkSize() {
+			return size_t{1} << header.chunkShift;
+		}
+
+		CompressedModuleHeader header;
+		const char *image;
+		size_t size;
+
+		// Buffer that a single chunk is decompressed into.
+		// As requests are handled one by one, a single buffer suffices.
+		uint8_t *chunkBuffer;
+	};
+
+	// Decompresses the given chunk into chunkBuffer. Returns the size of the chunk.
+	size_t decompressChunk(CompressedImage *image, size_t index) {
+		auto rawSize = frg::min(image->chunkSize(),
+				image->header.size - (index << image->header.chunkShift));
+
+		const uint8_t *data;
+		size_t length;
+		getCompressedChunk(image->image, index, &data, &length);
+		if(length == rawSize) {
+			memcpy(image->chunkBuffer, data, rawSize);
+		}else{
+			auto result = decompressLz4Block(data, length, image->chunkBuffer, rawSize);
+			if(result != static_cast<ptrdiff_t>(rawSize))
+				panicLogger() << "thor: Corrupted chunk " << index
+						<< " in compressed module" << frg::endlog;
+		}
+		return rawSize;
+	}
+
+	coroutine<void> handleCompressedModule(smarter::shared_ptr<MemoryView> backing,
+			CompressedImage *image) {
+		auto wq = WorkQueue::generalQueue()->take();
+		while(true) {
+			auto manageOutcome = co_await backing->submitManage();
+			auto error = manageOutcome.get<0>();
+			auto type = manageOutcome.get<1>();
+			auto offset = manageOutcome.get<2>();
+			auto size = manageOutcome.get<3>();
+			assert(error == Error::success);
+
+			if(type == ManageRequest::writeback) {
+				// The decompressed data can always be reproduced; dirty pages
+				// are kept in the page cache and need not be written anywhere.
+				backing->updateRange(ManageRequest::writeback, offset, size);
+				continue;
+			}
+			assert(type == ManageRequest::initialize);
+
+			if(logDecompression)
+				infoLogger() << "thor: Decompressing module range 0x" << frg::hex_fmt(offset)
+						<< ", size 0x" << frg::hex_fmt(size) << frg::endlog;
+
+			// Decompress all chunks that overlap the requested range.
+			auto end = frg::min(offset + size, static_cast<uintptr_t>(image->header.size));
+			auto progress = offset;
+			while(progress < end) {
+				auto index = progress >> image->header.chunkShift;
+				auto chunkStart = index << image->header.chunkShift;
+				auto chunkSize = decompressChunk(image, index);
+
+				auto chunk = frg::min(chunkStart + chunkSize, end) - progress;
+				auto copyOutcome = co_await backing->copyTo(progress,
+						image->chunkBuffer + (progress - chunkStart), chunk, wq);
+				assert(copyOutcome);
+				progress += chunk;
+			}
+
+			// Pages beyond the end of the file are already zero.
+			backing->updateRange(ManageRequest::initialize, offset, size);
+		}
+	}
+}
+
+smarter::shared_ptr<MemoryView> createCompressedModule(const char *data, size_t size,
+		PhysicalAddr physical, size_t *fileSize) {
+	CompressedModuleHeader header;
+	if(!parseCompressedModule(data, size, &header))
+		return nullptr;
+
+	// The initrd window is unmapped after boot. Data that is kept in place is accessed
+	// through the direct physical mapping (the caller maps these pages read-only and
+	// never frees them), everything else is copied to the kernel heap.
+	const char *imageData;
+	if(physical != PhysicalAddr(-1)) {
+		imageData = static_cast<const char *>(mapDirectPhysical(physical));
+	}else{
+		auto copy = static_cast<char *>(kernelAlloc->allocate(size));
+		memcpy(copy, data, size);
+		imageData = copy;
+	}
+
+	auto image = frg::construct<CompressedImage>(*kernelAlloc, imageData, size, header);
+	auto alignedSize = (header.size + (kPageSize - 1)) & ~size_t{kPageSize - 1};
+	if(!alignedSize)
+		alignedSize = kPageSize;
+
+	// Pages are decompressed on demand. Readahead covers entire chunks,
+	// such that a chunk is decompressed once rather than once per readahead window.
+	auto managed = smarter::allocate_shared<ManagedSpace>(*kernelAlloc, alignedSize, true);
+	managed->selfPtr = managed;
+	managed->readaheadWindow = image->chunkSize() >> kPageShift;
+	auto backing = smarter::allocate_shared<BackingMemory>(*kernelAlloc, managed);
+	auto frontal = smarter::allocate_shared<FrontalMemory>(*kernelAlloc, std::move(managed));
+	frontal->selfPtr = frontal;
+
+	async::detach_with_allocator(*kernelAlloc,
+			handleCompressedModule(std::move(backing), image));
+
+	*fileSize = header.size;
+	return frontal;
+}
+
+} // namespace thor
@@ -60,6 +60,14 @@ PhysicalAddr PhysicalChunkAllocator::allocate(size_t size, int addressBits) {
 	_freePages.store(currentFree - size / kPageSize, std::memory_order_relaxed);
 	_usedPages.store(currentUsed + size / kPageSize, std::memory_order_relaxed);
 
+	if(size == kPageSize && _donatedHead != static_cast<PhysicalAddr>(-1)
+			&& (addressBits >= 64 || _donatedHead < (PhysicalAddr{1} << addressBits))) {
+		auto physical = _donatedHead;
+		PageAccessor accessor{physical};
+		_donatedHead = *reinterpret_cast<PhysicalAddr *>(accessor.get());
+		return physical;
+	}
+
 	// TODO: This could be solved better.
 	int target = 0;
 	while(size > (size_t(kPageSize) << target))
@@ -92,6 +100,12 @@ void PhysicalChunkAllocator::free(PhysicalAddr address, size_t size) {
 	while(size > (size_t(kPageSize) << target))
 		target++;
 
+	auto currentFree = _freePages.load(std::memory_order_relaxed);
+	auto currentUsed = _usedPages.load(std::memory_order_relaxed);
+	assert(currentUsed > size / kPageSize);
+	_freePages.store(currentFree + size / kPageSize, std::memory_order_relaxed);
+	_usedPages.store(currentUsed - size / kPageSize, std::memory_order_relaxed);
+
 	for(int i = 0; i < _numRegions; i++) {
 		if(address < _allRegions[i].physicalBase)
 			continue;
@@ -99,15 +113,46 @@ void PhysicalChunkAllocator::free(PhysicalAddr address, size_t size) {
 			continue;
 
 		_allRegions[i].buddyAccessor.free(address, target);
-		auto currentFree = _freePages.load(std::memory_order_relaxed);
-		auto currentUsed = _usedPages.load(std::memory_order_relaxed);
-		assert(currentUsed > size / kPageSize);
-		_freePages.store(currentFree + size / kPageSize, std::memory_order_relaxed);
-		_usedPages.store(currentUsed - size / kPageSize, std::memory_order_relaxed);
 		return;
 	}
 
-	assert(!"Physical page is not part of any region");
+	// Pages outside of all regions can only come from the donated list.
+	assert(_numDonatedPages && size == kPageSize && "Physical page is not part of any region");
+	PageAccessor accessor{address};
+	*reinterpret_cast<PhysicalAddr *>(accessor.get()) = _donatedHead;
+	_donatedHead = address;
+}
+
+void PhysicalChunkAllocator::donate(PhysicalAddr address, size_t size) {
+	assert(!(address & (kPageSize - 1)));
+	assert(!(size & (kPageSize - 1)));
+
+#ifdef THOR_KASAN
+	// We cannot allocate KASAN shadow for the direct physical mapping at runtime.
+	(void)address;
+	(void)size;
+	return;
+#else
+	// Eir only includes regions in the direct physical mapping.
+	for(size_t offset = 0; offset < size; offset += kPageSize)
+		KernelPageSpace::global().mapSingle4k(directPhysicalOffset() + address + offset,
+				address + offset, page_access::write, CachingMode::null);
+
+	auto irq_lock = frg::guard(&irqMutex());
+	auto lock = frg::guard(&_mutex);
+
+	for(size_t offset = 0; offset < size; offset += kPageSize) {
+		PageAccessor accessor{address + offset};
+		*reinterpret_cast<PhysicalAddr *>(accessor.get()) = _donatedHead;
+		_donatedHead = address + offset;
+	}
+	_numDonatedPages += size / kPageSize;
+
+	auto currentTotal = _totalPages.load(std::memory_order_relaxed);
+	auto currentFree = _freePages.load(std::memory_order_relaxed);
+	_totalPages.store(currentTotal + size / kPageSize, std::memory_order_relaxed);
+	_freePages.store(currentFree + size / kPageSize, std::memory_order_relaxed);
+#endif
 }
 
 PhysicalWindow::PhysicalWindow(PhysicalAddr physical, size_t size, CachingMode caching)
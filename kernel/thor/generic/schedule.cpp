@@ -1,8 +1,11 @@
 #include <assert.h>
 
+#include <frg/utility.hpp>
+
 #include <thor-internal/arch-generic/cpu.hpp>
 #include <thor-internal/arch-generic/ints.hpp>
 #include <thor-internal/cpu-data.hpp>
+#include <thor-internal/cpuidle.hpp>
 #include <thor-internal/debug.hpp>
 #include <thor-internal/ostrace.hpp>
 #include <thor-internal/schedule.hpp>
@@ -22,6 +25,42 @@ namespace {
 	// Minimum length of a preemption time slice in ns.
 	constexpr int64_t sliceGranularity = 10'000'000;
 
+	// Time slice of round-robin entities in ns.
+	constexpr uint64_t rrSliceGranularity = 10'000'000;
+
+	// Limits of the deadline class parameters in ns.
+	constexpr uint64_t minDeadlineRuntime = 10'000;
+	constexpr uint64_t maxDeadlinePeriod = uint64_t{1} << 32;
+
+	// Bandwidth is stored as a fixed point fraction of a CPU.
+	constexpr int bandwidthShift = 20;
+	// The deadline class can reserve at most 95% of each CPU.
+	constexpr uint64_t maxBandwidthPerCpu = (uint64_t{95} << bandwidthShift) / 100;
+
+	// Protects totalDeadlineBandwidth and ScheduleEntity::dlBandwidth.
+	frg::ticket_spinlock admissionMutex;
+	uint64_t totalDeadlineBandwidth = 0;
+
+	int classRank(SchedulePolicy policy) {
+		switch(policy) {
+		case SchedulePolicy::fair: return 0;
+		case SchedulePolicy::fifo:
+		case SchedulePolicy::roundRobin: return 1;
+		case SchedulePolicy::deadline: return 2;
+		}
+		__builtin_unreachable();
+	}
+
+	LatencyClass latencyClass(SchedulePolicy policy) {
+		switch(policy) {
+		case SchedulePolicy::fair: return LatencyClass::fair;
+		case SchedulePolicy::fifo:
+		case SchedulePolicy::roundRobin: return LatencyClass::realtime;
+		case SchedulePolicy::deadline: return LatencyClass::deadline;
+		}
+		__builtin_unreachable();
+	}
+
 	struct IdleTask final : ScheduleEntity {
 		IdleTask()
 		: ScheduleEntity{ScheduleType::idle} { }
@@ -30,13 +69,14 @@ namespace {
 			runOnStack([] (Continuation) {
 				if(logIdle)
 					infoLogger() << "System is idle" << frg::endlog;
-				suspendSelf();
-				__builtin_trap();
+				runIdleLoop();
 			}, getCpuData()->idleStack.base());
 			__builtin_trap();
 		}
 
 		void handlePreemption(IrqImageAccessor image) override {
+			interruptIdle();
+
 			auto *scheduler = &localScheduler.get();
 			scheduler->update();
 			if(scheduler->maybeReschedule()) {
@@ -56,22 +96,39 @@ namespace {
 int ScheduleEntity::orderPriority(const ScheduleEntity *a, const ScheduleEntity *b) {
 	assert(a->type() == ScheduleType::regular);
 	assert(b->type() == ScheduleType::regular);
-	return b->priority - a->priority; // Prefer larger priority.
+	// Prefer higher classes.
+	if(auto rank = classRank(b->params.policy) - classRank(a->params.policy); rank)
+		return rank;
+	// Prefer earlier deadlines.
+	if(a->params.policy == SchedulePolicy::deadline) {
+		if(a->dlDeadline != b->dlDeadline)
+			return a->dlDeadline < b->dlDeadline ? -1 : 1;
+		return 0;
+	}
+	return b->params.priority - a->params.priority; // Prefer larger priority.
 }
 
 bool ScheduleEntity::scheduleBefore(const ScheduleEntity *a, const ScheduleEntity *b) {
 	assert(a->type() == ScheduleType::regular);
 	assert(b->type() == ScheduleType::regular);
+	if(a->params.policy != SchedulePolicy::fair)
+		return a->rtSequence < b->rtSequence; // First come, first served.
 	return a->baseUnfairness - a->refProgress
 			> b->baseUnfairness - b->refProgress; // Prefer greater unfairness.
 }
 
 ScheduleEntity::ScheduleEntity(ScheduleType type)
-: type_{type}, state{ScheduleState::null}, priority{0}, _refClock{0}, _runTime{0},
+: type_{type}, state{ScheduleState::null}, _refClock{0}, _runTime{0},
 		refProgress{0}, baseUnfairness{0} { }
 
 ScheduleEntity::~ScheduleEntity() {
 	assert(state == ScheduleState::null);
+
+	if(dlBandwidth) {
+		auto irqLock = frg::guard(&irqMutex());
+		auto lock = frg::guard(&admissionMutex);
+		totalDeadlineBandwidth -= dlBandwidth;
+	}
 }
 
 void Scheduler::associate(ScheduleEntity *entity, Scheduler *scheduler) {
@@ -79,6 +136,9 @@ void Scheduler::associate(ScheduleEntity *entity, Scheduler *scheduler) {
 
 //	infoLogger() << "associate " << entity << frg::endlog;
 	assert(entity->state == ScheduleState::null);
+
+	auto irqLock = frg::guard(&irqMutex());
+	auto lock = frg::guard(&entity->_associationMutex);
 	entity->_scheduler = scheduler;
 	entity->state = ScheduleState::attached;
 }
@@ -94,22 +154,125 @@ void Scheduler::unassociate(ScheduleEntity *entity) {
 
 	assert(entity->state == ScheduleState::attached);
 	assert(entity != self->_current);
+
+	auto lock = frg::guard(&entity->_associationMutex);
+
+	// Apply pending parameter changes now since the entity leaves the scheduler.
+	// The entity is not in the wait queue, so this is safe on any CPU.
+	{
+		auto schedulerLock = frg::guard(&self->_mutex);
+		if(entity->paramsChanged) {
+			self->_changedList.erase(self->_changedList.iterator_to(entity));
+			entity->paramsChanged = false;
+			self->_applyParameters(entity, entity->requestedParams);
+		}
+	}
+
 	entity->_scheduler = nullptr;
 	entity->state = ScheduleState::null;
 }
 
 void Scheduler::setPriority(ScheduleEntity *entity, int priority) {
+	auto params = getParameters(entity);
+	if(params.policy != SchedulePolicy::fair)
+		return;
+	params.priority = priority;
+	auto error = setParameters(entity, params);
+	assert(error == Error::success);
+}
+
+Error Scheduler::setParameters(ScheduleEntity *entity, ScheduleParameters params) {
 	assert(entity->type() == ScheduleType::regular);
 
-	auto scheduleLock = frg::guard(&irqMutex());
+	uint64_t bandwidth = 0;
+	switch(params.policy) {
+	case SchedulePolicy::fair:
+		break;
+	case SchedulePolicy::fifo:
+	case SchedulePolicy::roundRobin:
+		if(params.priority < 1 || params.priority > 99)
+			return Error::illegalArgs;
+		break;
+	case SchedulePolicy::deadline:
+		if(params.runtime < minDeadlineRuntime
+				|| params.runtime > params.deadline
+				|| params.deadline > params.period
+				|| params.period > maxDeadlinePeriod)
+			return Error::illegalArgs;
+		bandwidth = (params.runtime << bandwidthShift) / params.period;
+		break;
+	default:
+		return Error::illegalArgs;
+	}
+	if(params.policy != SchedulePolicy::deadline) {
+		params.runtime = 0;
+		params.deadline = 0;
+		params.period = 0;
+	}
+
+	auto irqLock = frg::guard(&irqMutex());
 
+	// Admission control: the deadline class may not reserve more than a fixed share
+	// of the system's CPUs. Like Linux, we only check the global bandwidth;
+	// this does not guarantee that all deadlines are met if entities are badly placed.
+	{
+		auto lock = frg::guard(&admissionMutex);
+		auto total = totalDeadlineBandwidth - entity->dlBandwidth + bandwidth;
+		if(bandwidth > entity->dlBandwidth && total > getCpuCount() * maxBandwidthPerCpu)
+			return Error::illegalState;
+		totalDeadlineBandwidth = total;
+		entity->dlBandwidth = bandwidth;
+	}
+
+	auto lock = frg::guard(&entity->_associationMutex);
 	auto self = entity->_scheduler;
-	assert(self);
+	if(!self) {
+		entity->params = params;
+		return Error::success;
+	}
 
-	// Otherwise, we would have to remove-reinsert into the queue.
-	assert(entity == self->_current);
+	{
+		auto schedulerLock = frg::guard(&self->_mutex);
+		entity->requestedParams = params;
+		if(!entity->paramsChanged) {
+			entity->paramsChanged = true;
+			self->_changedList.push_back(entity);
+		}
+	}
 
-	entity->priority = priority;
+	// Like resume(), make sure that the scheduler applies the change soon.
+	if(self == &localScheduler.get()) {
+		self->_mustCallPreemption = true;
+	}else{
+		wakeCpu(self->_cpuContext);
+	}
+	return Error::success;
+}
+
+ScheduleParameters Scheduler::getParameters(ScheduleEntity *entity) {
+	assert(entity->type() == ScheduleType::regular);
+
+	auto irqLock = frg::guard(&irqMutex());
+	auto lock = frg::guard(&entity->_associationMutex);
+	auto self = entity->_scheduler;
+	if(!self)
+		return entity->params;
+
+	auto schedulerLock = frg::guard(&self->_mutex);
+	if(entity->paramsChanged)
+		return entity->requestedParams;
+	return entity->params;
+}
+
+void Scheduler::getLatencyHistogram(LatencyClass cls, uint64_t *buckets) {
+	for(size_t b = 0; b < numLatencyBuckets; b++)
+		buckets[b] = 0;
+	for(size_t i = 0; i < getCpuCount(); i++) {
+		auto self = &localScheduler.getFor(i);
+		for(size_t b = 0; b < numLatencyBuckets; b++)
+			buckets[b] += __atomic_load_n(&self->_latencyHistogram[static_cast<size_t>(cls)][b],
+					__ATOMIC_RELAXED);
+	}
 }
 
 void Scheduler::resume(ScheduleEntity *entity) {
@@ -127,9 +290,11 @@ void Scheduler::resume(ScheduleEntity *entity) {
 		auto lock = frg::guard(&self->_mutex);
 
 		entity->state = ScheduleState::pending;
+		entity->wakeClock = getClockNanos();
 
 		wasEmpty = self->_pendingList.empty();
 		self->_pendingList.push_back(entity);
+		self->_idleHint.store(false, std::memory_order_relaxed);
 	}
 
 	if(wasEmpty) {
@@ -147,7 +312,7 @@ void Scheduler::resume(ScheduleEntity *entity) {
 			//       to ensure that a higher priority thread gets to run as soon as possible.
 			self->_mustCallPreemption = true;
 		}else{
-			sendPingIpi(self->_cpuContext);
+			wakeCpu(self->_cpuContext);
 		}
 	}
 }
@@ -242,7 +407,41 @@ void Scheduler::updateQueue() {
 		auto lock = frg::guard(&_mutex);
 
 		pendingSnapshot.splice(pendingSnapshot.end(), _pendingList);
+
+		// Apply parameter changes. Entities in the wait queue need to be re-inserted
+		// since their position depends on the parameters.
+		while(!_changedList.empty()) {
+			auto entity = _changedList.pop_front();
+			assert(entity->paramsChanged);
+			entity->paramsChanged = false;
+
+			// Throttled entities are not in the wait queue; _applyParameters() unthrottles them.
+			bool queued = entity->state == ScheduleState::active && entity != _current;
+			if(queued) {
+				if(entity->dlThrottled) {
+					_throttledList.erase(_throttledList.iterator_to(entity));
+					_numWaiting++;
+				}else{
+					_waitQueue.remove(entity);
+				}
+			}
+			_applyParameters(entity, entity->requestedParams);
+			if(queued)
+				_waitQueue.push(entity);
+		}
 	}
+
+	// Return throttled entities whose next period has started to the wait queue.
+	for(auto it = _throttledList.begin(); it != _throttledList.end(); ) {
+		auto entity = *it;
+		++it;
+		if(!_replenishDeadline(entity))
+			continue;
+		_throttledList.erase(_throttledList.iterator_to(entity));
+		_waitQueue.push(entity);
+		_numWaiting++;
+	}
+
 	while(!pendingSnapshot.empty()) {
 		auto entity = pendingSnapshot.pop_front();
 		assert(entity->state == ScheduleState::pending);
@@ -252,6 +451,33 @@ void Scheduler::updateQueue() {
 		entity->_refClock = _refClock;
 		entity->state = ScheduleState::active;
 
+		// Woken entities queue behind real-time entities of the same priority.
+		entity->rtSequence = _rtSequence++;
+
+		// Entities that blocked after exhausting their budget stay throttled.
+		if(entity->dlThrottled && !_replenishDeadline(entity)) {
+			_throttledList.push_back(entity);
+			// Make sure that the CPU notices the replenishment.
+			auto armed = getPreemptionDeadline();
+			if(!armed || entity->dlReplenishClock < *armed) {
+				ostrace::emit(ostEvtArmPreemption);
+				setPreemptionDeadline(entity->dlReplenishClock);
+			}
+			continue;
+		}
+
+		// CBS wakeup rule: keep the current deadline only if the remaining budget
+		// does not exceed the reserved bandwidth until that deadline.
+		if(entity->params.policy == SchedulePolicy::deadline) {
+			if(_refClock >= entity->dlDeadline
+					|| static_cast<__int128>(entity->dlBudget) * entity->params.period
+						> static_cast<__int128>(entity->dlDeadline - _refClock)
+							* entity->params.runtime) {
+				entity->dlDeadline = _refClock + entity->params.deadline;
+				entity->dlBudget = entity->params.runtime;
+			}
+		}
+
 		_waitQueue.push(entity);
 		_numWaiting++;
 	}
@@ -262,6 +488,10 @@ bool Scheduler::maybeReschedule() {
 	assert(_current);
 
 	auto wantToSchedule = [this] () -> bool {
+		// Throttled entities always give up the CPU (even if that makes it idle).
+		if(_current->type() == ScheduleType::regular && _current->dlThrottled)
+			return true;
+
 		// If there are no waiters, we keep the current entity.
 		// Otherwise, if the current entity is not active anymore, we always switch.
 		if(_waitQueue.empty())
@@ -272,24 +502,34 @@ bool Scheduler::maybeReschedule() {
 		assert(_current->type() == ScheduleType::regular);
 		assert(_current->state == ScheduleState::active);
 
-		// Switch based on entity priority.
+		// Switch based on entity class, priority and deadline.
 		if(auto po = ScheduleEntity::orderPriority(_current, _waitQueue.top()); po > 0) {
 			return true;
 		}else if(po < 0) {
 			return false;
 		}
 
-		// Switch based on unfairness.
-		auto diff = _liveUnfairness(_current)
-				+ (static_cast<Progress>(sliceGranularity) << progressShift)
-				- _liveUnfairness(_waitQueue.top());
-		return diff < 0;
+		switch(_current->params.policy) {
+		case SchedulePolicy::fair: {
+			// Switch based on unfairness.
+			auto diff = _liveUnfairness(_current)
+					+ (static_cast<Progress>(sliceGranularity) << progressShift)
+					- _liveUnfairness(_waitQueue.top());
+			return diff < 0;
+		}
+		case SchedulePolicy::roundRobin:
+			return _refClock - _sliceClock >= rrSliceGranularity;
+		case SchedulePolicy::fifo:
+		case SchedulePolicy::deadline:
+			return false;
+		}
+		__builtin_unreachable();
 	};
 
 	if(!wantToSchedule())
 		return false;
 
-	_unschedule();
+	_unschedule(false);
 	_schedule();
 	return true;
 }
@@ -298,7 +538,7 @@ void Scheduler::forceReschedule() {
 	assert(!intsAreEnabled());
 
 	if(_current)
-		_unschedule();
+		_unschedule(true);
 	_schedule();
 }
 
@@ -311,8 +551,17 @@ void Scheduler::forceReschedule() {
 	_sliceClock = _refClock;
 	_mustCallPreemption = false;
 
-	if(!getPreemptionDeadline())
+	_idleHint.store(_current->type() == ScheduleType::idle, std::memory_order_relaxed);
+	if(_current->type() == ScheduleType::idle) {
+		// Stop the preemption tick while we are idle; resume() wakes us up if necessary.
+		// Throttled entities need a tick at their replenishment time, though.
+		auto replenishment = _nextReplenishment();
+		if(replenishment)
+			ostrace::emit(ostEvtArmPreemption);
+		setPreemptionDeadline(replenishment);
+	}else if(!getPreemptionDeadline()) {
 		_updatePreemption();
+	}
 
 	currentRunnable()->invoke();
 }
@@ -329,7 +578,7 @@ ScheduleEntity *Scheduler::currentRunnable() {
 	return _current;
 }
 
-void Scheduler::_unschedule() {
+void Scheduler::_unschedule(bool yield) {
 	assert(_current);
 
 	// Decrease the unfairness at the end of the time slice.
@@ -337,8 +586,18 @@ void Scheduler::_unschedule() {
 
 	if(_current->type() == ScheduleType::regular
 			|| _current->state == ScheduleState::active) {
-		_waitQueue.push(_current);
-		_numWaiting++;
+		// Real-time entities that are preempted by higher priorities stay at the head
+		// of their priority. They move to the tail if they yield or their slice expires.
+		if(yield || (_current->params.policy == SchedulePolicy::roundRobin
+				&& _refClock - _sliceClock >= rrSliceGranularity))
+			_current->rtSequence = _rtSequence++;
+
+		if(_current->dlThrottled) {
+			_throttledList.push_back(_current);
+		}else{
+			_waitQueue.push(_current);
+			_numWaiting++;
+		}
 	}
 
 	_current = nullptr;
@@ -363,17 +622,18 @@ void Scheduler::_schedule() {
 	assert(entity->state == ScheduleState::active);
 	_updateWaitingEntity(entity);
 	_updateEntityStats(entity);
+	_recordLatency(entity);
 
 	if(logScheduling) {
 //		infoLogger() << "System progress: " << progressToNanos(_systemProgress) / (1000 * 1000)
 //				<< " ms" << frg::endlog;
-		infoLogger() << "Running entity with priority: " << entity->priority
+		infoLogger() << "Running entity with priority: " << entity->params.priority
 				<< ", unfairness: " << progressToNanos(_liveUnfairness(entity)) / (1000 * 1000)
 				<< " ms, runtime: " << _liveRuntime(entity) / (1000 * 1000)
 				<< " ms (" << (_numWaiting + 1) << " active threads)" << frg::endlog;
 	}
 	if(logNextBest && !_waitQueue.empty())
-		infoLogger() << "    Next entity has priority: " << _waitQueue.top()->priority
+		infoLogger() << "    Next entity has priority: " << _waitQueue.top()->params.priority
 				<< ", unfairness: " << progressToNanos(_liveUnfairness(_waitQueue.top())) / (1000 * 1000)
 				<< " ms, runtime: " << _liveRuntime(_waitQueue.top()) / (1000 * 1000)
 				<< " ms" << frg::endlog;
@@ -381,30 +641,43 @@ void Scheduler::_schedule() {
 	_scheduled = entity;
 }
 
-// Returns true if preemption should be done immediately.
 void Scheduler::_updatePreemption() {
 	if(disablePreemption)
 		return;
 
-	// Disable preemption if there are no other threads.
-	if(_waitQueue.empty())
-		return;
+	// Throttled entities need to be returned to the wait queue in time.
+	auto deadline = _nextReplenishment();
+	auto armAt = [&] (uint64_t clock) {
+		if(!deadline || clock < *deadline)
+			deadline = clock;
+	};
 
-	// If there was no current entity, we would have rescheduled.
 	assert(_current);
-	assert(_current->type() == ScheduleType::regular);
-	assert(_current->state == ScheduleState::active);
+	if(_current->type() == ScheduleType::regular) {
+		assert(_current->state == ScheduleState::active);
 
-	if(auto po = ScheduleEntity::orderPriority(_current, _waitQueue.top()); po < 0) {
-		// Disable preemption if we have higher priority.
-		return;
-	}else{
-		// If there was an entity with higher priority, we would have rescheduled.
-		assert(!po);
+		if(_current->params.policy == SchedulePolicy::deadline) {
+			// Deadline entities are throttled once their budget is exhausted,
+			// even if no other entity is waiting.
+			armAt(getClockNanos() + frg::max(_current->dlBudget, int64_t{0}));
+		}else if(!_waitQueue.empty()) {
+			// If there was an entity with higher priority, we would have rescheduled.
+			auto po = ScheduleEntity::orderPriority(_current, _waitQueue.top());
+			assert(po <= 0);
+
+			// Disable preemption if we have higher priority.
+			// FIFO entities are not preempted by entities of the same priority.
+			if(!po && _current->params.policy == SchedulePolicy::fair)
+				armAt(getClockNanos() + sliceGranularity);
+			if(!po && _current->params.policy == SchedulePolicy::roundRobin)
+				armAt(_sliceClock + rrSliceGranularity);
+		}
 	}
 
-	ostrace::emit(ostEvtArmPreemption);
-	setPreemptionDeadline(getClockNanos() + sliceGranularity);
+	if(deadline) {
+		ostrace::emit(ostEvtArmPreemption);
+		setPreemptionDeadline(*deadline);
+	}
 }
 
 void Scheduler::_updateCurrentEntity() {
@@ -420,6 +693,9 @@ void Scheduler::_updateCurrentEntity() {
 				<< " us (" << _numWaiting << " waiting threads)" << frg::endlog;
 	_current->baseUnfairness -= _numWaiting * delta_progress;
 	_current->refProgress = _systemProgress;
+
+	// Keep the runtime (and the deadline budget) up to date.
+	_updateEntityStats(_current);
 }
 
 void Scheduler::_updateWaitingEntity(ScheduleEntity *entity) {
@@ -442,11 +718,89 @@ void Scheduler::_updateEntityStats(ScheduleEntity *entity) {
 	assert(entity->state == ScheduleState::active
 			|| entity == _current);
 
-	if(entity == _current)
-		entity->_runTime += _refClock - entity->_refClock;
+	if(entity == _current) {
+		auto delta = _refClock - entity->_refClock;
+		entity->_runTime += delta;
+		if(entity->params.policy == SchedulePolicy::deadline) {
+			entity->dlBudget -= delta;
+			if(entity->dlBudget <= 0 && !entity->dlThrottled)
+				_throttleDeadline(entity);
+		}
+	}
 	entity->_refClock = _refClock;
 }
 
+void Scheduler::_applyParameters(ScheduleEntity *entity, const ScheduleParameters &params) {
+	bool wasDeadline = entity->params.policy == SchedulePolicy::deadline;
+	entity->params = params;
+
+	// Entities start with a fresh CBS period; they keep it if only the priority changes.
+	// Throttled entities also start a fresh period, i.e., they are no longer throttled.
+	if(params.policy == SchedulePolicy::deadline) {
+		if(!wasDeadline || entity->dlThrottled
+				|| entity->dlBudget > static_cast<int64_t>(params.runtime)) {
+			entity->dlDeadline = _refClock + params.deadline;
+			entity->dlBudget = params.runtime;
+		}
+	}else{
+		entity->dlDeadline = 0;
+		entity->dlBudget = 0;
+	}
+	entity->dlThrottled = false;
+}
+
+// Hard CBS: once the budget is exhausted, the entity is throttled until the start of
+// its next period. This bounds the CPU time of deadline entities to their reserved
+// bandwidth, such that they cannot starve real-time and fair entities.
+void Scheduler::_throttleDeadline(ScheduleEntity *entity) {
+	assert(entity->params.policy == SchedulePolicy::deadline);
+	entity->dlThrottled = true;
+	entity->dlReplenishClock = entity->dlDeadline
+			- entity->params.deadline + entity->params.period;
+}
+
+// Recharges the budget of a throttled entity once its next period has started.
+// Overruns are charged to the following periods; if the budget is still exhausted,
+// the entity stays throttled for another period.
+// Returns true if the entity is no longer throttled.
+bool Scheduler::_replenishDeadline(ScheduleEntity *entity) {
+	assert(entity->dlThrottled);
+	while(entity->dlReplenishClock <= _refClock) {
+		entity->dlDeadline = entity->dlReplenishClock + entity->params.deadline;
+		entity->dlBudget += entity->params.runtime;
+		if(entity->dlBudget > 0) {
+			entity->dlThrottled = false;
+			return true;
+		}
+		entity->dlReplenishClock += entity->params.period;
+	}
+	return false;
+}
+
+frg::optional<uint64_t> Scheduler::_nextReplenishment() {
+	frg::optional<uint64_t> clock;
+	for(auto entity : _throttledList) {
+		if(!clock || entity->dlReplenishClock < *clock)
+			clock = entity->dlReplenishClock;
+	}
+	return clock;
+}
+
+void Scheduler::_recordLatency(ScheduleEntity *entity) {
+	if(!entity->wakeClock)
+		return;
+	auto now = getClockNanos();
+	auto latency = now > entity->wakeClock ? (now - entity->wakeClock) / 1000 : 0;
+	entity->wakeClock = 0;
+
+	size_t bucket = 0;
+	if(latency)
+		bucket = frg::min(size_t(64 - __builtin_clzll(latency)), numLatencyBuckets - 1);
+
+	auto &counter = _latencyHistogram[static_cast<size_t>(latencyClass(entity->params.policy))][bucket];
+	__atomic_store_n(&counter, counter + 1, __ATOMIC_RELAXED);
+}
+
 namespace {
 
 template<typename ImageAccessor>
@@ -134,6 +134,17 @@ namespace initrd {
 		size_t index;
 	};
 
+	// PT_READ_ENTRIES_BATCH encodes entries like struct linux_dirent64
+	// (see protocols::fs::DirentHeader); we cannot include <dirent.h> here.
+	constexpr size_t direntNameOffset = 19;
+	constexpr uint8_t direntTypeDirectory = 4; // DT_DIR
+	constexpr uint8_t direntTypeRegular = 8; // DT_REG
+	constexpr size_t maxEntriesBatchSize = 64 * 1024;
+
+	size_t direntLength(const MfsDirectory::Link &entry) {
+		return (direntNameOffset + entry.name.size() + 1 + 7) & ~size_t(7);
+	}
+
 	// ----------------------------------------------------
 	// initrd file handling.
 	// ----------------------------------------------------
@@ -279,6 +290,67 @@ namespace initrd {
 					// TODO: improve error handling here.
 					assert(respError == Error::success);
 				}
+			}else if(req.req_type() == managarm::fs::CntReqType::PT_READ_ENTRIES_BATCH) {
+				// Determine how many entries fit into the response.
+				size_t maxSize = frg::min(static_cast<size_t>(frg::max(req.size(), 0)),
+						maxEntriesBatchSize);
+				size_t end = file->index;
+				size_t size = 0;
+				while(end < file->node->numEntries()) {
+					auto length = direntLength(file->node->getEntry(end));
+					if(size + length > maxSize)
+						break;
+					size += length;
+					end++;
+				}
+
+				managarm::fs::SvrResponse<KernelAlloc> resp(*kernelAlloc);
+				if(file->index == file->node->numEntries()) {
+					resp.set_error(managarm::fs::Errors::END_OF_FILE);
+				}else if(end == file->index) {
+					resp.set_error(managarm::fs::Errors::ILLEGAL_ARGUMENT);
+				}else{
+					resp.set_error(managarm::fs::Errors::SUCCESS);
+				}
+
+				frg::string<KernelAlloc> ser(*kernelAlloc);
+				resp.SerializeToString(&ser);
+				frg::unique_memory<KernelAlloc> respBuffer{*kernelAlloc, ser.size()};
+				memcpy(respBuffer.data(), ser.data(), ser.size());
+				auto respError = co_await SendBufferSender{conversation, std::move(respBuffer)};
+				// TODO: improve error handling here.
+				assert(respError == Error::success);
+
+				if(end == file->index)
+					continue;
+
+				frg::unique_memory<KernelAlloc> entriesBuffer{*kernelAlloc, size};
+				auto p = reinterpret_cast<char *>(entriesBuffer.data());
+				memset(p, 0, size);
+				for(; file->index < end; file->index++) {
+					auto entry = file->node->getEntry(file->index);
+					uint64_t ino = entry.node->inode;
+					int64_t off = file->index + 1;
+					uint16_t reclen = direntLength(entry);
+					uint8_t type;
+					if(entry.node->type == MfsType::directory) {
+						type = direntTypeDirectory;
+					}else{
+						assert(entry.node->type == MfsType::regular);
+						type = direntTypeRegular;
+					}
+
+					memcpy(p, &ino, 8);
+					memcpy(p + 8, &off, 8);
+					memcpy(p + 16, &reclen, 2);
+					memcpy(p + 18, &type, 1);
+					memcpy(p + direntNameOffset, entry.name.data(), entry.name.size());
+					p += reclen;
+				}
+
+				auto entriesError = co_await SendBufferSender{conversation, std::move(entriesBuffer)};
+				// TODO: improve error handling here.
+				assert(entriesError == Error::success);
 			}else{
 				urgentLogger() << "thor: Illegal request type " << (int32_t)req.req_type()
 						<< " for kernel provided directory file" << frg::endlog;
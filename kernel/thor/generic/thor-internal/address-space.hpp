@@ -528,6 +528,12 @@ public:
 	coroutine<frg::expected<Error>>
 	synchronize(VirtualAddr address, size_t length);
 
+	// Maps all mappings of this space into target (which should be empty) at the same addresses.
+	// Views that support fork() (i.e., copy-on-write memory) are forked,
+	// all other views are shared between both spaces.
+	coroutine<frg::expected<Error>>
+	fork(VirtualSpace *target);
+
 	coroutine<frg::expected<Error>>
 	unmap(VirtualAddr address, size_t length);
 
@@ -596,7 +602,8 @@ public:
 		auto offset = address - mapping->address;
 		auto [futexSpace, futexOffset] = FRG_TRY(mapping->view->resolveGlobalFutex(
 				mapping->viewOffset + offset));
-		return FutexIdentity{reinterpret_cast<uintptr_t>(futexSpace.get()), offset};
+		// Must match GlobalFutex::getIdentity().
+		return FutexIdentity{reinterpret_cast<uintptr_t>(futexSpace.get()), futexOffset};
 	}
 
 	coroutine<frg::expected<Error, GlobalFutex>> grabGlobalFutex(uintptr_t address,
@@ -621,6 +628,19 @@ public:
 		co_return GlobalFutex{std::move(futexSpace), futexOffset, futexPhysical};
 	}
 
+	// Private futexes are only shared between threads of this address space.
+	// They are identified by their virtual address; hence, wakeups do not need
+	// to resolve the futex through the memory view.
+	FutexIdentity privateFutexIdentity(uintptr_t address) {
+		return {reinterpret_cast<uintptr_t>(this), address};
+	}
+
+	coroutine<frg::expected<Error, PrivateFutex>> grabPrivateFutex(uintptr_t address,
+			smarter::shared_ptr<WorkQueue> wq) {
+		auto futex = FRG_CO_TRY(co_await grabGlobalFutex(address, std::move(wq)));
+		co_return PrivateFutex{std::move(futex), privateFutexIdentity(address)};
+	}
+
 	// ----------------------------------------------------------------------------------
 
 	smarter::borrowed_ptr<VirtualSpace> selfPtr;
@@ -177,4 +177,21 @@ void forkExecutor(F functor, Executor *executor) {
 // Fill buffer with entropy obtained from the CPU.
 Error getEntropyFromCpu(void *buffer, size_t size);
 
+
+struct CpuData;
+
+// Describes which resources a CPU shares with other CPUs.
+// CPUs with the same ID share the respective resource.
+struct CpuTopology {
+	// Physical core (i.e., CPUs with the same coreId are SMT siblings).
+	uint32_t coreId;
+	// Last level cache.
+	uint32_t llcId;
+	uint32_t numaNode;
+};
+
+// Can be called for any CPU that has been booted.
+// The result can change during boot (e.g., once firmware tables are parsed).
+CpuTopology getCpuTopology(CpuData *cpu);
+
 } // namespace thor
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <atomic>
+
 #include <thor-internal/arch/ints.hpp>
 
 namespace thor {
@@ -10,4 +12,28 @@ void sendPingIpi(CpuData *dstData);
 void sendShootdownIpi();
 void sendSelfCallIpi();
 
+// Hardware idle state (e.g., HLT or an MWAIT C-state on x86).
+struct IdleState {
+	const char *name;
+	// Worst-case time until the CPU resumes execution, in ns.
+	uint64_t exitLatency;
+	// Minimal idle duration for which entering the state pays off, in ns.
+	uint64_t targetResidency;
+	// Whether stores to the monitored word wake up the CPU (without an IPI).
+	bool monitorsStores;
+};
+
+// Idle states are sorted from the shallowest to the deepest state.
+// There is always at least one state.
+size_t getNumIdleStates();
+const IdleState &getIdleState(size_t index);
+
+// Puts the CPU into the given idle state until an IRQ arrives or, if the state
+// monitorsStores, until *word no longer equals value. Must be called with IRQs disabled.
+// Pending IRQs are handled before this function returns (with IRQs disabled again).
+void enterIdleState(size_t index, std::atomic<uint32_t> *word, uint32_t value);
+
+// Calls fn with IRQs disabled such that IRQs see the idle domain.
+[[noreturn]] void runInIdleDomain(void (*fn)());
+
 } // namespace thor
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <frg/optional.hpp>
+#include <thor-internal/util.hpp>
 
 namespace thor {
 
@@ -13,6 +14,9 @@ void setTimerDeadline(frg::optional<uint64_t> deadline);
 bool haveTimer();
 // Get the raw timestamp in preemption timer ticks.
 uint64_t getRawTimestampCounter();
+// Returns the fraction that converts getRawTimestampCounter() into getClockNanos()
+// if user space can read the same counter (on all CPUs). Otherwise, returns null_opt.
+frg::optional<FreqFraction> getUserClockFraction();
 
 // Called by the architecture-specific code. Handles timer deadline
 // expiry.
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <thor-internal/memory-view.hpp>
+
+namespace thor {
+
+// Returns the read-only page that allows user space to read the monotone clock
+// without entering the kernel (see HelClockPage).
+smarter::shared_ptr<MemoryView> getClockPageMemory();
+
+} // namespace thor
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace thor {
+
+struct CpuData;
+
+// The governor's idle states: state 0 is polling, state i > 0 is hardware idle state i - 1
+// (see getIdleState()).
+constexpr size_t maxCpuIdleStates = 8;
+
+struct CpuIdleStatistics {
+	// Number of times that each state was entered.
+	uint64_t entries[maxCpuIdleStates];
+	// Time spent in each state, in ns.
+	uint64_t residency[maxCpuIdleStates];
+	// Number of wakeups with a known cause (wakeCpu() or timer expiration)
+	// and the sum of their latencies in ns.
+	uint64_t wakeups;
+	uint64_t wakeupLatency;
+};
+
+// Runs the idle loop of the current CPU. Called by the scheduler's idle task.
+// Picks an idle state based on the next timer deadline and recent idle durations.
+[[noreturn]] void runIdleLoop();
+
+// Must be called by IRQs that interrupt the idle loop, before they reschedule.
+void interruptIdle();
+
+// Makes sure that the given CPU notices changes to its scheduler soon.
+// This avoids the IPI if the CPU polls or monitors its wakeup word.
+void wakeCpu(CpuData *cpu);
+
+size_t getNumCpuIdleStates();
+const char *getCpuIdleStateName(size_t index);
+CpuIdleStatistics getCpuIdleStatistics(size_t cpu);
+
+} // namespace thor
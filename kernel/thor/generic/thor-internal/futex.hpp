@@ -2,7 +2,6 @@
 
 #include <async/cancellation.hpp>
 #include <frg/functional.hpp>
-#include <frg/hash_map.hpp>
 #include <frg/list.hpp>
 #include <frg/spinlock.hpp>
 
@@ -55,13 +54,18 @@ concept Futex = requires(F f) {
 };
 
 struct FutexRealm {
+	// Matches all waiters in wake().
+	static constexpr uint32_t allBits = ~uint32_t{0};
+
 private:
+	struct Bucket;
+
 	// Represents a single waiter.
 	struct Node {
 		friend struct FutexRealm;
 
-		Node(FutexRealm *realm, FutexIdentity id)
-		: realm_{realm}, id_{id}, cobs_{this} { }
+		Node(FutexRealm *realm, FutexIdentity id, uint32_t bitset)
+		: realm_{realm}, id_{id}, bitset_{bitset}, cobs_{this} { }
 
 	protected:
 		virtual void complete() = 0;
@@ -72,23 +76,23 @@ private:
 		void cancel_() {
 			{
 				auto irqLock = frg::guard(&irqMutex());
-				auto lock = frg::guard(&realm_->_mutex);
-
-				if(!result_) {
-					auto sit = realm_->_slots.get(id_);
-					assert(sit);			
-
-					// Invariant: If the slot exists then its queue is not empty.
-					assert(!sit->queue.empty());
-
-					auto nit = sit->queue.iterator_to(this);
-					sit->queue.erase(nit);
-					result_ = Error::cancelled;
 
-					if(sit->queue.empty())
-						realm_->_slots.remove(id_);
-				}else{
-					assert(!queueHook_.in_list);
+				while(true) {
+					auto bucket = bucket_.load(std::memory_order_relaxed);
+					auto lock = frg::guard(&bucket->mutex);
+					// requeue() might have moved the node to a different bucket in the meantime.
+					// It changes bucket_ while holding the lock of the old bucket.
+					if(bucket_.load(std::memory_order_relaxed) != bucket)
+						continue;
+
+					if(!result_) {
+						auto nit = bucket->queue.iterator_to(this);
+						bucket->queue.erase(nit);
+						result_ = Error::cancelled;
+					}else{
+						assert(!queueHook_.in_list);
+					}
+					break;
 				}
 			}
 
@@ -96,40 +100,68 @@ private:
 		}
 
 		FutexRealm *realm_;
+		// Protected by the lock of bucket_.
 		FutexIdentity id_;
+		uint32_t bitset_;
+		// Bucket that the node is queued in. Only changed by requeue().
+		std::atomic<Bucket *> bucket_{nullptr};
 		frg::optional<Error> result_; // Set after completion.
 		async::cancellation_observer<frg::bound_mem_fn<&Node::cancel_>> cobs_;
 		frg::default_list_hook<Node> queueHook_;
 	};
 
-	struct Slot {
-		frg::intrusive_list<
+	using NodeList = frg::intrusive_list<
+		Node,
+		frg::locate_member<
 			Node,
-			frg::locate_member<
-				Node,
-				frg::default_list_hook<Node>,
-				&Node::queueHook_
-			>
-		> queue;
+			frg::default_list_hook<Node>,
+			&Node::queueHook_
+		>
+	>;
+
+	// Waiters of all futexes that hash to the same bucket share a queue.
+	// This avoids allocations in the wait path and contention between unrelated futexes.
+	struct Bucket {
+		frg::ticket_spinlock mutex;
+		NodeList queue;
 	};
 
-public:
-	FutexRealm()
-	: _slots{FutexIdentity::Hash{}, *kernelAlloc} { }
+	static constexpr size_t numBuckets = 256;
+
+	Bucket *bucketOf_(FutexIdentity id) {
+		return &_buckets[FutexIdentity::Hash{}(id) % numBuckets];
+	}
+
+	// Removes a node from its queue and completes it (or lets cancel_() complete it).
+	// Must be called with the lock of the node's bucket held.
+	static void wakeNode_(Bucket *bucket, Node *node, NodeList &pending) {
+		assert(!node->result_);
+		bucket->queue.erase(bucket->queue.iterator_to(node));
 
-	bool empty() {
-		return _slots.empty();
+		node->result_ = Error::success;
+		if(node->cobs_.try_reset())
+			pending.push_back(node);
 	}
 
+	static void completePending_(NodeList &pending) {
+		while(!pending.empty()) {
+			auto node = pending.pop_front();
+			node->complete();
+		}
+	}
+
+public:
+	FutexRealm() = default;
+
 	// ----------------------------------------------------------------------------------
 	// wait().
 	// ----------------------------------------------------------------------------------
 
 	template<Futex F, typename R>
 	struct WaitOperation final : private Node {
-		WaitOperation(FutexRealm *self, F f, unsigned int expected,
+		WaitOperation(FutexRealm *self, F f, unsigned int expected, uint32_t bitset,
 				async::cancellation_token ct, R receiver)
-		: Node{self, f.getIdentity()}, f_{std::move(f)}, expected_{expected}, ct_{ct},
+		: Node{self, f.getIdentity(), bitset}, f_{std::move(f)}, expected_{expected}, ct_{ct},
 				receiver_{std::move(receiver)} { }
 
 		WaitOperation(const WaitOperation &) = delete;
@@ -143,27 +175,26 @@ public:
 			F f = std::move(f_);
 
 			auto fastPath = [&] {
+				auto bucket = realm_->bucketOf_(id_);
+
 				auto irqLock = frg::guard(&irqMutex());
-				auto lock = frg::guard(&realm_->_mutex);
+				auto lock = frg::guard(&bucket->mutex);
 
 				if(f.read() != expected_) {
 					result_ = Error::futexRace;
 					return true;
 				}
 
+				// cancel_() can run as soon as try_set() succeeds. It needs bucket_ to find
+				// the lock that we hold; it only sees the node once we push it below.
+				bucket_.store(bucket, std::memory_order_relaxed);
 				if(!cobs_.try_set(ct_)) {
 					result_ = Error::cancelled;
 					return true;
 				}
 
-				auto sit = realm_->_slots.get(id_);
-				if(!sit) {
-					realm_->_slots.insert(id_, Slot());
-					sit = realm_->_slots.get(id_);
-				}
-
 				assert(!queueHook_.in_list);
-				sit->queue.push_back(this);
+				bucket->queue.push_back(this);
 				return false;
 			}(); // Immediately invoked.
 
@@ -194,7 +225,7 @@ public:
 
 		template<typename R>
 		WaitOperation<F, R> connect(R receiver) {
-			return {self, std::move(f), expected, ct, std::move(receiver)};
+			return {self, std::move(f), expected, bitset, ct, std::move(receiver)};
 		}
 
 		async::sender_awaiter<WaitSender> operator co_await() {
@@ -204,70 +235,117 @@ public:
 		FutexRealm *self;
 		F f;
 		unsigned int expected;
+		uint32_t bitset;
 		async::cancellation_token ct;
 	};
 
+	// Waits until the futex is woken, unless its value differs from expected.
+	// Only wake() calls whose bitset intersects the given bitset wake the waiter.
 	template<Futex F>
-	WaitSender<F> wait(F f, unsigned int expected, async::cancellation_token ct = {}) {
-		return {this, std::move(f), expected, ct};
+	WaitSender<F> wait(F f, unsigned int expected, async::cancellation_token ct = {},
+			uint32_t bitset = allBits) {
+		assert(bitset);
+		return {this, std::move(f), expected, bitset, ct};
 	}
 
 	// ----------------------------------------------------------------------------------
 
-	void wake(FutexIdentity id) {
-		frg::intrusive_list<
-			Node,
-			frg::locate_member<
-				Node,
-				frg::default_list_hook<Node>,
-				&Node::queueHook_
-			>
-		> pending;
+	// Wakes up to count waiters (in FIFO order). Returns the number of woken waiters.
+	size_t wake(FutexIdentity id, size_t count = SIZE_MAX, uint32_t bitset = allBits) {
+		NodeList pending;
+		size_t woken = 0;
 		{
+			auto bucket = bucketOf_(id);
+
 			auto irqLock = frg::guard(&irqMutex());
-			auto lock = frg::guard(&_mutex);
-
-			auto sit = _slots.get(id);
-			if(!sit)
-				return;
-			// Invariant: If the slot exists then its queue is not empty.
-			assert(!sit->queue.empty());
-
-			// TODO: Enable users to only wake a certain number of waiters.
-			while(!sit->queue.empty()) {
-				auto node = sit->queue.front();
-				assert(!node->result_);
-				sit->queue.pop_front();
-
-				node->result_ = Error::success;
-				if(node->cobs_.try_reset()) {
-					pending.push_back(node);
-				}
+			auto lock = frg::guard(&bucket->mutex);
+
+			auto it = bucket->queue.begin();
+			while(it != bucket->queue.end() && woken < count) {
+				auto node = *it;
+				++it;
+				if(node->id_ != id || !(node->bitset_ & bitset))
+					continue;
+				wakeNode_(bucket, node, pending);
+				woken++;
 			}
-
-			if(sit->queue.empty())
-				_slots.remove(id);
 		}
 
-		while(!pending.empty()) {
-			auto node = pending.pop_front();
-			node->complete();
+		completePending_(pending);
+		return woken;
+	}
+
+	// Wakes up to wakeCount waiters of the futex f and moves up to requeueCount of the
+	// remaining waiters to the futex identified by to (without waking them).
+	// If expected is given, fails with Error::futexRace unless f has the expected value.
+	// Returns the number of woken and requeued waiters.
+	template<Futex F>
+	frg::expected<Error, size_t> requeue(F f, FutexIdentity to,
+			frg::optional<unsigned int> expected, size_t wakeCount, size_t requeueCount) {
+		auto from = f.getIdentity();
+		auto srcBucket = bucketOf_(from);
+		auto dstBucket = bucketOf_(to);
+
+		// Requeueing to the same futex would visit the requeued waiters again.
+		if(to == from)
+			requeueCount = 0;
+
+		NodeList pending;
+		// Empty if the futex does not have the expected value.
+		frg::optional<size_t> affected;
+		{
+			auto irqLock = frg::guard(&irqMutex());
+
+			// Lock both buckets in a consistent order to avoid deadlocks.
+			auto firstBucket = frg::min(srcBucket, dstBucket);
+			auto secondBucket = frg::max(srcBucket, dstBucket);
+			firstBucket->mutex.lock();
+			if(secondBucket != firstBucket)
+				secondBucket->mutex.lock();
+
+			affected = [&] () -> frg::optional<size_t> {
+				if(expected && f.read() != *expected)
+					return frg::null_opt;
+
+				size_t woken = 0;
+				size_t requeued = 0;
+				auto it = srcBucket->queue.begin();
+				while(it != srcBucket->queue.end()
+						&& (woken < wakeCount || requeued < requeueCount)) {
+					auto node = *it;
+					++it;
+					if(node->id_ != from)
+						continue;
+
+					if(woken < wakeCount) {
+						wakeNode_(srcBucket, node, pending);
+						woken++;
+						continue;
+					}
+
+					srcBucket->queue.erase(srcBucket->queue.iterator_to(node));
+					node->id_ = to;
+					node->bucket_.store(dstBucket, std::memory_order_relaxed);
+					dstBucket->queue.push_back(node);
+					requeued++;
+				}
+				return woken + requeued;
+			}(); // Immediately invoked.
+
+			if(secondBucket != firstBucket)
+				secondBucket->mutex.unlock();
+			firstBucket->mutex.unlock();
 		}
+
+		f.retire();
+		completePending_(pending);
+		if(!affected)
+			return Error::futexRace;
+		return *affected;
 	}
 
 private:
-	using Mutex = frg::ticket_spinlock;
-
-	// TODO: use a scalable hash table with fine-grained locks to
-	// improve the scalability of the futex algorithm.
-	Mutex _mutex;
-
-	frg::hash_map<
-		FutexIdentity,
-		Slot,
-		FutexIdentity::Hash,
-		KernelAlloc
-	> _slots;
+	Bucket _buckets[numBuckets];
 };
 
 } // namespace thor
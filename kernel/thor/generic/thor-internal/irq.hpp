@@ -1,5 +1,7 @@
 #pragma once
 
+#include <atomic>
+
 #include <async/recurring-event.hpp>
 #include <frg/expected.hpp>
 #include <frg/list.hpp>
@@ -105,6 +107,8 @@ struct IrqSink {
 	}
 
 	// This method is called with sinkMutex() held.
+	// Only raises that return IrqStatus::indefinite advance the sequence number;
+	// raises that are acked or nacked synchronously are invisible to user space.
 	virtual IrqStatus raise() = 0;
 
 	virtual void dumpHardwareState();
@@ -187,6 +191,19 @@ public:
 	// This function is called from IrqSlot::raise().
 	void raise();
 
+	// Number of times that the IRQ was raised on the given CPU.
+	uint64_t raiseCount(size_t cpu);
+
+	// Number of raises that woke up user space (as opposed to raises
+	// that were handled or rejected by kernlets).
+	uint64_t wakeupCount();
+
+	// Called by sinks from raise() (i.e., with the pin's lock held).
+	void countWakeup();
+
+	// Routes the IRQ to the given CPU (if the interrupt controller supports that).
+	virtual Error setAffinity(size_t cpu);
+
 private:
 	void _acknowledge();
 	void _nack();
@@ -218,6 +235,10 @@ private:
 	frg::string<KernelAlloc> _name;
 	// Hash of the IRQ name. Mostly useful when extracting entropy from IRQs.
 	uint32_t _hash;
+	// Index into the per-CPU IRQ counters (or -1 if there are too many pins).
+	int _statisticsIndex;
+	// Protected by _mutex for writing but read without locks.
+	std::atomic<uint64_t> _numWakeups{0};
 
 	// Must be protected against IRQs.
 	frg::ticket_spinlock _mutex;
@@ -258,6 +279,21 @@ private:
 	> _sinkList;
 };
 
+// Returns the pins that IRQ statistics are recorded for (e.g., for /proc/interrupts).
+size_t getNumRegisteredIrqPins();
+IrqPin *getRegisteredIrqPin(size_t index);
+
+struct MsiPin;
+
+// Represents a device that sends MSIs (e.g., a PCI function).
+struct MsiDevice {
+	// Writes the message of the MSI to the device's MSI(-X) configuration.
+	virtual void setupMsi(MsiPin *msi, size_t index) = 0;
+
+protected:
+	~MsiDevice() = default;
+};
+
 struct MsiPin : IrqPin {
 	MsiPin(frg::string<KernelAlloc> name)
 	: IrqPin{std::move(name)} { }
@@ -265,8 +301,25 @@ struct MsiPin : IrqPin {
 	virtual uint64_t getMessageAddress() = 0;
 	virtual uint32_t getMessageData() = 0;
 
+	// Programs the MSI into the device. The device is reprogrammed
+	// whenever the affinity of the MSI changes.
+	void attachDevice(MsiDevice *device, size_t index);
+
+	Error setAffinity(size_t cpu) override;
+
 protected:
+	// Changes the CPU that the message is delivered to.
+	// Afterwards, getMessageAddress() and getMessageData() return the new message.
+	virtual Error retarget(size_t cpu) = 0;
+
 	~MsiPin() = default;
+
+private:
+	// Protects the message against concurrent retargeting.
+	frg::ticket_spinlock _deviceMutex;
+
+	MsiDevice *_device = nullptr;
+	size_t _deviceIndex = 0;
 };
 
 // ----------------------------------------------------------------------------
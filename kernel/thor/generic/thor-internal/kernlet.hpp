@@ -52,7 +52,10 @@ struct BoundKernlet {
 	void setupMemoryViewBinding(size_t index, void *p);
 	void setupBitsetEventBinding(size_t index, smarter::shared_ptr<BitsetEvent> event);
 
-	int invokeIrqAutomation();
+	// Returns 1 if the kernlet handled the IRQ, 2 if the IRQ was not raised by the device
+	// and 0 if the IRQ needs to be handled by user space.
+	// triggeredEvents is set if the kernlet triggered events (i.e., woke up user space).
+	int invokeIrqAutomation(bool &triggeredEvents);
 
 private:
 	smarter::shared_ptr<KernletObject> _object;
@@ -66,6 +66,7 @@ private:
 	std::atomic<CpuData *> _assignedCpu{nullptr};
 
 	// Protected by the LbNode that currently owns the node.
+	// Null while the control block is moved between nodes.
 	LbNode *node_{nullptr};
 
 	// Protected by the LbNode that currently owns the node.
@@ -81,6 +82,10 @@ private:
 
 	// Protected by mutex_;
 	frg::vector<uint8_t, KernelAlloc> affinityMask_;
+
+	// Time of the last wake-affine migration (see LoadBalancer::placeWakee()).
+	// Protected by the thread's mutex.
+	uint64_t lastWakeMove_{0};
 };
 
 // Per-CPU load balancing data structure.
@@ -105,6 +110,12 @@ struct LbNode {
 	// Equal to totalLoad before load balancing but updated during load balancing.
 	// Protected by mutex during main phase of load balancing.
 	uint64_t currentLoad{0};
+
+	// Topology of cpu (see CpuTopology). Written by cpu during load balancing
+	// (since NUMA information becomes available late during boot) and read racily.
+	std::atomic<uint32_t> coreId{0};
+	std::atomic<uint32_t> llcId{0};
+	std::atomic<uint32_t> numaNode{0};
 };
 
 extern PerCpu<LbNode> lbNode;
@@ -125,12 +136,20 @@ struct LoadBalancer {
 	// The thread is detached from the load balancer when the weak reference goes out of scope.
 	void connect(Thread *thread, CpuData *cpu);
 
+	// Wake-affine placement: called when the current CPU wakes up a blocked thread.
+	// Must be called with the thread's mutex held.
+	// Returns the CPU that the thread should be resumed on or nullptr to keep its CPU.
+	// The load balancer's bookkeeping follows during the next load balancing round.
+	CpuData *placeWakee(Thread *thread);
+
 private:
 	coroutine<void> run_(CpuData *cpu);
 
 	// Move tasks from srcNode to dstNode to balance load.
 	// newLoad: newLoad at dstNode after balancing.
-	void balanceBetween_(LbNode *srcNode, LbNode *dstNode, uint64_t &newLoad, uint64_t idealLoad);
+	// margin: srcNode must exceed idealLoad by margin before we move tasks.
+	void balanceBetween_(LbNode *srcNode, LbNode *dstNode, uint64_t &newLoad, uint64_t idealLoad,
+			uint64_t margin);
 
 	async::barrier barrier_;
 };
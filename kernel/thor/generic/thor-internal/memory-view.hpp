@@ -170,6 +170,8 @@ public:
 
 using FetchFlags = uint32_t;
 inline constexpr FetchFlags fetchDisallowBacking = 1;
+// The page is fetched in order to write to it; writers may be throttled.
+inline constexpr FetchFlags fetchWrite = 2;
 
 struct RangeToEvict {
 	uintptr_t offset;
@@ -316,6 +318,10 @@ public:
 	// Marks a range of pages as dirty.
 	virtual void markDirty(uintptr_t offset, size_t size) = 0;
 
+	// Writes back the dirty pages of a range (without waiting for them to expire)
+	// and waits until the writeback completes. Does nothing for views without writeback.
+	virtual coroutine<void> writeback(uintptr_t offset, size_t size);
+
 	virtual void submitManage(ManageNode *handle);
 
 	// Called (e.g. by user space) to update a range after loading or writeback.
@@ -324,6 +330,16 @@ public:
 	virtual Error setIndirection(size_t slot, smarter::shared_ptr<MemoryView> view,
 			uintptr_t offset, size_t size);
 
+	// Views that are written by the kernel and shared with user space (e.g., the clock page)
+	// are read-only: they cannot be mapped or protected as writable.
+	bool isReadOnly() {
+		return readOnly_;
+	}
+
+	void setReadOnly() {
+		readOnly_ = true;
+	}
+
 	// ----------------------------------------------------------------------------------
 	// Memory eviction.
 	// ----------------------------------------------------------------------------------
@@ -540,8 +556,14 @@ public:
 		R receiver_;
 	};
 
+	friend async::sender_awaiter<ForkSender, ForkSender::value_type>
+	operator co_await(ForkSender sender) {
+		return {sender};
+	}
+
 private:
 	EvictionQueue *associatedEvictionQueue_;
+	bool readOnly_ = false;
 };
 
 struct SliceRange {
@@ -607,7 +629,7 @@ inline auto copyBetweenViews(MemoryView *destView, uintptr_t destOffset,
 					auto destFetchOffset = (nd.destOffset + nd.progress) & ~(kPageSize - 1);
 					auto srcFetchOffset = (nd.srcOffset + nd.progress) & ~(kPageSize - 1);
 					return async::sequence(
-						async::transform(nd.destView->fetchRange(destFetchOffset, 0, nd.wq),
+						async::transform(nd.destView->fetchRange(destFetchOffset, fetchWrite, nd.wq),
 								[&nd] (frg::expected<Error, PhysicalRange> resultOrError) {
 							assert(resultOrError);
 							auto range = resultOrError.value();
@@ -714,6 +736,7 @@ struct ImmediateMemory final : MemoryView, GlobalFutexSpace {
 			fetchRange(uintptr_t offset, FetchFlags flags,
 			smarter::shared_ptr<WorkQueue> wq) override;
 	void markDirty(uintptr_t offset, size_t size) override;
+	coroutine<void> writeback(uintptr_t offset, size_t size) override;
 
 	coroutine<frg::expected<Error, PhysicalAddr>> takeGlobalFutex(uintptr_t offset,
 			smarter::shared_ptr<WorkQueue> wq) override;
@@ -809,6 +832,7 @@ struct AllocatedMemory final : MemoryView, GlobalFutexSpace {
 			fetchRange(uintptr_t offset, FetchFlags flags,
 			smarter::shared_ptr<WorkQueue> wq) override;
 	void markDirty(uintptr_t offset, size_t size) override;
+	coroutine<void> writeback(uintptr_t offset, size_t size) override;
 
 	coroutine<frg::expected<Error, PhysicalAddr>> takeGlobalFutex(uintptr_t offset,
 			smarter::shared_ptr<WorkQueue> wq) override;
@@ -850,6 +874,8 @@ struct ManagedSpace : CacheBundle {
 		PhysicalAddr physical = PhysicalAddr(-1);
 		LoadState loadState = kStateMissing;
 		unsigned int lockCount = 0;
+		// Time at which the page entered kStateWantWriteback or kStateAnotherWriteback.
+		uint64_t dirtyTime = 0;
 		CachePage cachePage;
 	};
 
@@ -890,6 +916,11 @@ struct ManagedSpace : CacheBundle {
 	void _progressManagement(ManageList &pending);
 	void _progressMonitors(MonitorList &pending);
 
+	// Helpers for writeback. Called with the mutex held.
+	void _queueWriteback(ManagedPage *page, uint64_t dirtyTime);
+	bool _isWritebackDue(uint64_t now);
+	frg::tuple<uint64_t, size_t> _takeWritebackRun();
+
 	smarter::borrowed_ptr<ManagedSpace> selfPtr;
 
 	frg::ticket_spinlock mutex;
@@ -898,6 +929,9 @@ struct ManagedSpace : CacheBundle {
 
 	size_t numPages;
 	bool readahead;
+	// If non-zero, readahead initializes the aligned window of this many pages
+	// (a power of two) instead of the pages that follow the faulting page.
+	size_t readaheadWindow = 0;
 
 	EvictionQueue _evictQueue;
 
@@ -919,6 +953,19 @@ struct ManagedSpace : CacheBundle {
 		>
 	> _writebackList;
 
+	// Number of pages in kStateWantWriteback.
+	size_t _numDirtyPages = 0;
+
+	// Number of explicit writeback requests (see FrontalMemory::writeback()).
+	// While this is non-zero, dirty pages are written back immediately.
+	size_t _numWritebackWaiters = 0;
+	// Raised whenever writeback of some pages completes.
+	async::recurring_event _writebackEvent;
+
+	// Links ManagedSpaces that have dirty pages; owned by the WritebackController.
+	frg::default_list_hook<ManagedSpace> _dirtyHook;
+	bool _dirtyRegistered = false;
+
 	ManageList _managementQueue;
 	MonitorList _monitorQueue;
 
@@ -971,6 +1018,7 @@ public:
 			fetchRange(uintptr_t offset, FetchFlags flags,
 			smarter::shared_ptr<WorkQueue> wq) override;
 	void markDirty(uintptr_t offset, size_t size) override;
+	coroutine<void> writeback(uintptr_t offset, size_t size) override;
 
 	coroutine<frg::expected<Error, PhysicalAddr>> takeGlobalFutex(uintptr_t offset,
 			smarter::shared_ptr<WorkQueue> wq) override;
@@ -1000,6 +1048,7 @@ struct IndirectMemory final : MemoryView {
 			fetchRange(uintptr_t offset, FetchFlags flags,
 			smarter::shared_ptr<WorkQueue> wq) override;
 	void markDirty(uintptr_t offset, size_t size) override;
+	coroutine<void> writeback(uintptr_t offset, size_t size) override;
 
 	Error setIndirection(size_t slot, smarter::shared_ptr<MemoryView> memory,
 			uintptr_t offset, size_t size) override;
@@ -1073,6 +1122,7 @@ public:
 			fetchRange(uintptr_t offset, FetchFlags flags,
 			smarter::shared_ptr<WorkQueue> wq) override;
 	void markDirty(uintptr_t offset, size_t size) override;
+	coroutine<void> writeback(uintptr_t offset, size_t size) override;
 
 	coroutine<frg::expected<Error, PhysicalAddr>> takeGlobalFutex(uintptr_t offset,
 			smarter::shared_ptr<WorkQueue> wq) override;
@@ -1152,6 +1202,29 @@ private:
 	PhysicalAddr physical_ = PhysicalAddr(-1);
 };
 
+// A GlobalFutex that is identified by an address space-local identity
+// (see VirtualSpace::grabPrivateFutex()).
+struct PrivateFutex {
+	FutexIdentity getIdentity() {
+		return identity;
+	}
+
+	unsigned int read() {
+		return futex.read();
+	}
+
+	void retire() {
+		futex.retire();
+	}
+
+	GlobalFutex futex;
+	FutexIdentity identity;
+};
+
 FutexRealm *getGlobalFutexRealm();
 
+// Number of pages of ManagedSpaces that are dirty or currently under writeback.
+size_t numDirtyPages();
+size_t numWritebackPages();
+
 } // namespace thor
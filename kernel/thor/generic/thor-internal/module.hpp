@@ -1,5 +1,7 @@
 #pragma once
 
+#include <atomic>
+
 #include <frg/string.hpp>
 #include <frg/vector.hpp>
 #include <thor-internal/address-space.hpp>
@@ -15,9 +17,15 @@ enum class MfsType {
 
 struct MfsNode {
 	MfsNode(MfsType type)
-	: type{type} { }
+	: type{type}, inode{_nextInode.fetch_add(1, std::memory_order_relaxed)} { }
 
 	const MfsType type;
+
+	// Unique inode number of the node (starting at 1, since 0 is not a valid inode number).
+	const uint64_t inode;
+
+private:
+	static inline std::atomic<uint64_t> _nextInode{1};
 };
 
 struct MfsDirectory : MfsNode {
@@ -77,4 +85,12 @@ extern MfsDirectory *mfsRoot;
 
 MfsNode *resolveModule(frg::string_view path);
 
+// Returns a MemoryView that decompresses a module (see compressed-module.hpp) on demand.
+// Returns nullptr if the data is not a compressed module.
+// If physical is not PhysicalAddr(-1), the compressed data is used in place and the
+// caller needs to keep the pages that contain it and map them into the direct physical
+// mapping before calling this function. Otherwise, the data is copied.
+smarter::shared_ptr<MemoryView> createCompressedModule(const char *data, size_t size,
+		PhysicalAddr physical, size_t *fileSize);
+
 } // namespace thor
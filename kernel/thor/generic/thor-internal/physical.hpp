@@ -125,6 +125,10 @@ public:
 	PhysicalAddr allocate(size_t size, int addressBits = 64);
 	void free(PhysicalAddr address, size_t size);
 
+	// Adds memory that is not part of any region (e.g., unused parts of the initrd).
+	// Donated pages are kept on a free list and only used for single-page allocations.
+	void donate(PhysicalAddr address, size_t size);
+
 	size_t numTotalPages() {
 		return _totalPages.load(std::memory_order_relaxed);
 	}
@@ -147,6 +151,10 @@ private:
 	Region _allRegions[8];
 	int _numRegions = 0;
 
+	// Singly linked list of donated pages. The link is stored in the pages themselves.
+	PhysicalAddr _donatedHead = static_cast<PhysicalAddr>(-1);
+	size_t _numDonatedPages = 0;
+
 	std::atomic<size_t> _totalPages{0};
 	std::atomic<size_t> _usedPages{0};
 	std::atomic<size_t> _freePages{0};
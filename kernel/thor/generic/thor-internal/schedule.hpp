@@ -3,10 +3,14 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include <atomic>
+
 #include <frg/list.hpp>
+#include <frg/optional.hpp>
 #include <frg/pairing_heap.hpp>
 #include <frg/spinlock.hpp>
 #include <thor-internal/cpu-data.hpp>
+#include <thor-internal/error.hpp>
 #include <thor-internal/arch-generic/cpu.hpp>
 
 namespace thor {
@@ -20,6 +24,42 @@ enum class ScheduleType {
 	regular
 };
 
+// Scheduling classes of regular entities. Deadline entities always take precedence
+// over real-time entities, which in turn take precedence over fair entities.
+enum class SchedulePolicy {
+	fair,
+	// Real-time FIFO: runs until it blocks, yields or is preempted by a higher priority.
+	fifo,
+	// Like fifo but round-robin among entities of the same priority.
+	roundRobin,
+	// Earliest deadline first; each entity is served by a constant bandwidth server.
+	// Entities that exhaust their budget are throttled until their next period.
+	deadline
+};
+
+struct ScheduleParameters {
+	SchedulePolicy policy = SchedulePolicy::fair;
+	// Priority within the fair or real-time class. Larger values are preferred.
+	int priority = 0;
+	// Parameters of the deadline class (in ns). The entity receives runtime ns
+	// of CPU time within deadline ns after the start of each period.
+	uint64_t runtime = 0;
+	uint64_t deadline = 0;
+	uint64_t period = 0;
+};
+
+// Wakeup-to-run latencies are recorded in power-of-two buckets (in us).
+// Bucket 0 counts latencies < 1 us, bucket i counts latencies in [2^(i-1), 2^i) us
+// and the last bucket counts all larger latencies.
+constexpr size_t numLatencyBuckets = 20;
+
+enum class LatencyClass {
+	fair,
+	realtime,
+	deadline,
+	count
+};
+
 enum class ScheduleState {
 	null,
 	attached,
@@ -75,11 +115,36 @@ private:
 	Scheduler *_scheduler;
 
 	ScheduleState state;
-	int priority;
+
+	// Parameters that are in effect. Only changed by the scheduler that owns the entity.
+	ScheduleParameters params;
+
+	// Parameters set by Scheduler::setParameters(); protected by Scheduler::_mutex.
+	ScheduleParameters requestedParams;
+	bool paramsChanged = false;
+
+	// Bandwidth that is reserved for the deadline class; protected by the admission lock.
+	uint64_t dlBandwidth = 0;
 
 	frg::default_list_hook<ScheduleEntity> listHook;
+	frg::default_list_hook<ScheduleEntity> changeHook;
+	frg::default_list_hook<ScheduleEntity> throttleHook;
 	frg::pairing_heap_hook<ScheduleEntity> heapHook;
 
+	// Real-time classes: order among entities of equal priority.
+	uint64_t rtSequence = 0;
+
+	// Deadline class: current absolute deadline and remaining runtime until it.
+	uint64_t dlDeadline = 0;
+	int64_t dlBudget = 0;
+	// Deadline class: set once the budget is exhausted. Throttled entities do not run
+	// until dlReplenishClock (the start of their next period).
+	bool dlThrottled = false;
+	uint64_t dlReplenishClock = 0;
+
+	// Time of the last resume(); zero if the entity has run since then.
+	uint64_t wakeClock = 0;
+
 	uint64_t _refClock;
 	uint64_t _runTime;
 
@@ -107,8 +172,19 @@ struct Scheduler {
 	static void associate(ScheduleEntity *entity, Scheduler *scheduler);
 	static void unassociate(ScheduleEntity *entity);
 
+	// Changes the priority of fair entities. Entities of other classes keep their
+	// parameters; use setParameters() to change the class.
 	static void setPriority(ScheduleEntity *entity, int priority);
 
+	// Changes the scheduling class of an entity. Can be called for any entity;
+	// the change takes effect once the owning CPU updates its queue.
+	// Returns illegalState if the deadline class cannot admit the entity's bandwidth.
+	static Error setParameters(ScheduleEntity *entity, ScheduleParameters params);
+	static ScheduleParameters getParameters(ScheduleEntity *entity);
+
+	// Sum of the latency histograms of all CPUs.
+	static void getLatencyHistogram(LatencyClass cls, uint64_t *buckets);
+
 	static void resume(ScheduleEntity *entity);
 	static void suspendCurrent();
 
@@ -164,10 +240,27 @@ public:
 
 	ScheduleEntity *currentRunnable();
 
+	// Racy hint whether the CPU is idle, i.e., it runs the idle task and no entity
+	// was resumed since. Intended for placement decisions on other CPUs.
+	bool idleHint() {
+		return _idleHint.load(std::memory_order_relaxed);
+	}
+
+	// Number of entities that wait for the CPU. Must be called on the scheduler's CPU.
+	size_t numWaiting() {
+		return _numWaiting;
+	}
+
 private:
-	void _unschedule();
+	void _unschedule(bool yield);
 	void _schedule();
 
+	void _applyParameters(ScheduleEntity *entity, const ScheduleParameters &params);
+	void _throttleDeadline(ScheduleEntity *entity);
+	bool _replenishDeadline(ScheduleEntity *entity);
+	frg::optional<uint64_t> _nextReplenishment();
+	void _recordLatency(ScheduleEntity *entity);
+
 private:
 	void _updatePreemption();
 
@@ -193,9 +286,23 @@ private:
 
 	size_t _numWaiting = 0;
 
+	// Active deadline entities that are throttled. They are neither in _waitQueue
+	// nor counted in _numWaiting.
+	frg::intrusive_list<
+		ScheduleEntity,
+		frg::locate_member<
+			ScheduleEntity,
+			frg::default_list_hook<ScheduleEntity>,
+			&ScheduleEntity::throttleHook
+		>
+	> _throttledList;
+
 	// See mustCallPreemption().
 	bool _mustCallPreemption{false};
 
+	// See idleHint().
+	std::atomic<bool> _idleHint{false};
+
 	// The last tick at which the scheduler's state (i.e. progress) was updated.
 	// In our model this is the time point at which slice T started.
 	uint64_t _refClock = 0;
@@ -207,11 +314,18 @@ private:
 	// This allows us to easily track u_p(T) for all waiting processes.
 	Progress _systemProgress = 0;
 
+	// Source of ScheduleEntity::rtSequence.
+	uint64_t _rtSequence = 0;
+
+	// Written only by this CPU but read by getLatencyHistogram().
+	uint64_t _latencyHistogram[static_cast<size_t>(LatencyClass::count)][numLatencyBuckets] = {};
+
 	// ----------------------------------------------------------------------------------
 	// Management of pending entities.
 	// ----------------------------------------------------------------------------------
 
-	// Note that _mutex *only* protects _pendingList and nothing more!
+	// Note that _mutex *only* protects _pendingList, _changedList
+	// and ScheduleEntity::requestedParams and nothing more!
 	frg::ticket_spinlock _mutex;
 
 	frg::intrusive_list<
@@ -222,6 +336,16 @@ private:
 			&ScheduleEntity::listHook
 		>
 	> _pendingList;
+
+	// Entities whose requestedParams need to be applied.
+	frg::intrusive_list<
+		ScheduleEntity,
+		frg::locate_member<
+			ScheduleEntity,
+			frg::default_list_hook<ScheduleEntity>,
+			&ScheduleEntity::changeHook
+		>
+	> _changedList;
 };
 
 // Similar to Scheduler::checkPreemption() but specialized for threads.
@@ -6,6 +6,7 @@
 #include <async/cancellation.hpp>
 #include <frg/container_of.hpp>
 #include <frg/intrusive.hpp>
+#include <frg/list.hpp>
 #include <frg/pairing_heap.hpp>
 #include <frg/spinlock.hpp>
 #include <thor-internal/arch-generic/timer.hpp>
@@ -16,6 +17,7 @@ namespace thor {
 
 struct CpuData;
 struct PrecisionTimerEngine;
+struct TimerWheel;
 
 struct ClockSource {
 	virtual uint64_t currentNanos() = 0;
@@ -44,6 +46,7 @@ struct PrecisionTimerNode {
 
 	friend struct CompareTimer;
 	friend struct PrecisionTimerEngine;
+	friend struct TimerWheel;
 
 	PrecisionTimerNode()
 	: _engine{nullptr}, _cancelCb{this} { }
@@ -59,17 +62,33 @@ struct PrecisionTimerNode {
 		_elapsed = elapsed;
 	}
 
+	// The timer may elapse up to slack ns after its deadline.
+	// Timers with enough slack are kept in a timer wheel (see TimerWheel).
+	void setSlack(uint64_t slack) {
+		_slack = slack;
+	}
+
 	bool wasCancelled() {
 		return _wasCancelled;
 	}
 
 	frg::pairing_heap_hook<PrecisionTimerNode> hook;
+	frg::default_list_hook<PrecisionTimerNode> wheelHook;
 
 private:
 	uint64_t _deadline;
+	uint64_t _slack = 0;
 	async::cancellation_token _cancelToken;
 	Worklet *_elapsed;
 
+	// Only valid for timers in the wheel: _deadline rounded up to the wheel's granularity,
+	// the lowest level that the timer can be put into and the timer's current slot.
+	uint64_t _expiry;
+	int _minLevel;
+	int _level;
+	int _slot;
+	bool _inWheel = false;
+
 	// TODO: If we allow timer engines to be destructed, this needs to be refcounted.
 	PrecisionTimerEngine *_engine;
 
@@ -84,6 +103,60 @@ struct CompareTimer {
 	}
 };
 
+using TimerList = frg::intrusive_list<
+	PrecisionTimerNode,
+	frg::locate_member<
+		PrecisionTimerNode,
+		frg::default_list_hook<PrecisionTimerNode>,
+		&PrecisionTimerNode::wheelHook
+	>
+>;
+
+// Hierarchical timer wheel for timers that tolerate slack (e.g., timeouts that are
+// usually cancelled before they elapse). Inserting and removing timers is O(1).
+// Level l consists of numSlots slots of 2^(baseShift + l * levelShift) ns each.
+// Timers are put into the lowest level that covers their expiry and move to lower levels
+// once their slot is reached (until they reach their _minLevel where they elapse).
+// Not thread-safe; protected by the PrecisionTimerEngine's mutex.
+struct TimerWheel {
+	static constexpr int baseShift = 20; // About 1 ms.
+	static constexpr int levelShift = 6;
+	static constexpr int numLevels = 5;
+	static constexpr int numSlots = 1 << levelShift;
+
+	static constexpr int shiftOf(int level) {
+		return baseShift + level * levelShift;
+	}
+
+	// Returns the highest level whose granularity does not exceed slack
+	// or -1 if the timer needs to be more precise than the wheel.
+	static int levelForSlack(uint64_t slack);
+
+	bool empty() {
+		return !_numTimers;
+	}
+
+	// Precondition: timer->_expiry and timer->_minLevel are set up.
+	void insert(PrecisionTimerNode *timer, uint64_t now);
+	void remove(PrecisionTimerNode *timer);
+
+	// Moves all timers that expire until now to the expired list.
+	void advance(uint64_t now, TimerList &expired);
+
+	// Returns the earliest time at which the wheel needs to advance.
+	frg::optional<uint64_t> nextExpiry();
+
+private:
+	void _insert(PrecisionTimerNode *timer);
+
+	// Last processed slot number (i.e., time >> shiftOf(l)) of each level.
+	uint64_t _clocks[numLevels] = {};
+	// Bit i is set if slot i of the level is non-empty.
+	uint64_t _occupied[numLevels] = {};
+	TimerList _slots[numLevels][numSlots];
+	size_t _numTimers = 0;
+};
+
 struct PrecisionTimerEngine final {
 	friend struct PrecisionTimerNode;
 
@@ -96,6 +169,9 @@ public:
 
 	void installTimer(PrecisionTimerNode *timer);
 
+	// Returns the deadline of the earliest timer, or frg::null_opt if there is none.
+	frg::optional<uint64_t> nextDeadline();
+
 	// ----------------------------------------------------------------------------------
 	// Sender boilerplate for sleep()
 	// ----------------------------------------------------------------------------------
@@ -115,12 +191,19 @@ public:
 		PrecisionTimerEngine *self;
 		uint64_t deadline;
 		async::cancellation_token cancellation;
+		uint64_t slack = 0;
 	};
 
 	SleepSender sleep(uint64_t deadline, async::cancellation_token cancellation = {}) {
 		return {this, deadline, cancellation};
 	}
 
+	// Like sleep() but the sleep may end up to slack ns after the deadline.
+	SleepSender coarseSleep(uint64_t deadline, uint64_t slack,
+			async::cancellation_token cancellation = {}) {
+		return {this, deadline, cancellation, slack};
+	}
+
 	SleepSender sleepFor(uint64_t nanos, async::cancellation_token cancellation = {}) {
 		return {this, getClockNanos() + nanos, cancellation};
 	}
@@ -139,7 +222,8 @@ public:
 				auto op = frg::container_of(base, &SleepOperation::worklet_);
 				async::execution::set_value(op->receiver_);
 			}, WorkQueue::generalQueue());
-			node_.setup(s_.deadline, &worklet_);
+			node_.setup(s_.deadline, s_.cancellation, &worklet_);
+			node_.setSlack(s_.slack);
 			s_.self->installTimer(&node_);
 		}
 
@@ -165,6 +249,8 @@ public:
 
 private:
 	void _progress();
+	void _elapse(PrecisionTimerNode *timer);
+	frg::optional<uint64_t> _nextDeadline();
 
 	CpuData *_ourCpu;
 
@@ -180,6 +266,9 @@ private:
 		CompareTimer
 	> _timerQueue;
 
+	// Timers that tolerate slack.
+	TimerWheel _wheel;
+
 	size_t _activeTimers;
 };
 
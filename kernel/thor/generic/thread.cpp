@@ -404,6 +404,16 @@ void Thread::unblockOther(smarter::borrowed_ptr<Thread> thread) {
 
 	thread->_updateRunTime();
 	thread->_runState = kRunDeferred;
+	if(auto cpu = LoadBalancer::singleton().placeWakee(thread.get()); cpu) {
+		if(logMigration)
+			infoLogger() << "thor: " << (void *)thread.get()
+					<< " is woken up on CPU " << cpu->cpuIndex << frg::endlog;
+
+		// The thread is blocked and does not run on any CPU,
+		// hence we can move it to another scheduler right away.
+		Scheduler::unassociate(thread.get());
+		Scheduler::associate(thread.get(), &localScheduler.get(cpu));
+	}
 	Scheduler::resume(thread.get());
 }
 
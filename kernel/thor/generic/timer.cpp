@@ -98,6 +98,120 @@ void handleTimerInterrupt() {
 }
 
 
+// --------------------------------------------------------
+// TimerWheel
+// --------------------------------------------------------
+
+int TimerWheel::levelForSlack(uint64_t slack) {
+	int level = -1;
+	while(level + 1 < numLevels && (uint64_t{1} << shiftOf(level + 1)) <= slack)
+		level++;
+	return level;
+}
+
+void TimerWheel::insert(PrecisionTimerNode *timer, uint64_t now) {
+	// Resynchronize the clocks instead of processing stale slots.
+	if(!_numTimers) {
+		for(int l = 0; l < numLevels; l++)
+			_clocks[l] = now >> shiftOf(l);
+	}
+
+	_insert(timer);
+	timer->_inWheel = true;
+	_numTimers++;
+}
+
+void TimerWheel::_insert(PrecisionTimerNode *timer) {
+	// Put the timer into the lowest level that covers its expiry.
+	// Since the clocks of all levels are derived from the same time,
+	// the expiry is always in the future on levels above _minLevel.
+	int level = timer->_minLevel;
+	uint64_t n = timer->_expiry >> shiftOf(level);
+	while(level + 1 < numLevels && n > _clocks[level] + numSlots - 1) {
+		level++;
+		n = timer->_expiry >> shiftOf(level);
+	}
+	assert(n > _clocks[level] || level == timer->_minLevel);
+
+	// Expired timers go into the next slot. Timers beyond the highest level go into
+	// its last slot; they move to the right slot once that slot is reached.
+	if(n <= _clocks[level])
+		n = _clocks[level] + 1;
+	if(n > _clocks[level] + numSlots - 1)
+		n = _clocks[level] + numSlots - 1;
+
+	auto slot = n & (numSlots - 1);
+	timer->_level = level;
+	timer->_slot = slot;
+	_slots[level][slot].push_back(timer);
+	_occupied[level] |= uint64_t{1} << slot;
+}
+
+void TimerWheel::remove(PrecisionTimerNode *timer) {
+	assert(timer->_inWheel);
+	auto &list = _slots[timer->_level][timer->_slot];
+	list.erase(list.iterator_to(timer));
+	if(list.empty())
+		_occupied[timer->_level] &= ~(uint64_t{1} << timer->_slot);
+	timer->_inWheel = false;
+	_numTimers--;
+}
+
+void TimerWheel::advance(uint64_t now, TimerList &expired) {
+	if(!_numTimers)
+		return;
+
+	TimerList reached;
+	for(int l = 0; l < numLevels; l++) {
+		auto target = now >> shiftOf(l);
+		// Higher levels cannot advance either.
+		if(target <= _clocks[l])
+			break;
+
+		auto steps = frg::min(target - _clocks[l], uint64_t{numSlots});
+		for(uint64_t k = 1; k <= steps; k++) {
+			auto slot = (_clocks[l] + k) & (numSlots - 1);
+			if(!(_occupied[l] & (uint64_t{1} << slot)))
+				continue;
+			reached.splice(reached.end(), _slots[l][slot]);
+			_occupied[l] &= ~(uint64_t{1} << slot);
+		}
+		_clocks[l] = target;
+	}
+
+	while(!reached.empty()) {
+		auto timer = reached.pop_front();
+		if(timer->_expiry <= now) {
+			timer->_inWheel = false;
+			_numTimers--;
+			expired.push_back(timer);
+		}else{
+			_insert(timer);
+		}
+	}
+}
+
+frg::optional<uint64_t> TimerWheel::nextExpiry() {
+	frg::optional<uint64_t> expiry;
+	for(int l = 0; l < numLevels; l++) {
+		if(!_occupied[l])
+			continue;
+
+		// Find the first occupied slot after the current one.
+		auto start = (_clocks[l] + 1) & (numSlots - 1);
+		auto rotated = (_occupied[l] >> start) | (_occupied[l] << ((numSlots - start) % numSlots));
+		auto n = _clocks[l] + 1 + __builtin_ctzll(rotated);
+		auto candidate = n << shiftOf(l);
+		if(!expiry || candidate < *expiry)
+			expiry = candidate;
+	}
+	return expiry;
+}
+
+// --------------------------------------------------------
+// PrecisionTimerEngine
+// --------------------------------------------------------
+
 extern PerCpu<PrecisionTimerEngine> timerEngine;
 THOR_DEFINE_PERCPU(timerEngine);
 
@@ -124,19 +238,56 @@ void PrecisionTimerEngine::installTimer(PrecisionTimerNode *timer) {
 		return;
 	}
 
-	_timerQueue.push(timer);
+	// Timers that already elapsed go into the heap such that they elapse immediately.
+	// So do timers whose expiry cannot be rounded up without overflowing
+	// (e.g., timers with an infinite deadline).
+	auto now = getClockNanos();
+	auto level = TimerWheel::levelForSlack(timer->_slack);
+	auto granularity = level >= 0 ? uint64_t{1} << TimerWheel::shiftOf(level) : 1;
+	if(level >= 0 && timer->_deadline > now
+			&& timer->_deadline <= ~uint64_t{0} - (granularity - 1)) {
+		timer->_expiry = (timer->_deadline + granularity - 1) & ~(granularity - 1);
+		timer->_minLevel = level;
+		_wheel.insert(timer, now);
+	}else{
+		_timerQueue.push(timer);
+	}
 	_activeTimers++;
 	timer->_state = TimerState::queued;
 
 	_progress();
 }
 
+frg::optional<uint64_t> PrecisionTimerEngine::nextDeadline() {
+	auto irq_lock = frg::guard(&irqMutex());
+	auto lock = frg::guard(&_mutex);
+
+	return _nextDeadline();
+}
+
+frg::optional<uint64_t> PrecisionTimerEngine::_nextDeadline() {
+	auto deadline = _wheel.nextExpiry();
+	if(!_timerQueue.empty()) {
+		auto top = _timerQueue.top()->_deadline;
+		if(!deadline || top < *deadline)
+			deadline = top;
+	}
+	return deadline;
+}
+
+// Note that cancellation does not reprogram the timer hardware, even if the timer
+// was the next one to elapse (this would require an IPI if we run on another CPU).
+// Instead, the next timer IRQ finds that there is nothing to do.
 void PrecisionTimerEngine::cancelTimer(PrecisionTimerNode *timer) {
 	auto irq_lock = frg::guard(&irqMutex());
 	auto lock = frg::guard(&_mutex);
 
 	if(timer->_state == TimerState::queued) {
-		_timerQueue.remove(timer);
+		if(timer->_inWheel) {
+			_wheel.remove(timer);
+		}else{
+			_timerQueue.remove(timer);
+		}
 		_activeTimers--;
 		timer->_wasCancelled = true;
 	}else{
@@ -163,42 +314,46 @@ void PrecisionTimerEngine::_progress() {
 	assert(getCpuData() == _ourCpu);
 
 	auto current = getClockNanos();
+	frg::optional<uint64_t> deadline;
 	do {
 		// Process all timers that elapsed in the past.
 		if(logProgress)
 			infoLogger() << "thor: Processing timers until " << current << frg::endlog;
-		while(true) {
-			if(_timerQueue.empty()) {
-				setTimerEngineDeadline(frg::null_opt);
-				return;
-			}
-
-			if(_timerQueue.top()->_deadline > current)
-				break;
-
+		while(!_timerQueue.empty() && _timerQueue.top()->_deadline <= current) {
 			auto timer = _timerQueue.top();
-			assert(timer->_state == TimerState::queued);
 			_timerQueue.pop();
-			_activeTimers--;
-			if(logProgress)
-				infoLogger() << "thor: Timer completed" << frg::endlog;
-			if(timer->_cancelCb.try_reset()) {
-				timer->_state = TimerState::retired;
-				WorkQueue::post(timer->_elapsed);
-			}else{
-				// Let the cancellation handler invoke the continuation.
-				timer->_state = TimerState::elapsed;
-			}
+			_elapse(timer);
 		}
 
+		TimerList expired;
+		_wheel.advance(current, expired);
+		while(!expired.empty())
+			_elapse(expired.pop_front());
+
 		// Setup the interrupt.
-		assert(!_timerQueue.empty());
-		setTimerEngineDeadline(_timerQueue.top()->_deadline);
+		deadline = _nextDeadline();
+		setTimerEngineDeadline(deadline);
+		if(!deadline)
+			return;
 
 		// We iterate if there was a race.
 		// Technically, this is optional but it may help to avoid unnecessary IRQs.
 		current = getClockNanos();
-	} while(_timerQueue.top()->_deadline <= current);
+	} while(*deadline <= current);
+}
+
+void PrecisionTimerEngine::_elapse(PrecisionTimerNode *timer) {
+	assert(timer->_state == TimerState::queued);
+	_activeTimers--;
+	if(logProgress)
+		infoLogger() << "thor: Timer completed" << frg::endlog;
+	if(timer->_cancelCb.try_reset()) {
+		timer->_state = TimerState::retired;
+		WorkQueue::post(timer->_elapsed);
+	}else{
+		// Let the cancellation handler invoke the continuation.
+		timer->_state = TimerState::elapsed;
+	}
 }
 
 PrecisionTimerEngine *generalTimerEngine() {
@@ -0,0 +1,122 @@
+#include <thor-internal/debug.hpp>
+#include <thor-internal/main.hpp>
+#include <thor-internal/acpi/acpi.hpp>
+
+#include <uacpi/acpi.h>
+#include <uacpi/tables.h>
+
+namespace thor {
+namespace acpi {
+
+namespace {
+
+// Like the MADT, we mark all SRAT structs as [[gnu::packed]].
+
+struct [[gnu::packed]] SratHeader {
+	uint32_t reserved1;
+	uint64_t reserved2;
+};
+
+struct [[gnu::packed]] SratGenericEntry {
+	uint8_t type;
+	uint8_t length;
+};
+
+struct [[gnu::packed]] SratLocalEntry {
+	SratGenericEntry generic;
+	uint8_t proximityDomainLow;
+	uint8_t localApicId;
+	uint32_t flags;
+	uint8_t localSapicEid;
+	uint8_t proximityDomainHigh[3];
+	uint32_t clockDomain;
+};
+
+struct [[gnu::packed]] SratLocalX2Entry {
+	SratGenericEntry generic;
+	uint16_t reserved1;
+	uint32_t proximityDomain;
+	uint32_t localX2ApicId;
+	uint32_t flags;
+	uint32_t clockDomain;
+	uint32_t reserved2;
+};
+
+namespace affinity_flags {
+	static constexpr uint32_t enabled = 1;
+};
+
+struct CpuAffinity {
+	uint32_t apicId;
+	uint32_t proximityDomain;
+};
+
+// CPUs that do not fit into the table are reported as node 0.
+constexpr size_t maxCpuAffinities = 256;
+
+CpuAffinity cpuAffinities[maxCpuAffinities];
+// Only written once the table is complete.
+size_t numCpuAffinities = 0;
+
+} // anonymous namespace
+
+uint32_t getNumaNode(uint32_t apicId) {
+	// Pairs with the release store in parseSratTask.
+	auto n = __atomic_load_n(&numCpuAffinities, __ATOMIC_ACQUIRE);
+	for(size_t i = 0; i < n; i++) {
+		if(cpuAffinities[i].apicId == apicId)
+			return cpuAffinities[i].proximityDomain;
+	}
+	return 0;
+}
+
+static initgraph::Task parseSratTask{&globalInitEngine, "acpi.parse-srat",
+	initgraph::Requires{getTablesDiscoveredStage()},
+	[] {
+		uacpi_table sratTbl;
+
+		if(uacpi_table_find_by_signature("SRAT", &sratTbl) != UACPI_STATUS_OK) {
+			infoLogger() << "thor: No SRAT, assuming a single NUMA node" << frg::endlog;
+			return;
+		}
+		auto *srat = sratTbl.hdr;
+
+		size_t offset = sizeof(acpi_sdt_hdr) + sizeof(SratHeader);
+		size_t n = 0;
+		auto addCpuAffinity = [&] (uint32_t apicId, uint32_t proximityDomain) {
+			if(n == maxCpuAffinities) {
+				warningLogger() << "thor: Ignoring SRAT entry for local APIC "
+						<< apicId << frg::endlog;
+				return;
+			}
+			cpuAffinities[n++] = {apicId, proximityDomain};
+		};
+		while(offset < srat->length) {
+			auto generic = (SratGenericEntry *)(sratTbl.virt_addr + offset);
+			if(!generic->length)
+				break;
+			if(generic->type == 0) { // local APIC affinity
+				auto entry = (SratLocalEntry *)generic;
+				if(entry->flags & affinity_flags::enabled) {
+					uint32_t domain = entry->proximityDomainLow
+							| (entry->proximityDomainHigh[0] << 8)
+							| (entry->proximityDomainHigh[1] << 16)
+							| (entry->proximityDomainHigh[2] << 24);
+					addCpuAffinity(entry->localApicId, domain);
+				}
+			}else if(generic->type == 2) { // local x2APIC affinity
+				auto entry = (SratLocalX2Entry *)generic;
+				if(entry->flags & affinity_flags::enabled)
+					addCpuAffinity(entry->localX2ApicId, entry->proximityDomain);
+			}
+			offset += generic->length;
+		}
+
+		__atomic_store_n(&numCpuAffinities, n, __ATOMIC_RELEASE);
+
+		infoLogger() << "thor: SRAT describes the NUMA nodes of "
+				<< n << " CPUs" << frg::endlog;
+	}
+};
+
+} } // namespace thor::acpi
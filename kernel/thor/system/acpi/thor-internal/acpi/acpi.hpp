@@ -113,6 +113,10 @@ void initGlue();
 void initEc();
 void initEvents();
 
+// Returns the SRAT proximity domain of the CPU with the given (x2)APIC ID.
+// Returns zero if there is no SRAT or if it does not describe the CPU.
+uint32_t getNumaNode(uint32_t apicId);
+
 struct AcpiObject final : public KernelBusObject {
 	AcpiObject(uacpi_namespace_node *node, unsigned int id)
 	: node{node}, instance{id} {
@@ -298,7 +298,7 @@ static initgraph::Task enumerateDmalog{&globalInitEngine, "pci.enumerate-dmalog"
 					IrqPin::attachSink(pin, dmalog.get());
 
 					pciDevice->enableBusmaster();
-					pciDevice->setupMsi(pin, 0);
+					pin->attachDevice(pciDevice, 0);
 					pciDevice->enableMsi();
 					useMsi = true;
 				}
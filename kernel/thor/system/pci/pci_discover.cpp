@@ -412,7 +412,7 @@ coroutine<frg::expected<Error>> PciEntity::handleRequest(LaneHandle lane) {
 				+ frg::to_allocated_string(*kernelAlloc, req->index()));
 		IrqPin::attachSink(interrupt, object.get());
 
-		static_cast<PciDevice *>(this)->setupMsi(interrupt, req->index());
+		interrupt->attachDevice(static_cast<PciDevice *>(this), req->index());
 
 		managarm::hw::SvrResponse<KernelAlloc> resp{*kernelAlloc};
 		resp.set_error(managarm::hw::Errors::SUCCESS);
@@ -788,8 +788,11 @@ void PciDevice::setupMsi(MsiPin *msi, size_t index) {
 	auto io = parentBus->io;
 
 	if (msixIndex >= 0) {
-		// Setup the MSI-X table.
+		// Setup the MSI-X table. The entry is masked while it is rewritten
+		// since it might be active already (when the MSI is retargeted).
 		auto space = arch::mem_space{msixMapping}.subspace(index * 16);
+		space.store(msixVectorControl,
+				space.load(msixVectorControl) | uint32_t{1});
 		space.store(msixMessageAddress, msi->getMessageAddress());
 		space.store(msixMessageData, msi->getMessageData());
 		space.store(msixVectorControl,
@@ -354,7 +354,7 @@ struct PciBridge final : PciEntity {
 	async::oneshot_event mbusPublished;
 };
 
-struct PciDevice final : PciEntity {
+struct PciDevice final : PciEntity, MsiDevice {
 	PciDevice(PciBus *parentBus_, uint32_t seg, uint32_t bus, uint32_t slot, uint32_t function,
 			uint16_t vendor, uint16_t device_id, uint8_t revision,
 			uint8_t class_code, uint8_t sub_class, uint8_t interface, uint16_t subsystem_vendor, uint16_t subsystem_device)
@@ -374,7 +374,7 @@ struct PciDevice final : PciEntity {
 
 	void enableIrq();
 
-	void setupMsi(MsiPin *msi, size_t index);
+	void setupMsi(MsiPin *msi, size_t index) override;
 	void enableMsi();
 
 	uint16_t subsystemVendor;
@@ -8,6 +8,7 @@
 #include <algorithm>
 #include <iostream>
 #include <memory>
+#include <optional>
 #include <unordered_map>
 #include <unordered_set>
 #include <queue>
@@ -60,6 +61,24 @@ struct Entity {
 
 	void updateProperty(std::string key, mbus_ng::AnyItem value) {
 		_properties.emplace(key, value);
+		_encoded.reset();
+	}
+
+	// Returns the entity in its wire format. The encoding is cached until
+	// the properties change.
+	const managarm::mbus::Entity &encoded() {
+		if(!_encoded) {
+			_encoded.emplace();
+			_encoded->set_id(_id);
+			_encoded->set_name(_name);
+			for(auto &kv : _properties) {
+				managarm::mbus::Property prop;
+				prop.set_name(kv.first);
+				prop.set_item(mbus_ng::encodeItem(kv.second));
+				_encoded->add_properties(std::move(prop));
+			}
+		}
+		return *_encoded;
 	}
 
 	async::result<void> submitRemoteLane(helix::UniqueLane &&lane) {
@@ -76,6 +95,7 @@ private:
 	uint64_t _seq;
 	std::string _name;
 	std::unordered_map<std::string, mbus_ng::AnyItem> _properties;
+	std::optional<managarm::mbus::Entity> _encoded;
 
 	struct SubmittedLane {
 		helix::UniqueLane lane;
@@ -114,7 +134,7 @@ struct EqualsFilter {
 	: _property(std::move(property)), _value{mbus_ng::StringItem{std::move(value)}} { }
 
 	std::string getProperty() const { return _property; }
-	mbus_ng::AnyItem getValue() const { return _value; }
+	const mbus_ng::AnyItem &getValue() const { return _value; }
 
 private:
 	std::string _property;
@@ -204,6 +224,35 @@ using EntitySeqTree = frg::rbtree<
 >;
 EntitySeqTree entitySeqTree;
 
+// Inverted index of all string properties: maps property names to values and
+// values to the entities that have them. Used to find candidates for filters
+// without visiting all entities.
+using EntitySet = std::unordered_set<Entity *>;
+std::unordered_map<std::string, std::unordered_map<std::string, EntitySet>> propertyIndex;
+
+void indexEntity(Entity *entity) {
+	for(auto &kv : entity->getProperties()) {
+		auto string = std::get_if<mbus_ng::StringItem>(&kv.second);
+		if(!string)
+			continue;
+		propertyIndex[kv.first][string->value].insert(entity);
+	}
+}
+
+void unindexEntity(Entity *entity) {
+	for(auto &kv : entity->getProperties()) {
+		auto string = std::get_if<mbus_ng::StringItem>(&kv.second);
+		if(!string)
+			continue;
+		auto &values = propertyIndex[kv.first];
+		auto it = values.find(string->value);
+		assert(it != values.end());
+		it->second.erase(entity);
+		if(it->second.empty())
+			values.erase(it);
+	}
+}
+
 std::shared_ptr<Entity> getEntityById(int64_t id) {
 	auto it = allEntities.find(id);
 	if(it == allEntities.end())
@@ -254,43 +303,95 @@ auto seqLowerBound(uint64_t inSeq) {
 	return successor;
 }
 
+// Returns a superset of the entities that match the filter, or std::nullopt
+// if the index cannot narrow down the filter (e.g. for empty conjunctions).
+static std::optional<std::vector<Entity *>> findCandidates(const AnyFilter &filter) {
+	if(auto real = std::get_if<EqualsFilter>(&filter); real) {
+		std::vector<Entity *> candidates;
+		auto value = std::get_if<mbus_ng::StringItem>(&real->getValue());
+		if(!value)
+			return std::nullopt;
+		auto values = propertyIndex.find(real->getProperty());
+		if(values == propertyIndex.end())
+			return candidates;
+		auto it = values->second.find(value->value);
+		if(it == values->second.end())
+			return candidates;
+		candidates.assign(it->second.begin(), it->second.end());
+		return candidates;
+	}else if(auto real = std::get_if<Conjunction>(&filter); real) {
+		// Any operand's candidates will do; use the smallest set.
+		std::optional<std::vector<Entity *>> smallest;
+		for(auto &operand : real->getOperands()) {
+			auto candidates = findCandidates(operand);
+			if(candidates && (!smallest || candidates->size() < smallest->size()))
+				smallest = std::move(candidates);
+			if(smallest && smallest->empty())
+				break;
+		}
+		return smallest;
+	}else if(auto real = std::get_if<Disjunction>(&filter); real) {
+		std::unordered_set<Entity *> all;
+		for(auto &operand : real->getOperands()) {
+			auto candidates = findCandidates(operand);
+			if(!candidates)
+				return std::nullopt;
+			all.insert(candidates->begin(), candidates->end());
+		}
+		return std::vector<Entity *>{all.begin(), all.end()};
+	}else{
+		throw std::runtime_error("Unexpected filter");
+	}
+}
+
 async::result<std::tuple<uint64_t, uint64_t>>
 tryEnumerate(managarm::mbus::EnumerateResponse &resp, uint64_t inSeq, const AnyFilter &filter) {
 	auto actualSeq = co_await globalSeq.async_wait(inSeq);
 	auto outSeq = actualSeq;
 
+	constexpr size_t maxEntitiesPerMessage = 16;
+
+	// Limit the amount of entities we send at once.
+	// Send back the seq number of the successor of the last entity
+	// to the client, so it can pick back up where we left off.
+	// This is correct since in the non-paginated case, the returned
+	// seq number is the seq of the first new entity.
+	auto addEntity = [&] (Entity *entity) -> bool {
+		resp.add_entities(entity->encoded());
+		if (resp.entities().size() >= maxEntitiesPerMessage) {
+			outSeq = entity->seq() + 1;
+			return false;
+		}
+		return true;
+	};
+
+	if (auto candidates = findCandidates(filter); candidates) {
+		// Only visit the entities that the index returns, in seq order.
+		std::erase_if(*candidates, [&] (Entity *entity) {
+			return entity->seq() < inSeq;
+		});
+		std::sort(candidates->begin(), candidates->end(), [] (Entity *a, Entity *b) {
+			return a->seq() < b->seq();
+		});
+
+		for (auto entity : *candidates) {
+			if (!matchesFilter(entity, filter)) continue;
+			if (!addEntity(entity))
+				break;
+		}
+		co_return {outSeq, actualSeq};
+	}
+
 	// Find the first entity with an interesting seq number.
 	auto cur = seqLowerBound(inSeq);
 
-	constexpr size_t maxEntitiesPerMessage = 16;
-
 	// At this point, cur and all successors should have ->seq() >= inSeq
 	for (; cur; cur = EntitySeqTree::successor(cur)) {
 		assert(cur->seq() >= inSeq);
 		// The client doesn't want to see this.
 		if (!matchesFilter(cur, filter)) continue;
-
-		managarm::mbus::Entity protoEntity;
-		protoEntity.set_id(cur->id());
-		protoEntity.set_name(cur->name());
-		for(auto kv : cur->getProperties()) {
-			managarm::mbus::Property prop;
-			prop.set_name(kv.first);
-			prop.set_item(mbus_ng::encodeItem(kv.second));
-			protoEntity.add_properties(prop);
-		}
-
-		resp.add_entities(protoEntity);
-
-		// Limit the amount of entities we send at once.
-		// Send back the seq number of the successor of the last entity
-		// to the client, so it can pick back up where we left off.
-		// This is correct since in the non-paginated case, the returned
-		// seq number is the seq of the first new entity.
-		if (resp.entities().size() >= maxEntitiesPerMessage) {
-			outSeq = cur->seq() + 1;
+		if (!addEntity(cur))
 			break;
-		}
 	}
 
 	co_return {outSeq, actualSeq};
@@ -416,12 +517,8 @@ async::detached serve(helix::UniqueLane lane) {
 				resp.set_error(managarm::mbus::Error::NO_SUCH_ENTITY);
 			} else {
 				resp.set_error(managarm::mbus::Error::SUCCESS);
-				for(auto kv : entity->getProperties()) {
-					managarm::mbus::Property prop;
-					prop.set_name(kv.first);
-					prop.set_item(mbus_ng::encodeItem(kv.second));
+				for(auto &prop : entity->encoded().properties())
 					resp.add_properties(prop);
-				}
 			}
 
 			auto [sendHead, sendTail] =
@@ -489,6 +586,7 @@ async::detached serve(helix::UniqueLane lane) {
 
 			allEntities.insert({ child->id(), child });
 			entitySeqTree.insert(child.get());
+			indexEntity(child.get());
 
 			// Wake up all pending enumeration operations.
 			globalSeq.raise();
@@ -525,9 +623,11 @@ async::detached serve(helix::UniqueLane lane) {
 			if(!entity) {
 				resp.set_error(managarm::mbus::Error::NO_SUCH_ENTITY);
 			} else {
+				unindexEntity(entity.get());
 				for(auto p : req->properties()) {
 					entity->updateProperty(p.name(), mbus_ng::decodeItem(p.item()));
 				}
+				indexEntity(entity.get());
 
 				resp.set_error(managarm::mbus::Error::SUCCESS);
 
@@ -25,6 +25,7 @@
 #include <ranges>
 #include <filesystem>
 #include <optional>
+#include <vector>
 #include <fstream>
 
 bool logDiscovery = false;
@@ -127,6 +128,23 @@ private:
 	std::unordered_set<std::string> knownDevices_;
 };
 
+// Starts a server through runsvr without waiting for it. This way, all servers
+// start concurrently; servers that depend on other servers pass --wait-for to runsvr.
+// runsvr records the launch in ostrace such that the boot timeline can be analyzed.
+void launchServer(std::vector<const char *> args, const char *mbusId = nullptr) {
+	auto pid = fork();
+	if(!pid) {
+		if(mbusId)
+			setenv("MBUS_ID", mbusId, 1);
+		std::vector<const char *> argv{"/usr/bin/runsvr", "--trace"};
+		argv.insert(argv.end(), args.begin(), args.end());
+		argv.push_back(nullptr);
+		execv("/usr/bin/runsvr", const_cast<char *const *>(argv.data()));
+		std::cout << "init: Failed to execute runsvr" << std::endl;
+		_exit(1);
+	}else assert(pid != -1);
+}
+
 std::optional<std::string> checkRootDevice(std::string device) {
 	if(logDiscovery)
 		std::cout << "init: Considering device " << device << std::endl;
@@ -180,51 +198,23 @@ int main() {
 	std::cout <<"init: Entering first stage" << std::endl;
 
 #if defined (__x86_64__)
-	auto uart = fork();
-	if(!uart) {
-		execl("/usr/bin/runsvr", "/usr/bin/runsvr", "runsvr", "/usr/bin/uart", nullptr);
-	}else assert(uart != -1);
+	launchServer({"runsvr", "/usr/bin/uart"});
 #endif
 
 	// Start essential bus and storage drivers.
 #if defined (__x86_64__)
-	auto ehci = fork();
-	if(!ehci) {
-		execl("/usr/bin/runsvr", "/usr/bin/runsvr", "runsvr", "/usr/bin/ehci", nullptr);
-	}else assert(ehci != -1);
+	launchServer({"runsvr", "/usr/bin/ehci"});
+	// UHCI waits for the EHCI companion of each controller itself.
+	launchServer({"runsvr", "/usr/bin/uhci"});
 #endif
-
-	auto xhci = fork();
-	if(!xhci) {
-		execl("/usr/bin/runsvr", "/usr/bin/runsvr", "runsvr", "/usr/bin/xhci", nullptr);
-	}else assert(xhci != -1);
-
-	auto virtio = fork();
-	if(!virtio) {
-		execl("/usr/bin/runsvr", "/usr/bin/runsvr", "runsvr", "/usr/bin/virtio-block", nullptr);
-	}else assert(virtio != -1);
-
+	launchServer({"runsvr", "/usr/bin/xhci"});
+	launchServer({"runsvr", "/usr/bin/virtio-block"});
 #if defined (__x86_64__)
-	auto block_ata = fork();
-	if(!block_ata) {
-		execl("/usr/bin/runsvr", "/usr/bin/runsvr", "runsvr", "/usr/bin/block-ata", nullptr);
-	}else assert(block_ata != -1);
+	launchServer({"runsvr", "/usr/bin/block-ata"});
 #endif
-
-	auto block_ahci = fork();
-	if(!block_ahci) {
-		execl("/usr/bin/runsvr", "/usr/bin/runsvr", "run", "/usr/lib/managarm/server/block-ahci.bin", nullptr);
-	}else assert(block_ahci != -1);
-
-	auto block_nvme = fork();
-	if(!block_nvme) {
-		execl("/usr/bin/runsvr", "/usr/bin/runsvr", "runsvr", "/usr/bin/block-nvme", nullptr);
-	}else assert(block_nvme != -1);
-
-	auto block_usb = fork();
-	if(!block_usb) {
-		execl("/usr/bin/runsvr", "/usr/bin/runsvr", "runsvr", "/usr/bin/storage", nullptr);
-	}else assert(block_usb != -1);
+	launchServer({"run", "/usr/lib/managarm/server/block-ahci.bin"});
+	launchServer({"runsvr", "/usr/bin/block-nvme"});
+	launchServer({"runsvr", "/usr/bin/storage"});
 
 	Cmdline cmdlineHelper{};
 	auto cmdline = async::run(cmdlineHelper.get(), helix::currentDispatcher);
@@ -280,11 +270,8 @@ int main() {
 		auto subsystemIt = uevent->find("SUBSYSTEM");
 
 		if(subsystemIt != uevent->end() && subsystemIt->second == "pci" && uevent->contains("PCI_CLASS") && uevent->at("PCI_CLASS") == "10802") {
-			auto nvme_server = fork();
-			if(!nvme_server) {
-				setenv("MBUS_ID", uevent->at("MBUS_ID").c_str(), 1);
-				execl("/usr/bin/runsvr", "/usr/bin/runsvr", "--fork", "bind", "/usr/lib/managarm/server/block-nvme.bin", nullptr);
-			}else assert(nvme_server != -1);
+			launchServer({"--fork", "bind", "/usr/lib/managarm/server/block-nvme.bin"},
+					uevent->at("MBUS_ID").c_str());
 		}
 
 		if (!rootPath && subsystemIt != uevent->end() && subsystemIt->second == "block")
@@ -292,11 +279,8 @@ int main() {
 
 		if(!uefiNetDevpathResolved) {
 			if("/sys" + devpath == dpSysfsPath.string()) {
-				auto netserver = fork();
-				if(!netserver) {
-					setenv("MBUS_ID", uevent->at("MBUS_ID").c_str(), 1);
-					execl("/usr/bin/runsvr", "/usr/bin/runsvr", "--fork", "bind", "/usr/lib/managarm/server/netserver.bin", nullptr);
-				}else assert(netserver != -1);
+				launchServer({"--fork", "bind", "/usr/lib/managarm/server/netserver.bin"},
+						uevent->at("MBUS_ID").c_str());
 				uefiNetDevpathResolved = true;
 			}
 		} else if(!interfaceUp) {
@@ -309,12 +293,9 @@ int main() {
 				auto [_, events] = async::run(enumerator.nextEvents(), helix::currentDispatcher).unwrap();
 				assert(events.size() == 1);
 
-				auto mbus_str = std::format("MBUS_ID={}", events[0].id);
-				auto nvme = fork();
-				if(!nvme) {
-					const char *env[] = { mbus_str.c_str(), nullptr };
-					execle("/usr/bin/runsvr", "/usr/bin/runsvr", "--fork", "bind", "/usr/lib/managarm/server/block-nvme.bin", nullptr, env);
-				}else assert(nvme != -1);
+				auto mbusId = std::to_string(events[0].id);
+				launchServer({"--fork", "bind", "/usr/lib/managarm/server/block-nvme.bin"},
+						mbusId.c_str());
 
 				interfaceUp = true;
 			}
@@ -324,14 +305,6 @@ int main() {
 	if (!rootPath->size())
 		throw std::runtime_error("Can't determine root device");
 
-#if defined (__x86_64__)
-	// Hack: Start UHCI only after EHCI devices are ready.
-	auto uhci = fork();
-	if(!uhci) {
-		execl("/usr/bin/runsvr", "/usr/bin/runsvr", "runsvr", "/usr/bin/uhci", nullptr);
-	}else assert(uhci != -1);
-#endif
-
 	std::cout << "init: Mounting " << *rootPath << std::endl;
 	if(mount(rootPath->data(), "/realfs", "ext2", 0, ""))
 		throw std::runtime_error("mount() failed");
@@ -119,12 +119,18 @@ async::result<ReadEntriesResult> DirectoryFile::readEntries() {
 	if(_iter != _node->_entries.end()) {
 		auto name = (*_iter)->getName();
 		_iter++;
+		_position++;
 		co_return name;
 	}else{
 		co_return std::nullopt;
 	}
 }
 
+async::result<protocols::fs::ReadEntriesBatchResult>
+DirectoryFile::readEntriesBatch(size_t max_size) {
+	return readDirentsBatch(_iter, _node->_entries.end(), _position, max_size);
+}
+
 helix::BorrowedDescriptor DirectoryFile::getPassthroughLane() {
 	return _passthrough;
 }
@@ -62,6 +62,7 @@ public:
 	void handleClose() override;
 
 	FutureMaybe<ReadEntriesResult> readEntries() override;
+	async::result<protocols::fs::ReadEntriesBatchResult> readEntriesBatch(size_t max_size) override;
 	helix::BorrowedDescriptor getPassthroughLane() override;
 
 private:
@@ -72,6 +73,8 @@ private:
 	async::cancellation_event _cancelServe;
 
 	std::set<std::shared_ptr<Link>, LinkCompare>::iterator _iter;
+	// Number of entries that were returned so far.
+	size_t _position = 0;
 };
 
 struct Link final : FsLink, std::enable_shared_from_this<Link> {
@@ -14,15 +14,13 @@ uint64_t convertToNanos(const timespec &ts, clockid_t clock, bool relative) {
 		nanos = UINT64_MAX;
 
 	if(relative) {
-		uint64_t now;
-		HEL_CHECK(helGetClock(&now));
+		auto now = clk::getClockNanos();
 		uint64_t r;
 		if(__builtin_add_overflow(now, nanos, &r))
 			return UINT64_MAX;
 		return r;
 	} else if(clock == CLOCK_REALTIME) {
-		uint64_t now;
-		HEL_CHECK(helGetClock(&now));
+		auto now = clk::getClockNanos();
 
 		// Transform real time to time since boot.
 		int64_t bootTime = clk::getRealtimeNanos() - now;
@@ -148,6 +148,12 @@ async::result<ReadEntriesResult> File::ptReadEntries(void *object) {
 	return self->readEntries();
 }
 
+async::result<protocols::fs::ReadEntriesBatchResult>
+File::ptReadEntriesBatch(void *object, size_t max_size) {
+	auto self = static_cast<File *>(object);
+	return self->readEntriesBatch(max_size);
+}
+
 async::result<frg::expected<protocols::fs::Error>> File::ptTruncate(void *object, size_t size) {
 	auto self = static_cast<File *>(object);
 	return self->truncate(size);
@@ -349,6 +355,10 @@ async::result<ReadEntriesResult> File::readEntries() {
 	throw std::runtime_error("posix: Object has no File::readEntries()");
 }
 
+async::result<protocols::fs::ReadEntriesBatchResult> File::readEntriesBatch(size_t) {
+	co_return protocols::fs::Error::illegalOperationTarget;
+}
+
 async::result<protocols::fs::RecvResult>
 File::recvMsg(Process *, uint32_t, void *, size_t,
 		void *, size_t, size_t) {
@@ -77,6 +77,9 @@ enum class Error {
 	alreadyConnected,
 
 	unsupportedSocketType,
+
+	// Corresponds with ELOOP
+	symbolicLinkLoop,
 };
 
 inline protocols::fs::Error operator|(Error e, protocols::fs::ToFsProtoError) {
@@ -139,8 +142,9 @@ inline managarm::posix::Errors operator|(Error e, ToPosixProtoError) {
 		case Error::noChildProcesses: return managarm::posix::Errors::NO_CHILD_PROCESSES;
 		case Error::alreadyConnected: return managarm::posix::Errors::ALREADY_CONNECTED;
 		case Error::unsupportedSocketType: return managarm::posix::Errors::UNSUPPORTED_SOCKET_TYPE;
+		case Error::symbolicLinkLoop: return managarm::posix::Errors::SYMBOLIC_LINK_LOOP;
+		case Error::badExecutable: return managarm::posix::Errors::BAD_EXECUTABLE;
 		case Error::fileClosed:
-		case Error::badExecutable:
 		case Error::seekOnPipe:
 		case Error::notConnected:
 		case Error::noSpaceLeft:
@@ -220,6 +224,9 @@ public:
 	static async::result<protocols::fs::ReadEntriesResult>
 	ptReadEntries(void *object);
 
+	static async::result<protocols::fs::ReadEntriesBatchResult>
+	ptReadEntriesBatch(void *object, size_t max_size);
+
 	static async::result<frg::expected<protocols::fs::Error>>
 	ptTruncate(void *object, size_t size);
 
@@ -284,6 +291,7 @@ public:
 		.write = &ptWrite,
 		.pwrite = &ptPwrite,
 		.readEntries = &ptReadEntries,
+		.readEntriesBatch = &ptReadEntriesBatch,
 		.accessMemory = &ptAccessMemory,
 		.truncate = &ptTruncate,
 		.fallocate = &ptAllocate,
@@ -394,6 +402,10 @@ public:
 
 	virtual FutureMaybe<ReadEntriesResult> readEntries();
 
+	// Returns as many entries as fit into max_size bytes (see protocols::fs::DirentBuilder).
+	// Returns illegalOperationTarget by default; clients fall back to readEntries() then.
+	virtual async::result<protocols::fs::ReadEntriesBatchResult> readEntriesBatch(size_t max_size);
+
 	virtual async::result<protocols::fs::RecvResult>
 		recvMsg(Process *process, uint32_t flags,
 			void *data, size_t max_length,
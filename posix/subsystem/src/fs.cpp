@@ -1,4 +1,5 @@
 
+#include <dirent.h>
 #include <linux/magic.h>
 #include <string.h>
 #include <sys/sysmacros.h>
@@ -198,3 +199,26 @@ void FsNode::notifyObservers(uint32_t events, const std::string &name, uint32_t
 	}
 }
 
+async::result<bool> appendDirent(protocols::fs::DirentBuilder &builder, FsLink *link, int64_t off) {
+	auto target = link->getTarget();
+
+	uint8_t type = DT_UNKNOWN;
+	switch(target->getType()) {
+	case VfsType::directory: type = DT_DIR; break;
+	case VfsType::regular: type = DT_REG; break;
+	case VfsType::symlink: type = DT_LNK; break;
+	case VfsType::charDevice: type = DT_CHR; break;
+	case VfsType::blockDevice: type = DT_BLK; break;
+	case VfsType::socket: type = DT_SOCK; break;
+	case VfsType::fifo: type = DT_FIFO; break;
+	case VfsType::null: break;
+	}
+
+	uint64_t ino = 0;
+	auto stats = co_await target->getStats();
+	if(stats)
+		ino = stats.value().inodeNumber;
+
+	// Directories in posix cannot be seeked; off is only reported to the client.
+	co_return builder.entry(ino, off, type, link->getName());
+}
@@ -208,6 +208,29 @@ private:
 	std::unordered_map<FsObserver *, std::shared_ptr<FsObserver>> _observers;
 };
 
+// Appends an entry for the link to the builder (for File::readEntriesBatch()).
+// off is the position of the next entry. Returns false if the entry does not fit.
+async::result<bool> appendDirent(protocols::fs::DirentBuilder &builder, FsLink *link, int64_t off);
+
+// Implements File::readEntriesBatch() for directories that iterate over a set of links.
+// Advances it (and position, i.e., the number of entries returned so far)
+// past all entries that were appended.
+template<typename It>
+async::result<protocols::fs::ReadEntriesBatchResult>
+readDirentsBatch(It &it, It end, size_t &position, size_t max_size) {
+	protocols::fs::DirentBuilder builder{max_size};
+	while(it != end) {
+		if(!(co_await appendDirent(builder, it->get(), position + 1)))
+			break;
+		it++;
+		position++;
+	}
+
+	if(it != end && !builder.numEntries())
+		co_return protocols::fs::Error::illegalArguments;
+	co_return builder.buffer();
+}
+
 // ----------------------------------------------------------------------------
 // SpecialLink class.
 // ----------------------------------------------------------------------------
@@ -58,6 +58,8 @@ async::result<void> serveSignals(std::shared_ptr<Process> self,
 		auto result = co_await self->signalContext()->pollSignal(sequence,
 				UINT64_C(-1), cancellation);
 		sequence = std::get<0>(result);
+		// The thread checks the pending set when it unblocks signals without a supercall.
+		self->publishPendingSignals();
 		//std::cout << "Calling helInterruptThread on " << self->pid() << std::endl;
 		HEL_CHECK(helInterruptThread(thread.getHandle()));
 	}
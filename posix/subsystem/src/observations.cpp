@@ -122,6 +122,9 @@ async::result<void> observeThread(std::shared_ptr<Process> self,
 
 		protocols::ostrace::Timer timer;
 
+		if(observe.observation() >= kHelObserveSuperCall)
+			self->countSupercall();
+
 		frg::scope_exit traceOnExit{[&] {
 			if(posix::ostContext.isActive()) {
 				posix::ostContext.emit(
@@ -199,6 +202,36 @@ async::result<void> observeThread(std::shared_ptr<Process> self,
 
 			HEL_CHECK(helResume(thread.getHandle()));
 			HEL_CHECK(helResume(new_thread));
+		}else if(observe.observation() == kHelObserveSuperCall + posix::superVfork) {
+			if(logRequests)
+				std::cout << "posix: vfork supercall" << std::endl;
+			auto child = Process::vfork(self);
+
+			// Copy registers from the current thread to the new one.
+			auto new_thread = child->threadDescriptor().getHandle();
+			uintptr_t pcrs[2], gprs[kHelNumGprs], thrs[2];
+			HEL_CHECK(helLoadRegisters(thread.getHandle(), kHelRegsProgram, &pcrs));
+			HEL_CHECK(helLoadRegisters(thread.getHandle(), kHelRegsGeneral, &gprs));
+			HEL_CHECK(helLoadRegisters(thread.getHandle(), kHelRegsThread, &thrs));
+
+			HEL_CHECK(helStoreRegisters(new_thread, kHelRegsProgram, &pcrs));
+			HEL_CHECK(helStoreRegisters(new_thread, kHelRegsThread, &thrs));
+
+			gprs[kHelRegError] = kHelErrNone;
+			gprs[kHelRegOut0] = 0;
+			HEL_CHECK(helStoreRegisters(new_thread, kHelRegsGeneral, &gprs));
+			HEL_CHECK(helResume(new_thread));
+
+			// The child runs on our stack; keep the current thread stopped until the child
+			// calls exec() or exits. Signals are delivered once the thread is resumed.
+			co_await child->awaitVforkRelease();
+			if(generation->inTermination)
+				break;
+			__atomic_store_n(&self->accessThreadPage()->tid, self->tid(), __ATOMIC_RELAXED);
+
+			gprs[kHelRegOut0] = child->pid();
+			HEL_CHECK(helStoreRegisters(thread.getHandle(), kHelRegsGeneral, &gprs));
+			HEL_CHECK(helResume(thread.getHandle()));
 		}else if(observe.observation() == kHelObserveSuperCall + posix::superClone) {
 			if(logRequests)
 				std::cout << "posix: clone supercall" << std::endl;
@@ -331,6 +364,7 @@ async::result<void> observeThread(std::shared_ptr<Process> self,
 			if(self->checkOrRequestSignalRaise()) {
 				auto active = co_await self->signalContext()->fetchSignal(
 						~self->signalMask(), true);
+				self->publishPendingSignals();
 				if(active) {
 					co_await self->signalContext()->raiseContext(active, self.get(), killed);
 				}
@@ -354,6 +388,7 @@ async::result<void> observeThread(std::shared_ptr<Process> self,
 						"in SIG_RAISE supercall" "\e[39m" << std::endl;
 			bool killed = false;
 			auto active = co_await self->signalContext()->fetchSignal(~self->signalMask(), true);
+			self->publishPendingSignals();
 			if(active)
 				co_await self->signalContext()->raiseContext(active, self.get(), killed);
 			if(killed)
@@ -421,6 +456,7 @@ async::result<void> observeThread(std::shared_ptr<Process> self,
 			if(self->checkOrRequestSignalRaise()) {
 				auto active = co_await self->signalContext()->fetchSignal(
 						~self->signalMask(), true);
+				self->publishPendingSignals();
 				if(active)
 					co_await self->signalContext()->raiseContext(active, self.get(), killed);
 			}
@@ -507,6 +543,17 @@ async::result<void> observeThread(std::shared_ptr<Process> self,
 			gprs[kHelRegOut0] = self->tid();
 			HEL_CHECK(helStoreRegisters(thread.getHandle(), kHelRegsGeneral, &gprs));
 			HEL_CHECK(helResume(thread.getHandle()));
+		}else if(observe.observation() == kHelObserveSuperCall + posix::superGetClockPage) {
+			if(logRequests)
+				std::cout << "posix: GET_CLOCK_PAGE supercall" << std::endl;
+
+			uintptr_t gprs[kHelNumGprs];
+			HEL_CHECK(helLoadRegisters(thread.getHandle(), kHelRegsGeneral, &gprs));
+
+			gprs[kHelRegError] = 0;
+			gprs[kHelRegOut0] = reinterpret_cast<uintptr_t>(self->clientClockPage());
+			HEL_CHECK(helStoreRegisters(thread.getHandle(), kHelRegsGeneral, &gprs));
+			HEL_CHECK(helResume(thread.getHandle()));
 		}else if(observe.observation() == kHelObserveSuperCall + posix::superSigGetPending) {
 			if(logRequests)
 				std::cout << "posix: SIG_GET_PENDING supercall" << std::endl;
@@ -593,6 +640,7 @@ async::result<void> observeThread(std::shared_ptr<Process> self,
 			if(self->checkOrRequestSignalRaise()) {
 				auto active = co_await self->signalContext()->fetchSignal(
 						~self->signalMask(), true);
+				self->publishPendingSignals();
 				if(active)
 					co_await self->signalContext()->raiseContext(active, self.get(), killed);
 			}
@@ -34,39 +34,18 @@ std::shared_ptr<VmContext> VmContext::create() {
 std::shared_ptr<VmContext> VmContext::clone(std::shared_ptr<VmContext> original) {
 	auto context = std::make_shared<VmContext>();
 
+	// The kernel copies all mappings at once (forking copy-on-write memory).
 	HelHandle space;
-	HEL_CHECK(helCreateSpace(&space));
+	HEL_CHECK(helForkSpace(original->_space.getHandle(), &space));
 	context->_space = helix::UniqueDescriptor(space);
 
 	for(const auto &entry : original->_areaTree) {
 		const auto &[address, area] = entry;
 
-		helix::UniqueDescriptor copyView;
-		if(area.copyOnWrite) {
-			HelHandle copyHandle;
-			HEL_CHECK(helForkMemory(area.copyView.getHandle(), &copyHandle));
-			copyView = helix::UniqueDescriptor{copyHandle};
-
-			void *pointer;
-			HelError error = helMapMemory(copyView.getHandle(), context->_space.getHandle(),
-					reinterpret_cast<void *>(address),
-					0, area.areaSize, area.nativeFlags, &pointer);
-			if(error != kHelErrNone && error != kHelErrAlreadyExists) {
-				HEL_CHECK(error);
-			}
-		}else{
-			void *pointer;
-			HEL_CHECK(helMapMemory(area.fileView.getHandle(), context->_space.getHandle(),
-					reinterpret_cast<void *>(address),
-					area.offset, area.areaSize, area.nativeFlags, &pointer));
-		}
-
 		Area copy;
 		copy.copyOnWrite = area.copyOnWrite;
 		copy.areaSize = area.areaSize;
 		copy.nativeFlags = area.nativeFlags;
-		copy.fileView = area.fileView.dup();
-		copy.copyView = std::move(copyView);
 		copy.file = area.file;
 		copy.offset = area.offset;
 		context->_areaTree.emplace(address, std::move(copy));
@@ -101,8 +80,6 @@ auto VmContext::splitAreaOn_(uintptr_t addr, size_t size) ->
 			right.copyOnWrite = area.copyOnWrite;
 			right.areaSize = area.areaSize - (addr - base);
 			right.nativeFlags = area.nativeFlags;
-			right.fileView = area.fileView.dup();
-			right.copyView = area.copyView.dup();
 			right.file = area.file;
 			right.offset = area.offset + (addr - base);
 
@@ -175,8 +152,6 @@ VmContext::mapFile(uintptr_t hint, helix::UniqueDescriptor memory,
 	area.copyOnWrite = copyOnWrite;
 	area.areaSize = alignedSize;
 	area.nativeFlags = nativeFlags;
-	area.fileView = std::move(memory);
-	area.copyView = std::move(copyView);
 	area.file = std::move(file);
 	area.offset = offset;
 	_areaTree.emplace(address, std::move(area));
@@ -214,8 +189,6 @@ async::result<void *> VmContext::remapFile(void *oldPointer,
 	area.copyOnWrite = it->second.copyOnWrite;
 	area.areaSize = alignedNewSize;
 	area.nativeFlags = it->second.nativeFlags;
-	area.fileView = std::move(it->second.fileView);
-	area.copyView = std::move(it->second.copyView);
 	area.file = std::move(it->second.file);
 	area.offset = it->second.offset;
 	_areaTree.erase(it);
@@ -233,7 +206,7 @@ async::result<void *> VmContext::remapFile(void *oldPointer,
 	co_return pointer;
 }
 
-async::result<void> VmContext::protectFile(void *pointer, size_t size, uint32_t protectionFlags) {
+async::result<Error> VmContext::protectFile(void *pointer, size_t size, uint32_t protectionFlags) {
 	size_t alignedSize = (size + 0xFFF) & ~size_t(0xFFF);
 	auto address = reinterpret_cast<uintptr_t>(pointer);
 
@@ -241,6 +214,9 @@ async::result<void> VmContext::protectFile(void *pointer, size_t size, uint32_t
 	auto &&submit = helix::submitProtectMemory(_space, &protect,
 			pointer, alignedSize, protectionFlags, helix::Dispatcher::global());
 	co_await submit.async_wait();
+	// The kernel refuses to make read-only pages (e.g., the clock page) writable.
+	if(protect.error() == kHelErrIllegalArgs)
+		co_return Error::accessDenied;
 	HEL_CHECK(protect.error());
 
 	auto [startIt, endIt] = splitAreaOn_(address, alignedSize);
@@ -252,6 +228,8 @@ async::result<void> VmContext::protectFile(void *pointer, size_t size, uint32_t
 			area.nativeFlags |= protectionFlags;
 		}
 	}
+
+	co_return Error::success;
 }
 
 void VmContext::unmapFile(void *pointer, size_t size) {
@@ -883,6 +861,19 @@ Process::~Process() {
 	_pgPointer->dropProcess(this);
 }
 
+void Process::initializeThreadPage_(uint64_t signalMask) {
+	auto page = accessThreadPage();
+	page->tid = tid();
+	page->pendingSignals = 0;
+	page->enteredSignalSeq = _enteredSignalSeq;
+	setSignalMask(signalMask);
+}
+
+void Process::publishPendingSignals() {
+	auto pending = std::get<1>(_signalContext->checkSignal());
+	__atomic_store_n(&accessThreadPage()->pendingSignals, pending, __ATOMIC_SEQ_CST);
+}
+
 bool Process::checkSignalRaise() {
 	auto p = reinterpret_cast<unsigned int *>(accessThreadPage());
 	unsigned int gsf = __atomic_load_n(p, __ATOMIC_RELAXED);
@@ -925,7 +916,7 @@ async::result<std::shared_ptr<Process>> Process::init(std::string path) {
 	process->_threadPageMapping = helix::Mapping{process->_threadPageMemory, 0, 0x1000};
 
 	// The initial signal mask allows all signals.
-	process->_signalMask = 0;
+	process->initializeThreadPage_(0);
 
 	auto [server_lane, client_lane] = helix::createStream();
 	HEL_CHECK(helTransferDescriptor(client_lane.getHandle(),
@@ -944,6 +935,10 @@ async::result<std::shared_ptr<Process>> Process::init(std::string path) {
 			process->_vmContext->getSpace().getHandle(),
 			nullptr, 0, 0x1000, kHelMapProtRead,
 			&process->_clientClkTrackerPage));
+	HEL_CHECK(helMapMemory(clk::clockPageMemory().getHandle(),
+			process->_vmContext->getSpace().getHandle(),
+			nullptr, 0, 0x1000, kHelMapProtRead,
+			&process->_clientClockPage));
 
 	process->_uid = 0;
 	process->_euid = 0;
@@ -997,25 +992,97 @@ std::shared_ptr<Process> Process::fork(std::shared_ptr<Process> original) {
 	process->_threadPageMapping = helix::Mapping{process->_threadPageMemory, 0, 0x1000};
 
 	// Signal masks are copied on fork().
-	process->_signalMask = original->_signalMask;
+	process->initializeThreadPage_(original->signalMask());
 
 	auto [server_lane, client_lane] = helix::createStream();
 	HEL_CHECK(helTransferDescriptor(client_lane.getHandle(),
 			process->_fileContext->getUniverse().getHandle(), &process->_clientPosixLane));
 	client_lane.release();
 
+	// The forked space shares all non-copy-on-write mappings with the parent
+	// (see helForkSpace()). Do not rely on that for the pages that posix maps:
+	// map the child's pages explicitly at the parent's addresses.
 	HEL_CHECK(helMapMemory(process->_threadPageMemory.getHandle(),
 			process->_vmContext->getSpace().getHandle(),
-			nullptr, 0, 0x1000, kHelMapProtRead | kHelMapProtWrite,
+			original->_clientThreadPage, 0, 0x1000,
+			kHelMapProtRead | kHelMapProtWrite | kHelMapFixed,
 			&process->_clientThreadPage));
 	HEL_CHECK(helMapMemory(process->_fileContext->fileTableMemory().getHandle(),
 			process->_vmContext->getSpace().getHandle(),
-			nullptr, 0, 0x1000, kHelMapProtRead,
+			original->_clientFileTable, 0, 0x1000,
+			kHelMapProtRead | kHelMapFixed,
 			&process->_clientFileTable));
 	HEL_CHECK(helMapMemory(clk::trackerPageMemory().getHandle(),
 			process->_vmContext->getSpace().getHandle(),
-			nullptr, 0, 0x1000, kHelMapProtRead,
+			original->_clientClkTrackerPage, 0, 0x1000,
+			kHelMapProtRead | kHelMapFixed,
 			&process->_clientClkTrackerPage));
+	HEL_CHECK(helMapMemory(clk::clockPageMemory().getHandle(),
+			process->_vmContext->getSpace().getHandle(),
+			original->_clientClockPage, 0, 0x1000,
+			kHelMapProtRead | kHelMapFixed,
+			&process->_clientClockPage));
+
+	process->_clientAuxBegin = original->_clientAuxBegin;
+	process->_clientAuxEnd = original->_clientAuxEnd;
+	process->_uid = original->_uid;
+	process->_euid = original->_euid;
+	process->_gid = original->_gid;
+	process->_egid = original->_egid;
+	original->_children.push_back(process);
+	process->_hull->initializeProcess(process.get());
+	process->_didExecute = false;
+
+	auto procfs_root = std::static_pointer_cast<procfs::DirectoryNode>(getProcfs()->getTarget());
+	process->_procfs_dir = procfs_root->createProcDirectory(std::to_string(process->_hull->getPid()), process.get());
+
+	HelHandle new_thread;
+	HEL_CHECK(helCreateThread(process->fileContext()->getUniverse().getHandle(),
+			process->vmContext()->getSpace().getHandle(), kHelAbiSystemV,
+			nullptr, nullptr, kHelThreadStopped, &new_thread));
+	process->_threadDescriptor = helix::UniqueDescriptor{new_thread};
+	process->_posixLane = std::move(server_lane);
+
+	auto generation = std::make_shared<Generation>();
+	process->_currentGeneration = generation;
+	async::detach(serve(process, std::move(generation)));
+
+	return process;
+}
+
+std::shared_ptr<Process> Process::vfork(std::shared_ptr<Process> original) {
+	auto hull = std::make_shared<PidHull>(nextPid++);
+	auto process = std::make_shared<Process>(std::move(hull), original.get());
+	process->_path = original->path();
+	process->_name = original->name();
+	process->_vmContext = original->_vmContext;
+	process->_fsContext = FsContext::clone(original->_fsContext);
+	process->_fileContext = FileContext::clone(original->_fileContext);
+	process->_signalContext = SignalContext::clone(original->_signalContext);
+	process->borrowsVmContext_ = true;
+
+	original->_pgPointer->reassociateProcess(process.get());
+
+	// The child runs on the parent's memory (while the parent is suspended),
+	// hence it also uses the parent's thread page. exec() allocates a new one.
+	process->_threadPageMemory = original->_threadPageMemory.dup();
+	process->_threadPageMapping = helix::Mapping{process->_threadPageMemory, 0, 0x1000};
+
+	// The (shared) thread page already contains the parent's signal mask,
+	// which is copied on vfork(). The TID is the child's until it releases the page
+	// (the parent restores it once it is resumed).
+	__atomic_store_n(&process->accessThreadPage()->tid, process->tid(), __ATOMIC_RELAXED);
+
+	auto [server_lane, client_lane] = helix::createStream();
+	HEL_CHECK(helTransferDescriptor(client_lane.getHandle(),
+			process->_fileContext->getUniverse().getHandle(), &process->_clientPosixLane));
+	client_lane.release();
+
+	// The child's file table is not mapped: until exec(), the child only sees the parent's.
+	process->_clientThreadPage = original->_clientThreadPage;
+	process->_clientFileTable = original->_clientFileTable;
+	process->_clientClkTrackerPage = original->_clientClkTrackerPage;
+	process->_clientClockPage = original->_clientClockPage;
 
 	process->_clientAuxBegin = original->_clientAuxBegin;
 	process->_clientAuxEnd = original->_clientAuxEnd;
@@ -1063,7 +1130,7 @@ std::shared_ptr<Process> Process::clone(std::shared_ptr<Process> original, void
 	process->_threadPageMapping = helix::Mapping{process->_threadPageMemory, 0, 0x1000};
 
 	// Signal masks are copied on clone().
-	process->_signalMask = original->_signalMask;
+	process->initializeThreadPage_(original->signalMask());
 
 	auto [server_lane, client_lane] = helix::createStream();
 	HEL_CHECK(helTransferDescriptor(client_lane.getHandle(),
@@ -1077,6 +1144,7 @@ std::shared_ptr<Process> Process::clone(std::shared_ptr<Process> original, void
 
 	process->_clientFileTable = original->_clientFileTable;
 	process->_clientClkTrackerPage = original->_clientClkTrackerPage;
+	process->_clientClockPage = original->_clientClockPage;
 
 	process->_clientAuxBegin = original->_clientAuxBegin;
 	process->_clientAuxEnd = original->_clientAuxEnd;
@@ -1105,6 +1173,89 @@ std::shared_ptr<Process> Process::clone(std::shared_ptr<Process> original, void
 	return process;
 }
 
+async::result<frg::expected<Error, std::shared_ptr<Process>>>
+Process::spawn(std::shared_ptr<Process> original, std::string path,
+		std::vector<std::string> args, std::vector<std::string> env,
+		std::shared_ptr<FileContext> fileContext, std::optional<uint64_t> signalMask) {
+	auto vmContext = VmContext::create();
+	auto fsContext = FsContext::clone(original->_fsContext);
+
+	// Load the program before allocating the PID such that we can simply bail out on errors.
+	// In contrast to fork() + exec(), the parent's address space is never copied.
+	auto execResult = FRG_CO_TRY(co_await execute(fsContext->getRoot(),
+			fsContext->getWorkingDirectory(),
+			path, std::move(args), std::move(env), vmContext,
+			fileContext->getUniverse(),
+			fileContext->clientMbusLane(), original.get()));
+	fileContext->closeOnExec();
+
+	auto hull = std::make_shared<PidHull>(nextPid++);
+	auto process = std::make_shared<Process>(std::move(hull), original.get());
+	size_t pos = path.rfind('/');
+	assert(pos != std::string::npos);
+	process->_name = path.substr(pos + 1);
+	process->_path = std::move(path);
+	process->_vmContext = std::move(vmContext);
+	process->_fsContext = std::move(fsContext);
+	process->_fileContext = std::move(fileContext);
+	process->_signalContext = SignalContext::clone(original->_signalContext);
+	process->_signalContext->resetHandlers();
+
+	original->_pgPointer->reassociateProcess(process.get());
+
+	HelHandle thread_memory;
+	HEL_CHECK(helAllocateMemory(0x1000, 0, nullptr, &thread_memory));
+	process->_threadPageMemory = helix::UniqueDescriptor{thread_memory};
+	process->_threadPageMapping = helix::Mapping{process->_threadPageMemory, 0, 0x1000};
+
+	process->initializeThreadPage_(signalMask.value_or(original->signalMask()));
+
+	auto [server_lane, client_lane] = helix::createStream();
+	HEL_CHECK(helTransferDescriptor(client_lane.getHandle(),
+			process->_fileContext->getUniverse().getHandle(), &process->_clientPosixLane));
+	client_lane.release();
+
+	HEL_CHECK(helMapMemory(process->_threadPageMemory.getHandle(),
+			process->_vmContext->getSpace().getHandle(),
+			nullptr, 0, 0x1000, kHelMapProtRead | kHelMapProtWrite,
+			&process->_clientThreadPage));
+	HEL_CHECK(helMapMemory(process->_fileContext->fileTableMemory().getHandle(),
+			process->_vmContext->getSpace().getHandle(),
+			nullptr, 0, 0x1000, kHelMapProtRead,
+			&process->_clientFileTable));
+	HEL_CHECK(helMapMemory(clk::trackerPageMemory().getHandle(),
+			process->_vmContext->getSpace().getHandle(),
+			nullptr, 0, 0x1000, kHelMapProtRead,
+			&process->_clientClkTrackerPage));
+	HEL_CHECK(helMapMemory(clk::clockPageMemory().getHandle(),
+			process->_vmContext->getSpace().getHandle(),
+			nullptr, 0, 0x1000, kHelMapProtRead,
+			&process->_clientClockPage));
+
+	process->_clientAuxBegin = execResult.auxBegin;
+	process->_clientAuxEnd = execResult.auxEnd;
+	process->_uid = original->_uid;
+	process->_euid = original->_euid;
+	process->_gid = original->_gid;
+	process->_egid = original->_egid;
+	original->_children.push_back(process);
+	process->_hull->initializeProcess(process.get());
+	process->_didExecute = true;
+
+	auto procfs_root = std::static_pointer_cast<procfs::DirectoryNode>(getProcfs()->getTarget());
+	process->_procfs_dir = procfs_root->createProcDirectory(std::to_string(process->_hull->getPid()), process.get());
+
+	process->_threadDescriptor = std::move(execResult.thread);
+	process->_posixLane = std::move(server_lane);
+
+	auto generation = std::make_shared<Generation>();
+	process->_currentGeneration = generation;
+	helResume(process->_threadDescriptor.getHandle());
+	async::detach(serve(process, std::move(generation)));
+
+	co_return process;
+}
+
 async::result<Error> Process::exec(std::shared_ptr<Process> process,
 		std::string path, std::vector<std::string> args, std::vector<std::string> env) {
 	auto exec_vm_context = VmContext::create();
@@ -1124,10 +1275,21 @@ async::result<Error> Process::exec(std::shared_ptr<Process> process,
 			process->_fileContext->getUniverse().getHandle(), &exec_posix_lane));
 	client_lane.release();
 
+	// Children created by vfork() share the thread page with their parent.
+	helix::UniqueDescriptor exec_thread_memory;
+	if(process->borrowsVmContext_) {
+		HelHandle handle;
+		HEL_CHECK(helAllocateMemory(0x1000, 0, nullptr, &handle));
+		exec_thread_memory = helix::UniqueDescriptor{handle};
+	}else{
+		exec_thread_memory = process->_threadPageMemory.dup();
+	}
+
 	void *exec_thread_page;
 	void *exec_clk_tracker_page;
+	void *exec_clock_page;
 	void *exec_client_table;
-	HEL_CHECK(helMapMemory(process->_threadPageMemory.getHandle(),
+	HEL_CHECK(helMapMemory(exec_thread_memory.getHandle(),
 			exec_vm_context->getSpace().getHandle(),
 			nullptr, 0, 0x1000, kHelMapProtRead | kHelMapProtWrite,
 			&exec_thread_page));
@@ -1135,6 +1297,10 @@ async::result<Error> Process::exec(std::shared_ptr<Process> process,
 			exec_vm_context->getSpace().getHandle(),
 			nullptr, 0, 0x1000, kHelMapProtRead,
 			&exec_clk_tracker_page));
+	HEL_CHECK(helMapMemory(clk::clockPageMemory().getHandle(),
+			exec_vm_context->getSpace().getHandle(),
+			nullptr, 0, 0x1000, kHelMapProtRead,
+			&exec_clock_page));
 	HEL_CHECK(helMapMemory(process->_fileContext->fileTableMemory().getHandle(),
 			exec_vm_context->getSpace().getHandle(),
 			nullptr, 0, 0x1000, kHelMapProtRead,
@@ -1166,10 +1332,20 @@ async::result<Error> Process::exec(std::shared_ptr<Process> process,
 	process->_clientPosixLane = exec_posix_lane;
 	process->_clientFileTable = exec_client_table;
 	process->_clientClkTrackerPage = exec_clk_tracker_page;
+	process->_clientClockPage = exec_clock_page;
 	process->_clientAuxBegin = execResult.auxBegin;
 	process->_clientAuxEnd = execResult.auxEnd;
 	process->_didExecute = true;
 
+	if(process->borrowsVmContext_) {
+		auto signalMask = process->signalMask();
+		process->_threadPageMemory = std::move(exec_thread_memory);
+		process->_threadPageMapping = helix::Mapping{process->_threadPageMemory, 0, 0x1000};
+		process->initializeThreadPage_(signalMask);
+		process->borrowsVmContext_ = false;
+		process->vforkRelease_.raise();
+	}
+
 	auto generation = std::make_shared<Generation>();
 	process->_currentGeneration = generation;
 	helResume(process->_threadDescriptor.getHandle());
@@ -1209,6 +1385,10 @@ async::result<void> Process::terminate(TerminationState state) {
 	_posixLane = {};
 	_threadDescriptor = {};
 	_vmContext = nullptr;
+	if(borrowsVmContext_) {
+		borrowsVmContext_ = false;
+		vforkRelease_.raise();
+	}
 	_fsContext = nullptr;
 	_fileContext = nullptr;
 	//_signalContext = nullptr; // TODO: Migrate the notifications to PID 1.
@@ -1304,6 +1484,10 @@ async::result<bool> Process::awaitNotifyTypeChange(async::cancellation_token tok
 	co_return co_await notifyTypeChange_.async_wait(token);
 }
 
+async::result<void> Process::awaitVforkRelease() {
+	co_await vforkRelease_.wait();
+}
+
 // --------------------------------------------------------------------------------------
 // Process groups and sessions.
 // --------------------------------------------------------------------------------------
@@ -9,6 +9,7 @@
 #include <async/recurring-event.hpp>
 #include <boost/intrusive/list.hpp>
 #include <frg/expected.hpp>
+#include <protocols/posix/data.hpp>
 #include <sys/time.h>
 
 #include "interval-timer.hpp"
@@ -42,7 +43,7 @@ struct VmContext {
 
 	async::result<void *> remapFile(void *old_pointer, size_t old_size, size_t new_size);
 
-	async::result<void> protectFile(void *pointer, size_t size, uint32_t protectionFlags);
+	async::result<Error> protectFile(void *pointer, size_t size, uint32_t protectionFlags);
 
 	void unmapFile(void *pointer, size_t size);
 
@@ -51,8 +52,6 @@ private:
 		bool copyOnWrite;
 		size_t areaSize;
 		uint32_t nativeFlags;
-		helix::UniqueDescriptor fileView;
-		helix::UniqueDescriptor copyView;
 		smarter::shared_ptr<File, FileHandle> file;
 		intptr_t offset;
 	};
@@ -351,9 +350,7 @@ struct Generation {
 	async::oneshot_event requestsDone;
 };
 
-struct ThreadPage {
-	int globalSignalFlag;
-};
+using ThreadPage = posix::ThreadPage;
 
 // --------------------------------------------------------------------------------------
 // The 'Process' class.
@@ -401,6 +398,19 @@ struct Process : std::enable_shared_from_this<Process> {
 	static std::shared_ptr<Process> fork(std::shared_ptr<Process> parent);
 	static std::shared_ptr<Process> clone(std::shared_ptr<Process> parent, void *ip, void *sp);
 
+	// Like fork() but the child borrows the parent's VmContext (and thread page)
+	// until it calls exec() or terminates; see awaitVforkRelease().
+	// The child may only issue supercalls, as its posix lane and file table
+	// are not visible in the parent's memory.
+	static std::shared_ptr<Process> vfork(std::shared_ptr<Process> parent);
+
+	// Creates a child that executes the given program (as posix_spawn()).
+	// The child uses the given FileContext, which is usually a clone of the parent's.
+	static async::result<frg::expected<Error, std::shared_ptr<Process>>>
+	spawn(std::shared_ptr<Process> parent, std::string path,
+			std::vector<std::string> args, std::vector<std::string> env,
+			std::shared_ptr<FileContext> fileContext, std::optional<uint64_t> signalMask);
+
 	static async::result<Error> exec(std::shared_ptr<Process> process,
 			std::string path, std::vector<std::string> args, std::vector<std::string> env);
 
@@ -530,18 +540,33 @@ public:
 	std::shared_ptr<ProcessGroup> pgPointer() { return _pgPointer; }
 	SignalContext *signalContext() { return _signalContext.get(); }
 
+	// The signal mask lives in the thread page such that the thread can change it
+	// without a supercall.
 	void setSignalMask(uint64_t mask) {
-		_signalMask = mask;
+		__atomic_store_n(&accessThreadPage()->signalMask, mask, __ATOMIC_SEQ_CST);
 	}
 
 	uint64_t signalMask() {
-		return _signalMask;
+		return __atomic_load_n(&accessThreadPage()->signalMask, __ATOMIC_SEQ_CST);
+	}
+
+	// Publishes the set of pending signals to the thread page.
+	// Must be called before the thread is interrupted to deliver a signal.
+	void publishPendingSignals();
+
+	uint64_t supercallCount() {
+		return supercallCount_;
+	}
+
+	void countSupercall() {
+		supercallCount_++;
 	}
 
 	HelHandle clientPosixLane() { return _clientPosixLane; }
 	void *clientThreadPage() { return _clientThreadPage; }
 	void *clientFileTable() { return _clientFileTable; }
 	void *clientClkTrackerPage() { return _clientClkTrackerPage; }
+	void *clientClockPage() { return _clientClockPage; }
 	void *clientAuxBegin() { return _clientAuxBegin; }
 	void *clientAuxEnd() { return _clientAuxEnd; }
 
@@ -605,6 +630,7 @@ public:
 
 	void enterSignal() {
 		_enteredSignalSeq++;
+		__atomic_store_n(&accessThreadPage()->enteredSignalSeq, _enteredSignalSeq, __ATOMIC_RELAXED);
 	}
 
 	void setParentDeathSignal(std::optional<int> sig) {
@@ -617,6 +643,9 @@ public:
 
 	async::result<bool> awaitNotifyTypeChange(async::cancellation_token token = {});
 
+	// Completes once a child created by vfork() stops borrowing its parent's VmContext.
+	async::result<void> awaitVforkRelease();
+
 	struct IntervalTimer : posix::IntervalTimer {
 		IntervalTimer(std::weak_ptr<Process> process, uint64_t initial, uint64_t interval)
 			: posix::IntervalTimer(initial, interval), process_{process} {}
@@ -684,6 +713,9 @@ public:
 	id_allocator<int> timerIdAllocator{};
 
 private:
+	// Writes the initial state to a newly mapped thread page.
+	void initializeThreadPage_(uint64_t signalMask);
+
 	Process *_parent;
 
 	std::shared_ptr<PidHull> _hull;
@@ -713,11 +745,11 @@ private:
 	void *_clientThreadPage;
 	void *_clientFileTable;
 	void *_clientClkTrackerPage;
+	void *_clientClockPage;
 	// Pointers to the aux vector in the client.
 	void *_clientAuxBegin = nullptr;
 	void *_clientAuxEnd = nullptr;
 
-	uint64_t _signalMask;
 	std::vector<std::shared_ptr<Process>> _children;
 
 	// The following intrusive queue stores notifications for wait().
@@ -752,6 +784,13 @@ private:
 	uint64_t _enteredSignalSeq = 0;
 
 	std::optional<int> parentDeathSignal_ = std::nullopt;
+
+	// Number of supercalls that the thread issued (exported via procfs).
+	uint64_t supercallCount_ = 0;
+
+	// True while this process (created by vfork()) borrows its parent's VmContext.
+	bool borrowsVmContext_ = false;
+	async::oneshot_event vforkRelease_;
 };
 
 std::shared_ptr<Process> findProcessWithCredentials(helix_ng::CredentialsView);
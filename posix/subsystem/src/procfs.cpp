@@ -1,3 +1,4 @@
+#include <format>
 #include <functional>
 #include <linux/magic.h>
 #include <print>
@@ -5,10 +6,13 @@
 #include <sstream>
 #include <iomanip>
 
+#include <bragi/helpers-std.hpp>
 #include <core/clock.hpp>
+#include <kerncfg.bragi.hpp>
 #include "common.hpp"
 #include "procfs.hpp"
 #include "process.hpp"
+#include "requests.hpp"
 
 #include <bitset>
 #include <sys/epoll.h>
@@ -141,12 +145,18 @@ async::result<ReadEntriesResult> DirectoryFile::readEntries() {
 	if(_iter != _node->_entries.end()) {
 		auto name = (*_iter)->getName();
 		_iter++;
+		_position++;
 		co_return name;
 	}else{
 		co_return std::nullopt;
 	}
 }
 
+async::result<protocols::fs::ReadEntriesBatchResult>
+DirectoryFile::readEntriesBatch(size_t max_size) {
+	return readDirentsBatch(_iter, _node->_entries.end(), _position, max_size);
+}
+
 helix::BorrowedDescriptor DirectoryFile::getPassthroughLane() {
 	return _passthrough;
 }
@@ -283,6 +293,11 @@ std::shared_ptr<Link> DirectoryNode::createRootDirectory() {
 	the_node->_entries.insert(std::move(self_thread_link));
 
 	the_node->directMkregular("uptime", std::make_shared<UptimeNode>());
+	the_node->directMkregular("meminfo", std::make_shared<MeminfoNode>());
+	the_node->directMkregular("interrupts", std::make_shared<InterruptsNode>());
+	the_node->directMkregular("irq_wakeups", std::make_shared<IrqWakeupsNode>());
+	the_node->directMkregular("sched_latency", std::make_shared<SchedLatencyNode>());
+	the_node->directMkregular("cpuidle", std::make_shared<CpuIdleNode>());
 	the_node->directMknode("mounts", std::make_shared<MountsLink>());
 
 	auto sysLink = the_node->directMkdir("sys");
@@ -462,6 +477,280 @@ async::result<void> UptimeNode::store(std::string) {
 	co_return;
 }
 
+async::result<std::string> MeminfoNode::show(Process *) {
+	managarm::kerncfg::GetMemoryInformationRequest req;
+	auto [offer, sendReq, recvResp] = co_await helix_ng::exchangeMsgs(
+		getKerncfgLane(),
+		helix_ng::offer(
+			helix_ng::sendBragiHeadOnly(req, frg::stl_allocator{}),
+			helix_ng::recvInline()
+		)
+	);
+	HEL_CHECK(offer.error());
+	HEL_CHECK(sendReq.error());
+	HEL_CHECK(recvResp.error());
+
+	auto resp = bragi::parse_head_only<managarm::kerncfg::GetMemoryInformationResponse>(recvResp);
+	assert(resp);
+	auto toKib = [&] (uint64_t units) {
+		return units * resp->memory_unit() / 1024;
+	};
+
+	// See man 5 proc for more details.
+	// Only a subset of the fields is supported.
+	std::stringstream stream;
+	auto field = [&] (const char *name, uint64_t units) {
+		stream << std::left << std::setw(16) << name
+				<< std::right << std::setw(8) << toKib(units) << " kB\n";
+	};
+	field("MemTotal:", resp->total_usable_memory());
+	field("MemFree:", resp->available_memory());
+	field("MemAvailable:", resp->available_memory());
+	field("Dirty:", resp->dirty_memory());
+	field("Writeback:", resp->writeback_memory());
+	co_return stream.str();
+}
+
+async::result<void> MeminfoNode::store(std::string) {
+	// TODO: proper error reporting.
+	std::cout << "posix: Can't store to a /proc/meminfo file" << std::endl;
+	co_return;
+}
+
+async::result<std::string> InterruptsNode::show(Process *) {
+	managarm::kerncfg::GetIrqStatisticsRequest req;
+	auto [offer, sendReq, recvHead] = co_await helix_ng::exchangeMsgs(
+		getKerncfgLane(),
+		helix_ng::offer(
+			helix_ng::want_lane,
+			helix_ng::sendBragiHeadOnly(req, frg::stl_allocator{}),
+			helix_ng::recvInline()
+		)
+	);
+	HEL_CHECK(offer.error());
+	HEL_CHECK(sendReq.error());
+	HEL_CHECK(recvHead.error());
+
+	auto preamble = bragi::read_preamble(recvHead);
+	assert(!preamble.error());
+
+	std::vector<std::byte> tailBuffer(preamble.tail_size());
+	auto [recvTail] = co_await helix_ng::exchangeMsgs(
+		offer.descriptor(),
+		helix_ng::recvBuffer(tailBuffer.data(), tailBuffer.size())
+	);
+	HEL_CHECK(recvTail.error());
+
+	auto resp = bragi::parse_head_tail<managarm::kerncfg::GetIrqStatisticsResponse>(recvHead, tailBuffer);
+	assert(resp);
+	auto numCpu = resp->num_cpu();
+	assert(resp->counts().size() == resp->names().size() * numCpu);
+
+	// See man 5 proc for more details.
+	// We number the IRQs in the order that thor registered them; the last
+	// column is the name of the IRQ pin.
+	std::stringstream stream;
+	stream << "    ";
+	for(size_t cpu = 0; cpu < numCpu; cpu++)
+		stream << std::setw(11) << ("CPU" + std::to_string(cpu));
+	stream << "\n";
+	for(size_t i = 0; i < resp->names().size(); i++) {
+		stream << std::setw(3) << i << ":";
+		for(size_t cpu = 0; cpu < numCpu; cpu++)
+			stream << " " << std::setw(10) << resp->counts()[i * numCpu + cpu];
+		stream << "  " << resp->names()[i] << "\n";
+	}
+	co_return stream.str();
+}
+
+async::result<void> InterruptsNode::store(std::string) {
+	// TODO: proper error reporting.
+	std::cout << "posix: Can't store to a /proc/interrupts file" << std::endl;
+	co_return;
+}
+
+async::result<std::string> IrqWakeupsNode::show(Process *) {
+	managarm::kerncfg::GetIrqStatisticsRequest req;
+	auto [offer, sendReq, recvHead] = co_await helix_ng::exchangeMsgs(
+		getKerncfgLane(),
+		helix_ng::offer(
+			helix_ng::want_lane,
+			helix_ng::sendBragiHeadOnly(req, frg::stl_allocator{}),
+			helix_ng::recvInline()
+		)
+	);
+	HEL_CHECK(offer.error());
+	HEL_CHECK(sendReq.error());
+	HEL_CHECK(recvHead.error());
+
+	auto preamble = bragi::read_preamble(recvHead);
+	assert(!preamble.error());
+
+	std::vector<std::byte> tailBuffer(preamble.tail_size());
+	auto [recvTail] = co_await helix_ng::exchangeMsgs(
+		offer.descriptor(),
+		helix_ng::recvBuffer(tailBuffer.data(), tailBuffer.size())
+	);
+	HEL_CHECK(recvTail.error());
+
+	auto resp = bragi::parse_head_tail<managarm::kerncfg::GetIrqStatisticsResponse>(recvHead, tailBuffer);
+	assert(resp);
+	auto numCpu = resp->num_cpu();
+	assert(resp->counts().size() == resp->names().size() * numCpu);
+	assert(resp->wakeups().size() == resp->names().size());
+
+	// One line per IRQ (numbered as in /proc/interrupts). IRQs that kernlets
+	// acknowledge or reject in the kernel do not wake up the driver.
+	std::stringstream stream;
+	stream << std::setw(3) << "irq" << " " << std::setw(12) << "interrupts"
+			<< " " << std::setw(12) << "wakeups" << " " << std::setw(8) << "ratio" << "\n";
+	for(size_t i = 0; i < resp->names().size(); i++) {
+		uint64_t interrupts = 0;
+		for(size_t cpu = 0; cpu < numCpu; cpu++)
+			interrupts += resp->counts()[i * numCpu + cpu];
+		auto wakeups = resp->wakeups()[i];
+
+		stream << std::setw(3) << i << " " << std::setw(12) << interrupts
+				<< " " << std::setw(12) << wakeups << " " << std::setw(8);
+		if(wakeups) {
+			stream << std::fixed << std::setprecision(2)
+					<< static_cast<double>(interrupts) / wakeups;
+		}else{
+			stream << "-";
+		}
+		stream << "  " << resp->names()[i] << "\n";
+	}
+	co_return stream.str();
+}
+
+async::result<void> IrqWakeupsNode::store(std::string) {
+	// TODO: proper error reporting.
+	std::cout << "posix: Can't store to a /proc/irq_wakeups file" << std::endl;
+	co_return;
+}
+
+async::result<std::string> SchedLatencyNode::show(Process *) {
+	managarm::kerncfg::GetSchedLatencyRequest req;
+	auto [offer, sendReq, recvHead] = co_await helix_ng::exchangeMsgs(
+		getKerncfgLane(),
+		helix_ng::offer(
+			helix_ng::want_lane,
+			helix_ng::sendBragiHeadOnly(req, frg::stl_allocator{}),
+			helix_ng::recvInline()
+		)
+	);
+	HEL_CHECK(offer.error());
+	HEL_CHECK(sendReq.error());
+	HEL_CHECK(recvHead.error());
+
+	auto preamble = bragi::read_preamble(recvHead);
+	assert(!preamble.error());
+
+	std::vector<std::byte> tailBuffer(preamble.tail_size());
+	auto [recvTail] = co_await helix_ng::exchangeMsgs(
+		offer.descriptor(),
+		helix_ng::recvBuffer(tailBuffer.data(), tailBuffer.size())
+	);
+	HEL_CHECK(recvTail.error());
+
+	auto resp = bragi::parse_head_tail<managarm::kerncfg::GetSchedLatencyResponse>(recvHead, tailBuffer);
+	assert(resp);
+	auto numBuckets = resp->num_buckets();
+	constexpr const char *classes[] = {"fair", "realtime", "deadline"};
+	assert(resp->counts().size() == numBuckets * std::size(classes));
+
+	// One line per latency bucket; the label is the upper bound of the bucket.
+	std::stringstream stream;
+	stream << std::setw(12) << "latency";
+	for(auto name : classes)
+		stream << " " << std::setw(12) << name;
+	stream << "\n";
+	for(size_t b = 0; b < numBuckets; b++) {
+		std::string label;
+		if(b + 1 == numBuckets) {
+			label = ">=" + std::to_string(uint64_t{1} << (b - 1)) + "us";
+		}else{
+			label = "<" + std::to_string(uint64_t{1} << b) + "us";
+		}
+		stream << std::setw(12) << label;
+		for(size_t c = 0; c < std::size(classes); c++)
+			stream << " " << std::setw(12) << resp->counts()[c * numBuckets + b];
+		stream << "\n";
+	}
+	co_return stream.str();
+}
+
+async::result<void> SchedLatencyNode::store(std::string) {
+	// TODO: proper error reporting.
+	std::cout << "posix: Can't store to a /proc/sched_latency file" << std::endl;
+	co_return;
+}
+
+async::result<std::string> CpuIdleNode::show(Process *) {
+	managarm::kerncfg::GetIdleStatisticsRequest req;
+	auto [offer, sendReq, recvHead] = co_await helix_ng::exchangeMsgs(
+		getKerncfgLane(),
+		helix_ng::offer(
+			helix_ng::want_lane,
+			helix_ng::sendBragiHeadOnly(req, frg::stl_allocator{}),
+			helix_ng::recvInline()
+		)
+	);
+	HEL_CHECK(offer.error());
+	HEL_CHECK(sendReq.error());
+	HEL_CHECK(recvHead.error());
+
+	auto preamble = bragi::read_preamble(recvHead);
+	assert(!preamble.error());
+
+	std::vector<std::byte> tailBuffer(preamble.tail_size());
+	auto [recvTail] = co_await helix_ng::exchangeMsgs(
+		offer.descriptor(),
+		helix_ng::recvBuffer(tailBuffer.data(), tailBuffer.size())
+	);
+	HEL_CHECK(recvTail.error());
+
+	auto resp = bragi::parse_head_tail<managarm::kerncfg::GetIdleStatisticsResponse>(recvHead, tailBuffer);
+	assert(resp);
+	auto numCpu = resp->num_cpu();
+	auto numStates = resp->num_states();
+	assert(resp->names().size() == numStates);
+	assert(resp->entries().size() == numCpu * numStates);
+	assert(resp->residency().size() == numCpu * numStates);
+	assert(resp->wakeups().size() == numCpu);
+	assert(resp->wakeup_latency().size() == numCpu);
+
+	// One line per CPU and idle state, followed by one line per CPU with the
+	// number of wakeups and their average latency.
+	std::stringstream stream;
+	stream << std::setw(5) << "cpu" << " " << std::setw(10) << "state"
+			<< " " << std::setw(12) << "entries" << " " << std::setw(14) << "time_us" << "\n";
+	for(size_t cpu = 0; cpu < numCpu; cpu++) {
+		for(size_t s = 0; s < numStates; s++) {
+			stream << std::setw(5) << cpu << " " << std::setw(10) << resp->names()[s]
+					<< " " << std::setw(12) << resp->entries()[cpu * numStates + s]
+					<< " " << std::setw(14) << resp->residency()[cpu * numStates + s] / 1000
+					<< "\n";
+		}
+	}
+	stream << "\n";
+	stream << std::setw(5) << "cpu" << " " << std::setw(12) << "wakeups"
+			<< " " << std::setw(14) << "avg_latency_ns" << "\n";
+	for(size_t cpu = 0; cpu < numCpu; cpu++) {
+		auto wakeups = resp->wakeups()[cpu];
+		stream << std::setw(5) << cpu << " " << std::setw(12) << wakeups
+				<< " " << std::setw(14) << (wakeups ? resp->wakeup_latency()[cpu] / wakeups : 0)
+				<< "\n";
+	}
+	co_return stream.str();
+}
+
+async::result<void> CpuIdleNode::store(std::string) {
+	// TODO: proper error reporting.
+	std::cout << "posix: Can't store to a /proc/cpuidle file" << std::endl;
+	co_return;
+}
+
 async::result<std::string> OstypeNode::show(Process *) {
 	// See man 5 proc for more details.
 	// Based on the man page from Linux man-pages 6.01, updated on 2022-10-09.
@@ -790,10 +1079,11 @@ async::result<std::string> StatusNode::show(Process *) {
 	stream << "Threads: 1\n"; // Number of threads in this process, hardcode to 1 for now.
 	// Signal related information, we should fill this out properly eventually.
 	stream << "SigQ: N/A\n";
-	// Masks of pending, blocked, ignored and caught signals, zero them all.
-	stream << "SigPnd: 0000000000000000\n";
+	// Masks of pending, blocked, ignored and caught signals.
+	// Ignored and caught signals are not reported yet.
+	stream << std::format("SigPnd: {:016x}\n", std::get<1>(_process->signalContext()->checkSignal()));
 	stream << "ShdPnd: 0000000000000000\n";
-	stream << "SigBlk: 0000000000000000\n";
+	stream << std::format("SigBlk: {:016x}\n", _process->signalMask());
 	stream << "SigIgn: 0000000000000000\n";
 	stream << "SigCgt: 0000000000000000\n";
 	// End of signal related information.
@@ -816,6 +1106,8 @@ async::result<std::string> StatusNode::show(Process *) {
 	stream << "Mems_allowed_list: N/A\n";
 	stream << "voluntary_ctxt_switches: N/A\n";
 	stream << "nonvoluntary_ctxt_switches: N/A\n";
+	// Managarm specific: number of supercalls (i.e., thread observations) so far.
+	stream << "Supercalls: " << _process->supercallCount() << "\n";
 	co_return stream.str();
 }
 
@@ -68,6 +68,7 @@ public:
 	void handleClose() override;
 
 	FutureMaybe<ReadEntriesResult> readEntries() override;
+	async::result<protocols::fs::ReadEntriesBatchResult> readEntriesBatch(size_t max_size) override;
 	helix::BorrowedDescriptor getPassthroughLane() override;
 
 private:
@@ -78,6 +79,8 @@ private:
 	async::cancellation_event _cancelServe;
 
 	std::set<std::shared_ptr<Link>, LinkCompare>::iterator _iter;
+	// Number of entries that were returned so far.
+	size_t _position = 0;
 };
 
 struct Link final : FsLink, std::enable_shared_from_this<Link> {
@@ -268,6 +271,44 @@ struct UptimeNode final : RegularNode {
 	async::result<void> store(std::string) override;
 };
 
+struct MeminfoNode final : RegularNode {
+	MeminfoNode() {}
+
+	async::result<std::string> show(Process *) override;
+	async::result<void> store(std::string) override;
+};
+
+struct InterruptsNode final : RegularNode {
+	InterruptsNode() {}
+
+	async::result<std::string> show(Process *) override;
+	async::result<void> store(std::string) override;
+};
+
+// Not present on Linux; exposes how many IRQs actually woke up their drivers.
+struct IrqWakeupsNode final : RegularNode {
+	IrqWakeupsNode() {}
+
+	async::result<std::string> show(Process *) override;
+	async::result<void> store(std::string) override;
+};
+
+// Not present on Linux; exposes the scheduler's wakeup-to-run latency histograms.
+struct SchedLatencyNode final : RegularNode {
+	SchedLatencyNode() {}
+
+	async::result<std::string> show(Process *) override;
+	async::result<void> store(std::string) override;
+};
+
+// Not present on Linux; exposes thor's per-CPU idle state residency and wakeup latencies.
+struct CpuIdleNode final : RegularNode {
+	CpuIdleNode() {}
+
+	async::result<std::string> show(Process *) override;
+	async::result<void> store(std::string) override;
+};
+
 struct OstypeNode final : RegularNode {
 	OstypeNode() {}
 
@@ -31,6 +31,10 @@ bool logAttrs = false;
 
 int nextPtsIndex = 0;
 
+// Number of bytes that can be queued in each direction. Writers block
+// (or fail with EAGAIN) while the queue that they write to is full.
+constexpr size_t queueCapacity = 64 * 1024;
+
 extern std::shared_ptr<RootLink> globalRootLink;
 
 //-----------------------------------------------------------------------------
@@ -42,9 +46,52 @@ struct Packet {
 	size_t offset = 0;
 };
 
+// Fixed-capacity FIFO of bytes.
+struct ByteRing {
+	ByteRing(size_t capacity)
+	: _buffer{std::make_unique<char[]>(capacity)}, _capacity{capacity} { }
+
+	size_t size() {
+		return _size;
+	}
+
+	size_t space() {
+		return _capacity - _size;
+	}
+
+	// Copies as many bytes as fit into the ring. Returns the number of bytes copied.
+	size_t write(const char *data, size_t length) {
+		auto n = std::min(length, space());
+		auto tail = (_head + _size) % _capacity;
+		auto first = std::min(n, _capacity - tail);
+		memcpy(_buffer.get() + tail, data, first);
+		memcpy(_buffer.get(), data + first, n - first);
+		_size += n;
+		return n;
+	}
+
+	// Removes up to length bytes from the ring. Returns the number of bytes copied.
+	size_t read(char *data, size_t length) {
+		auto n = std::min(length, _size);
+		auto first = std::min(n, _capacity - _head);
+		memcpy(data, _buffer.get() + _head, first);
+		memcpy(data + first, _buffer.get(), n - first);
+		_head = (_head + n) % _capacity;
+		_size -= n;
+		return n;
+	}
+
+private:
+	std::unique_ptr<char[]> _buffer;
+	size_t _capacity;
+	size_t _head = 0;
+	size_t _size = 0;
+};
+
 struct Channel {
 	Channel(int pts_index)
-	: ptsIndex{pts_index}, currentSeq{1}, masterInSeq{0}, slaveInSeq{0} {
+	: ptsIndex{pts_index}, currentSeq{1}, masterInSeq{0}, slaveInSeq{0},
+			masterOutSeq{1}, slaveOutSeq{1}, masterQueue{queueCapacity} {
 		memset(&activeSettings, 0, sizeof(struct termios));
 		// cflag: Linux also stores a baud rate here.
 		// lflag: Linux additionally sets ECHOCTL, ECHOKE (which we do not have).
@@ -71,6 +118,24 @@ struct Channel {
 
 	async::result<void> commonIoctl(Process *process, uint32_t id, helix_ng::RecvInlineResult msg, helix::UniqueLane conversation);
 
+	// True if input can be passed to the slave without per-character processing.
+	bool rawInput() {
+		return !(activeSettings.c_lflag & (ICANON | ECHO | ISIG))
+				&& !(activeSettings.c_iflag & (ISTRIP | IGNCR | ICRNL | INLCR | IUCLC));
+	}
+
+	// Queues a packet for the slave.
+	void enqueueInput(Packet packet) {
+		slaveQueueSize += packet.buffer.size() - packet.offset;
+		slaveQueue.push_back(std::move(packet));
+		slaveInSeq = ++currentSeq;
+		statusBell.raise();
+	}
+
+	// Performs output processing and copies as much data as fits into the master queue.
+	// Returns the number of input bytes that were consumed.
+	size_t writeOutput(const char *data, size_t length);
+
 	int ptsIndex;
 	ControllingTerminalState cts;
 
@@ -86,46 +151,58 @@ struct Channel {
 	uint64_t currentSeq;
 	uint64_t masterInSeq;
 	uint64_t slaveInSeq;
-
-	// The actual queue of this pipe.
-	std::deque<Packet> masterQueue;
+	// Sequence numbers at which space became available in the queue that the side writes to.
+	uint64_t masterOutSeq;
+	uint64_t slaveOutSeq;
+	// Sequence number at which the peer of the respective side hung up.
+	uint64_t masterHupSeq = 0;
+	uint64_t slaveHupSeq = 0;
+
+	// The master hangs up when it is closed, the slave when its last file is closed.
+	bool masterClosed = false;
+	int slaveCount = 0;
+	bool slaveClosed = false;
+
+	// Output of the slave. Output is not packetized, hence a ring suffices.
+	ByteRing masterQueue;
+
+	// Input of the slave. Packets delimit lines in canonical mode.
 	std::deque<Packet> slaveQueue;
+	size_t slaveQueueSize = 0;
 };
 
-namespace {
-
-void processOut(const char c, Packet &packet, std::shared_ptr<Channel> channel) {
-	if(!(channel->activeSettings.c_oflag & OPOST)) {
-		packet.buffer.push_back(c);
-		return;
-	}
-
-	if((channel->activeSettings.c_oflag & ONLCR) && c == '\n') {
-		packet.buffer.push_back('\r');
-		packet.buffer.push_back('\n');
-		return;
+size_t Channel::writeOutput(const char *data, size_t length) {
+	if(!(activeSettings.c_oflag & OPOST) || !(activeSettings.c_oflag & ONLCR))
+		return masterQueue.write(data, length);
+
+	// Copy everything up to the next newline in bulk, then translate the newline.
+	size_t progress = 0;
+	while(progress < length) {
+		auto newline = static_cast<const char *>(memchr(data + progress, '\n', length - progress));
+		auto chunk = newline ? (newline - data) - progress : length - progress;
+		auto written = masterQueue.write(data + progress, chunk);
+		progress += written;
+		if(written < chunk || !newline)
+			break;
+
+		if(masterQueue.space() < 2)
+			break;
+		masterQueue.write("\r\n", 2);
+		progress++;
 	}
-
-	packet.buffer.push_back(c);
-
-	return;
+	return progress;
 }
 
+namespace {
+
 void processIn(const char character, Packet &packet, std::shared_ptr<Channel> channel) {
 	auto enqueuePacket = [&channel](Packet packet) {
-		channel->slaveQueue.push_back(std::move(packet));
-		channel->slaveInSeq = ++channel->currentSeq;
-		channel->statusBell.raise();
+		channel->enqueueInput(std::move(packet));
 	};
 
+	// Echoed characters that do not fit into the master queue are dropped.
 	auto enqueueOut = [&channel](Packet packet) {
-		Packet parsed{};
-
-		for(auto c : packet.buffer) {
-			processOut(c, parsed, channel);
-		}
-
-		channel->masterQueue.push_back(std::move(parsed));
+		channel->writeOutput(packet.buffer.data(), packet.buffer.size());
 		channel->masterInSeq = ++channel->currentSeq;
 		channel->statusBell.raise();
 	};
@@ -371,6 +448,8 @@ public:
 	MasterFile(std::shared_ptr<MountView> mount, std::shared_ptr<FsLink> link,
 			bool nonBlocking);
 
+	void handleClose() override;
+
 	async::result<frg::expected<Error, size_t>>
 	readSome(Process *, void *data, size_t maxLength) override;
 
@@ -435,6 +514,8 @@ public:
 	SlaveFile(std::shared_ptr<MountView> mount, std::shared_ptr<FsLink> link,
 			std::shared_ptr<Channel> channel, bool nonBlock);
 
+	void handleClose() override;
+
 	async::result<frg::expected<Error, size_t>>
 	readSome(Process *, void *data, size_t maxLength) override;
 
@@ -471,7 +552,6 @@ private:
 	helix::UniqueLane _passthrough;
 
 	std::shared_ptr<Channel> _channel;
-	Packet _packet{};
 
 	bool nonBlock_;
 };
@@ -754,6 +834,13 @@ MasterFile::MasterFile(std::shared_ptr<MountView> mount, std::shared_ptr<FsLink>
 			std::make_shared<DeviceNode>(DeviceId{136, _channel->ptsIndex}));
 }
 
+void MasterFile::handleClose() {
+	// Wake up slave readers and writers; they observe the hangup.
+	_channel->masterClosed = true;
+	_channel->slaveHupSeq = ++_channel->currentSeq;
+	_channel->statusBell.raise();
+}
+
 async::result<frg::expected<Error, size_t>>
 MasterFile::readSome(Process *, void *data, size_t maxLength) {
 	if(logReadWrite)
@@ -761,19 +848,21 @@ MasterFile::readSome(Process *, void *data, size_t maxLength) {
 	if(!maxLength)
 		co_return 0;
 
-	if (_channel->masterQueue.empty() && _nonBlocking)
-		co_return Error::wouldBlock;
-
-	while(_channel->masterQueue.empty())
+	while(!_channel->masterQueue.size()) {
+		// Like Linux, report EIO once all slaves are closed.
+		if(_channel->slaveClosed)
+			co_return Error::ioError;
+		if(_nonBlocking)
+			co_return Error::wouldBlock;
 		co_await _channel->statusBell.async_wait();
+	}
 
-	auto packet = &_channel->masterQueue.front();
-	size_t chunk = std::min(packet->buffer.size() - packet->offset, maxLength);
+	auto chunk = _channel->masterQueue.read(reinterpret_cast<char *>(data), maxLength);
 	assert(chunk); // Otherwise, we return above due to !maxLength.
-	memcpy(data, packet->buffer.data() + packet->offset, chunk);
-	packet->offset += chunk;
-	if(packet->offset == packet->buffer.size())
-		_channel->masterQueue.pop_front();
+
+	// Wake up writers that wait for space.
+	_channel->slaveOutSeq = ++_channel->currentSeq;
+	_channel->statusBell.raise();
 	co_return chunk;
 }
 
@@ -782,24 +871,45 @@ MasterFile::writeAll(Process *, const void *data, size_t length) {
 	if(logReadWrite)
 		std::cout << std::format("posix: Write to tty {} of size {}\n", structName(), length);
 
-	auto enqueuePacket = [this](Packet packet) {
-		_channel->slaveQueue.push_back(std::move(packet));
-		_channel->slaveInSeq = ++_channel->currentSeq;
-		_channel->statusBell.raise();
-	};
-
 	auto s = reinterpret_cast<const char *>(data);
-	for(size_t i = 0; i < length; i++) {
-		processIn(s[i], _packet, _channel);
-	}
+	size_t progress = 0;
+	while(progress < length) {
+		if(_channel->slaveQueueSize >= queueCapacity) {
+			// Nobody will drain the queue anymore.
+			if(_channel->slaveClosed) {
+				if(progress)
+					break;
+				co_return Error::ioError;
+			}
+			if(_nonBlocking) {
+				if(progress)
+					break;
+				co_return Error::wouldBlock;
+			}
+			co_await _channel->statusBell.async_wait();
+			continue;
+		}
 
-	// Check whether all data was discarded above.
-	if(!(_channel->activeSettings.c_lflag & ICANON)) {
-		enqueuePacket(std::move(_packet));
-		_packet = Packet{};
+		auto chunk = std::min(length - progress, queueCapacity - _channel->slaveQueueSize);
+		if(_channel->rawInput()) {
+			// Fast path: no input processing and no echo.
+			Packet packet;
+			packet.buffer.assign(s + progress, s + progress + chunk);
+			_channel->enqueueInput(std::move(packet));
+		}else{
+			for(size_t i = 0; i < chunk; i++)
+				processIn(s[progress + i], _packet, _channel);
+
+			// Check whether all data was discarded above.
+			if(!(_channel->activeSettings.c_lflag & ICANON) && !_packet.buffer.empty()) {
+				_channel->enqueueInput(std::move(_packet));
+				_packet = Packet{};
+			}
+		}
+		progress += chunk;
 	}
 
-	co_return length;
+	co_return progress;
 }
 
 async::result<frg::expected<Error, ControllingTerminalState *>>
@@ -817,20 +927,26 @@ MasterFile::pollWait(Process *, uint64_t past_seq, int mask,
 			&& !cancellation.is_cancellation_requested())
 		co_await _channel->statusBell.async_wait(cancellation);
 
-	// For now making pts files always writable is sufficient.
-	int edges = EPOLLOUT;
+	int edges = 0;
 	if(_channel->masterInSeq > past_seq)
 		edges |= EPOLLIN;
+	if(_channel->masterOutSeq > past_seq)
+		edges |= EPOLLOUT;
+	if(_channel->masterHupSeq > past_seq)
+		edges |= EPOLLHUP;
 
 	co_return PollWaitResult{_channel->currentSeq, edges};
 }
 
 async::result<frg::expected<Error, PollStatusResult>>
 MasterFile::pollStatus(Process *) {
-	// For now making pts files always writable is sufficient.
-	int events = EPOLLOUT;
-	if(!_channel->masterQueue.empty())
+	int events = 0;
+	if(_channel->masterQueue.size())
 		events |= EPOLLIN;
+	if(_channel->slaveQueueSize < queueCapacity)
+		events |= EPOLLOUT;
+	if(_channel->slaveClosed)
+		events |= EPOLLHUP;
 
 	co_return PollStatusResult{_channel->currentSeq, events};
 }
@@ -884,11 +1000,7 @@ async::result<void> MasterFile::ioctl(Process *process, uint32_t id, helix_ng::R
 		}else if(req->command() == FIONREAD) {
 			managarm::fs::GenericIoctlReply resp;
 
-			size_t count = std::transform_reduce(_channel->masterQueue.begin(), _channel->masterQueue.end(), size_t{0}, std::plus<>(), [] (const Packet &p) {
-				return p.buffer.size() - p.offset;
-			});
-
-			resp.set_fionread_count(count);
+			resp.set_fionread_count(_channel->masterQueue.size());
 			resp.set_error(managarm::fs::Errors::SUCCESS);
 
 			auto ser = resp.SerializeAsString();
@@ -978,7 +1090,18 @@ SlaveFile::SlaveFile(std::shared_ptr<MountView> mount, std::shared_ptr<FsLink> l
 		std::shared_ptr<Channel> channel, bool nonBlock)
 : File{FileKind::unknown,  StructName::get("pts.slave"), std::move(mount), std::move(link),
 		File::defaultIsTerminal | File::defaultPipeLikeSeek},
-		_channel{std::move(channel)}, nonBlock_{nonBlock} { }
+		_channel{std::move(channel)}, nonBlock_{nonBlock} {
+	_channel->slaveCount++;
+	_channel->slaveClosed = false;
+}
+
+void SlaveFile::handleClose() {
+	if(_channel->slaveCount-- == 1) {
+		_channel->slaveClosed = true;
+		_channel->masterHupSeq = ++_channel->currentSeq;
+		_channel->statusBell.raise();
+	}
+}
 
 async::result<frg::expected<Error, size_t>>
 SlaveFile::readSome(Process *, void *data, size_t maxLength) {
@@ -988,6 +1111,9 @@ SlaveFile::readSome(Process *, void *data, size_t maxLength) {
 		co_return 0;
 
 	while(_channel->slaveQueue.empty()){
+		// After a hangup, reads return EOF.
+		if(_channel->masterClosed)
+			co_return 0;
 		if(nonBlock_){
 			if(logReadWrite)
 				std::cout << "posix: tty would block" << std::endl;
@@ -1003,6 +1129,13 @@ SlaveFile::readSome(Process *, void *data, size_t maxLength) {
 	packet->offset += chunk;
 	if(packet->offset == packet->buffer.size())
 		_channel->slaveQueue.pop_front();
+
+	// Wake up writers that wait for space.
+	if(chunk) {
+		_channel->slaveQueueSize -= chunk;
+		_channel->masterOutSeq = ++_channel->currentSeq;
+		_channel->statusBell.raise();
+	}
 	co_return chunk;
 }
 
@@ -1015,18 +1148,32 @@ SlaveFile::writeAll(Process *, const void *data, size_t length) {
 	if(!length)
 		co_return {};
 
-	// Perform output processing.
-	for(size_t i = 0; i < length; i++) {
-		char c;
-		memcpy(&c, reinterpret_cast<const char *>(data) + i, 1);
-		processOut(c, _packet, _channel);
-	}
+	auto s = reinterpret_cast<const char *>(data);
+	size_t progress = 0;
+	while(progress < length) {
+		// Like Linux, writes after a hangup fail with EIO.
+		if(_channel->masterClosed) {
+			if(progress)
+				break;
+			co_return Error::ioError;
+		}
+		auto chunk = _channel->writeOutput(s + progress, length - progress);
+		if(chunk) {
+			progress += chunk;
+			_channel->masterInSeq = ++_channel->currentSeq;
+			_channel->statusBell.raise();
+			continue;
+		}
 
-	_channel->masterQueue.push_back(std::move(_packet));
-	_channel->masterInSeq = ++_channel->currentSeq;
-	_channel->statusBell.raise();
-	_packet = Packet{};
-	co_return length;
+		// The master queue is full.
+		if(nonBlock_) {
+			if(progress)
+				break;
+			co_return Error::wouldBlock;
+		}
+		co_await _channel->statusBell.async_wait();
+	}
+	co_return progress;
 }
 
 async::result<frg::expected<Error, ControllingTerminalState *>>
@@ -1043,20 +1190,26 @@ SlaveFile::pollWait(Process *, uint64_t past_seq, int mask,
 			&& !cancellation.is_cancellation_requested())
 		co_await _channel->statusBell.async_wait(cancellation);
 
-	// For now making pts files always writable is sufficient.
-	int edges = EPOLLOUT;
+	int edges = 0;
 	if(_channel->slaveInSeq > past_seq)
 		edges |= EPOLLIN;
+	if(_channel->slaveOutSeq > past_seq)
+		edges |= EPOLLOUT;
+	if(_channel->slaveHupSeq > past_seq)
+		edges |= EPOLLIN | EPOLLOUT | EPOLLHUP | EPOLLERR;
 
 	co_return PollWaitResult{_channel->currentSeq, edges};
 }
 
 async::result<frg::expected<Error, PollStatusResult>>
 SlaveFile::pollStatus(Process *) {
-	// For now making pts files always writable is sufficient.
-	int events = EPOLLOUT;
+	int events = 0;
 	if(!_channel->slaveQueue.empty())
 		events |= EPOLLIN;
+	if(_channel->masterQueue.space())
+		events |= EPOLLOUT;
+	if(_channel->masterClosed)
+		events |= EPOLLIN | EPOLLOUT | EPOLLHUP | EPOLLERR;
 
 	co_return PollStatusResult{_channel->currentSeq, events};
 }
@@ -44,6 +44,106 @@
 #include "clocks.hpp"
 #include "debug-options.hpp"
 
+// Opens (and possibly creates) a file for OPENAT and posix_spawn() OPEN file actions.
+// Does not handle OF_CLOEXEC and OF_NOCTTY; that is up to the caller.
+static async::result<frg::expected<Error, smarter::shared_ptr<File, FileHandle>>>
+openFile(Process *self, ViewPath relativeTo, std::string path, uint32_t flags, uint32_t mode) {
+	SemanticFlags semanticFlags = 0;
+	if(flags & managarm::posix::OpenFlags::OF_NONBLOCK)
+		semanticFlags |= semanticNonBlock;
+
+	if(flags & managarm::posix::OpenFlags::OF_RDONLY)
+		semanticFlags |= semanticRead;
+	else if(flags & managarm::posix::OpenFlags::OF_WRONLY)
+		semanticFlags |= semanticWrite;
+	else if(flags & managarm::posix::OpenFlags::OF_RDWR)
+		semanticFlags |= semanticRead | semanticWrite;
+
+	if(flags & managarm::posix::OpenFlags::OF_APPEND)
+		semanticFlags |= semanticAppend;
+
+	auto translateResolveError = [] (protocols::fs::Error error) -> Error {
+		switch(error) {
+			// TODO: Verify additional constraints for sending EISDIR.
+			case protocols::fs::Error::isDirectory: return Error::isDirectory;
+			case protocols::fs::Error::fileNotFound: return Error::noSuchFile;
+			case protocols::fs::Error::notDirectory: return Error::notDirectory;
+			default:
+				std::cout << "posix: Unexpected failure from resolve()" << std::endl;
+				return Error::ioError;
+		}
+	};
+
+	smarter::shared_ptr<File, FileHandle> file;
+	PathResolver resolver;
+	resolver.setup(self->fsContext()->getRoot(), std::move(relativeTo), std::move(path), self);
+	if(flags & managarm::posix::OpenFlags::OF_CREATE) {
+		auto resolveResult = co_await resolver.resolve(resolvePrefix | resolveNoTrailingSlash);
+		if(!resolveResult)
+			co_return translateResolveError(resolveResult.error());
+
+		auto directory = resolver.currentLink()->getTarget();
+		auto pathTail = FRG_CO_TRY(co_await directory->getLink(resolver.nextComponent()));
+		if(pathTail) {
+			if(flags & managarm::posix::OpenFlags::OF_EXCLUSIVE)
+				co_return Error::alreadyExists;
+			auto target = pathTail->getTarget();
+			file = FRG_CO_TRY(co_await target->open(resolver.currentView(),
+					std::move(pathTail), semanticFlags));
+		}else{
+			assert(directory->superblock());
+			auto node = co_await directory->superblock()->createRegular(self);
+			if(!node)
+				co_return Error::noSuchFile;
+			if(auto e = co_await node->chmod(mode); e != Error::success) {
+				std::cout << "posix: chmod failed when creating file for OPEN" << std::endl;
+				co_return e;
+			}
+			// Due to races, link() can fail here.
+			// TODO: Implement a version of link() that eithers links the new node
+			// or returns the current node without failing.
+			auto link = FRG_CO_TRY(co_await directory->link(resolver.nextComponent(), node));
+			file = FRG_CO_TRY(co_await node->open(resolver.currentView(),
+					std::move(link), semanticFlags));
+		}
+	}else{
+		ResolveFlags resolveFlags = 0;
+		if(flags & managarm::posix::OpenFlags::OF_NOFOLLOW)
+			resolveFlags |= resolveDontFollow;
+
+		auto resolveResult = co_await resolver.resolve(resolveFlags);
+		if(!resolveResult)
+			co_return translateResolveError(resolveResult.error());
+
+		auto target = resolver.currentLink()->getTarget();
+		if(flags & managarm::posix::OpenFlags::OF_DIRECTORY) {
+			if(target->getType() != VfsType::directory)
+				co_return Error::notDirectory;
+		}
+
+		if(flags & managarm::posix::OpenFlags::OF_PATH) {
+			auto dummyFile = smarter::make_shared<DummyFile>(resolver.currentView(), resolver.currentLink());
+			DummyFile::serve(dummyFile);
+			file = File::constructHandle(std::move(dummyFile));
+		}else{
+			// this can only be a symlink if O_NOFOLLOW has been passed
+			if(target->getType() == VfsType::symlink)
+				co_return Error::symbolicLinkLoop;
+
+			file = FRG_CO_TRY(co_await target->open(resolver.currentView(),
+					resolver.currentLink(), semanticFlags));
+		}
+	}
+	if(!file)
+		co_return Error::noSuchFile;
+
+	if(flags & managarm::posix::OpenFlags::OF_TRUNC) {
+		auto result = co_await file->truncate(0);
+		assert(result || result.error() == protocols::fs::Error::illegalOperationTarget);
+	}
+	co_return file;
+}
+
 async::result<void> serveRequests(std::shared_ptr<Process> self,
 		std::shared_ptr<Generation> generation) {
 	auto logRequest = [&self]<class... Args>(bool cond, std::string_view name,
@@ -681,10 +781,15 @@ async::result<void> serveRequests(std::shared_ptr<Process> self,
 			if(req.mode() & PROT_EXEC)
 				native_flags |= kHelMapProtExecute;
 
-			co_await self->vmContext()->protectFile(
+			auto error = co_await self->vmContext()->protectFile(
 					reinterpret_cast<void *>(req.address()), req.size(), native_flags);
 
-			resp.set_error(managarm::posix::Errors::SUCCESS);
+			if(error == Error::accessDenied) {
+				resp.set_error(managarm::posix::Errors::ACCESS_DENIED);
+			}else{
+				assert(error == Error::success);
+				resp.set_error(managarm::posix::Errors::SUCCESS);
+			}
 			auto [send_resp] = co_await helix_ng::exchangeMsgs(conversation,
 				helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
 			);
@@ -1898,23 +2003,8 @@ async::result<void> serveRequests(std::shared_ptr<Process> self,
 				continue;
 			}
 
-			SemanticFlags semantic_flags = 0;
-			if(req->flags() & managarm::posix::OpenFlags::OF_NONBLOCK)
-				semantic_flags |= semanticNonBlock;
-
-			if (req->flags() & managarm::posix::OpenFlags::OF_RDONLY)
-				semantic_flags |= semanticRead;
-			else if (req->flags() & managarm::posix::OpenFlags::OF_WRONLY)
-				semantic_flags |= semanticWrite;
-			else if (req->flags() & managarm::posix::OpenFlags::OF_RDWR)
-				semantic_flags |= semanticRead | semanticWrite;
-
-			if(req->flags() & managarm::posix::OpenFlags::OF_APPEND)
-				semantic_flags |= semanticAppend;
-
 			ViewPath relative_to;
 			smarter::shared_ptr<File, FileHandle> file;
-			std::shared_ptr<FsLink> target_link;
 
 			if(req->fd() == AT_FDCWD) {
 				relative_to = self->fsContext()->getWorkingDirectory();
@@ -1929,153 +2019,15 @@ async::result<void> serveRequests(std::shared_ptr<Process> self,
 				relative_to = {file->associatedMount(), file->associatedLink()};
 			}
 
-			PathResolver resolver;
-			resolver.setup(self->fsContext()->getRoot(),
-					relative_to, req->path(), self.get());
-			if(req->flags() & managarm::posix::OpenFlags::OF_CREATE) {
-				auto resolveResult = co_await resolver.resolve(
-						resolvePrefix | resolveNoTrailingSlash);
-				if(!resolveResult) {
-					if(resolveResult.error() == protocols::fs::Error::isDirectory) {
-						// TODO: Verify additional constraints for sending EISDIR.
-						co_await sendErrorResponse(managarm::posix::Errors::IS_DIRECTORY);
-						continue;
-					} else if(resolveResult.error() == protocols::fs::Error::fileNotFound) {
-						co_await sendErrorResponse(managarm::posix::Errors::FILE_NOT_FOUND);
-						continue;
-					} else if(resolveResult.error() == protocols::fs::Error::notDirectory) {
-						co_await sendErrorResponse(managarm::posix::Errors::NOT_A_DIRECTORY);
-						continue;
-					} else {
-						std::cout << "posix: Unexpected failure from resolve()" << std::endl;
-						co_return;
-					}
-				}
+			logRequest(logRequests || logPaths, "OPENAT", "path='{}'", req->path());
 
-				logRequest(logRequests || logPaths, "OPENAT", "create '{}'",
-					ViewPath{resolver.currentView(), resolver.currentLink()}
-					.getPath(self->fsContext()->getRoot()));
-
-				auto directory = resolver.currentLink()->getTarget();
-				auto tailResult = co_await directory->getLink(resolver.nextComponent());
-				if(!tailResult) {
-					if(tailResult.error() == Error::illegalOperationTarget) {
-						co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_OPERATION_TARGET);
-						continue;
-					} else {
-						std::cout << "posix: Unexpected failure from resolve()" << std::endl;
-						co_return;
-					}
-				}
-				assert(tailResult);
-				auto pathTail = tailResult.value();
-				if(pathTail) {
-					if(req->flags() & managarm::posix::OpenFlags::OF_EXCLUSIVE) {
-						co_await sendErrorResponse(managarm::posix::Errors::ALREADY_EXISTS);
-						continue;
-					}else{
-						auto target = pathTail->getTarget();
-						auto fileResult = co_await target->open(
-											resolver.currentView(), std::move(pathTail),
-											semantic_flags);
-						assert(fileResult);
-						file = fileResult.value();
-						assert(file);
-					}
-				}else{
-					assert(directory->superblock());
-					auto node = co_await directory->superblock()->createRegular(self.get());
-					if (!node) {
-						co_await sendErrorResponse(managarm::posix::Errors::FILE_NOT_FOUND);
-						continue;
-					}
-					auto chmodResult = co_await node->chmod(req->mode());
-					if (chmodResult != Error::success) {
-						std::cout << "posix: chmod failed when creating file for OpenAtRequest!" << std::endl;
-						co_await sendErrorResponse(managarm::posix::Errors::INTERNAL_ERROR);
-						continue;
-					}
-					// Due to races, link() can fail here.
-					// TODO: Implement a version of link() that eithers links the new node
-					// or returns the current node without failing.
-					auto linkResult = co_await directory->link(resolver.nextComponent(), node);
-					assert(linkResult);
-					auto link = linkResult.value();
-					auto fileResult = co_await node->open(resolver.currentView(), std::move(link),
-										semantic_flags);
-					assert(fileResult);
-					file = fileResult.value();
-					assert(file);
-				}
-			}else{
-				ResolveFlags resolveFlags = 0;
-
-				if(req->flags() & managarm::posix::OpenFlags::OF_NOFOLLOW)
-					resolveFlags |= resolveDontFollow;
-
-				auto resolveResult = co_await resolver.resolve(resolveFlags);
-				if(!resolveResult) {
-					if(resolveResult.error() == protocols::fs::Error::isDirectory) {
-						// TODO: Verify additional constraints for sending EISDIR.
-						co_await sendErrorResponse(managarm::posix::Errors::IS_DIRECTORY);
-						continue;
-					} else if(resolveResult.error() == protocols::fs::Error::fileNotFound) {
-						co_await sendErrorResponse(managarm::posix::Errors::FILE_NOT_FOUND);
-						continue;
-					} else if(resolveResult.error() == protocols::fs::Error::notDirectory) {
-						co_await sendErrorResponse(managarm::posix::Errors::NOT_A_DIRECTORY);
-						continue;
-					} else {
-						std::cout << "posix: Unexpected failure from resolve()" << std::endl;
-						co_return;
-					}
-				}
-
-				logRequest(logRequests || logPaths, "OPENAT", "open '{}'",
-					ViewPath{resolver.currentView(), resolver.currentLink()}
-					.getPath(self->fsContext()->getRoot()));
-
-				auto target = resolver.currentLink()->getTarget();
-				if(req->flags() & managarm::posix::OpenFlags::OF_DIRECTORY) {
-					if(target->getType() != VfsType::directory) {
-						co_await sendErrorResponse(managarm::posix::Errors::NOT_A_DIRECTORY);
-						continue;
-					}
-				}
-
-				if(req->flags() & managarm::posix::OpenFlags::OF_PATH) {
-					auto dummyFile = smarter::make_shared<DummyFile>(resolver.currentView(), resolver.currentLink());
-					DummyFile::serve(dummyFile);
-					file = File::constructHandle(std::move(dummyFile));
-				} else {
-					// this can only be a symlink if O_NOFOLLOW has been passed
-					if(target->getType() == VfsType::symlink) {
-						co_await sendErrorResponse(managarm::posix::Errors::SYMBOLIC_LINK_LOOP);
-						continue;
-					}
-
-					auto fileResult = co_await target->open(resolver.currentView(), resolver.currentLink(), semantic_flags);
-					if(!fileResult) {
-						if(fileResult.error() == Error::noBackingDevice) {
-							co_await sendErrorResponse(managarm::posix::Errors::NO_BACKING_DEVICE);
-							continue;
-						} else if(fileResult.error() == Error::illegalArguments) {
-							co_await sendErrorResponse(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
-							continue;
-						} else {
-							std::cout << "posix: Unexpected failure from open()" << std::endl;
-							co_return;
-						}
-					}
-					assert(fileResult);
-					file = fileResult.value();
-				}
-			}
-
-			if(!file) {
-				co_await sendErrorResponse(managarm::posix::Errors::FILE_NOT_FOUND);
+			auto fileResult = co_await openFile(self.get(), std::move(relative_to),
+					req->path(), req->flags(), req->mode());
+			if(!fileResult) {
+				co_await sendErrorResponse(fileResult.error() | toPosixProtoError);
 				continue;
 			}
+			file = std::move(fileResult.value());
 
 			if(file->isTerminal() &&
 				!(req->flags() & managarm::posix::OpenFlags::OF_NOCTTY) &&
@@ -2090,10 +2042,6 @@ async::result<void> serveRequests(std::shared_ptr<Process> self,
 				}
 			}
 
-			if(req->flags() & managarm::posix::OpenFlags::OF_TRUNC) {
-				auto result = co_await file->truncate(0);
-				assert(result || result.error() == protocols::fs::Error::illegalOperationTarget);
-			}
 			int fd = self->fileContext()->attachFile(file,
 					req->flags() & managarm::posix::OpenFlags::OF_CLOEXEC);
 
@@ -2944,7 +2892,8 @@ async::result<void> serveRequests(std::shared_ptr<Process> self,
 			}else{
 				assert(req.timeout() > 0);
 				async::cancellation_event cancel_wait;
-				helix::TimeoutCancellation timer{static_cast<uint64_t>(req.timeout()), cancel_wait};
+				auto timeout = static_cast<uint64_t>(req.timeout());
+				helix::TimeoutCancellation timer{timeout, cancel_wait, helix::coarseSlack(timeout)};
 				k = co_await epoll::wait(epfile.get(), events, 16, cancel_wait);
 				co_await timer.retire();
 			}
@@ -3102,7 +3051,8 @@ async::result<void> serveRequests(std::shared_ptr<Process> self,
 			}else{
 				assert(req.timeout() > 0);
 				async::cancellation_event cancel_wait;
-				helix::TimeoutCancellation timer{static_cast<uint64_t>(req.timeout()), cancel_wait};
+				auto timeout = static_cast<uint64_t>(req.timeout());
+				helix::TimeoutCancellation timer{timeout, cancel_wait, helix::coarseSlack(timeout)};
 				k = co_await epoll::wait(epfile.get(), events, 16, cancel_wait);
 				co_await timer.retire();
 			}
@@ -4251,6 +4201,243 @@ async::result<void> serveRequests(std::shared_ptr<Process> self,
 				helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
 			);
 
+			HEL_CHECK(send_resp.error());
+			logBragiReply(resp);
+		}else if(preamble.id() == bragi::message_id<managarm::posix::SpawnRequest>) {
+			std::vector<uint8_t> tail(preamble.tail_size());
+			auto [recv_tail] = co_await helix_ng::exchangeMsgs(
+					conversation,
+					helix_ng::recvBuffer(tail.data(), tail.size())
+				);
+			HEL_CHECK(recv_tail.error());
+
+			logBragiRequest(tail);
+			auto req = bragi::parse_head_tail<managarm::posix::SpawnRequest>(recv_head, tail);
+			if (!req) {
+				std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
+				break;
+			}
+
+			logRequest(logRequests || logPaths, "SPAWN", "'{}'", req->path());
+
+			auto numActions = req->action_types().size();
+			if(req->action_fds().size() != numActions
+					|| req->action_new_fds().size() != numActions
+					|| req->action_flags().size() != numActions
+					|| req->action_modes().size() != numActions) {
+				co_await sendErrorResponse.template operator()<managarm::posix::SpawnResponse>
+					(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
+				continue;
+			}
+
+			// File actions operate on the child's copy of the file table,
+			// such that failures do not affect the caller.
+			auto fileContext = FileContext::clone(self->fileContext());
+			std::optional<managarm::posix::Errors> actionError;
+			size_t pathIndex = 0;
+			for(size_t i = 0; i < numActions && !actionError; i++) {
+				auto fd = req->action_fds()[i];
+				auto type = req->action_types()[i];
+				if(type == managarm::posix::SpawnActionType::CLOSE) {
+					if(fileContext->closeFile(fd) != Error::success)
+						actionError = managarm::posix::Errors::NO_SUCH_FD;
+				}else if(type == managarm::posix::SpawnActionType::DUP2) {
+					auto file = fileContext->getFile(fd);
+					auto newfd = req->action_new_fds()[i];
+					if(!file || newfd < 0) {
+						actionError = managarm::posix::Errors::NO_SUCH_FD;
+						continue;
+					}
+					// In contrast to dup2(), FD_CLOEXEC is also cleared if fd == newfd.
+					fileContext->attachFile(newfd, std::move(file), false);
+				}else if(type == managarm::posix::SpawnActionType::OPEN) {
+					if(pathIndex >= req->action_paths().size() || fd < 0) {
+						actionError = managarm::posix::Errors::ILLEGAL_ARGUMENTS;
+						continue;
+					}
+					auto flags = req->action_flags()[i];
+					auto fileResult = co_await openFile(self.get(),
+							self->fsContext()->getWorkingDirectory(),
+							req->action_paths()[pathIndex++], flags, req->action_modes()[i]);
+					if(!fileResult) {
+						actionError = fileResult.error() | toPosixProtoError;
+						continue;
+					}
+					fileContext->attachFile(fd, std::move(fileResult.value()),
+							flags & managarm::posix::OpenFlags::OF_CLOEXEC);
+				}else{
+					actionError = managarm::posix::Errors::ILLEGAL_ARGUMENTS;
+				}
+			}
+			if(actionError) {
+				co_await sendErrorResponse.template operator()<managarm::posix::SpawnResponse>
+					(*actionError);
+				continue;
+			}
+
+			std::optional<uint64_t> signalMask;
+			if(req->flags() & managarm::posix::SpawnFlags::SET_SIGMASK)
+				signalMask = req->sigmask();
+
+			auto spawnResult = co_await Process::spawn(self, req->path(),
+					req->args(), req->env(), std::move(fileContext), signalMask);
+			if(!spawnResult) {
+				auto error = spawnResult.error();
+				if(error == Error::eof)
+					error = Error::badExecutable;
+				co_await sendErrorResponse.template operator()<managarm::posix::SpawnResponse>
+					(error | toPosixProtoError);
+				continue;
+			}
+
+			managarm::posix::SpawnResponse resp;
+			resp.set_error(managarm::posix::Errors::SUCCESS);
+			resp.set_pid(spawnResult.value()->pid());
+
+			auto [send_resp] = co_await helix_ng::exchangeMsgs(
+				conversation,
+				helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
+			);
+
+			HEL_CHECK(send_resp.error());
+			logBragiReply(resp);
+		}else if(preamble.id() == managarm::posix::SetSchedulerRequest::message_id) {
+			auto req = bragi::parse_head_only<managarm::posix::SetSchedulerRequest>(recv_head);
+
+			if (!req) {
+				std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
+				break;
+			}
+
+			logRequest(logRequests, "SET_SCHEDULER", "pid={} policy={} priority={}",
+					req->pid(), req->policy(), req->priority());
+
+			auto target = req->pid() ? Process::findProcess(req->pid()) : self;
+			// Zombies are still found by PID but they no longer have a thread.
+			if(!target || target->threadDescriptor().getHandle() == kHelNullHandle) {
+				co_await sendErrorResponse.template operator()<managarm::posix::SetSchedulerResponse>
+					(managarm::posix::Errors::NO_SUCH_RESOURCE);
+				continue;
+			}
+
+			HelSchedulingParameters params{};
+			switch(req->policy()) {
+			case managarm::posix::SchedPolicy::OTHER:
+			case managarm::posix::SchedPolicy::BATCH:
+			case managarm::posix::SchedPolicy::IDLE:
+				// BATCH and IDLE are treated like OTHER.
+				params.policy = kHelSchedFair;
+				break;
+			case managarm::posix::SchedPolicy::FIFO:
+				params.policy = kHelSchedFifo;
+				break;
+			case managarm::posix::SchedPolicy::RR:
+				params.policy = kHelSchedRoundRobin;
+				break;
+			case managarm::posix::SchedPolicy::DEADLINE:
+				params.policy = kHelSchedDeadline;
+				break;
+			default:
+				co_await sendErrorResponse.template operator()<managarm::posix::SetSchedulerResponse>
+					(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
+				continue;
+			}
+			if(params.policy != kHelSchedFair) {
+				params.priority = req->priority();
+				params.runtime = req->runtime();
+				params.deadline = req->deadline();
+				params.period = req->period();
+			}else if(req->priority()) {
+				co_await sendErrorResponse.template operator()<managarm::posix::SetSchedulerResponse>
+					(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
+				continue;
+			}
+
+			// Like CAP_SYS_NICE on Linux: only root can use real-time and deadline policies
+			// or change the policy of other users' processes.
+			if(self->euid() != 0 && (params.policy != kHelSchedFair
+					|| (target != self && target->uid() != self->euid()))) {
+				co_await sendErrorResponse.template operator()<managarm::posix::SetSchedulerResponse>
+					(managarm::posix::Errors::INSUFFICIENT_PERMISSION);
+				continue;
+			}
+
+			managarm::posix::SetSchedulerResponse resp;
+			auto error = helSetSchedulingPolicy(target->threadDescriptor().getHandle(), &params);
+			if(error == kHelErrIllegalArgs) {
+				resp.set_error(managarm::posix::Errors::ILLEGAL_ARGUMENTS);
+			}else if(error == kHelErrIllegalState) {
+				// Admission control rejected the bandwidth (EBUSY).
+				resp.set_error(managarm::posix::Errors::RESOURCE_IN_USE);
+			}else if(error != kHelErrNone) {
+				std::cout << "posix: SET_SCHEDULER hel call returned unexpected error: "
+						<< error << std::endl;
+				resp.set_error(managarm::posix::Errors::INTERNAL_ERROR);
+			}else{
+				resp.set_error(managarm::posix::Errors::SUCCESS);
+			}
+
+			auto [send_resp] = co_await helix_ng::exchangeMsgs(
+				conversation,
+				helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
+			);
+
+			HEL_CHECK(send_resp.error());
+			logBragiReply(resp);
+		}else if(preamble.id() == managarm::posix::GetSchedulerRequest::message_id) {
+			auto req = bragi::parse_head_only<managarm::posix::GetSchedulerRequest>(recv_head);
+
+			if (!req) {
+				std::cout << "posix: Rejecting request due to decoding failure" << std::endl;
+				break;
+			}
+
+			logRequest(logRequests, "GET_SCHEDULER", "pid={}", req->pid());
+
+			auto target = req->pid() ? Process::findProcess(req->pid()) : self;
+			// Zombies are still found by PID but they no longer have a thread.
+			if(!target || target->threadDescriptor().getHandle() == kHelNullHandle) {
+				co_await sendErrorResponse.template operator()<managarm::posix::GetSchedulerResponse>
+					(managarm::posix::Errors::NO_SUCH_RESOURCE);
+				continue;
+			}
+
+			HelSchedulingParameters params;
+			if(auto e = helGetSchedulingPolicy(target->threadDescriptor().getHandle(), &params);
+					e != kHelErrNone) {
+				std::cout << "posix: GET_SCHEDULER hel call returned unexpected error: "
+						<< e << std::endl;
+				co_await sendErrorResponse.template operator()<managarm::posix::GetSchedulerResponse>
+					(managarm::posix::Errors::INTERNAL_ERROR);
+				continue;
+			}
+
+			managarm::posix::GetSchedulerResponse resp;
+			resp.set_error(managarm::posix::Errors::SUCCESS);
+			switch(params.policy) {
+			case kHelSchedFifo:
+				resp.set_policy(managarm::posix::SchedPolicy::FIFO);
+				resp.set_priority(params.priority);
+				break;
+			case kHelSchedRoundRobin:
+				resp.set_policy(managarm::posix::SchedPolicy::RR);
+				resp.set_priority(params.priority);
+				break;
+			case kHelSchedDeadline:
+				resp.set_policy(managarm::posix::SchedPolicy::DEADLINE);
+				resp.set_runtime(params.runtime);
+				resp.set_deadline(params.deadline);
+				resp.set_period(params.period);
+				break;
+			default:
+				resp.set_policy(managarm::posix::SchedPolicy::OTHER);
+			}
+
+			auto [send_resp] = co_await helix_ng::exchangeMsgs(
+				conversation,
+				helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
+			);
+
 			HEL_CHECK(send_resp.error());
 			logBragiReply(resp);
 		}else{
@@ -1,5 +1,8 @@
 
+#include <ctype.h>
+#include <stdlib.h>
 #include <string.h>
+#include <format>
 #include <iostream>
 #include <string_view>
 #include <linux/fs.h>
@@ -42,6 +45,10 @@ struct Device final : UnixDevice, drvcore::BlockDevice, std::enable_shared_from_
 		return _size;
 	}
 
+	helix::BorrowedLane lane() {
+		return _lane;
+	}
+
 	async::result<frg::expected<Error, smarter::shared_ptr<File, FileHandle>>>
 	open(std::shared_ptr<MountView> mount, std::shared_ptr<FsLink> link,
 			SemanticFlags semantic_flags) override {
@@ -59,6 +66,8 @@ struct Device final : UnixDevice, drvcore::BlockDevice, std::enable_shared_from_
 		ue.set("MINOR", std::to_string(dev.second));
 	}
 
+	std::shared_ptr<sysfs::Object> queue;
+
 private:
 	std::string _name;
 	helix::UniqueLane _lane;
@@ -66,6 +75,63 @@ private:
 	size_t _size;
 };
 
+// The queue/ directory of a disk.
+struct QueueObject final : sysfs::Object {
+	QueueObject(std::shared_ptr<Device> device)
+	: sysfs::Object{device, "queue"}, device{device.get()} { }
+
+	Device *device;
+};
+
+async::result<managarm::fs::BlockQueueStatsReply> queryQueueStats(Device *device) {
+	managarm::fs::BlockQueueStatsRequest req;
+
+	auto [offer, send_req, recv_resp] = co_await helix_ng::exchangeMsgs(
+		device->lane(),
+		helix_ng::offer(
+			helix_ng::sendBragiHeadOnly(req, frg::stl_allocator{}),
+			helix_ng::recvInline()
+		)
+	);
+	HEL_CHECK(offer.error());
+	HEL_CHECK(send_req.error());
+	HEL_CHECK(recv_resp.error());
+
+	auto resp = *bragi::parse_head_only<managarm::fs::BlockQueueStatsReply>(recv_resp);
+	recv_resp.reset();
+	co_return resp;
+}
+
+async::result<Error> configureQueue(Device *device, int32_t scheduler, uint64_t queue_depth) {
+	managarm::fs::BlockQueueConfigureRequest req;
+	req.set_scheduler(scheduler);
+	req.set_queue_depth(queue_depth);
+
+	auto [offer, send_req, recv_resp] = co_await helix_ng::exchangeMsgs(
+		device->lane(),
+		helix_ng::offer(
+			helix_ng::sendBragiHeadOnly(req, frg::stl_allocator{}),
+			helix_ng::recvInline()
+		)
+	);
+	HEL_CHECK(offer.error());
+	HEL_CHECK(send_req.error());
+	HEL_CHECK(recv_resp.error());
+
+	auto resp = *bragi::parse_head_only<managarm::fs::BlockQueueConfigureReply>(recv_resp);
+	recv_resp.reset();
+	if(resp.error() == managarm::fs::Errors::ILLEGAL_ARGUMENT)
+		co_return Error::illegalArguments;
+	assert(resp.error() == managarm::fs::Errors::SUCCESS);
+	co_return Error::success;
+}
+
+constexpr std::pair<int32_t, std::string_view> schedulerNames[] = {
+	{managarm::fs::IoScheduler::IOSCHED_NOOP, "noop"},
+	{managarm::fs::IoScheduler::IOSCHED_DEADLINE, "deadline"},
+	{managarm::fs::IoScheduler::IOSCHED_MQ, "mq"},
+};
+
 } // anonymous namepsace
 
 struct ReadOnlyAttribute : sysfs::Attribute {
@@ -96,10 +162,36 @@ struct ManagarmRootAttribute : sysfs::Attribute {
 	async::result<frg::expected<Error, std::string>> show(sysfs::Object *object) override;
 };
 
+struct StatAttribute : sysfs::Attribute {
+	StatAttribute(std::string name)
+	: sysfs::Attribute{std::move(name), false} { }
+
+	async::result<frg::expected<Error, std::string>> show(sysfs::Object *object) override;
+};
+
+struct SchedulerAttribute : sysfs::Attribute {
+	SchedulerAttribute(std::string name)
+	: sysfs::Attribute{std::move(name), true} { }
+
+	async::result<frg::expected<Error, std::string>> show(sysfs::Object *object) override;
+	async::result<Error> store(sysfs::Object *object, std::string data) override;
+};
+
+struct NrRequestsAttribute : sysfs::Attribute {
+	NrRequestsAttribute(std::string name)
+	: sysfs::Attribute{std::move(name), true} { }
+
+	async::result<frg::expected<Error, std::string>> show(sysfs::Object *object) override;
+	async::result<Error> store(sysfs::Object *object, std::string data) override;
+};
+
 ReadOnlyAttribute roAttr{"ro"};
 DevAttribute devAttr{"dev"};
 SizeAttribute sizeAttr{"size"};
 ManagarmRootAttribute managarmRootAttr{"managarm-root"};
+StatAttribute statAttr{"stat"};
+SchedulerAttribute schedulerAttr{"scheduler"};
+NrRequestsAttribute nrRequestsAttr{"nr_requests"};
 
 async::result<frg::expected<Error, std::string>> ReadOnlyAttribute::show(sysfs::Object *object) {
 	(void) object;
@@ -124,6 +216,64 @@ async::result<frg::expected<Error, std::string>> ManagarmRootAttribute::show(sys
 	co_return "1\n";
 }
 
+async::result<frg::expected<Error, std::string>> StatAttribute::show(sysfs::Object *object) {
+	auto device = static_cast<Device *>(object);
+	auto stats = co_await queryQueueStats(device);
+	// The format follows Linux' Documentation/block/stat.rst.
+	// We do not track discards and flushes; those fields are omitted.
+	co_return std::format("{} {} {} {} {} {} {} {} {} {} {}\n",
+			stats.read_ios(), stats.read_merges(), stats.read_sectors(), stats.read_ticks(),
+			stats.write_ios(), stats.write_merges(), stats.write_sectors(), stats.write_ticks(),
+			stats.in_flight(), stats.io_ticks(), stats.read_ticks() + stats.write_ticks());
+}
+
+async::result<frg::expected<Error, std::string>> SchedulerAttribute::show(sysfs::Object *object) {
+	auto queue = static_cast<QueueObject *>(object);
+	auto stats = co_await queryQueueStats(queue->device);
+
+	// The active scheduler is enclosed in brackets.
+	std::string result;
+	for(auto &[id, name] : schedulerNames) {
+		if(!result.empty())
+			result += ' ';
+		if(id == stats.scheduler())
+			result += std::format("[{}]", name);
+		else
+			result += name;
+	}
+	co_return result + "\n";
+}
+
+async::result<Error> SchedulerAttribute::store(sysfs::Object *object, std::string data) {
+	auto queue = static_cast<QueueObject *>(object);
+
+	std::string_view name{data};
+	while(!name.empty() && isspace(name.back()))
+		name.remove_suffix(1);
+
+	for(auto &[id, candidate] : schedulerNames) {
+		if(name == candidate)
+			co_return co_await configureQueue(queue->device, id, 0);
+	}
+	co_return Error::illegalArguments;
+}
+
+async::result<frg::expected<Error, std::string>> NrRequestsAttribute::show(sysfs::Object *object) {
+	auto queue = static_cast<QueueObject *>(object);
+	auto stats = co_await queryQueueStats(queue->device);
+	co_return std::to_string(stats.queue_depth()) + "\n";
+}
+
+async::result<Error> NrRequestsAttribute::store(sysfs::Object *object, std::string data) {
+	auto queue = static_cast<QueueObject *>(object);
+
+	char *end;
+	auto depth = strtoull(data.c_str(), &end, 10);
+	if(end == data.c_str() || !depth)
+		co_return Error::illegalArguments;
+	co_return co_await configureQueue(queue->device, -1, depth);
+}
+
 async::detached observePartitions() {
 	auto filter = mbus_ng::Conjunction({
 		mbus_ng::EqualsFilter{"unix.devtype", "block"},
@@ -277,6 +427,13 @@ async::detached run() {
 			device->assignId({8, minorAllocator.allocate()});
 			blockRegistry.install(device);
 			drvcore::installDevice(device);
+
+			// Whole disks are backed by a request queue in libblockfs.
+			device->realizeAttribute(&statAttr);
+			device->queue = std::make_shared<QueueObject>(device);
+			device->queue->addObject();
+			device->queue->realizeAttribute(&schedulerAttr);
+			device->queue->realizeAttribute(&nrRequestsAttr);
 		}
 	}
 }
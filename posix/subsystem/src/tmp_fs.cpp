@@ -266,6 +266,7 @@ public:
 	void handleClose() override;
 
 	FutureMaybe<ReadEntriesResult> readEntries() override;
+	async::result<protocols::fs::ReadEntriesBatchResult> readEntriesBatch(size_t max_size) override;
 	helix::BorrowedDescriptor getPassthroughLane() override;
 
 private:
@@ -276,6 +277,8 @@ private:
 	async::cancellation_event _cancelServe;
 
 	std::set<std::shared_ptr<Link>, LinkCompare>::iterator _iter;
+	// Number of entries that were returned so far.
+	size_t _position = 0;
 };
 
 struct DirectoryNode final : Node, std::enable_shared_from_this<DirectoryNode> {
@@ -745,12 +748,18 @@ DirectoryFile::readEntries() {
 	if(_iter != _node->_entries.end()) {
 		auto name = (*_iter)->getName();
 		_iter++;
+		_position++;
 		co_return name;
 	}else{
 		co_return std::nullopt;
 	}
 }
 
+async::result<protocols::fs::ReadEntriesBatchResult>
+DirectoryFile::readEntriesBatch(size_t max_size) {
+	return readDirentsBatch(_iter, _node->_entries.end(), _position, max_size);
+}
+
 helix::BorrowedDescriptor DirectoryFile::getPassthroughLane() {
 	return _passthrough;
 }
@@ -1,4 +1,5 @@
 
+#include <dirent.h>
 #include <fcntl.h>
 #include <string.h>
 #include <unistd.h>
@@ -101,16 +102,19 @@ async::result<void> populateRootView() {
 		assert(dir_fd != -1);
 
 		auto lane = helix::BorrowedLane{helix::handleForFd(dir_fd)};
+		std::vector<char> entries(0x1000);
 		while(true) {
 			managarm::fs::CntRequest req;
-			req.set_req_type(managarm::fs::CntReqType::PT_READ_ENTRIES);
+			req.set_req_type(managarm::fs::CntReqType::PT_READ_ENTRIES_BATCH);
+			req.set_size(entries.size());
 
 			auto ser = req.SerializeAsString();
-			auto [offer, send_req, recv_resp] = co_await helix_ng::exchangeMsgs(
+			auto [offer, send_req, recv_resp, recv_entries] = co_await helix_ng::exchangeMsgs(
 				lane,
 				helix_ng::offer(
 					helix_ng::sendBuffer(ser.data(), ser.size()),
-					helix_ng::recvInline()
+					helix_ng::recvInline(),
+					helix_ng::recvBuffer(entries.data(), entries.size())
 				)
 			);
 			HEL_CHECK(offer.error());
@@ -123,21 +127,28 @@ async::result<void> populateRootView() {
 			if(resp.error() == managarm::fs::Errors::END_OF_FILE)
 				break;
 			assert(resp.error() == managarm::fs::Errors::SUCCESS);
+			HEL_CHECK(recv_entries.error());
+
+			protocols::fs::DirentReader reader{entries.data(), recv_entries.actualLength()};
+			protocols::fs::DirentHeader header;
+			std::string_view entry_name;
+			while(reader.next(header, entry_name)) {
+				std::string name{entry_name};
+				//std::cout << "posix: Importing " << item.second + "/" + name << std::endl;
+
+				if(header.type == DT_DIR) {
+					// TODO: Check for errors from mkdir().
+					auto link = std::get<std::shared_ptr<FsLink>>(
+							co_await item.first->mkdir(name));
+					stack.push_back({link->getTarget(), item.second + "/" + name});
+				}else{
+					assert(header.type == DT_REG);
 
-			//std::cout << "posix: Importing " << item.second + "/" + resp.path() << std::endl;
-
-			if(resp.file_type() == managarm::fs::FileType::DIRECTORY) {
-				// TODO: Check for errors from mkdir().
-				auto link = std::get<std::shared_ptr<FsLink>>(
-						co_await item.first->mkdir(resp.path()));
-				stack.push_back({link->getTarget(), item.second + "/" + resp.path()});
-			}else{
-				assert(resp.file_type() == managarm::fs::FileType::REGULAR);
-
-				auto file_path = "/" + item.second + "/" + resp.path();
-				auto node = tmp_fs::createMemoryNode(std::move(file_path));
-				auto result = co_await item.first->link(resp.path(), node);
-				assert(result);
+					auto file_path = "/" + item.second + "/" + name;
+					auto node = tmp_fs::createMemoryNode(std::move(file_path));
+					auto result = co_await item.first->link(name, node);
+					assert(result);
+				}
 			}
 		}
 	}
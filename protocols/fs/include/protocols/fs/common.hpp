@@ -1,8 +1,11 @@
 #pragma once
 
+#include <dirent.h>
 #include <optional>
+#include <stddef.h>
 #include <string.h>
 #include <string>
+#include <string_view>
 #include <sys/socket.h>
 #include <variant>
 #include <vector>
@@ -129,6 +132,9 @@ using ReadResult = std::variant<Error, size_t>;
 
 using ReadEntriesResult = std::optional<std::string>;
 
+// Holds the encoded entries; an empty buffer indicates the end of the directory.
+using ReadEntriesBatchResult = std::variant<Error, std::vector<char>>;
+
 using PollResult = std::tuple<uint64_t, int, int>;
 using PollWaitResult = std::tuple<uint64_t, int>;
 using PollStatusResult = std::tuple<uint64_t, int>;
@@ -234,4 +240,81 @@ private:
 	size_t _offset;
 };
 
+// Header of an entry in the response to PT_READ_ENTRIES_BATCH.
+// The layout matches struct linux_dirent64, i.e., clients can copy the entries
+// into the result of getdents64() without re-encoding them.
+struct DirentHeader {
+	uint64_t ino;
+	int64_t off;
+	uint16_t reclen;
+	uint8_t type;
+	char name[];
+};
+
+struct DirentBuilder {
+	DirentBuilder(size_t max_size)
+	: _maxSize{max_size} { }
+
+	// Returns false (without appending anything) if the entry does not fit.
+	// type is one of the DT_* constants. off is the position of the next entry.
+	[[nodiscard("You must check whether the entry fits")]]
+	bool entry(uint64_t ino, int64_t off, uint8_t type, std::string_view name) {
+		auto reclen = (offsetof(DirentHeader, name) + name.size() + 1 + 7) & ~size_t(7);
+		if(_buffer.size() + reclen > _maxSize)
+			return false;
+
+		auto offset = _buffer.size();
+		_buffer.resize(offset + reclen);
+
+		DirentHeader h;
+		h.ino = ino;
+		h.off = off;
+		h.reclen = reclen;
+		h.type = type;
+		memcpy(_buffer.data() + offset, &h, offsetof(DirentHeader, name));
+		memcpy(_buffer.data() + offset + offsetof(DirentHeader, name), name.data(), name.size());
+		_numEntries++;
+		return true;
+	}
+
+	size_t numEntries() {
+		return _numEntries;
+	}
+
+	std::vector<char> buffer() {
+		return std::move(_buffer);
+	}
+
+private:
+	std::vector<char> _buffer;
+	size_t _maxSize;
+	size_t _numEntries = 0;
+};
+
+// Iterates over the entries that were encoded by a DirentBuilder.
+struct DirentReader {
+	DirentReader(const void *data, size_t size)
+	: _data{static_cast<const char *>(data)}, _size{size} { }
+
+	// Returns false if there are no more entries (or if the buffer is malformed).
+	bool next(DirentHeader &h, std::string_view &name) {
+		if(_offset + offsetof(DirentHeader, name) > _size)
+			return false;
+		memcpy(&h, _data + _offset, offsetof(DirentHeader, name));
+		if(h.reclen <= offsetof(DirentHeader, name) || _offset + h.reclen > _size)
+			return false;
+
+		auto name_ptr = _data + _offset + offsetof(DirentHeader, name);
+		name = std::string_view{name_ptr,
+				strnlen(name_ptr, h.reclen - offsetof(DirentHeader, name))};
+		_offset += h.reclen;
+		return true;
+	}
+
+private:
+	const char *_data;
+	size_t _size;
+	size_t _offset = 0;
+};
+
 } } // namespace protocols::fs
@@ -15,6 +15,7 @@
 #include <smarter.hpp>
 #include <deque>
 #include <memory>
+#include <optional>
 
 namespace managarm::fs {
 	struct CntRequest;
@@ -55,6 +56,16 @@ using OpenResult = std::pair<helix::UniqueLane, helix::UniqueLane>;
 using MkdirResult = std::pair<std::shared_ptr<void>, int64_t>;
 using SymlinkResult = std::pair<std::shared_ptr<void>, int64_t>;
 
+// Data that is sent to the client without copying it into an intermediate buffer first
+// (e.g., data in a mapping of the page cache). The data stays valid as long as hold is alive.
+struct ReadView {
+	const void *data = nullptr;
+	size_t length = 0;
+	std::shared_ptr<void> hold;
+};
+
+using ReadViewResult = std::variant<Error, ReadView>;
+
 using TraverseLinksResult = frg::expected<Error, std::tuple<std::vector<std::pair<std::shared_ptr<void>, int64_t>>, FileType, size_t>>;
 
 struct FileOperations {
@@ -78,6 +89,11 @@ struct FileOperations {
 		read = f;
 		return *this;
 	}
+	constexpr FileOperations &withReadView(async::result<ReadViewResult> (*f)(void *object,
+			helix_ng::CredentialsView, std::optional<int64_t> offset, size_t length)) {
+		readView = f;
+		return *this;
+	}
 	constexpr FileOperations &withWrite(async::result<frg::expected<protocols::fs::Error, size_t>> (*f)(void *object,
 			helix_ng::CredentialsView, const void *buffer, size_t length)) {
 		write = f;
@@ -149,11 +165,19 @@ struct FileOperations {
 			void *buffer, size_t length) = nullptr;
 	async::result<ReadResult> (*pread)(void *object, int64_t offset, helix_ng::CredentialsView credentials,
 			void *buffer, size_t length) = nullptr;
+	// If present, READ and PT_PREAD use this instead of read() and pread().
+	// Without an offset, reads from (and advances) the current file offset.
+	// There is no counterpart for WRITE and PT_PWRITE; they always use write() and pwrite().
+	async::result<ReadViewResult> (*readView)(void *object, helix_ng::CredentialsView credentials,
+			std::optional<int64_t> offset, size_t length) = nullptr;
 	async::result<frg::expected<protocols::fs::Error, size_t>> (*write)(void *object, helix_ng::CredentialsView credentials,
 			const void *buffer, size_t length) = nullptr;
 	async::result<frg::expected<protocols::fs::Error, size_t>> (*pwrite)(void *object, int64_t offset, helix_ng::CredentialsView credentials,
 			const void *buffer, size_t length) = nullptr;
 	async::result<ReadEntriesResult> (*readEntries)(void *object) = nullptr;
+	// Returns as many entries as fit into max_size bytes (encoded by a DirentBuilder).
+	// Fails with illegalArguments if not even a single entry fits.
+	async::result<ReadEntriesBatchResult> (*readEntriesBatch)(void *object, size_t max_size) = nullptr;
 	async::result<helix::BorrowedDescriptor>(*accessMemory)(void *object) = nullptr;
 	async::result<frg::expected<protocols::fs::Error>> (*truncate)(void *object, size_t size) = nullptr;
 	async::result<frg::expected<protocols::fs::Error>> (*fallocate)(void *object, int64_t offset, size_t size) = nullptr;
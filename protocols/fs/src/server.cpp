@@ -1,4 +1,5 @@
 
+#include <algorithm>
 #include <stdio.h>
 #include <string.h>
 #include <unistd.h>
@@ -35,6 +36,9 @@ bool handleSoPasscred(bool so_passcred, struct ucred &ucred, pid_t process_pid,
 
 namespace {
 
+// Upper bound on the size of a single PT_READ_ENTRIES_BATCH response.
+constexpr size_t maxEntriesBatchSize = 64 * 1024;
+
 constinit protocols::ostrace::Event ostEvtRequest{"fs.request"};
 constinit protocols::ostrace::UintAttribute ostAttrRequest{"request"};
 constinit protocols::ostrace::UintAttribute ostAttrTime{"time"};
@@ -54,6 +58,39 @@ async::result<void> initOstrace() {
 	co_await ostContext.create();
 }
 
+// Sends the response to READ or PT_PREAD directly from a ReadView.
+template<typename LogFn>
+async::result<void> sendReadView(helix::UniqueLane &conversation, ReadViewResult res,
+		LogFn &logBragiSerializedReply) {
+	managarm::fs::SvrResponse resp;
+	auto error = std::get_if<Error>(&res);
+	if(error) {
+		resp.set_error(*error | toFsError);
+
+		auto ser = resp.SerializeAsString();
+		auto [send_resp] = co_await helix_ng::exchangeMsgs(
+			conversation,
+			helix_ng::sendBuffer(ser.data(), ser.size())
+		);
+		HEL_CHECK(send_resp.error());
+		logBragiSerializedReply(ser);
+		co_return;
+	}
+
+	auto &view = std::get<ReadView>(res);
+	resp.set_error(managarm::fs::Errors::SUCCESS);
+
+	auto ser = resp.SerializeAsString();
+	auto [send_resp, send_data] = co_await helix_ng::exchangeMsgs(
+		conversation,
+		helix_ng::sendBuffer(ser.data(), ser.size()),
+		helix_ng::sendBuffer(view.data, view.length)
+	);
+	HEL_CHECK(send_resp.error());
+	HEL_CHECK(send_data.error());
+	logBragiSerializedReply(ser);
+}
+
 async::detached handlePassthrough(smarter::shared_ptr<void> file,
 		const FileOperations *file_ops,
 		managarm::fs::CntRequest req, helix::UniqueLane conversation, timespec requestTimestamp) {
@@ -180,6 +217,13 @@ async::detached handlePassthrough(smarter::shared_ptr<void> file,
 		);
 		HEL_CHECK(extract_creds.error());
 
+		if(file_ops->readView) {
+			auto res = co_await file_ops->readView(file.get(), extract_creds.credentials(),
+					std::nullopt, req.size());
+			co_await sendReadView(conversation, std::move(res), logBragiSerializedReply);
+			co_return;
+		}
+
 		if(!file_ops->read) {
 			managarm::fs::SvrResponse resp;
 			resp.set_error(managarm::fs::Errors::ILLEGAL_OPERATION_TARGET);
@@ -233,6 +277,13 @@ async::detached handlePassthrough(smarter::shared_ptr<void> file,
 		);
 		HEL_CHECK(extract_creds.error());
 
+		if(file_ops->readView) {
+			auto res = co_await file_ops->readView(file.get(), extract_creds.credentials(),
+					req.offset(), req.size());
+			co_await sendReadView(conversation, std::move(res), logBragiSerializedReply);
+			co_return;
+		}
+
 		if(!file_ops->pread) {
 			managarm::fs::SvrResponse resp;
 			resp.set_error(managarm::fs::Errors::ILLEGAL_OPERATION_TARGET);
@@ -452,6 +503,53 @@ async::detached handlePassthrough(smarter::shared_ptr<void> file,
 			helix_ng::sendBuffer(ser.data(), ser.size()));
 		HEL_CHECK(send_resp.error());
 		logBragiSerializedReply(ser);
+	}else if(req.req_type() == managarm::fs::CntReqType::PT_READ_ENTRIES_BATCH) {
+		if(!file_ops->readEntriesBatch || req.size() <= 0) {
+			managarm::fs::SvrResponse resp;
+			resp.set_error(file_ops->readEntriesBatch
+					? managarm::fs::Errors::ILLEGAL_ARGUMENT
+					: managarm::fs::Errors::ILLEGAL_OPERATION_TARGET);
+
+			auto ser = resp.SerializeAsString();
+			auto [send_resp] = co_await helix_ng::exchangeMsgs(
+				conversation,
+				helix_ng::sendBuffer(ser.data(), ser.size())
+			);
+			HEL_CHECK(send_resp.error());
+			logBragiSerializedReply(ser);
+			co_return;
+		}
+		auto result = co_await file_ops->readEntriesBatch(file.get(),
+				std::min(static_cast<size_t>(req.size()), maxEntriesBatchSize));
+
+		managarm::fs::SvrResponse resp;
+		auto error = std::get_if<Error>(&result);
+		if(error) {
+			resp.set_error(*error | toFsError);
+		}else if(std::get<std::vector<char>>(result).empty()) {
+			resp.set_error(managarm::fs::Errors::END_OF_FILE);
+		}else{
+			resp.set_error(managarm::fs::Errors::SUCCESS);
+		}
+
+		auto ser = resp.SerializeAsString();
+		if(resp.error() != managarm::fs::Errors::SUCCESS) {
+			auto [send_resp] = co_await helix_ng::exchangeMsgs(
+				conversation,
+				helix_ng::sendBuffer(ser.data(), ser.size()));
+			HEL_CHECK(send_resp.error());
+			logBragiSerializedReply(ser);
+			co_return;
+		}
+
+		auto &entries = std::get<std::vector<char>>(result);
+		auto [send_resp, send_data] = co_await helix_ng::exchangeMsgs(
+			conversation,
+			helix_ng::sendBuffer(ser.data(), ser.size()),
+			helix_ng::sendBuffer(entries.data(), entries.size()));
+		HEL_CHECK(send_resp.error());
+		HEL_CHECK(send_data.error());
+		logBragiSerializedReply(ser);
 	}else if(req.req_type() == managarm::fs::CntReqType::MMAP) {
 		if(!file_ops->accessMemory) {
 			managarm::fs::SvrResponse resp;
@@ -2,8 +2,10 @@
 
 #include <span>
 #include <string>
+#include <string_view>
 
 #include <async/queue.hpp>
+#include <async/recurring-event.hpp>
 #include <async/result.hpp>
 #include <helix/ipc.hpp>
 #include <ostrace.bragi.hpp>
@@ -97,6 +99,23 @@ struct BragiAttribute : Term {
 	}
 };
 
+// Stores a string in a BufferAttribute record.
+struct StringAttribute : Term {
+	friend struct Context;
+
+	using Record = managarm::ostrace::BufferAttribute;
+
+	constexpr StringAttribute(const char *name)
+	: Term{name} { }
+
+	std::pair<StringAttribute *, Record> operator() (std::string_view v) {
+		Record record;
+		record.set_id(static_cast<uint64_t>(id()));
+		record.set_buffer(std::vector<uint8_t>(v.begin(), v.end()));
+		return {this, std::move(record)};
+	}
+};
+
 // Lifetime:
 //   * The Vocabulary needs to outlive the Context.
 struct Context {
@@ -163,6 +182,7 @@ struct Context {
 		(emitMsg(args.second), ...);
 		emitMsg(endOfRecord);
 
+		numPending_++;
 		queue_.put(std::move(buffer));
 	}
 
@@ -171,6 +191,10 @@ struct Context {
 		emitWithTimestamp(event, 0, std::forward<Args>(args)...);
 	}
 
+	// Waits until all events have been sent to the kernel.
+	// Short-lived programs need to call this before they exit.
+	async::result<void> flush();
+
 private:
 	async::result<ItemId> announceItem_(std::string_view name);
 	async::result<void> run_();
@@ -179,6 +203,8 @@ private:
 	helix::UniqueLane lane_;
 	bool enabled_ = false;
 	async::queue<std::vector<char>, frg::stl_allocator> queue_;
+	size_t numPending_ = 0;
+	async::recurring_event drained_;
 };
 
 struct Timer {
@@ -116,7 +116,16 @@ async::result<void> Context::run_() {
 		assert(maybeResp);
 		auto &resp = maybeResp.value();
 		assert(resp.error() == managarm::ostrace::Error::SUCCESS);
+
+		assert(numPending_);
+		if(!--numPending_)
+			drained_.raise();
 	}
 }
 
+async::result<void> Context::flush() {
+	while(numPending_)
+		co_await drained_.async_wait();
+}
+
 } // namespace protocols::ostrace
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <stdint.h>
 #include <hel.h>
 
 namespace posix {
@@ -10,6 +11,30 @@ struct ManagarmProcessData {
 	void *threadPage;
 	HelHandle *fileTable;
 	void *clockTrackerPage;
+	// Note: posix writes the entire struct to the libc's buffer, hence adding
+	// fields breaks the ABI. The clock page is returned by superGetClockPage instead.
+};
+
+// Layout of the per-thread page that is shared between posix and the thread.
+// It allows threads to query and change their signal state without supercalls.
+struct ThreadPage {
+	// Set to 1 by the thread while it cannot handle signals.
+	// posix sets it to 2 to request a superSigRaise once signals can be handled again.
+	unsigned int globalSignalFlag;
+
+	// TID of the thread. Written by posix.
+	int tid;
+
+	// Signal mask of the thread. The thread may update it without a supercall;
+	// however, if it unblocks a signal in pendingSignals, it has to issue superSigRaise.
+	uint64_t signalMask;
+
+	// Superset of the signals that are currently pending. Written by posix
+	// before it interrupts the thread to deliver a signal.
+	uint64_t pendingSignals;
+
+	// Incremented by posix whenever a signal handler is entered (see superSigSuspend).
+	uint64_t enteredSignalSeq;
 };
 
 struct ManagarmServerData {
@@ -20,6 +20,9 @@ inline constexpr uint32_t superSigSuspend = 13;
 inline constexpr uint32_t superGetTid = 14;
 inline constexpr uint32_t superSigGetPending = 15;
 inline constexpr uint32_t superSigTimedWait = 16;
+inline constexpr uint32_t superVfork = 17;
+// Returns the address of the kernel's clock page (see HelClockPage) in the caller.
+inline constexpr uint32_t superGetClockPage = 18;
 inline constexpr uint32_t superGetServerData = 64;
 
 } // namespace posix
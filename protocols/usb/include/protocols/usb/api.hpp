@@ -55,12 +55,14 @@ struct InterruptTransfer {
 struct BulkTransfer {
 	BulkTransfer(XferFlags flags, arch::dma_buffer_view buffer)
 	: flags{flags}, buffer{buffer},
-			allowShortPackets{false}, lazyNotification{false} { }
+			allowShortPackets{false}, lazyNotification{false}, streamId{0} { }
 
 	XferFlags flags;
 	arch::dma_buffer_view buffer;
 	bool allowShortPackets;
 	bool lazyNotification;
+	// Bulk stream that the transfer is queued on (USB 3); 0 if streams are not used.
+	uint16_t streamId;
 };
 
 enum class PipeType {
@@ -79,6 +81,14 @@ public:
 	virtual async::result<frg::expected<UsbError, size_t>> transfer(ControlTransfer info) = 0;
 	virtual async::result<frg::expected<UsbError, size_t>> transfer(InterruptTransfer info) = 0;
 	virtual async::result<frg::expected<UsbError, size_t>> transfer(BulkTransfer info) = 0;
+
+	// Allocates bulk streams 1 to N for this endpoint. Returns N (which may be less
+	// than count). The default implementation does not support streams.
+	virtual async::result<frg::expected<UsbError, size_t>> allocateStreams(size_t count);
+
+	// Completes all pending transfers of a stream with an error.
+	// Used when the device will never serve them. The default implementation does not support streams.
+	virtual async::result<frg::expected<UsbError>> abortStream(uint16_t streamId);
 };
 
 
@@ -88,6 +98,8 @@ struct Endpoint {
 	async::result<frg::expected<UsbError, size_t>> transfer(ControlTransfer info) const;
 	async::result<frg::expected<UsbError, size_t>> transfer(InterruptTransfer info) const;
 	async::result<frg::expected<UsbError, size_t>> transfer(BulkTransfer info) const;
+	async::result<frg::expected<UsbError, size_t>> allocateStreams(size_t count) const;
+	async::result<frg::expected<UsbError>> abortStream(uint16_t streamId) const;
 
 private:
 	std::shared_ptr<EndpointData> _state;
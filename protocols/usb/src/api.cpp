@@ -101,6 +101,18 @@ Interface::getEndpoint(PipeType type, int number) const {
 	return _state->getEndpoint(type, number);
 }
 
+// ----------------------------------------------------------------------------
+// EndpointData.
+// ----------------------------------------------------------------------------
+
+async::result<frg::expected<UsbError, size_t>> EndpointData::allocateStreams(size_t) {
+	co_return UsbError::unsupported;
+}
+
+async::result<frg::expected<UsbError>> EndpointData::abortStream(uint16_t) {
+	co_return UsbError::unsupported;
+}
+
 // ----------------------------------------------------------------------------
 // Endpoint.
 // ----------------------------------------------------------------------------
@@ -116,4 +128,12 @@ async::result<frg::expected<UsbError, size_t>> Endpoint::transfer(BulkTransfer i
 	return _state->transfer(info);
 }
 
+async::result<frg::expected<UsbError, size_t>> Endpoint::allocateStreams(size_t count) const {
+	return _state->allocateStreams(count);
+}
+
+async::result<frg::expected<UsbError>> Endpoint::abortStream(uint16_t streamId) const {
+	return _state->abortStream(streamId);
+}
+
 } // namespace protocols::usb
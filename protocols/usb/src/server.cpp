@@ -48,10 +48,69 @@ auto handleXferReq(auto req, auto &endpoint, auto &&...xferArgs) {
 	if (req->dir() == managarm::usb::XferDirection::TO_DEVICE)
 		xfer.allowShortPackets = req->allow_short_packets();
 	xfer.lazyNotification = req->lazy_notification();
+	if constexpr (requires { xfer.streamId; })
+		xfer.streamId = req->stream_id();
 
 	return endpoint.transfer(xfer);
 };
 
+// Performs a single transfer and sends the response.
+// Transfers are handled concurrently such that class drivers can keep multiple
+// transfers queued on the same endpoint (e.g., pre-posted IN transfers).
+async::detached handleTransfer(Endpoint endpoint, helix::UniqueDescriptor conversation,
+		managarm::usb::TransferRequest req, arch::dma_buffer buffer) {
+	frg::expected<UsbError, uint64_t> outcome;
+
+	switch (req.type()) {
+		using enum managarm::usb::XferType;
+		case INTERRUPT:
+			outcome = co_await handleXferReq<InterruptTransfer>(&req, endpoint, buffer);
+			break;
+		case BULK:
+			outcome = co_await handleXferReq<BulkTransfer>(&req, endpoint, buffer);
+			break;
+			// TODO(qookie): Support control EPs
+			//case CONTROL:
+			//	outcome = co_await handleXferReq<ControlTransfer>(&req, endpoint, buffer);
+			//	break;
+		default:
+			std::cout << "Unexpected endpoint type\n";
+			co_return;
+	}
+
+	if (!outcome) {
+		co_await respondWithError(conversation, outcome.error());
+		co_return;
+	}
+
+	auto length = outcome.value();
+
+	managarm::usb::SvrResponse resp;
+	resp.set_error(managarm::usb::Errors::SUCCESS);
+
+	if (req.dir() == managarm::usb::XferDirection::TO_HOST) {
+		auto [sendResp, sendData] =
+			co_await helix_ng::exchangeMsgs(
+				conversation,
+				helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{}),
+				helix_ng::sendBuffer(buffer.data(), length)
+			);
+
+		HEL_CHECK(sendResp.error());
+		HEL_CHECK(sendData.error());
+	} else {
+		resp.set_size(length);
+
+		auto [sendResp] =
+			co_await helix_ng::exchangeMsgs(
+				conversation,
+				helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
+			);
+
+		HEL_CHECK(sendResp.error());
+	}
+}
+
 } // namespace anonymous
 
 async::detached serveEndpoint(Endpoint endpoint, helix::UniqueLane lane) {
@@ -95,54 +154,55 @@ async::detached serveEndpoint(Endpoint endpoint, helix::UniqueLane lane) {
 				HEL_CHECK(recvBuffer.error());
 			}
 
-			frg::expected<UsbError, uint64_t> outcome;
-
-			switch (req->type()) {
-				using enum managarm::usb::XferType;
-				case INTERRUPT:
-					outcome = co_await handleXferReq<InterruptTransfer>(req, endpoint, buffer);
-					break;
-				case BULK:
-					outcome = co_await handleXferReq<BulkTransfer>(req, endpoint, buffer);
-					break;
-					// TODO(qookie): Support control EPs
-					//case CONTROL:
-					//	outcome = co_await handleXferReq<ControlTransfer>(req, endpoint, buffer);
-					//	break;
-				default:
-					std::cout << "Unexpected endpoint type\n";
-					co_return;
+			// HCDs queue the transfer before they suspend for the first time,
+			// hence transfers are still submitted in the order of the requests.
+			handleTransfer(endpoint, std::move(conversation), std::move(*req), std::move(buffer));
+		} else if (preamble.id() == bragi::message_id<managarm::usb::AllocateStreamsRequest>) {
+			auto req = bragi::parse_head_only<managarm::usb::AllocateStreamsRequest>(recvReq);
+			recvReq.reset();
+			if (!req) {
+				co_return;
 			}
 
+			auto outcome = co_await endpoint.allocateStreams(req->count());
 			if (!outcome) {
 				co_await respondWithError(conversation, outcome.error());
 				continue;
 			}
 
-			auto length = outcome.value();
-
 			managarm::usb::SvrResponse resp;
 			resp.set_error(managarm::usb::Errors::SUCCESS);
+			resp.set_size(outcome.value());
 
-			if (req->dir() == managarm::usb::XferDirection::TO_HOST) {
-				auto [sendResp, sendData] =
-					co_await helix_ng::exchangeMsgs(
-						conversation,
-						helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{}),
-						helix_ng::sendBuffer(buffer.data(), length)
-					);
+			auto [sendResp] = co_await helix_ng::exchangeMsgs(
+				conversation,
+				helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
+			);
 
-				HEL_CHECK(sendResp.error());
-				HEL_CHECK(sendData.error());
-			} else {
-				auto [sendResp] =
-					co_await helix_ng::exchangeMsgs(
-						conversation,
-						helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
-					);
+			HEL_CHECK(sendResp.error());
+		} else if (preamble.id() == bragi::message_id<managarm::usb::AbortStreamRequest>) {
+			auto req = bragi::parse_head_only<managarm::usb::AbortStreamRequest>(recvReq);
+			recvReq.reset();
+			if (!req) {
+				co_return;
+			}
 
-				HEL_CHECK(sendResp.error());
+			// Pending transfers are handled concurrently, hence this does not block them.
+			auto outcome = co_await endpoint.abortStream(req->stream_id());
+			if (!outcome) {
+				co_await respondWithError(conversation, outcome.error());
+				continue;
 			}
+
+			managarm::usb::SvrResponse resp;
+			resp.set_error(managarm::usb::Errors::SUCCESS);
+
+			auto [sendResp] = co_await helix_ng::exchangeMsgs(
+				conversation,
+				helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
+			);
+
+			HEL_CHECK(sendResp.error());
 		}else{
 			recvReq.reset();
 			managarm::usb::SvrResponse resp;
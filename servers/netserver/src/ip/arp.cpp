@@ -168,7 +168,7 @@ async::detached entryProber(uint32_t ip, Neighbours::Entry &e, uint32_t sender)
 		std::cout << "netserver: sent arp req" << std::endl;
 
 		async::cancellation_event ev;
-		helix::TimeoutCancellation timer { 1'000'000'000, ev };
+		helix::TimeoutCancellation timer { 1'000'000'000, ev, helix::coarseSlack(1'000'000'000) };
 		co_await e.change.async_wait(ev);
 		co_await timer.retire();
 
@@ -0,0 +1,113 @@
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+#include <hel.h>
+#include <hel-syscalls.h>
+
+#include "testsuite.hpp"
+
+namespace {
+
+// Submits helSubmitWriteMemory() to a single-chunk queue and waits for the result.
+HelError writeMemory(HelHandle handle, uintptr_t address, const void *buffer, size_t length) {
+	HelQueueParameters params{
+		.flags = 0,
+		.ringShift = 0,
+		.numChunks = 1,
+		.chunkSize = 4096
+	};
+	HelHandle queueHandle;
+	HEL_CHECK(helCreateQueue(&params, &queueHandle));
+
+	auto chunkOffset = (sizeof(HelQueue) + sizeof(int) + 63) & ~size_t(63);
+	auto overallSize = (chunkOffset + sizeof(HelChunk) + params.chunkSize + 0xFFF) & ~size_t(0xFFF);
+	void *mapping;
+	HEL_CHECK(helMapMemory(queueHandle, kHelNullHandle, nullptr,
+			0, overallSize, kHelMapProtRead | kHelMapProtWrite, &mapping));
+	auto queue = reinterpret_cast<HelQueue *>(mapping);
+	auto chunk = reinterpret_cast<HelChunk *>(reinterpret_cast<std::byte *>(mapping) + chunkOffset);
+
+	// Hand the only chunk to the kernel.
+	chunk->progressFutex = 0;
+	queue->indexQueue[0] = 0;
+	if(__atomic_exchange_n(&queue->headFutex, 1, __ATOMIC_RELEASE) & kHelHeadWaiters)
+		HEL_CHECK(helFutexWake(&queue->headFutex));
+
+	HEL_CHECK(helSubmitWriteMemory(handle, address, length, buffer, queueHandle, 0));
+
+	while(true) {
+		auto futex = __atomic_load_n(&chunk->progressFutex, __ATOMIC_ACQUIRE);
+		if(futex & kHelProgressMask)
+			break;
+		if(!(futex & kHelProgressWaiters)
+				&& !__atomic_compare_exchange_n(&chunk->progressFutex, &futex,
+					futex | kHelProgressWaiters, false, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE))
+			continue;
+		HEL_CHECK(helFutexWait(&chunk->progressFutex, futex | kHelProgressWaiters, -1));
+	}
+
+	auto result = reinterpret_cast<HelSimpleResult *>(chunk->buffer + sizeof(HelElement));
+	auto error = result->error;
+
+	HEL_CHECK(helUnmapMemory(kHelNullHandle, mapping, overallSize));
+	HEL_CHECK(helCloseDescriptor(kHelThisUniverse, queueHandle));
+	return error;
+}
+
+// The kernel never leaves the seqlock odd after an update.
+void checkClockPageIntact(HelHandle clockHandle) {
+	void *window;
+	HEL_CHECK(helMapMemory(clockHandle, kHelNullHandle, nullptr, 0, 0x1000,
+			kHelMapProtRead, &window));
+	auto page = reinterpret_cast<HelClockPage *>(window);
+	assert(!(__atomic_load_n(&page->seqlock, __ATOMIC_ACQUIRE) & 1));
+	HEL_CHECK(helUnmapMemory(kHelNullHandle, window, 0x1000));
+}
+
+} // anonymous namespace
+
+DEFINE_TEST(clockPageMapWritable, ([] {
+	HelHandle handle;
+	HEL_CHECK(helGetClockPage(&handle));
+	void *window;
+	assert(helMapMemory(handle, kHelNullHandle, nullptr, 0, 0x1000,
+			kHelMapProtRead | kHelMapProtWrite, &window) == kHelErrIllegalArgs);
+	HEL_CHECK(helCloseDescriptor(kHelThisUniverse, handle));
+}))
+
+DEFINE_TEST(clockPageWriteMemory, ([] {
+	HelHandle handle;
+	HEL_CHECK(helGetClockPage(&handle));
+	uint64_t seqlock = 1;
+	assert(writeMemory(handle, 0, &seqlock, sizeof(uint64_t)) == kHelErrIllegalArgs);
+	checkClockPageIntact(handle);
+	HEL_CHECK(helCloseDescriptor(kHelThisUniverse, handle));
+}))
+
+DEFINE_TEST(clockPageWriteSpace, ([] {
+	HelHandle handle;
+	HEL_CHECK(helGetClockPage(&handle));
+	HelHandle space;
+	HEL_CHECK(helCreateSpace(&space));
+	void *window;
+	HEL_CHECK(helMapMemory(handle, space, nullptr, 0, 0x1000, kHelMapProtRead, &window));
+
+	uint64_t seqlock = 1;
+	assert(writeMemory(space, reinterpret_cast<uintptr_t>(window),
+			&seqlock, sizeof(uint64_t)) == kHelErrFault);
+	checkClockPageIntact(handle);
+
+	HEL_CHECK(helCloseDescriptor(kHelThisUniverse, space));
+	HEL_CHECK(helCloseDescriptor(kHelThisUniverse, handle));
+}))
+
+DEFINE_TEST(clockPageIndirection, ([] {
+	HelHandle handle;
+	HEL_CHECK(helGetClockPage(&handle));
+	HelHandle indirect;
+	HEL_CHECK(helCreateIndirectMemory(1, &indirect));
+	assert(helAlterMemoryIndirection(indirect, 0, handle, 0, 0x1000) == kHelErrIllegalArgs);
+	HEL_CHECK(helCloseDescriptor(kHelThisUniverse, indirect));
+	HEL_CHECK(helCloseDescriptor(kHelThisUniverse, handle));
+}))
@@ -0,0 +1,43 @@
+#include <cassert>
+#include <cstdint>
+
+#include <hel.h>
+#include <hel-syscalls.h>
+
+#include "testsuite.hpp"
+
+namespace {
+
+// Waits on a futex that is never woken and returns the time at which the wait returned.
+uint64_t waitForTimeout(uint64_t deadline, uint32_t flags) {
+	int futex = 0;
+	HEL_CHECK(helFutexWaitBitset(&futex, 0, deadline, UINT32_MAX, kHelFutexPrivate | flags));
+	uint64_t now;
+	HEL_CHECK(helGetClock(&now));
+	return now;
+}
+
+} // anonymous namespace
+
+DEFINE_TEST(futexTimeout, ([] {
+	uint64_t start;
+	HEL_CHECK(helGetClock(&start));
+	auto deadline = start + 10'000'000;
+	assert(waitForTimeout(deadline, 0) >= deadline);
+}))
+
+// Coarse timeouts may elapse late but never early.
+DEFINE_TEST(coarseFutexTimeout, ([] {
+	uint64_t start;
+	HEL_CHECK(helGetClock(&start));
+	for(uint64_t timeout : {500'000ull, 10'000'000ull, 100'000'000ull}) {
+		auto deadline = start + timeout;
+		assert(waitForTimeout(deadline, kHelFutexCoarse) >= deadline);
+		HEL_CHECK(helGetClock(&start));
+	}
+}))
+
+DEFINE_TEST(futexIllegalFlags, ([] {
+	int futex = 0;
+	assert(helFutexWaitBitset(&futex, 0, -1, UINT32_MAX, 0x80) == kHelErrIllegalArgs);
+}))
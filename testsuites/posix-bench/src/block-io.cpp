@@ -0,0 +1,109 @@
+#include <cassert>
+#include <cstdlib>
+#include <fcntl.h>
+#include <iostream>
+#include <random>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "testsuite.hpp"
+
+// fio-style throughput benchmark for block devices (and files on top of them).
+// Usage: posix-bench block_io <path> [<block size>] [<total size>] [<jobs>] [write]
+// The path should refer to a device (or a file) that is not in the page cache yet.
+// Writes are destructive and therefore only performed if "write" is given.
+
+namespace {
+
+struct job_result {
+	uint64_t bytes = 0;
+	uint64_t ops = 0;
+};
+
+void report(const char *pattern, size_t block_size, int jobs,
+		uint64_t bytes, uint64_t ops, uint64_t ns) {
+	std::cout << "    " << pattern << " bs=" << block_size << " jobs=" << jobs
+			<< ": " << (bytes * 1000 / ns) << " MB/s, "
+			<< (ops * 1'000'000'000 / ns) << " IOPS" << std::endl;
+}
+
+// Each job works on its own part of [start, start + total).
+void run_pattern(const char *pattern, int fd, off_t start, size_t block_size, size_t total,
+		int jobs, bool random, bool write) {
+	std::vector<job_result> results(jobs);
+	std::vector<std::thread> threads;
+
+	stopwatch watch;
+	for(int j = 0; j < jobs; j++) {
+		threads.emplace_back([&, j] {
+			std::vector<char> buffer(block_size, static_cast<char>(j));
+			size_t per_job = total / jobs;
+			size_t num_blocks = per_job / block_size;
+			off_t base = start + j * per_job;
+
+			std::mt19937_64 rng{static_cast<uint64_t>(j)};
+			std::uniform_int_distribution<size_t> dist{0, num_blocks - 1};
+
+			for(size_t i = 0; i < num_blocks; i++) {
+				off_t offset = base + (random ? dist(rng) : i) * block_size;
+				ssize_t n;
+				if(write) {
+					n = pwrite(fd, buffer.data(), block_size, offset);
+				}else{
+					n = pread(fd, buffer.data(), block_size, offset);
+				}
+				assert(n == static_cast<ssize_t>(block_size));
+				results[j].bytes += n;
+				results[j].ops++;
+			}
+		});
+	}
+	for(auto &thread : threads)
+		thread.join();
+	if(write)
+		fsync(fd);
+	auto ns = watch.elapsed();
+
+	job_result sum;
+	for(auto &result : results) {
+		sum.bytes += result.bytes;
+		sum.ops += result.ops;
+	}
+	report(pattern, block_size, jobs, sum.bytes, sum.ops, ns);
+}
+
+} // anonymous namespace
+
+DEFINE_BENCHMARK(block_io, ([] (const benchmark_args &args) {
+	if(args.empty()) {
+		std::cout << "    Skipping: no device given" << std::endl;
+		return;
+	}
+
+	auto &path = args[0];
+	size_t block_size = args.size() > 1 ? std::strtoull(args[1].c_str(), nullptr, 0) : 128 * 1024;
+	size_t total = args.size() > 2 ? std::strtoull(args[2].c_str(), nullptr, 0) : 256 << 20;
+	int jobs = args.size() > 3 ? std::atoi(args[3].c_str()) : 4;
+	bool write = args.size() > 4 && args[4] == "write";
+	assert(block_size && jobs > 0);
+
+	int fd = open(path.c_str(), write ? O_RDWR : O_RDONLY);
+	if(fd < 0) {
+		std::cout << "    Skipping: cannot open " << path << std::endl;
+		return;
+	}
+
+	// Random I/O uses the second half of the range such that it does not hit
+	// pages that were cached by the sequential run.
+	size_t half = total / 2;
+	run_pattern("seqread", fd, 0, block_size, half, 1, false, false);
+	run_pattern("randread", fd, half, 4096, half, jobs, true, false);
+	if(write) {
+		run_pattern("seqwrite", fd, 0, block_size, half, 1, false, true);
+		run_pattern("randwrite", fd, half, 4096, half, jobs, true, true);
+	}
+
+	close(fd);
+}))
@@ -0,0 +1,110 @@
+#include <cassert>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+
+#include <hel.h>
+#include <hel-syscalls.h>
+#include <protocols/posix/supercalls.hpp>
+
+#include "testsuite.hpp"
+
+// Measures the number of clock reads per second: clock_gettime() of the libc,
+// helGetClock() and reading the kernel's clock page (which posix maps into each
+// process, see superGetClockPage) directly. Without a syscall, a read is
+// dominated by the cost of reading the timestamp counter.
+// Usage: posix-bench clock [<iterations>]
+
+namespace {
+
+uint64_t time_clock(clockid_t clock, int iterations) {
+	stopwatch watch;
+	for(int i = 0; i < iterations; i++) {
+		struct timespec ts;
+		[[maybe_unused]] auto e = clock_gettime(clock, &ts);
+		assert(!e);
+	}
+	return watch.elapsed();
+}
+
+template<typename F>
+uint64_t time_reads(int iterations, F read) {
+	stopwatch watch;
+	for(int i = 0; i < iterations; i++) {
+		[[maybe_unused]] uint64_t now = read();
+		assert(now);
+	}
+	return watch.elapsed();
+}
+
+const HelClockPage *clock_page() {
+	HelWord address;
+	HEL_CHECK(helSyscall0_1(kHelCallSuper + posix::superGetClockPage, &address));
+	return reinterpret_cast<const HelClockPage *>(address);
+}
+
+// Returns false if the page does not export the clock (see HelClockPageMode).
+bool read_clock_page(const HelClockPage *page, uint64_t &now) {
+	while(true) {
+		auto seqlock = __atomic_load_n(&page->seqlock, __ATOMIC_ACQUIRE);
+		if(seqlock & 1)
+			continue;
+
+		auto mode = __atomic_load_n(&page->mode, __ATOMIC_RELAXED);
+		auto factor = __atomic_load_n(&page->factor, __ATOMIC_RELAXED);
+		auto shift = __atomic_load_n(&page->shift, __ATOMIC_RELAXED);
+
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		if(__atomic_load_n(&page->seqlock, __ATOMIC_RELAXED) != seqlock)
+			continue;
+
+		if(mode != kHelClockPageCounter)
+			return false;
+#if defined(__x86_64__)
+		uint32_t lsw, msw;
+		asm volatile ("lfence; rdtsc" : "=a"(lsw), "=d"(msw));
+		auto counter = (static_cast<uint64_t>(msw) << 32) | static_cast<uint64_t>(lsw);
+		now = (static_cast<__uint128_t>(factor) * counter) >> shift;
+		return true;
+#else
+		// The kernel does not export the counter on other architectures.
+		return false;
+#endif
+	}
+}
+
+} // anonymous namespace
+
+DEFINE_BENCHMARK(clock, ([] (const benchmark_args &args) {
+	int iterations = args.size() > 0 ? std::atoi(args[0].c_str()) : 1000000;
+
+	auto monotonic_ns = time_clock(CLOCK_MONOTONIC, iterations);
+	auto realtime_ns = time_clock(CLOCK_REALTIME, iterations);
+
+	auto syscall_ns = time_reads(iterations, [] {
+		uint64_t now;
+		HEL_CHECK(helGetClock(&now));
+		return now;
+	});
+
+	std::cout << "    CLOCK_MONOTONIC: " << (iterations * 1'000'000'000ull / monotonic_ns)
+			<< " calls/s, CLOCK_REALTIME: " << (iterations * 1'000'000'000ull / realtime_ns)
+			<< " calls/s, helGetClock(): " << (iterations * 1'000'000'000ull / syscall_ns)
+			<< " calls/s" << std::endl;
+
+	auto page = clock_page();
+	uint64_t now;
+	if(!read_clock_page(page, now)) {
+		std::cout << "    The clock page does not export the clock" << std::endl;
+		return;
+	}
+
+	auto page_ns = time_reads(iterations, [&] {
+		[[maybe_unused]] auto success = read_clock_page(page, now);
+		assert(success);
+		return now;
+	});
+
+	std::cout << "    Clock page: " << (iterations * 1'000'000'000ull / page_ns)
+			<< " reads/s" << std::endl;
+}))
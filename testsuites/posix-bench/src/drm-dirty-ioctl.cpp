@@ -0,0 +1,145 @@
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <libdrm/drm.h>
+#include <libdrm/drm_mode.h>
+#include <string>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <vector>
+
+#include "testsuite.hpp"
+
+// Measures the round-trip latency of DRM_IOCTL_MODE_DIRTYFB for small damage rectangles
+// (e.g., a blinking cursor) compared to full-screen updates.
+// Usage: posix-bench drm_dirty_ioctl [<card>]
+// This is not the frame time: virtio and vmware only queue transfers in the ioctl and
+// flush asynchronously, while plainfb blits synchronously before it replies.
+
+namespace {
+
+bool find_output(int fd, uint32_t &connector_id, uint32_t &crtc_id, drm_mode_modeinfo &mode) {
+	drm_mode_card_res res{};
+	if(ioctl(fd, DRM_IOCTL_MODE_GETRESOURCES, &res))
+		return false;
+	std::vector<uint32_t> crtcs(res.count_crtcs);
+	std::vector<uint32_t> connectors(res.count_connectors);
+	res.count_fbs = 0;
+	res.count_encoders = 0;
+	res.crtc_id_ptr = reinterpret_cast<uintptr_t>(crtcs.data());
+	res.connector_id_ptr = reinterpret_cast<uintptr_t>(connectors.data());
+	if(ioctl(fd, DRM_IOCTL_MODE_GETRESOURCES, &res) || crtcs.empty())
+		return false;
+
+	for(auto id : connectors) {
+		drm_mode_get_connector conn{};
+		conn.connector_id = id;
+		if(ioctl(fd, DRM_IOCTL_MODE_GETCONNECTOR, &conn) || !conn.count_modes)
+			continue;
+		std::vector<drm_mode_modeinfo> modes(conn.count_modes);
+		conn.count_props = 0;
+		conn.count_encoders = 0;
+		conn.modes_ptr = reinterpret_cast<uintptr_t>(modes.data());
+		if(ioctl(fd, DRM_IOCTL_MODE_GETCONNECTOR, &conn))
+			continue;
+
+		connector_id = id;
+		crtc_id = crtcs[0];
+		mode = modes[0];
+		return true;
+	}
+	return false;
+}
+
+uint64_t time_dirty(int fd, uint32_t fb_id, uint32_t *pixels, uint32_t pitch,
+		drm_clip_rect *clip, int iterations) {
+	stopwatch watch;
+	for(int i = 0; i < iterations; i++) {
+		// Touch the damaged region such that the driver has something to transfer.
+		if(clip)
+			pixels[clip->y1 * (pitch / 4) + clip->x1] = i;
+
+		drm_mode_fb_dirty_cmd cmd{};
+		cmd.fb_id = fb_id;
+		cmd.num_clips = clip ? 1 : 0;
+		cmd.clips_ptr = reinterpret_cast<uintptr_t>(clip);
+		[[maybe_unused]] auto e = ioctl(fd, DRM_IOCTL_MODE_DIRTYFB, &cmd);
+		assert(!e);
+	}
+	return watch.elapsed();
+}
+
+} // anonymous namespace
+
+DEFINE_BENCHMARK(drm_dirty_ioctl, ([] (const benchmark_args &args) {
+	auto card = args.size() > 0 ? args[0] : std::string{"/dev/dri/card0"};
+
+	int fd = open(card.c_str(), O_RDWR);
+	if(fd < 0) {
+		std::cout << "    Skipping: cannot open " << card << std::endl;
+		return;
+	}
+
+	uint32_t connector_id, crtc_id;
+	drm_mode_modeinfo mode;
+	if(!find_output(fd, connector_id, crtc_id, mode)) {
+		std::cout << "    Skipping: no connected output" << std::endl;
+		close(fd);
+		return;
+	}
+
+	drm_mode_create_dumb dumb{};
+	dumb.width = mode.hdisplay;
+	dumb.height = mode.vdisplay;
+	dumb.bpp = 32;
+	[[maybe_unused]] auto e = ioctl(fd, DRM_IOCTL_MODE_CREATE_DUMB, &dumb);
+	assert(!e);
+
+	drm_mode_fb_cmd fb{};
+	fb.width = dumb.width;
+	fb.height = dumb.height;
+	fb.pitch = dumb.pitch;
+	fb.bpp = 32;
+	fb.depth = 24;
+	fb.handle = dumb.handle;
+	e = ioctl(fd, DRM_IOCTL_MODE_ADDFB, &fb);
+	assert(!e);
+
+	drm_mode_map_dumb map{};
+	map.handle = dumb.handle;
+	e = ioctl(fd, DRM_IOCTL_MODE_MAP_DUMB, &map);
+	assert(!e);
+	auto pixels = static_cast<uint32_t *>(mmap(nullptr, dumb.size,
+			PROT_READ | PROT_WRITE, MAP_SHARED, fd, map.offset));
+	assert(pixels != MAP_FAILED);
+	memset(pixels, 0, dumb.size);
+
+	drm_mode_crtc crtc{};
+	crtc.crtc_id = crtc_id;
+	crtc.fb_id = fb.fb_id;
+	crtc.set_connectors_ptr = reinterpret_cast<uintptr_t>(&connector_id);
+	crtc.count_connectors = 1;
+	crtc.mode = mode;
+	crtc.mode_valid = 1;
+	e = ioctl(fd, DRM_IOCTL_MODE_SETCRTC, &crtc);
+	assert(!e);
+
+	constexpr int iterations = 1000;
+	drm_clip_rect cursor{16, 16, 24, 32};
+	auto small_ns = time_dirty(fd, fb.fb_id, pixels, dumb.pitch, &cursor, iterations);
+	auto full_ns = time_dirty(fd, fb.fb_id, pixels, dumb.pitch, nullptr, iterations);
+
+	std::cout << "    " << mode.hdisplay << "x" << mode.vdisplay << ": "
+			<< (small_ns / iterations) << " ns per 8x16 DIRTYFB ioctl, "
+			<< (full_ns / iterations) << " ns per full-screen DIRTYFB ioctl" << std::endl;
+
+	munmap(pixels, dumb.size);
+	ioctl(fd, DRM_IOCTL_MODE_RMFB, &fb.fb_id);
+	drm_mode_destroy_dumb destroy{};
+	destroy.handle = dumb.handle;
+	ioctl(fd, DRM_IOCTL_MODE_DESTROY_DUMB, &destroy);
+	close(fd);
+}))
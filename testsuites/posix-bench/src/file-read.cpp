@@ -0,0 +1,77 @@
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <unistd.h>
+#include <vector>
+
+#include "testsuite.hpp"
+
+// Measures read() throughput of a file that is already in the page cache.
+// Usage: posix-bench file_read [<path>] [<buffer size>]
+// memcpy() throughput of the same amount of data is reported for comparison.
+
+namespace {
+
+uint64_t read_all(int fd, std::vector<char> &buffer) {
+	uint64_t total = 0;
+	auto offset = lseek(fd, 0, SEEK_SET);
+	assert(!offset);
+	(void)offset;
+	while(true) {
+		auto n = read(fd, buffer.data(), buffer.size());
+		assert(n >= 0);
+		if(!n)
+			break;
+		total += n;
+	}
+	return total;
+}
+
+} // anonymous namespace
+
+DEFINE_BENCHMARK(file_read, ([] (const benchmark_args &args) {
+	auto path = args.size() > 0 ? args[0] : std::string{"/usr/bin/posix-bench"};
+	size_t buffer_size = args.size() > 1 ? std::strtoull(args[1].c_str(), nullptr, 0) : 128 * 1024;
+	assert(buffer_size);
+
+	int fd = open(path.c_str(), O_RDONLY);
+	if(fd < 0) {
+		std::cout << "    Skipping: cannot open " << path << std::endl;
+		return;
+	}
+
+	std::vector<char> buffer(buffer_size);
+
+	// The first pass populates the page cache.
+	auto size = read_all(fd, buffer);
+	if(!size) {
+		std::cout << "    Skipping: " << path << " is empty" << std::endl;
+		close(fd);
+		return;
+	}
+
+	constexpr int passes = 16;
+	stopwatch read_watch;
+	for(int i = 0; i < passes; i++) {
+		auto n = read_all(fd, buffer);
+		assert(n == size);
+		(void)n;
+	}
+	auto read_ns = read_watch.elapsed();
+
+	std::vector<char> source(buffer_size, 1);
+	stopwatch memcpy_watch;
+	for(int i = 0; i < passes; i++) {
+		for(uint64_t progress = 0; progress < size; progress += buffer_size)
+			memcpy(buffer.data(), source.data(), std::min<uint64_t>(buffer_size, size - progress));
+	}
+	auto memcpy_ns = memcpy_watch.elapsed();
+
+	std::cout << "    read bs=" << buffer_size << ": "
+			<< (size * passes * 1000 / read_ns) << " MB/s (memcpy: "
+			<< (size * passes * 1000 / memcpy_ns) << " MB/s)" << std::endl;
+	close(fd);
+}))
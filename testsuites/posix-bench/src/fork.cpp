@@ -0,0 +1,58 @@
+#include <cassert>
+#include <cstdlib>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+#include "testsuite.hpp"
+
+// Measures the latency of fork() (including the child's exit) depending on
+// the number of mappings in the parent's address space.
+// Usage: posix-bench fork_latency [<iterations>]
+
+namespace {
+
+uint64_t time_fork(int iterations) {
+	stopwatch watch;
+	for(int i = 0; i < iterations; i++) {
+		auto pid = fork();
+		assert(pid >= 0);
+		if(!pid)
+			_exit(0);
+		int status;
+		[[maybe_unused]] auto e = waitpid(pid, &status, 0);
+		assert(e == pid);
+	}
+	return watch.elapsed();
+}
+
+} // anonymous namespace
+
+DEFINE_BENCHMARK(fork_latency, ([] (const benchmark_args &args) {
+	int iterations = args.size() > 0 ? std::atoi(args[0].c_str()) : 100;
+
+	std::vector<void *> areas;
+	for(size_t count : {0, 16, 128, 512}) {
+		// Use distinct protections such that adjacent areas cannot be merged.
+		while(areas.size() < count) {
+			int prot = (areas.size() % 2) ? PROT_READ : PROT_READ | PROT_WRITE;
+			auto p = mmap(nullptr, 0x4000, PROT_READ | PROT_WRITE,
+					MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			assert(p != MAP_FAILED);
+			// Touch the area such that fork() has to copy-on-write it.
+			static_cast<char *>(p)[0] = 1;
+			[[maybe_unused]] auto e = mprotect(p, 0x4000, prot);
+			assert(!e);
+			areas.push_back(p);
+		}
+
+		auto ns = time_fork(iterations);
+		std::cout << "    " << count << " additional mappings: "
+				<< (ns / iterations / 1000) << " us per fork()" << std::endl;
+	}
+
+	for(auto p : areas)
+		munmap(p, 0x4000);
+}))
@@ -0,0 +1,117 @@
+#include <condition_variable>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <hel.h>
+#include <hel-syscalls.h>
+
+#include "testsuite.hpp"
+
+// Measures contended pthread mutexes and condition variables: N threads increment
+// a shared counter under a single mutex, and a producer hands items to N consumers
+// through a condition variable. Since the libc may not use private futexes or
+// wake-N, the mutex is also measured with a lock that calls the hel futex syscalls
+// directly (helFutexWaitBitset() and helFutexWakeBitset() with kHelFutexPrivate).
+// Usage: posix-bench futex [<threads>] [<iterations>]
+
+namespace {
+
+// Mutex from Drepper's "Futexes Are Tricky": 0 = unlocked, 1 = locked,
+// 2 = locked with (potential) waiters.
+struct futex_mutex {
+	void lock() {
+		int c = 0;
+		if(__atomic_compare_exchange_n(&state_, &c, 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+			return;
+		if(c != 2)
+			c = __atomic_exchange_n(&state_, 2, __ATOMIC_ACQUIRE);
+		while(c) {
+			HEL_CHECK(helFutexWaitBitset(&state_, 2, -1, ~uint32_t{0}, kHelFutexPrivate));
+			c = __atomic_exchange_n(&state_, 2, __ATOMIC_ACQUIRE);
+		}
+	}
+
+	void unlock() {
+		if(__atomic_fetch_sub(&state_, 1, __ATOMIC_RELEASE) == 1)
+			return;
+		__atomic_store_n(&state_, 0, __ATOMIC_RELEASE);
+		size_t woken;
+		HEL_CHECK(helFutexWakeBitset(&state_, 1, ~uint32_t{0}, kHelFutexPrivate, &woken));
+	}
+
+private:
+	int state_ = 0;
+};
+
+template<typename Mutex>
+uint64_t time_contended_lock(Mutex &mutex, int num_threads, int iterations) {
+	long counter = 0;
+
+	stopwatch watch;
+	std::vector<std::thread> threads;
+	for(int t = 0; t < num_threads; t++) {
+		threads.emplace_back([&] {
+			for(int i = 0; i < iterations; i++) {
+				std::lock_guard lock{mutex};
+				counter++;
+			}
+		});
+	}
+	for(auto &thread : threads)
+		thread.join();
+	return watch.elapsed();
+}
+
+} // anonymous namespace
+
+DEFINE_BENCHMARK(futex, ([] (const benchmark_args &args) {
+	int num_threads = args.size() > 0 ? std::atoi(args[0].c_str()) : 4;
+	int iterations = args.size() > 1 ? std::atoi(args[1].c_str()) : 100000;
+
+	std::mutex mutex;
+	auto mutex_ns = time_contended_lock(mutex, num_threads, iterations);
+
+	futex_mutex raw_mutex;
+	auto raw_mutex_ns = time_contended_lock(raw_mutex, num_threads, iterations);
+
+	std::condition_variable cv;
+	long produced = 0;
+	long consumed = 0;
+	long total = static_cast<long>(num_threads) * iterations;
+
+	stopwatch cv_watch;
+	{
+		std::vector<std::thread> consumers;
+		for(int t = 0; t < num_threads; t++) {
+			consumers.emplace_back([&] {
+				std::unique_lock lock{mutex};
+				while(true) {
+					cv.wait(lock, [&] { return produced > consumed || consumed == total; });
+					if(consumed == total)
+						break;
+					consumed++;
+				}
+				// Let the remaining consumers exit.
+				cv.notify_all();
+			});
+		}
+		for(long i = 0; i < total; i++) {
+			{
+				std::lock_guard lock{mutex};
+				produced++;
+			}
+			cv.notify_one();
+		}
+		for(auto &consumer : consumers)
+			consumer.join();
+	}
+	auto cv_ns = cv_watch.elapsed();
+
+	std::cout << "    " << num_threads << " threads: "
+			<< (mutex_ns / total) << " ns per contended lock/unlock (libc), "
+			<< (raw_mutex_ns / total) << " ns per contended lock/unlock (private futex), "
+			<< (cv_ns / total) << " ns per condition variable hand-off (libc)" << std::endl;
+}))
@@ -0,0 +1,71 @@
+#include <cassert>
+#include <cstdlib>
+#include <iostream>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+#include "testsuite.hpp"
+
+// Measures the latency of synchronous round trips between two threads
+// (i.e., one thread wakes up the other and then blocks until it gets a reply).
+// This is sensitive to the CPUs that the scheduler picks for woken up threads.
+// Usage: posix-bench ipc_roundtrip [<iterations>]
+
+namespace {
+
+// ping and pong are pairs of connected file descriptors (read end, write end).
+uint64_t time_round_trips(int ping[2], int pong[2], int iterations) {
+	std::thread echo{[&] {
+		char c;
+		for(int i = 0; i < iterations; i++) {
+			[[maybe_unused]] auto n = read(ping[0], &c, 1);
+			assert(n == 1);
+			n = write(pong[1], &c, 1);
+			assert(n == 1);
+		}
+	}};
+
+	stopwatch watch;
+	char c = 'x';
+	for(int i = 0; i < iterations; i++) {
+		[[maybe_unused]] auto n = write(ping[1], &c, 1);
+		assert(n == 1);
+		n = read(pong[0], &c, 1);
+		assert(n == 1);
+	}
+	auto ns = watch.elapsed();
+	echo.join();
+	return ns;
+}
+
+} // anonymous namespace
+
+DEFINE_BENCHMARK(ipc_roundtrip, ([] (const benchmark_args &args) {
+	int iterations = args.size() > 0 ? std::atoi(args[0].c_str()) : 100000;
+
+	int ping[2], pong[2];
+	[[maybe_unused]] int e = pipe(ping);
+	assert(!e);
+	e = pipe(pong);
+	assert(!e);
+	auto pipe_ns = time_round_trips(ping, pong, iterations);
+	close(ping[0]);
+	close(ping[1]);
+	close(pong[0]);
+	close(pong[1]);
+
+	// Both ends of a socket pair are bidirectional.
+	int sv[2];
+	e = socketpair(AF_UNIX, SOCK_STREAM, 0, sv);
+	assert(!e);
+	int forward[2] = {sv[1], sv[0]};
+	int backward[2] = {sv[0], sv[1]};
+	auto socket_ns = time_round_trips(forward, backward, iterations);
+	close(sv[0]);
+	close(sv[1]);
+
+	std::cout << "    " << iterations << " round trips: "
+			<< (pipe_ns / iterations) << " ns per pipe round trip, "
+			<< (socket_ns / iterations) << " ns per socket round trip" << std::endl;
+}))
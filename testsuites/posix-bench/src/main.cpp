@@ -0,0 +1,37 @@
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "testsuite.hpp"
+
+std::vector<abstract_benchmark_case *> &benchmark_case_ptrs() {
+	static std::vector<abstract_benchmark_case *> singleton;
+	return singleton;
+}
+
+void abstract_benchmark_case::register_case(abstract_benchmark_case *bcp) {
+	benchmark_case_ptrs().push_back(bcp);
+}
+
+// Usage: posix-bench [<benchmark> [<args>...]]
+// Without arguments, all benchmarks are run with their default parameters.
+int main(int argc, char **argv) {
+	if(argc < 2) {
+		for(abstract_benchmark_case *bcp : benchmark_case_ptrs()) {
+			std::cout << "posix-bench: Running " << bcp->name() << std::endl;
+			bcp->run({});
+		}
+		return 0;
+	}
+
+	for(abstract_benchmark_case *bcp : benchmark_case_ptrs()) {
+		if(strcmp(bcp->name(), argv[1]))
+			continue;
+		std::cout << "posix-bench: Running " << bcp->name() << std::endl;
+		bcp->run(benchmark_args(argv + 2, argv + argc));
+		return 0;
+	}
+
+	std::cerr << "posix-bench: Unknown benchmark " << argv[1] << std::endl;
+	return 1;
+}
@@ -0,0 +1,63 @@
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <fcntl.h>
+#include <iostream>
+#include <termios.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "testsuite.hpp"
+
+// Measures the throughput of streaming output through a PTY in raw mode
+// (like a terminal multiplexer that relays a build log).
+// Usage: posix-bench pty_stream [<total size>] [<write size>]
+
+DEFINE_BENCHMARK(pty_stream, ([] (const benchmark_args &args) {
+	size_t total_size = args.size() > 0 ? std::strtoull(args[0].c_str(), nullptr, 0) : 64 << 20;
+	size_t write_size = args.size() > 1 ? std::strtoull(args[1].c_str(), nullptr, 0) : 4096;
+
+	int master = posix_openpt(O_RDWR | O_NOCTTY);
+	assert(master >= 0);
+	[[maybe_unused]] int e = grantpt(master);
+	assert(!e);
+	e = unlockpt(master);
+	assert(!e);
+	int slave = open(ptsname(master), O_RDWR | O_NOCTTY);
+	assert(slave >= 0);
+
+	struct termios attrs;
+	e = tcgetattr(slave, &attrs);
+	assert(!e);
+	cfmakeraw(&attrs);
+	e = tcsetattr(slave, TCSANOW, &attrs);
+	assert(!e);
+
+	stopwatch watch;
+	std::thread writer{[&] {
+		std::vector<char> buffer(write_size, 'x');
+		size_t progress = 0;
+		while(progress < total_size) {
+			auto n = write(slave, buffer.data(), std::min(write_size, total_size - progress));
+			assert(n > 0);
+			progress += n;
+		}
+	}};
+
+	std::vector<char> buffer(64 * 1024);
+	size_t progress = 0;
+	while(progress < total_size) {
+		auto n = read(master, buffer.data(), buffer.size());
+		assert(n > 0);
+		progress += n;
+	}
+	auto ns = watch.elapsed();
+	writer.join();
+
+	std::cout << "    " << (total_size >> 20) << " MiB in " << write_size << " byte writes: "
+			<< (total_size * 1'000'000'000 / ns / 1024) << " KiB/s" << std::endl;
+
+	close(slave);
+	close(master);
+}))
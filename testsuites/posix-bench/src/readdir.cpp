@@ -0,0 +1,161 @@
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <iostream>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+#include <async/result.hpp>
+#include <helix/ipc.hpp>
+#include <helix/passthrough-fd.hpp>
+#include <protocols/fs/common.hpp>
+#include <fs.bragi.hpp>
+
+#include "testsuite.hpp"
+
+// Measures the throughput of listing a directory (like ls -f).
+// Usage: posix-bench readdir [<path>] [<number of files>]
+// If the directory does not exist, it is created and populated with empty files
+// (and removed again afterwards).
+// readdir() is compared to sending PT_READ_ENTRIES_BATCH requests directly to the
+// file's passthrough lane (mlibc's readdir() still sends one PT_READ_ENTRIES per entry).
+
+namespace {
+
+// Upper bound on the size of a PT_READ_ENTRIES_BATCH response (see protocols/fs).
+constexpr size_t max_batch_size = 64 * 1024;
+constexpr size_t default_num_files = 10000;
+
+std::string file_name(size_t i) {
+	char buffer[32];
+	snprintf(buffer, sizeof(buffer), "file-%06zu", i);
+	return buffer;
+}
+
+size_t list_directory(const std::string &path) {
+	auto dir = opendir(path.c_str());
+	assert(dir);
+	size_t count = 0;
+	while(readdir(dir))
+		count++;
+	closedir(dir);
+	return count;
+}
+
+struct batch_listing {
+	size_t count = 0;
+	size_t requests = 0;
+};
+
+async::result<batch_listing> list_directory_batched(const std::string &path) {
+	int fd = open(path.c_str(), O_RDONLY | O_DIRECTORY);
+	assert(fd >= 0);
+	auto lane = helix::BorrowedLane{helix::handleForFd(fd)};
+
+	batch_listing result;
+	std::vector<char> entries(max_batch_size);
+	while(true) {
+		managarm::fs::CntRequest req;
+		req.set_req_type(managarm::fs::CntReqType::PT_READ_ENTRIES_BATCH);
+		req.set_size(entries.size());
+
+		auto ser = req.SerializeAsString();
+		auto [offer, send_req, recv_resp, recv_entries] = co_await helix_ng::exchangeMsgs(
+			lane,
+			helix_ng::offer(
+				helix_ng::sendBuffer(ser.data(), ser.size()),
+				helix_ng::recvInline(),
+				helix_ng::recvBuffer(entries.data(), entries.size())
+			)
+		);
+		HEL_CHECK(offer.error());
+		HEL_CHECK(send_req.error());
+		HEL_CHECK(recv_resp.error());
+		result.requests++;
+
+		managarm::fs::SvrResponse resp;
+		resp.ParseFromArray(recv_resp.data(), recv_resp.length());
+		recv_resp.reset();
+		if(resp.error() == managarm::fs::Errors::END_OF_FILE)
+			break;
+		assert(resp.error() == managarm::fs::Errors::SUCCESS);
+		HEL_CHECK(recv_entries.error());
+
+		protocols::fs::DirentReader reader{entries.data(), recv_entries.actualLength()};
+		protocols::fs::DirentHeader header;
+		std::string_view name;
+		while(reader.next(header, name))
+			result.count++;
+	}
+
+	close(fd);
+	co_return result;
+}
+
+} // anonymous namespace
+
+DEFINE_BENCHMARK(readdir, ([] (const benchmark_args &args) {
+	auto path = args.size() > 0 ? args[0] : std::string{"/tmp/posix-bench-readdir"};
+	size_t num_files = args.size() > 1 ? std::strtoull(args[1].c_str(), nullptr, 0)
+			: default_num_files;
+
+	bool populate = mkdir(path.c_str(), 0755) == 0;
+	if(populate) {
+		for(size_t i = 0; i < num_files; i++) {
+			auto file_path = path + "/" + file_name(i);
+			int fd = open(file_path.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0644);
+			assert(fd >= 0);
+			close(fd);
+		}
+	}else if(access(path.c_str(), R_OK)) {
+		std::cout << "    Skipping: cannot access " << path << std::endl;
+		return;
+	}
+
+	// The first pass populates caches.
+	auto count = list_directory(path);
+
+	constexpr int passes = 8;
+	stopwatch watch;
+	for(int i = 0; i < passes; i++) {
+		[[maybe_unused]] auto n = list_directory(path);
+		assert(n == count);
+	}
+	auto ns = watch.elapsed();
+
+	std::cout << "    readdir(): " << count << " entries: "
+			<< (ns / passes / 1000) << " us per listing, "
+			<< (count * passes * 1'000'000'000 / ns) << " entries/s" << std::endl;
+
+	auto first = async::run(list_directory_batched(path), helix::currentDispatcher);
+	if(first.count != count) {
+		std::cout << "    Note: PT_READ_ENTRIES_BATCH returned " << first.count
+				<< " entries, readdir() returned " << count << std::endl;
+	}
+
+	watch = stopwatch{};
+	for(int i = 0; i < passes; i++) {
+		[[maybe_unused]] auto listing = async::run(list_directory_batched(path),
+				helix::currentDispatcher);
+		assert(listing.count == first.count);
+	}
+	ns = watch.elapsed();
+
+	std::cout << "    PT_READ_ENTRIES_BATCH: " << first.count << " entries in "
+			<< first.requests << " requests: "
+			<< (ns / passes / 1000) << " us per listing, "
+			<< (first.count * passes * 1'000'000'000 / ns) << " entries/s" << std::endl;
+
+	if(populate) {
+		for(size_t i = 0; i < num_files; i++) {
+			auto file_path = path + "/" + file_name(i);
+			unlink(file_path.c_str());
+		}
+		rmdir(path.c_str());
+	}
+}))
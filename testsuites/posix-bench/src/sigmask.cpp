@@ -0,0 +1,81 @@
+#include <cassert>
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <unistd.h>
+
+#include <hel-syscalls.h>
+#include <protocols/posix/data.hpp>
+#include <protocols/posix/supercalls.hpp>
+
+#include "testsuite.hpp"
+
+// Measures the cost of blocking and unblocking signals around a critical section
+// (as done by many locking implementations) and of gettid().
+// The libc functions are compared to accessing the thread page directly
+// (the libc may still issue superSigMask and superGetTid supercalls).
+// Usage: posix-bench sigmask [<iterations>]
+
+namespace {
+
+posix::ThreadPage *thread_page() {
+	posix::ManagarmProcessData data;
+	HEL_CHECK(helSyscall1(kHelCallSuper + posix::superGetProcessData,
+			reinterpret_cast<HelWord>(&data)));
+	return static_cast<posix::ThreadPage *>(data.threadPage);
+}
+
+// Sets the signal mask in the thread page (see posix::ThreadPage) and returns the former mask.
+uint64_t set_page_mask(posix::ThreadPage *page, uint64_t mask) {
+	auto former = __atomic_exchange_n(&page->signalMask, mask, __ATOMIC_SEQ_CST);
+	if(former & ~mask & __atomic_load_n(&page->pendingSignals, __ATOMIC_SEQ_CST))
+		HEL_CHECK(helSyscall0(kHelCallSuper + posix::superSigRaise));
+	return former;
+}
+
+} // anonymous namespace
+
+DEFINE_BENCHMARK(sigmask, ([] (const benchmark_args &args) {
+	int iterations = args.size() > 0 ? std::atoi(args[0].c_str()) : 100000;
+
+	sigset_t all, former;
+	sigfillset(&all);
+
+	stopwatch mask_watch;
+	for(int i = 0; i < iterations; i++) {
+		[[maybe_unused]] auto e = sigprocmask(SIG_BLOCK, &all, &former);
+		assert(!e);
+		e = sigprocmask(SIG_SETMASK, &former, nullptr);
+		assert(!e);
+	}
+	auto mask_ns = mask_watch.elapsed();
+
+	stopwatch tid_watch;
+	for(int i = 0; i < iterations; i++) {
+		[[maybe_unused]] auto tid = gettid();
+		assert(tid > 0);
+	}
+	auto tid_ns = tid_watch.elapsed();
+
+	auto page = thread_page();
+	assert(__atomic_load_n(&page->tid, __ATOMIC_RELAXED) == gettid());
+
+	stopwatch page_mask_watch;
+	for(int i = 0; i < iterations; i++) {
+		auto former_mask = set_page_mask(page, ~uint64_t{0});
+		set_page_mask(page, former_mask);
+	}
+	auto page_mask_ns = page_mask_watch.elapsed();
+
+	stopwatch page_tid_watch;
+	for(int i = 0; i < iterations; i++) {
+		[[maybe_unused]] auto tid = __atomic_load_n(&page->tid, __ATOMIC_RELAXED);
+		assert(tid > 0);
+	}
+	auto page_tid_ns = page_tid_watch.elapsed();
+
+	std::cout << "    libc: " << (mask_ns / iterations / 2) << " ns per sigprocmask(), "
+			<< (tid_ns / iterations) << " ns per gettid()" << std::endl;
+	std::cout << "    thread page: " << (page_mask_ns / iterations / 2) << " ns per mask change, "
+			<< (page_tid_ns / iterations) << " ns per TID read" << std::endl;
+}))
@@ -0,0 +1,131 @@
+#include <cassert>
+#include <cstdlib>
+#include <fcntl.h>
+#include <iostream>
+#include <spawn.h>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <async/result.hpp>
+#include <bragi/helpers-std.hpp>
+#include <hel-syscalls.h>
+#include <helix/ipc.hpp>
+#include <protocols/posix/data.hpp>
+#include <protocols/posix/supercalls.hpp>
+#include <posix.bragi.hpp>
+
+#include "testsuite.hpp"
+
+extern char **environ;
+
+// Measures the latency of starting a short-lived program (like system() or
+// a shell pipeline does) using fork(), vfork() and posix_spawn() of the libc,
+// and by sending a SpawnRequest to posix directly.
+// Note that the libc may implement vfork() and posix_spawn() on top of fork()
+// (i.e., without using the superVfork supercall or the SpawnRequest).
+// Usage: posix-bench spawn_latency [<program>] [<iterations>]
+
+namespace {
+
+template<typename F>
+uint64_t time_spawn(int iterations, F start) {
+	stopwatch watch;
+	for(int i = 0; i < iterations; i++) {
+		pid_t pid = start();
+		assert(pid > 0);
+		int status;
+		[[maybe_unused]] auto e = waitpid(pid, &status, 0);
+		assert(e == pid);
+		assert(WIFEXITED(status) && !WEXITSTATUS(status));
+	}
+	return watch.elapsed();
+}
+
+helix::BorrowedLane posix_lane() {
+	posix::ManagarmProcessData data;
+	HEL_CHECK(helSyscall1(kHelCallSuper + posix::superGetProcessData,
+			reinterpret_cast<HelWord>(&data)));
+	return helix::BorrowedLane{data.posixLane};
+}
+
+// Sends a SpawnRequest with the same file action as the posix_spawn() measurement.
+async::result<pid_t> spawn_request(const std::string &program) {
+	managarm::posix::SpawnRequest req;
+	req.set_path(program);
+	req.add_args(program);
+	for(auto env = environ; *env; env++)
+		req.add_env(*env);
+	req.add_action_types(managarm::posix::SpawnActionType::OPEN);
+	req.add_action_fds(0);
+	req.add_action_new_fds(-1);
+	req.add_action_flags(managarm::posix::OpenFlags::OF_RDONLY);
+	req.add_action_modes(0);
+	req.add_action_paths("/dev/null");
+
+	auto [offer, send_head, send_tail, recv_resp] = co_await helix_ng::exchangeMsgs(
+		posix_lane(),
+		helix_ng::offer(
+			helix_ng::sendBragiHeadTail(req, frg::stl_allocator{}),
+			helix_ng::recvInline()
+		)
+	);
+	HEL_CHECK(offer.error());
+	HEL_CHECK(send_head.error());
+	HEL_CHECK(send_tail.error());
+	HEL_CHECK(recv_resp.error());
+
+	auto resp = bragi::parse_head_only<managarm::posix::SpawnResponse>(recv_resp);
+	recv_resp.reset();
+	assert(resp);
+	assert(resp->error() == managarm::posix::Errors::SUCCESS);
+	co_return resp->pid();
+}
+
+} // anonymous namespace
+
+DEFINE_BENCHMARK(spawn_latency, ([] (const benchmark_args &args) {
+	auto program = args.size() > 0 ? args[0] : std::string{"/usr/bin/true"};
+	int iterations = args.size() > 1 ? std::atoi(args[1].c_str()) : 100;
+	char *argv[] = {program.data(), nullptr};
+
+	auto fork_ns = time_spawn(iterations, [&] {
+		auto pid = fork();
+		if(!pid) {
+			execve(argv[0], argv, environ);
+			_exit(127);
+		}
+		return pid;
+	});
+
+	auto vfork_ns = time_spawn(iterations, [&] {
+		auto pid = vfork();
+		if(!pid) {
+			execve(argv[0], argv, environ);
+			_exit(127);
+		}
+		return pid;
+	});
+
+	// Redirect stdin such that the file actions are part of the measurement.
+	posix_spawn_file_actions_t actions;
+	posix_spawn_file_actions_init(&actions);
+	posix_spawn_file_actions_addopen(&actions, 0, "/dev/null", O_RDONLY, 0);
+	auto spawn_ns = time_spawn(iterations, [&] {
+		pid_t pid;
+		[[maybe_unused]] auto e = posix_spawn(&pid, argv[0], &actions, nullptr, argv, environ);
+		assert(!e);
+		return pid;
+	});
+	posix_spawn_file_actions_destroy(&actions);
+
+	auto request_ns = time_spawn(iterations, [&] {
+		return async::run(spawn_request(program), helix::currentDispatcher);
+	});
+
+	std::cout << "    " << program << ": "
+			<< (fork_ns / iterations / 1000) << " us per fork() + execve(), "
+			<< (vfork_ns / iterations / 1000) << " us per vfork() + execve(), "
+			<< (spawn_ns / iterations / 1000) << " us per posix_spawn(), "
+			<< (request_ns / iterations / 1000) << " us per SpawnRequest" << std::endl;
+}))
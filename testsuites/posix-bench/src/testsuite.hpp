@@ -0,0 +1,67 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#define DEFINE_BENCHMARK(s, f) \
+	static benchmark_case bench_ ## s{#s, f};
+
+// Benchmarks receive the command line arguments that follow their name.
+using benchmark_args = std::vector<std::string>;
+
+struct abstract_benchmark_case {
+private:
+	static void register_case(abstract_benchmark_case *bcp);
+
+public:
+	abstract_benchmark_case(const char *name)
+	: name_{name} {
+		register_case(this);
+	}
+
+	abstract_benchmark_case(const abstract_benchmark_case &) = delete;
+
+	virtual ~abstract_benchmark_case() = default;
+
+	abstract_benchmark_case &operator= (const abstract_benchmark_case &) = delete;
+
+	const char *name() {
+		return name_;
+	}
+
+	virtual void run(const benchmark_args &args) = 0;
+
+private:
+	const char *name_;
+};
+
+template<typename F>
+struct benchmark_case : abstract_benchmark_case {
+	benchmark_case(const char *name, F functor)
+	: abstract_benchmark_case{name}, functor_{std::move(functor)} { }
+
+	void run(const benchmark_args &args) override {
+		functor_(args);
+	}
+
+private:
+	F functor_;
+};
+
+// Measures wall clock time in nanoseconds.
+struct stopwatch {
+	using clock = std::chrono::steady_clock;
+
+	stopwatch()
+	: ref_{clock::now()} { }
+
+	uint64_t elapsed() {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - ref_).count();
+	}
+
+private:
+	std::chrono::time_point<clock> ref_;
+};
@@ -2,6 +2,8 @@
 
 import os
 import shutil
+import stat
+import struct
 import subprocess
 import tempfile
 import sys
@@ -11,6 +13,10 @@ parser = argparse.ArgumentParser(description = 'Generate a managarm initrd')
 parser.add_argument('-t', '--triple', dest = 'arch',
 		choices = ['x86_64-managarm', 'aarch64-managarm', 'riscv64-managarm'], default = 'x86_64-managarm',
 		help = 'Target system triple (default: x86_64-managarm)')
+parser.add_argument('--align', dest = 'align', type = int, default = 0x1000,
+		help = 'Alignment of file data in the archive (default: 4096, 0 disables alignment)')
+parser.add_argument('--compress', dest = 'compress', action = 'store_true',
+		help = 'Compress files; thor decompresses them on demand')
 
 args = parser.parse_args()
 
@@ -99,7 +105,7 @@ for fname in os.listdir('system-root/usr/lib/managarm/server'):
 		continue
 	add_file('system-root/usr/lib/managarm/server', 'usr/lib/managarm/server', fname)
 
-# Copy (= hard link) the files to a temporary directory, run GNU cpio.
+# Copy (= hard link) the files to a temporary directory.
 
 tree_path = tempfile.mkdtemp(prefix='initrd-', dir='.')
 
@@ -115,14 +121,122 @@ for rel_path in file_list:
 	else:
 		os.link(entry.source, dest_path)
 
-proc = subprocess.Popen(['cpio', '--create', '--format=newc',
-			'-D', tree_path,
-			'--file', 'initrd.cpio',
-			'--quiet'],
-		stdin=subprocess.PIPE,
-		encoding='ascii')
-proc.communicate(input='\n'.join(file_list))
-if proc.returncode != 0:
-	sys.exit(1)
+# Compression in the format that thor expects (see kernel/common/compressed-module.hpp).
+# Files are split into chunks that are compressed independently using the LZ4 block
+# format; this allows thor to decompress only the pages that are actually accessed.
+
+compressed_magic = b'\x89MZ4'
+chunk_shift = 16
+
+try:
+	import lz4.block
+	def compress_block(data):
+		return lz4.block.compress(data, store_size=False)
+except ImportError:
+	# Simple greedy compressor. It is much slower and compresses slightly worse than
+	# liblz4 but produces valid LZ4 blocks.
+	def compress_block(data):
+		out = bytearray()
+		table = dict()
+
+		def emit(literals, offset, match_length):
+			lit_len = len(literals)
+			token_lit = min(lit_len, 15)
+			token_match = 0 if match_length is None else min(match_length - 4, 15)
+			out.append((token_lit << 4) | token_match)
+			if lit_len >= 15:
+				n = lit_len - 15
+				while n >= 255:
+					out.append(255)
+					n -= 255
+				out.append(n)
+			out.extend(literals)
+			if match_length is None:
+				return
+			out.extend(struct.pack('<H', offset))
+			if match_length - 4 >= 15:
+				n = match_length - 4 - 15
+				while n >= 255:
+					out.append(255)
+					n -= 255
+				out.append(n)
+
+		# The last match must start at least 12 bytes before the end of the block
+		# and the last 5 bytes are always literals.
+		match_limit = len(data) - 12
+		end_limit = len(data) - 5
+		anchor = 0
+		i = 0
+		while i < match_limit:
+			key = data[i:i + 4]
+			candidate = table.get(key)
+			table[key] = i
+			if candidate is None or i - candidate > 0xFFFF:
+				i += 1
+				continue
+			length = 4
+			while i + length < end_limit and data[candidate + length] == data[i + length]:
+				length += 1
+			emit(data[anchor:i], i - candidate, length)
+			i += length
+			anchor = i
+		emit(data[anchor:], None, None)
+		return bytes(out)
+
+def compress_file(data):
+	chunk_size = 1 << chunk_shift
+	num_chunks = (len(data) + chunk_size - 1) // chunk_size
+	chunks = []
+	for i in range(num_chunks):
+		raw = data[i * chunk_size:(i + 1) * chunk_size]
+		packed = compress_block(raw)
+		# Chunks that do not shrink are stored verbatim.
+		chunks.append(packed if len(packed) < len(raw) else raw)
+	offset = 24 + (num_chunks + 1) * 4
+	offsets = [offset]
+	for chunk in chunks:
+		offset += len(chunk)
+		offsets.append(offset)
+	header = compressed_magic + struct.pack('<IQII', chunk_shift, len(data), num_chunks, 0)
+	return header + struct.pack(f'<{num_chunks + 1}I', *offsets) + b''.join(chunks)
+
+# Write the archive in the "newc" format (as GNU cpio does).
+# Thor maps file data in place if it is page aligned. To align the data, we pad the
+# file name with NUL bytes; the name size in the header includes the padding.
+
+def write_entry(f, ino, mode, nlink, mtime, name, data):
+	encoded = name.encode('ascii') + b'\0'
+	offset = f.tell()
+	name_size = len(encoded)
+	if args.align and len(data) >= args.align:
+		data_offset = offset + 110 + name_size
+		data_offset = (data_offset + args.align - 1) & ~(args.align - 1)
+		name_size = data_offset - offset - 110
+	fields = [ino, mode, 0, 0, nlink, mtime, len(data), 0, 0, 0, 0, name_size, 0]
+	f.write(b'070701' + b''.join(f'{v:08X}'.encode('ascii') for v in fields))
+	f.write(encoded.ljust(name_size, b'\0'))
+	f.write(b'\0' * (-f.tell() % 4))
+	f.write(data)
+	f.write(b'\0' * (-f.tell() % 4))
+
+with open('initrd.cpio', 'wb') as f:
+	for ino, rel_path in enumerate(file_list, start=1):
+		st = os.lstat(os.path.join(tree_path, rel_path))
+		data = b''
+		if stat.S_ISREG(st.st_mode):
+			with open(os.path.join(tree_path, rel_path), 'rb') as src:
+				data = src.read()
+			# Eir loads the kernel from the initrd, hence it is never compressed.
+			if args.compress and rel_path != 'thor' and data:
+				compressed = compress_file(data)
+				if len(compressed) < len(data):
+					# Thor keeps page aligned compressed data in place, hence we align it as usual.
+					data = compressed
+		nlink = 2 if stat.S_ISDIR(st.st_mode) else 1
+		write_entry(f, ino, st.st_mode, nlink, int(st.st_mtime), rel_path, data)
+	write_entry(f, 0, 0, 1, 0, 'TRAILER!!!', b'')
+	# Thor only uses the last file in place if its last page is part of the archive.
+	if args.align:
+		f.write(b'\0' * (-f.tell() % args.align))
 
 shutil.rmtree(tree_path)
@@ -0,0 +1,132 @@
+#include <CLI/App.hpp>
+#include <CLI/Formatter.hpp>
+#include <CLI/Config.hpp>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include <compressed-module.hpp>
+
+// Measures how fast thor decompresses the files of an initrd that was generated
+// by gen-initrd.py --compress. Thor uses the same decoder (compressed-module.hpp).
+
+namespace {
+
+uint32_t parseHex(const char *c, int n) {
+	uint32_t v = 0;
+	for(int i = 0; i < n; i++)
+		v = (v << 4) | (c[i] <= '9' ? c[i] - '0' : (c[i] | 0x20) - 'a' + 10);
+	return v;
+}
+
+struct File {
+	std::string path;
+	const char *data;
+	size_t size;
+};
+
+// Parses a "newc" archive. Name sizes may include NUL padding (see gen-initrd.py).
+std::vector<File> parseArchive(const std::vector<char> &archive) {
+	constexpr size_t headerSize = 110;
+	constexpr uint32_t regularType = 0100000;
+
+	std::vector<File> files;
+	size_t p = 0;
+	while(p + headerSize <= archive.size()) {
+		auto header = archive.data() + p;
+		auto mode = parseHex(header + 14, 8);
+		auto fileSize = parseHex(header + 54, 8);
+		auto nameSize = parseHex(header + 94, 8);
+		std::string path{header + headerSize};
+		if(path == "TRAILER!!!")
+			break;
+
+		auto data = (p + headerSize + nameSize + 3) & ~size_t{3};
+		if(data + fileSize > archive.size())
+			throw std::runtime_error("truncated archive");
+		if((mode & 0170000) == regularType)
+			files.push_back({path, archive.data() + data, fileSize});
+		p = (data + fileSize + 3) & ~size_t{3};
+	}
+	return files;
+}
+
+} // anonymous namespace
+
+int main(int argc, char **argv) {
+	std::string input{"initrd.cpio"};
+	int iterations = 10;
+
+	CLI::App app{"initrd-bench: measure decompression of compressed initrd files"};
+	app.add_option("input", input, "Path to the initrd (default: initrd.cpio)");
+	app.add_option("-n,--iterations", iterations, "Number of iterations (default: 10)")
+		->check(CLI::PositiveNumber);
+	CLI11_PARSE(app, argc, argv);
+
+	std::ifstream in{input, std::ios::binary};
+	if(!in) {
+		std::cerr << "initrd-bench: Could not open " << input << std::endl;
+		return 1;
+	}
+	std::vector<char> archive{std::istreambuf_iterator<char>{in}, {}};
+
+	auto start = std::chrono::steady_clock::now();
+	auto files = parseArchive(archive);
+	auto parseTime = std::chrono::steady_clock::now() - start;
+
+	size_t totalCompressed = 0;
+	size_t totalRaw = 0;
+	size_t numChunks = 0;
+	std::chrono::nanoseconds decompressTime{};
+	std::vector<uint8_t> buffer;
+	for(auto &file : files) {
+		CompressedModuleHeader header;
+		if(!parseCompressedModule(file.data, file.size, &header)) {
+			totalCompressed += file.size;
+			totalRaw += file.size;
+			continue;
+		}
+
+		size_t chunkSize = size_t{1} << header.chunkShift;
+		buffer.resize(chunkSize);
+		auto fileStart = std::chrono::steady_clock::now();
+		for(int it = 0; it < iterations; it++) {
+			for(size_t i = 0; i < header.numChunks; i++) {
+				auto rawSize = std::min(chunkSize, header.size - i * chunkSize);
+				const uint8_t *chunk;
+				size_t length;
+				getCompressedChunk(file.data, i, &chunk, &length);
+				if(length == rawSize)
+					continue;
+				if(decompressLz4Block(chunk, length, buffer.data(), rawSize)
+						!= static_cast<ptrdiff_t>(rawSize)) {
+					std::cerr << "initrd-bench: Corrupted chunk " << i
+							<< " in " << file.path << std::endl;
+					return 1;
+				}
+			}
+		}
+		decompressTime += (std::chrono::steady_clock::now() - fileStart) / iterations;
+
+		std::cout << file.path << ": " << header.size << " -> " << file.size
+				<< " bytes (" << (100 * file.size / header.size) << "%)" << std::endl;
+		totalCompressed += file.size;
+		totalRaw += header.size;
+		numChunks += header.numChunks;
+	}
+
+	auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(decompressTime).count();
+	std::cout << "Archive parsed in "
+			<< std::chrono::duration_cast<std::chrono::microseconds>(parseTime).count()
+			<< " us" << std::endl;
+	std::cout << "Total: " << totalRaw << " -> " << totalCompressed << " bytes, "
+			<< numChunks << " chunks" << std::endl;
+	if(ns) {
+		std::cout << "Decompressing everything takes " << ns / 1000 << " us ("
+				<< (totalRaw * 1000 / ns) << " MB/s, "
+				<< ns / std::max(numChunks, size_t{1}) / 1000 << " us per chunk)" << std::endl;
+	}
+	return 0;
+}
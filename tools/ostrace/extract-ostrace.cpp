@@ -4,6 +4,14 @@
 #include <sys/stat.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <format>
+#include <iostream>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
 #include <bragi/helpers-std.hpp>
 #include <CLI/App.hpp>
 #include <CLI/Formatter.hpp>
@@ -227,14 +235,146 @@ private:
 	std::map<bragi_msg_metadata, std::pair<size_t, size_t>> requests_;
 };
 
+// Reconstructs the boot timeline from the runsvr.launch events that runsvr emits.
+struct BootPolicy {
+	struct Launch {
+		std::string server;
+		std::map<std::string, uint64_t> times;
+
+		uint64_t time(const char *name) const {
+			auto it = times.find(name);
+			if(it == times.end())
+				return 0;
+			return it->second;
+		}
+
+		// Time at which the server's dependencies were available.
+		uint64_t ready() const {
+			return std::max(time("start"), time("dependency"));
+		}
+
+		// Time at which the server was up (i.e., served its first request, if any).
+		uint64_t done() const {
+			return std::max(time("launched"), time("bound"));
+		}
+	};
+
+	bool onEvent(managarm::ostrace::EventRecord &record, size_t) {
+		inLaunch_ = terms.at(record.id()) == "runsvr.launch";
+		if(inLaunch_)
+			current_ = {};
+		return true;
+	}
+
+	bool onDefinition(managarm::ostrace::Definition &, size_t) {
+		return true;
+	}
+
+	bool onEndOfRecord(size_t) {
+		if(inLaunch_)
+			launches_.push_back(std::move(current_));
+		inLaunch_ = false;
+		return true;
+	}
+
+	bool onUintAttribute(managarm::ostrace::UintAttribute &record, size_t) {
+		if(inLaunch_)
+			current_.times[terms.at(record.id())] = record.v();
+		return true;
+	}
+
+	bool onBufferAttribute(managarm::ostrace::BufferAttribute &record, size_t) {
+		if(inLaunch_ && terms.at(record.id()) == "server")
+			current_.server.assign(record.buffer().begin(), record.buffer().end());
+		return true;
+	}
+
+	size_t passes() {
+		return 1;
+	}
+
+	void reset() {
+		launches_.clear();
+		inLaunch_ = false;
+	}
+
+	void report() {
+		if(launches_.empty()) {
+			std::cout << "No runsvr.launch events found (was runsvr run with --trace?)\n";
+			return;
+		}
+
+		std::ranges::sort(launches_, [] (const Launch &a, const Launch &b) {
+			return a.time("start") < b.time("start");
+		});
+
+		auto ms = [] (uint64_t ns) {
+			return std::format("{:9.3f}", ns / 1e6);
+		};
+
+		std::cout << "    start    ready     done  server\n";
+		for(auto &launch : launches_)
+			std::cout << ms(launch.time("start")) << ms(launch.ready())
+					<< ms(launch.done()) << "  " << launch.server << "\n";
+
+		// The critical path ends at the server that is up last. The predecessor of a
+		// server is the server that was up last before the server's dependencies
+		// were available. Servers that neither waited for dependencies nor were
+		// bound to a device (i.e., servers that init starts right away) end the path.
+		std::vector<const Launch *> path;
+		auto last = std::ranges::max_element(launches_, {}, &Launch::done);
+		for(const Launch *launch = &*last; launch; ) {
+			path.push_back(launch);
+			if(!launch->time("dependency") && !launch->time("bound"))
+				break;
+
+			const Launch *predecessor = nullptr;
+			for(auto &candidate : launches_) {
+				if(&candidate == launch || candidate.done() > launch->ready())
+					continue;
+				if(!predecessor || candidate.done() > predecessor->done())
+					predecessor = &candidate;
+			}
+			launch = predecessor;
+		}
+
+		std::cout << "\nCritical path (times in ms):\n";
+		// init currently starts all servers without --wait-for; the path then only
+		// consists of servers that were bound to devices.
+		if(std::ranges::none_of(launches_, [] (const Launch &launch) {
+			return launch.time("dependency") != 0;
+		}))
+			std::cout << "  (no server waited for dependencies)\n";
+		for(auto it = path.rbegin(); it != path.rend(); ++it) {
+			auto launch = *it;
+			std::cout << "  " << launch->server
+					<< ": waited " << ms(launch->ready() - launch->time("start"))
+					<< ", started " << ms(launch->time("launched") - launch->ready());
+			if(launch->time("bound"))
+				std::cout << ", first request " << ms(launch->time("bound") - launch->time("launched"));
+			std::cout << ", up at " << ms(launch->done()) << "\n";
+		}
+	}
+
+	std::unordered_map<uint64_t, std::string> terms;
+	size_t parsedRecords;
+
+private:
+	std::vector<Launch> launches_;
+	Launch current_;
+	bool inLaunch_ = false;
+};
+
 } // namespace
 
 int main(int argc, char **argv) {
 	std::string path{"virtio-trace.bin"};
 	bool pcap = false;
+	bool boot = false;
 
 	CLI::App app{"extract-ostrace: extract records from ostrace logs"};
 	app.add_flag("--pcap", pcap, "Produce a bragi.pcap");
+	app.add_flag("--boot", boot, "Show the boot timeline and its critical path");
 	app.add_option("path", path, "Path to the input file");
 	CLI11_PARSE(app, argc, argv);
 
@@ -389,6 +529,10 @@ int main(int argc, char **argv) {
 	if(pcap) {
 		auto policy = WiresharkPolicy{};
 		parseWithPolicy(policy, fileBuffer);
+	} else if(boot) {
+		auto policy = BootPolicy{};
+		parseWithPolicy(policy, fileBuffer);
+		policy.report();
 	} else {
 		auto policy = JsonPolicy{};
 		parseWithPolicy(policy, fileBuffer);
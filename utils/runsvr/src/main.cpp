@@ -7,7 +7,9 @@
 #include <async/oneshot-event.hpp>
 #include <bragi/helpers-std.hpp>
 #include <helix/memory.hpp>
+#include <helix/timer.hpp>
 #include <protocols/mbus/client.hpp>
+#include <protocols/ostrace/ostrace.hpp>
 #include <svrctl.bragi.hpp>
 
 #include <CLI/CLI.hpp>
@@ -74,6 +76,114 @@ static std::vector<std::byte> readEntireFile(const char *path) {
 	return buffer;
 }
 
+// ----------------------------------------------------------------------------
+// Boot tracing.
+// ----------------------------------------------------------------------------
+
+// Each launch emits one runsvr.launch event. All times are in nanoseconds since boot.
+//   start: runsvr was started.
+//   dependency: all mbus dependencies (see --wait-for) were found (zero if there are none).
+//   launched: the server was started by the kernel.
+//   bound: the server replied to the DeviceBindRequest (zero if not applicable).
+// tools/ostrace (extract-ostrace --boot) turns these events into a boot timeline.
+constinit protocols::ostrace::Event ostEvtLaunch{"runsvr.launch"};
+constinit protocols::ostrace::StringAttribute ostAttrServer{"server"};
+constinit protocols::ostrace::UintAttribute ostAttrStart{"start"};
+constinit protocols::ostrace::UintAttribute ostAttrDependency{"dependency"};
+constinit protocols::ostrace::UintAttribute ostAttrLaunched{"launched"};
+constinit protocols::ostrace::UintAttribute ostAttrBound{"bound"};
+constinit protocols::ostrace::UintAttribute ostAttrMbusId{"mbusId"};
+
+protocols::ostrace::Vocabulary ostVocabulary{
+	ostEvtLaunch,
+	ostAttrServer,
+	ostAttrStart,
+	ostAttrDependency,
+	ostAttrLaunched,
+	ostAttrBound,
+	ostAttrMbusId,
+};
+
+protocols::ostrace::Context ostContext{ostVocabulary};
+
+struct LaunchTimes {
+	uint64_t start = 0;
+	uint64_t dependency = 0;
+	uint64_t launched = 0;
+	uint64_t bound = 0;
+};
+
+uint64_t currentClock() {
+	uint64_t now;
+	HEL_CHECK(helGetClock(&now));
+	return now;
+}
+
+async::result<void> traceLaunch(const std::string &server, const LaunchTimes &times,
+		int64_t mbusId) {
+	co_await ostContext.create();
+	ostContext.emitWithTimestamp(ostEvtLaunch, times.start,
+			ostAttrServer(server),
+			ostAttrStart(times.start),
+			ostAttrDependency(times.dependency),
+			ostAttrLaunched(times.launched),
+			ostAttrBound(times.bound),
+			ostAttrMbusId(mbusId));
+	co_await ostContext.flush();
+}
+
+// ----------------------------------------------------------------------------
+// mbus dependencies.
+// ----------------------------------------------------------------------------
+
+// Waits until an entity that has all of the given properties appears in mbus.
+// Gives up after timeout nanoseconds (if non-zero). Returns false on timeout.
+async::result<bool> waitForEntity(const std::vector<std::string> &properties,
+		uint64_t timeout) {
+	std::vector<mbus_ng::AnyFilter> operands;
+	for(auto &property : properties) {
+		auto equals = property.find('=');
+		if(equals == std::string::npos)
+			throw std::runtime_error(std::format("Invalid dependency '{}'", property));
+		operands.push_back(mbus_ng::EqualsFilter{property.substr(0, equals),
+				property.substr(equals + 1)});
+	}
+
+	// Enumeration cannot be cancelled; the waiters are simply abandoned
+	// (runsvr exits soon after the launch anyway).
+	struct State {
+		bool done = false;
+		bool found = false;
+		async::oneshot_event event;
+	};
+	auto state = std::make_shared<State>();
+
+	async::detach([] (mbus_ng::AnyFilter filter,
+			std::shared_ptr<State> state) -> async::result<void> {
+		auto enumerator = mbus_ng::Instance::global().enumerate(std::move(filter));
+		(co_await enumerator.nextEvents()).unwrap();
+		if(state->done)
+			co_return;
+		state->done = true;
+		state->found = true;
+		state->event.raise();
+	}(mbus_ng::Conjunction{std::move(operands)}, state));
+
+	if(timeout) {
+		async::detach([] (uint64_t timeout,
+				std::shared_ptr<State> state) -> async::result<void> {
+			co_await helix::sleepFor(timeout);
+			if(state->done)
+				co_return;
+			state->done = true;
+			state->event.raise();
+		}(timeout, state));
+	}
+
+	co_await state->event.wait();
+	co_return state->found;
+}
+
 // ----------------------------------------------------------------------------
 // svrctl handling.
 // ----------------------------------------------------------------------------
@@ -194,13 +304,33 @@ enum class action {
 	runsvr, run, bind, upload
 };
 
-async::result<int> asyncMain(action act, std::string path) {
+struct Options {
+	std::vector<std::string> waitFor;
+	uint64_t waitTimeout = 0;
+	bool trace = false;
+};
+
+async::result<int> asyncMain(action act, std::string path, Options options) {
+	LaunchTimes times;
+	times.start = currentClock();
+	std::string server = path;
+	int64_t mbusId = -1;
+
+	// Wait for mbus dependencies before doing anything else.
+	// This allows init to start all servers at once.
+	if(!options.waitFor.empty()) {
+		if(!co_await waitForEntity(options.waitFor, options.waitTimeout))
+			log("runsvr: Timeout while waiting for dependencies of %s\n", path.c_str());
+		times.dependency = currentClock();
+	}
+
 	co_await enumerateSvrctl();
 
 	switch (act) {
 		case action::runsvr: {
 			log("runsvr: Running %s\n", path.c_str());
 			co_await runServer(path.c_str());
+			times.launched = currentClock();
 
 			break;
 		}
@@ -214,11 +344,13 @@ async::result<int> asyncMain(action act, std::string path) {
 			desc.decode_body(rd, deser);
 
 			log("runsvr: Running %s\n", desc.name().c_str());
+			server = desc.name();
 
 			for(auto &file : desc.files())
 				co_await uploadFile(file.path().c_str());
 
 			co_await runServer(desc.exec().c_str());
+			times.launched = currentClock();
 
 			break;
 		}
@@ -233,12 +365,16 @@ async::result<int> asyncMain(action act, std::string path) {
 
 			auto id_str = getenv("MBUS_ID");
 			log("runsvr: Binding driver %s to mbus ID %s\n", desc.name().c_str(), id_str);
+			server = desc.name();
+			mbusId = std::stoi(id_str);
 
 			for(auto &file : desc.files())
 				co_await uploadFile(file.path().c_str());
 
 			auto lane = co_await runServer(desc.exec().c_str());
-			co_await bindServer(lane, std::stoi(id_str));
+			times.launched = currentClock();
+			co_await bindServer(lane, mbusId);
+			times.bound = currentClock();
 
 			break;
 		}
@@ -256,6 +392,9 @@ async::result<int> asyncMain(action act, std::string path) {
 		}
 	}
 
+	if(options.trace && act != action::upload)
+		co_await traceLaunch(server, times, mbusId);
+
 	co_return 0;
 }
 
@@ -265,9 +404,16 @@ int main(int argc, const char **argv) {
 	bool do_fork = false;
 	std::string path;
 	action act;
+	Options options;
+	uint64_t waitTimeoutMs = 0;
 
 	CLI::App app{"runsvr"};
 	app.add_flag("-f,--fork", do_fork, "Fork off before continuing");
+	app.add_option("-w,--wait-for", options.waitFor,
+			"Wait for an mbus entity with the given property (key=value) before starting");
+	app.add_option("--wait-timeout", waitTimeoutMs,
+			"Start anyway after this many milliseconds (default: wait forever)");
+	app.add_flag("-t,--trace", options.trace, "Record the launch in ostrace");
 
 	CLI::App *sub_runsvr = app.add_subcommand("runsvr", "Run a server (deprecated)");
 	sub_runsvr->add_option("path", path, "Path to executable")->required();
@@ -310,5 +456,7 @@ int main(int argc, const char **argv) {
 		mbus_ng::recreateInstance();
 	}
 
-	return async::run(asyncMain(act, std::move(path)), helix::currentDispatcher);
+	options.waitTimeout = waitTimeoutMs * 1'000'000;
+	return async::run(asyncMain(act, std::move(path), std::move(options)),
+			helix::currentDispatcher);
 }